@@ -62,9 +62,39 @@ struct CoordinatorSensorSnapshot {
     bool mmWaveOnline = false;
     int16_t wifiRssi = -127;
     bool wifiConnected = false;
+    // ESP-NOW RX hand-off ring (see EspNow::getRxQueueStats)
+    uint32_t espNowRxDropped = 0;
+    uint32_t espNowRxHighWater = 0;
     uint32_t timestampMs = 0;
 };
 
+// Radio link to a node as the coordinator sees it (see LinkQuality)
+struct LinkReport {
+    float rssiDbm = -127.0f;  // moving average of received frames
+    int8_t lastRssi = -127;
+    float per = 0.0f;         // moving average of unicast send failures
+    const char* rate = "1M";  // PHY rate unicast frames to the node use
+    uint32_t sent = 0;        // unicast send callbacks
+    uint32_t failed = 0;
+    uint32_t received = 0;
+    uint32_t lastSeenMs = 0;
+};
+
+// Per-node set_light delivery, from acks matched by cmd_id (see CommandTracker)
+struct CommandDeliveryStats {
+    static constexpr size_t LATENCY_BUCKETS = 8;
+    static constexpr uint16_t BUCKET_LIMIT_MS[LATENCY_BUCKETS - 1] = {10, 25, 50, 100, 250, 500, 1000};
+    uint32_t commands = 0;     // distinct commands sent
+    uint32_t delivered = 0;    // acked before ttl_ms
+    uint32_t expired = 0;      // no ack within ttl_ms
+    uint32_t superseded = 0;   // replaced by a newer command before an ack
+    uint32_t retransmits = 0;
+    // First send -> ack, per BUCKET_LIMIT_MS and one bucket above
+    uint32_t ackLatencyBuckets[LATENCY_BUCKETS] = {};
+    uint32_t ackLatencySumMs = 0;
+    uint32_t ackLatencyMaxMs = 0;
+};
+
 
 
 
@@ -0,0 +1,105 @@
+#include "CommandTracker.h"
+
+static String macToString(const uint8_t mac[6]) {
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buf);
+}
+
+// Defaults::RETRY_COUNT and CMD_TTL_MS; EspNow::begin() applies the configured values
+CommandTracker::CommandTracker() : pendingCount(0), maxRetries(3), defaultTtlMs(1500), resend(nullptr) {
+    for (auto& p : table) p.used = false;
+}
+
+CommandTracker::Pending* CommandTracker::find(const uint8_t mac[6]) {
+    for (auto& p : table) {
+        if (p.used && memcmp(p.mac, mac, 6) == 0) return &p;
+    }
+    return nullptr;
+}
+
+void CommandTracker::release(Pending& p) {
+    p.used = false;
+    pendingCount--;
+}
+
+CommandDeliveryStats& CommandTracker::statsFor(const uint8_t mac[6]) {
+    return nodeStats[macToString(mac)];
+}
+
+void CommandTracker::track(const uint8_t mac[6], const SetLightMessage& msg, uint32_t nowMs) {
+    Pending* slot = find(mac);
+    if (slot) {
+        statsFor(mac).superseded++;
+    } else {
+        for (auto& p : table) {
+            if (!p.used) { slot = &p; break; }
+        }
+        if (!slot) {
+            // Table full: give up on the oldest command
+            slot = &table[0];
+            for (auto& p : table) {
+                if (nowMs - p.firstSentMs > nowMs - slot->firstSentMs) slot = &p;
+            }
+            statsFor(slot->mac).expired++;
+        } else {
+            pendingCount++;
+        }
+    }
+    slot->used = true;
+    memcpy(slot->mac, mac, 6);
+    slot->retries = 0;
+    slot->firstSentMs = nowMs;
+    slot->rtoMs = INITIAL_RTO_MS;
+    slot->nextRetryMs = nowMs + INITIAL_RTO_MS;
+    slot->ttlMs = msg.ttl_ms ? msg.ttl_ms : defaultTtlMs;
+    slot->msg = msg;
+    statsFor(mac).commands++;
+}
+
+bool CommandTracker::onAck(const uint8_t mac[6], const char* cmdId, uint32_t nowMs) {
+    Pending* p = find(mac);
+    if (!p || !(p->msg.cmd_id == cmdId)) return false;
+    CommandDeliveryStats& st = statsFor(mac);
+    uint32_t latency = nowMs - p->firstSentMs;
+    st.delivered++;
+    st.ackLatencySumMs += latency;
+    if (latency > st.ackLatencyMaxMs) st.ackLatencyMaxMs = latency;
+    size_t b = 0;
+    while (b < CommandDeliveryStats::LATENCY_BUCKETS - 1 && latency >= CommandDeliveryStats::BUCKET_LIMIT_MS[b]) ++b;
+    st.ackLatencyBuckets[b]++;
+    release(*p);
+    return true;
+}
+
+void CommandTracker::supersede(const uint8_t mac[6]) {
+    Pending* p = find(mac);
+    if (!p) return;
+    statsFor(mac).superseded++;
+    release(*p);
+}
+
+void CommandTracker::poll(uint32_t nowMs) {
+    if (pendingCount == 0) return;
+    for (auto& p : table) {
+        if (!p.used) continue;
+        if (nowMs - p.firstSentMs >= p.ttlMs) {
+            statsFor(p.mac).expired++;
+            release(p);
+            continue;
+        }
+        if (p.retries >= maxRetries || (int32_t)(nowMs - p.nextRetryMs) < 0) continue;
+        p.retries++;
+        p.rtoMs *= 2;
+        p.nextRetryMs = nowMs + p.rtoMs;
+        statsFor(p.mac).retransmits++;
+        if (resend) resend(p.mac, p.msg);
+    }
+}
+
+void CommandTracker::forget(const uint8_t mac[6]) {
+    Pending* p = find(mac);
+    if (p) release(*p);
+    nodeStats.erase(macToString(mac));
+}
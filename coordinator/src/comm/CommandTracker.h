@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include "../Models.h"
+#include "../../shared/src/EspNowMessage.h"
+
+// Pending set_light commands, matched against the node's AckMessage by cmd_id.
+//
+// A command without an ack is sent again after INITIAL_RTO_MS, doubling each
+// time, at most maxRetries times, and is given up once its ttl_ms has passed
+// since the first send (the node ignores it after that anyway). A node only
+// has one command pending: a newer one for the same node supersedes it, so a
+// late retransmit can never undo a later colour. Nodes re-ack a cmd_id they
+// already applied without applying it again.
+//
+// Runs on the loop task only.
+class CommandTracker {
+public:
+    static constexpr size_t MAX_PENDING = 32;
+    static constexpr uint32_t INITIAL_RTO_MS = 150;  // covers a node's 100 ms RX period
+
+    // Send a retransmit; false if it could not be queued (counted, retried on schedule)
+    using Resend = std::function<bool(const uint8_t mac[6], const SetLightMessage& msg)>;
+
+    CommandTracker();
+
+    void setResend(Resend fn) { resend = fn; }
+    void setMaxRetries(uint8_t retries) { maxRetries = retries; }
+    void setDefaultTtlMs(uint16_t ttl) { defaultTtlMs = ttl; }
+
+    // msg was just sent to mac for the first time
+    void track(const uint8_t mac[6], const SetLightMessage& msg, uint32_t nowMs);
+    // Ack from mac; false when nothing pending matches (late, duplicate or superseded)
+    bool onAck(const uint8_t mac[6], const char* cmdId, uint32_t nowMs);
+    // Drop mac's pending command because something newer went out another way
+    void supersede(const uint8_t mac[6]);
+    // Retransmit due commands and expire old ones
+    void poll(uint32_t nowMs);
+    void forget(const uint8_t mac[6]);
+
+    size_t pending() const { return pendingCount; }
+    // Keyed by node id ("AA:BB:CC:DD:EE:FF")
+    const std::map<String, CommandDeliveryStats>& stats() const { return nodeStats; }
+
+private:
+    struct Pending {
+        bool used;
+        uint8_t mac[6];
+        uint8_t retries;
+        uint32_t firstSentMs;
+        uint32_t nextRetryMs;
+        uint32_t rtoMs;
+        uint16_t ttlMs;
+        SetLightMessage msg;
+    };
+
+    Pending* find(const uint8_t mac[6]);
+    void release(Pending& p);
+    CommandDeliveryStats& statsFor(const uint8_t mac[6]);
+
+    Pending table[MAX_PENDING];
+    size_t pendingCount;
+    uint8_t maxRetries;
+    uint16_t defaultTtlMs;
+    Resend resend;
+    std::map<String, CommandDeliveryStats> nodeStats;
+};
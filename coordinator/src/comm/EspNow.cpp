@@ -2,70 +2,48 @@
 #include <WiFi.h>
 #include <esp_wifi.h>
 #include <esp_now.h>
+#include <esp_idf_version.h>
 #include "../../shared/src/EspNowMessage.h"
+#include "../../shared/src/LightSchedule.h"
 #include "../nodes/NodeRegistry.h"
 #include "../utils/Logger.h"
+#include "../../shared/src/ConfigManager.h"
 #include <Preferences.h>
 #include <map>
 
 // Simple singleton to bridge static callbacks
 static EspNow* s_self = nullptr;
-// Recently handled JOIN requests to avoid duplicate processing
-static std::map<String, uint32_t> s_recentJoin;
 
 // ✓ ESP-NOW v2.0 callback signatures (Checklist: ESP-NOW Version)
-// v2 uses esp_now_recv_info_t instead of passing MAC directly
+// Both callbacks run in the Wi-Fi driver task. They only copy into lock-free
+// rings; parsing, peer bookkeeping, NVS, logging and MQTT happen in loop().
 void staticRecvCallback(const esp_now_recv_info_t* recv_info, const uint8_t* data, int len) {
-    // Extract RSSI and pass to handler (ESP-NOW v2.0 provides RSSI in recv_info)
-    if (s_self && recv_info && recv_info->src_addr) {
-        s_self->handleEspNowReceive(recv_info->src_addr, data, len);
-        
-        // Update RSSI stats (rx_ctrl is a pointer in ESP-NOW v2.0)
-        char macStr[18];
-        snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-                 recv_info->src_addr[0], recv_info->src_addr[1], recv_info->src_addr[2],
-                 recv_info->src_addr[3], recv_info->src_addr[4], recv_info->src_addr[5]);
-        String smac(macStr);
-        
-        auto& stats = s_self->peerStats[smac];
-        if (recv_info->rx_ctrl) {
-            stats.lastRssi = recv_info->rx_ctrl->rssi;
-        }
-        stats.lastSeenMs = millis();
-        stats.messageCount++;
-    } else {
-        Logger::error("s_self is NULL or invalid recv_info in receive callback!");
+    if (!s_self) return;
+    if (!recv_info || !recv_info->src_addr || !data || len <= 0 ||
+        len > (int)sizeof(RxFrame::data) ||
+        (!WireCodec::isJsonFrame(data, len) && !WireCodec::isBinaryFrame(data, len))) {
+        s_self->rxDroppedInvalid.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
+    RxFrame* frame = s_self->rxRing.acquire();
+    if (!frame) return; // counted as dropped by the ring
+    memcpy(frame->mac, recv_info->src_addr, 6);
+    // rx_ctrl is a pointer in ESP-NOW v2.0
+    frame->rssi = recv_info->rx_ctrl ? (int8_t)recv_info->rx_ctrl->rssi : -127;
+    frame->rxMs = millis();
+    frame->len = (uint16_t)len;
+    memcpy(frame->data, data, len);
+    s_self->rxRing.publish();
 }
 
 void staticSendCallback(const uint8_t* mac, esp_now_send_status_t status) {
-    if (!mac) {
-        Logger::warn("ESP-NOW V2: send_cb (null mac) status=%d", (int)status);
-        return;
-    }
-    
-    char macStr[18];
-    snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    
-    // Update stats and trigger error callback
-    if (s_self) {
-        String smac(macStr);
-        auto& stats = s_self->peerStats[smac];
-        if (status != ESP_NOW_SEND_SUCCESS) {
-            stats.failedCount++;
-            // Trigger error callback for visual feedback
-            if (s_self->sendErrorCallback) {
-                s_self->sendErrorCallback(smac);
-            }
-        }
-    }
-    
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        Logger::debug("ESP-NOW V2: send_cb OK -> %s", macStr);
-    } else {
-        Logger::warn("ESP-NOW V2: send_cb to %s FAILED (status=%d)", macStr, (int)status);
-    }
+    if (!s_self || !mac) return;
+    TxStatus* st = s_self->txStatusRing.acquire();
+    if (!st) return;
+    memcpy(st->mac, mac, 6);
+    st->ok = (status == ESP_NOW_SEND_SUCCESS);
+    st->atUs = micros();
+    s_self->txStatusRing.publish();
 }
 
 // small helper to hex encode bytes
@@ -96,7 +74,31 @@ EspNow::EspNow()
     , pairingEndTime(0)
     , messageCallback(nullptr)
     , pairingCallback(nullptr)
-    , sendErrorCallback(nullptr) {}
+    , sendErrorCallback(nullptr)
+    , rxDroppedInvalid(0)
+    , lastCmdStamp(0)
+    , legacyPeerKeys(0)
+    , fragmentSeq(0)
+    , broadcastSeq((uint16_t)esp_random())
+    , seqStats{0, 0, 0}
+    , batchSeq(0)
+    , beaconSeq(0)
+    , beaconPeriodMs(0)
+    , switchChannel(0)
+    , switchAtMs(0) {
+    txQueue.setTransmit([this](const uint8_t mac[6], const uint8_t* data, size_t len) {
+        return transmitFrame(mac, data, len);
+    });
+    commands.setResend([this](const uint8_t mac[6], const SetLightMessage& msg) {
+        return sendMessage(mac, msg);
+    });
+    // One driver slot stays with the broadcast peer
+    peerCache.setCapacity(ESP_NOW_MAX_TOTAL_PEER_NUM - 1);
+    peerCache.setDriver(
+        [this](const uint8_t mac[6]) { return registerDriverPeer(mac); },
+        [](const uint8_t mac[6]) { esp_now_del_peer(mac); });
+    peerCache.setBusy([this](const uint8_t mac[6]) { return txQueue.inFlight(mac) > 0; });
+}
 
 EspNow::~EspNow() {}
 
@@ -119,7 +121,8 @@ bool EspNow::begin() {
     esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE);
     esp_wifi_set_promiscuous(false);
 
-    // Optionally set a conservative ESPNOW PHY rate (if available)
+    // Broadcasts (beacons, light_batch) must reach every tile, so the interface
+    // stays at 1 Mbps; unicast rates are set per peer from its LinkQuality
     #ifdef CONFIG_IDF_TARGET_ESP32S3
     #ifdef WIFI_PHY_RATE_1M_L
     esp_wifi_config_espnow_rate(WIFI_IF_STA, WIFI_PHY_RATE_1M_L);
@@ -230,14 +233,18 @@ bool EspNow::begin() {
         Logger::error("✗ Failed to add broadcast peer, error=%d", (int)bres);
     }
     
-    // Load persisted peers and re-register them
+    // Load persisted peers; they are registered with the driver on first use
+    peerCache.reset();
     loadPeersFromStorage();
-    for (const auto& macStr : peers) {
-        uint8_t peerMac[6];
-        if (macStringToBytes(macStr, peerMac)) {
-            addPeer(peerMac);
-            Logger::info("  ✓ Restored peer: %s", macStr.c_str());
-        }
+    Logger::info("  ✓ Restored %d peers (driver holds %d at a time)",
+                 peerTable.pairedCount(), ESP_NOW_MAX_TOTAL_PEER_NUM - 1);
+
+    // set_light delivery: retransmits and fallback TTL (see CommandTracker)
+    ConfigManager config("coordinator");
+    if (config.begin()) {
+        commands.setMaxRetries((uint8_t)config.getInt(ConfigKeys::RETRY_COUNT, Defaults::RETRY_COUNT));
+        commands.setDefaultTtlMs((uint16_t)config.getInt(ConfigKeys::CMD_TTL_MS, Defaults::CMD_TTL_MS));
+        config.end();
     }
     
     Logger::info("===========================================");
@@ -277,13 +284,8 @@ void EspNow::loop() {
                 peerInfo.encrypt = false;
                 peerInfo.ifidx = WIFI_IF_STA;
                 esp_now_add_peer(&peerInfo);
-                // Re-add all known peers
-                for (const auto& macStr : peers) {
-                    uint8_t peerMac[6];
-                    if (macStringToBytes(macStr, peerMac)) {
-                        addPeer(peerMac);
-                    }
-                }
+                // Node peers went with the old driver state; re-registered on next use
+                peerCache.reset();
             } else {
                 Logger::error("ESP-NOW reinit failed: %d", initResult);
             }
@@ -291,11 +293,60 @@ void EspNow::loop() {
         return; // Don't proceed if not initialized
     }
     
+    // Frames and send results queued by the driver callbacks since last time
+    drainTxStatusRing();
+    drainRxRing();
+    // Announced channel switch: the nodes retune now too
+    if (switchChannel != 0 && (int32_t)(millis() - switchAtMs) >= 0) {
+        uint8_t channel = switchChannel;
+        switchChannel = 0;
+        moveToChannel(channel);
+    }
+    // Frames queued while the driver was busy, and in-flight timeouts
+    txQueue.pump(micros());
+    // Unacked set_light commands: retransmit or expire
+    commands.poll(millis());
+    // Peer list changes, coalesced into one NVS write
+    if (peerStore.due(millis())) savePeersToStorage();
+    
     // Debug: Periodically log that we're alive and waiting
     static uint32_t lastDebugLog = 0;
     uint32_t now = millis();
     if (now - lastDebugLog > 10000) {
-        Logger::debug("ESP-NOW: Loop running, pairing=%d, peers=%d", isPairingEnabled(), peers.size());
+        RxQueueStats rx = getRxQueueStats();
+        Logger::debug("ESP-NOW: Loop running, pairing=%d, peers=%d, rx=%lu dropped=%lu/%lu hwm=%lu/%lu",
+                      isPairingEnabled(), peerTable.pairedCount(), (unsigned long)rx.received,
+                      (unsigned long)rx.droppedFull, (unsigned long)rx.droppedInvalid,
+                      (unsigned long)rx.highWater, (unsigned long)rx.capacity);
+        const TxQueue::Stats& tx = txQueue.stats();
+        Logger::debug("ESP-NOW: tx sent=%lu ok=%lu fail=%lu busy=%lu dropped=%lu timeout=%lu late=%lu depth=%u hwm=%u latency p50=%lums p95=%lums max=%luus",
+                      (unsigned long)tx.sent, (unsigned long)tx.delivered, (unsigned long)tx.failed,
+                      (unsigned long)tx.busy, (unsigned long)tx.dropped, (unsigned long)tx.timedOut,
+                      (unsigned long)tx.late,
+                      (unsigned)tx.depth, (unsigned)tx.maxDepth,
+                      (unsigned long)txQueue.latencyPercentileMs(50), (unsigned long)txQueue.latencyPercentileMs(95),
+                      (unsigned long)tx.latencyMaxUs);
+        for (size_t c = 0; c < TxQueue::PRIORITIES; ++c) {
+            TxQueue::Priority prio = (TxQueue::Priority)c;
+            const TxQueue::ClassStats& cs = tx.byClass[c];
+            Logger::debug("ESP-NOW: tx %s queued=%lu dropped=%lu delay p50=%lums p95=%lums max=%luus",
+                          TxQueue::priorityName(prio), (unsigned long)cs.queued, (unsigned long)cs.dropped,
+                          (unsigned long)txQueue.latencyPercentileMs(prio, 50),
+                          (unsigned long)txQueue.latencyPercentileMs(prio, 95), (unsigned long)cs.latencyMaxUs);
+        }
+        PeerCache::Stats pc = peerCache.stats();
+        Logger::debug("ESP-NOW: driver peers %u/%u hits=%lu misses=%lu evictions=%lu failures=%lu",
+                      (unsigned)pc.registered, (unsigned)pc.capacity, (unsigned long)pc.hits,
+                      (unsigned long)pc.misses, (unsigned long)pc.evictions, (unsigned long)pc.failures);
+        unsigned atRate[LinkQuality::RATES] = {};
+        for (const PeerTable::Peer& peer : peerTable) {
+            if (peer.paired) atRate[(size_t)peer.link.rate()]++;
+        }
+        Logger::debug("ESP-NOW: unicast rates 1M=%u 6M=%u 12M=%u 24M=%u 36M=%u 54M=%u",
+                      atRate[0], atRate[1], atRate[2], atRate[3], atRate[4], atRate[5]);
+        Logger::debug("ESP-NOW: rx seq duplicates=%lu stale=%lu resyncs=%lu",
+                      (unsigned long)seqStats.duplicates, (unsigned long)seqStats.stale,
+                      (unsigned long)seqStats.resyncs);
         lastDebugLog = now;
     }
 
@@ -309,9 +360,8 @@ void EspNow::loop() {
         if (now - lastBeacon > beaconInterval) {
             uint8_t bcast[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
             const char* ping = "{\"msg\":\"pairing_ping\"}";
-            esp_err_t res = esp_now_send(bcast, (const uint8_t*)ping, strlen(ping));
-            if (res != ESP_OK) {
-                Logger::debug("Pairing beacon failed: %d", (int)res);
+            if (!sendBytes(bcast, (const uint8_t*)ping, strlen(ping))) {
+                Logger::debug("Pairing beacon not queued");
             }
             lastBeacon = now;
         }
@@ -332,19 +382,13 @@ bool EspNow::sendLightCommand(const String& nodeId, uint8_t brightness, uint16_t
     }
 
     SetLightMessage msg;
-    // Optimize: Build cmd_id more efficiently
-    char cmdIdBuf[32];
-    snprintf(cmdIdBuf, sizeof(cmdIdBuf), "%lu-%02X%02X%02X", 
-             (unsigned long)millis(), mac[3], mac[4], mac[5]);
-    msg.cmd_id = cmdIdBuf;
     msg.light_id = ""; // coordinator will publish state mapping separately
     msg.r = 0; msg.g = 0; msg.b = 0; msg.w = brightness;
     msg.fade_ms = fadeMs;
     msg.override_status = overrideStatus;
     msg.ttl_ms = ttlMs;
 
-    String json = msg.toJson();
-    bool ok = sendToMac(mac, json);
+    bool ok = sendTrackedCommand(mac, msg);
     if (!ok) {
         Logger::warn("sendLightCommand: failed to deliver to %s", nodeId.c_str());
     } else {
@@ -353,7 +397,7 @@ bool EspNow::sendLightCommand(const String& nodeId, uint8_t brightness, uint16_t
     return ok;
 }
 
-bool EspNow::sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs, bool overrideStatus, uint16_t ttlMs, int8_t pixel) {
+bool EspNow::sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs, bool overrideStatus, uint16_t ttlMs, int8_t pixel, uint32_t atMs) {
     uint8_t mac[6];
     if (!macStringToBytes(nodeId, mac)) {
         Logger::warn("sendColorCommand: invalid MAC string %s", nodeId.c_str());
@@ -361,10 +405,6 @@ bool EspNow::sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_
     }
 
     SetLightMessage msg;
-    char cmdIdBuf[32];
-    snprintf(cmdIdBuf, sizeof(cmdIdBuf), "%lu-%02X%02X%02X", 
-             (unsigned long)millis(), mac[3], mac[4], mac[5]);
-    msg.cmd_id = cmdIdBuf;
     msg.light_id = "";
     msg.r = r;
     msg.g = g;
@@ -374,9 +414,9 @@ bool EspNow::sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_
     msg.override_status = overrideStatus;
     msg.ttl_ms = ttlMs;
     msg.pixel = pixel;
+    msg.at_ms = atMs;
 
-    String json = msg.toJson();
-    bool ok = sendToMac(mac, json);
+    bool ok = sendTrackedCommand(mac, msg);
     if (!ok) {
         Logger::warn("sendColorCommand: failed to deliver to %s", nodeId.c_str());
     } else {
@@ -386,6 +426,128 @@ bool EspNow::sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_
     return ok;
 }
 
+bool EspNow::sendTrackedCommand(const uint8_t mac[6], SetLightMessage& msg) {
+    // Millisecond stamp, bumped so two commands never share a cmd_id (nodes
+    // treat a repeated cmd_id as a retransmit and only re-ack it)
+    uint32_t stamp = millis();
+    if ((int32_t)(stamp - lastCmdStamp) <= 0) stamp = lastCmdStamp + 1;
+    lastCmdStamp = stamp;
+    char cmdIdBuf[32];
+    snprintf(cmdIdBuf, sizeof(cmdIdBuf), "%lu-%02X%02X%02X",
+             (unsigned long)stamp, mac[3], mac[4], mac[5]);
+    msg.cmd_id = cmdIdBuf;
+
+    if (!sendMessage(mac, msg)) return false;
+    commands.track(mac, msg, millis());
+    return true;
+}
+
+size_t EspNow::sendColorBatch(const std::vector<LightBatchEntry>& targets, bool overrideStatus, uint16_t ttlMs) {
+    SetLightBatchMessage batch;
+    batch.override_status = overrideStatus;
+    batch.ttl_ms = ttlMs;
+    size_t sent = 0;
+
+    // Frames this takes: one per JSON-wire node, shared frames for the rest
+    size_t unicast = 0;
+    size_t batched = 0;
+    for (const auto& t : targets) {
+        uint8_t mac[6];
+        if (!macStringToBytes(t.nodeId, mac)) continue;
+        if (getPeerWireFormat(mac) == WireCodec::Format::BINARY) batched++;
+        else unicast++;
+    }
+    size_t frames = unicast + (batched + SetLightBatchMessage::MAX_ENTRIES - 1) / SetLightBatchMessage::MAX_ENTRIES;
+    uint32_t atMs = unicast + batched > 1 ? millis() + LightSchedule::leadMs(frames) : 0;
+    batch.at_ms = atMs;
+
+    for (const auto& t : targets) {
+        uint8_t mac[6];
+        if (!macStringToBytes(t.nodeId, mac)) {
+            Logger::warn("sendColorBatch: invalid MAC string %s", t.nodeId.c_str());
+            continue;
+        }
+        // Nodes that only speak JSON cannot decode batch frames
+        if (getPeerWireFormat(mac) != WireCodec::Format::BINARY) {
+            if (sendColorCommand(t.nodeId, t.r, t.g, t.b, t.w, t.fadeMs, overrideStatus, ttlMs, t.pixel, atMs)) sent++;
+            continue;
+        }
+        if (batch.isFull()) {
+            if (broadcastBatch(batch)) sent += batch.count;
+            batch.count = 0;
+        }
+        // Batch frames carry no cmd_id: stop retransmitting anything older
+        commands.supersede(mac);
+        batch.add(mac, t.r, t.g, t.b, t.w, t.fadeMs, t.pixel);
+    }
+    if (batch.count > 0 && broadcastBatch(batch)) sent += batch.count;
+    return sent;
+}
+
+bool EspNow::broadcastBatch(SetLightBatchMessage& batch) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    batch.batch_id = ++batchSeq;
+    uint8_t frame[WireCodec::MAX_FRAME_LEN];
+    size_t len = batch.toBinary(frame, sizeof(frame));
+    bool ok = sendBytes(bcast, frame, len);
+    if (!ok) {
+        Logger::warn("light_batch %lu: broadcast failed", (unsigned long)batch.batch_id);
+    } else {
+        Logger::info("light_batch %lu sent: %u node(s), %u bytes",
+                     (unsigned long)batch.batch_id, (unsigned)batch.count, (unsigned)len);
+    }
+    return ok;
+}
+
+bool EspNow::sendBeacon(BeaconMessage& beacon) {
+    static const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    beacon.seq = ++beaconSeq;
+    beacon.time_ms = millis();
+    beacon.switch_channel = switchChannel;
+    beacon.switch_at_ms = switchChannel != 0 ? switchAtMs : 0;
+    beaconPeriodMs = beacon.period_ms;
+    uint8_t frame[BeaconMessage::maxFrameSize()];
+    size_t len = beacon.toBinary(frame, sizeof(frame));
+    bool ok = sendBytes(bcast, frame, len);
+    if (!ok) {
+        Logger::warn("beacon %u: broadcast failed", (unsigned)beacon.seq);
+    } else {
+        Logger::debug("beacon %u sent: %u bytes", (unsigned)beacon.seq, (unsigned)len);
+    }
+    return ok;
+}
+
+bool EspNow::announceChannelSwitch(uint8_t channel) {
+    if (channel < 1 || channel > 13) return false;
+    uint8_t current = 0;
+    wifi_second_chan_t second = WIFI_SECOND_CHAN_NONE;
+    esp_wifi_get_channel(&current, &second);
+    if (channel == current && switchChannel == 0) return false;
+    if (beaconPeriodMs == 0) {
+        switchChannel = 0;
+        moveToChannel(channel);
+        return true;
+    }
+    // The next beacon can be up to a period away; half a period more keeps the
+    // last announcement clear of the switch itself
+    uint32_t lead = (uint32_t)CHANNEL_SWITCH_BEACONS * beaconPeriodMs + beaconPeriodMs / 2;
+    switchChannel = channel;
+    switchAtMs = millis() + lead;
+    Logger::info("Channel switch %d -> %d announced, in %lu ms", (int)current, (int)channel, (unsigned long)lead);
+    return true;
+}
+
+void EspNow::moveToChannel(uint8_t channel) {
+    esp_wifi_set_promiscuous(true);
+    esp_err_t res = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    esp_wifi_set_promiscuous(false);
+    if (res != ESP_OK) {
+        Logger::error("Channel switch to %d failed: %d", (int)channel, (int)res);
+        return;
+    }
+    updatePeerChannels();
+}
+
 bool EspNow::broadcastPairingMessage() {
     // Placeholder broadcast
     return true;
@@ -404,11 +566,11 @@ bool EspNow::isPairingEnabled() const {
     return pairingEnabled && millis() < pairingEndTime;
 }
 
-void EspNow::setMessageCallback(std::function<void(const String& nodeId, const uint8_t* data, size_t len)> callback) {
+void EspNow::setMessageCallback(std::function<void(const String& nodeId, const EspNowMessage& msg)> callback) {
     messageCallback = callback;
 }
 
-void EspNow::setPairingCallback(std::function<void(const uint8_t* mac, const uint8_t* data, size_t len)> callback) {
+void EspNow::setPairingCallback(std::function<void(const uint8_t* mac, const JoinRequestMessage& request)> callback) {
     pairingCallback = callback;
 }
 
@@ -416,23 +578,98 @@ void EspNow::setSendErrorCallback(std::function<void(const String& nodeId)> call
     sendErrorCallback = callback;
 }
 
-void EspNow::handleEspNowReceive(const uint8_t* mac, const uint8_t* data, int len) {
-    // Validate parameters first
-    if (!mac || !data || len <= 0 || len > 250) {
-        return; // Silent drop for invalid packets
+void EspNow::drainRxRing() {
+    // Only what is queued now; frames arriving meanwhile wait for the next loop()
+    size_t pending = rxRing.size();
+    while (pending-- > 0) {
+        RxFrame* frame = rxRing.front();
+        if (!frame) break;
+        handleEspNowReceive(*frame);
+        rxRing.pop();
     }
-    
-    // Quick filter: must be JSON
-    if (((const char*)data)[0] != '{') {
-        return; // Drop non-JSON frames silently
+}
+
+void EspNow::drainTxStatusRing() {
+    while (TxStatus* st = txStatusRing.front()) {
+        uint8_t mac[6];
+        memcpy(mac, st->mac, 6);
+        bool ok = st->ok;
+        // Frees a window slot; the next queued frame goes out on the pump below
+        txQueue.onComplete(mac, ok, st->atUs);
+        txStatusRing.pop();
+
+        // Unicast results feed the peer's error rate; broadcasts are never acked
+        if (!(mac[0] & 0x01)) {
+            if (PeerTable::Peer* peer = peerTable.find(mac)) {
+                if (peer->link.onSend(ok)) applyPeerRate(*peer);
+            }
+        }
+
+        if (ok) {
+            Logger::debug("ESP-NOW V2: send_cb OK -> %02X:%02X:%02X:%02X:%02X:%02X",
+                          mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            continue;
+        }
+        char macStr[18];
+        snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        Logger::warn("ESP-NOW V2: send_cb to %s FAILED", macStr);
+        String smac(macStr);
+        if (PeerTable::Peer* peer = peerTable.find(mac)) {
+            peer->stats.failedCount++;
+        }
+        // Trigger error callback for visual feedback
+        if (sendErrorCallback) {
+            sendErrorCallback(smac);
+        }
     }
-    
-    char macStr[18];
-    snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+RxQueueStats EspNow::getRxQueueStats() const {
+    auto ring = rxRing.stats();
+    RxQueueStats out;
+    out.received = ring.pushed;
+    out.droppedFull = ring.dropped;
+    out.droppedInvalid = rxDroppedInvalid.load(std::memory_order_relaxed);
+    out.highWater = ring.highWater;
+    out.depth = rxRing.size();
+    out.capacity = rxRing.capacity();
+    return out;
+}
+
+void EspNow::handleEspNowReceive(const RxFrame& frame) {
+    const uint8_t* mac = frame.mac;
+    const uint8_t* data = frame.data;
+    int len = frame.len;
     
     // Only log at DEBUG level to reduce overhead
-    Logger::debug("RX %dB from %s", len, macStr);
+    Logger::debug("RX %dB from %02X:%02X:%02X:%02X:%02X:%02X", len,
+                  mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    // Active peers stay registered with the driver
+    peerCache.touch(mac, frame.rxMs);
+
+    // Update RSSI stats. Only known peers: entries are made on JOIN_REQUEST or
+    // addPeer(), so neighbours and stray senders cannot fill the table
+    if (PeerTable::Peer* peer = peerTable.find(mac)) {
+        PeerStats& stats = peer->stats;
+        if (frame.rssi != -127) {
+            stats.lastRssi = frame.rssi;
+            if (peer->link.onRssi(frame.rssi)) applyPeerRate(*peer);
+        }
+        stats.lastSeenMs = frame.rxMs;
+        stats.messageCount++;
+    }
+
+    // Fragments are held until the whole message is in
+    if (Fragmentation::isFragment(data, len)) {
+        size_t full = 0;
+        const uint8_t* message = reassembler.accept(mac, data, (size_t)len, frame.rxMs, full);
+        if (message) {
+            processReceivedData(mac, message, (int)full);
+        }
+        return;
+    }
     
     processReceivedData(mac, data, len);
 }
@@ -446,91 +683,273 @@ void EspNow::processReceivedData(const uint8_t* mac, const uint8_t* data, int le
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     
-    // Avoid String allocation for nodeId until needed
-    // Basic forwarding: if pairing is active and the message is a join_request, forward raw data
-    String payload((const char*)data, len);
-    MessageType mt = MessageFactory::getMessageType(payload);
+    // Drop what this peer has already delivered (SeqWindow.h). A JOIN_REQUEST
+    // comes from a node that (re)started, so its count starts over.
+    uint16_t seq = 0;
+    PeerTable::Peer* sender = peerTable.find(mac);
+    if (sender && WireCodec::readSeq(data, (size_t)len, seq)) {
+        if (MessageFactory::getMessageType(data, (size_t)len) == MessageType::JOIN_REQUEST) {
+            sender->rxSeq.reset();
+        }
+        SeqWindow::Verdict verdict = sender->rxSeq.accept(seq);
+        SeqWindow::count(verdict, seqStats);
+        if (!SeqWindow::handle(verdict)) {
+            Logger::debug("Dropping %s seq %u from %s",
+                          verdict == SeqWindow::Verdict::DUPLICATE ? "duplicate" : "stale", (unsigned)seq, macStr);
+            return;
+        }
+    }
+    
+    // Decode exactly once; handlers receive the typed message by reference
+    EspNowMessage* msg = rxSlot.decode(data, (size_t)len);
+    if (!msg) {
+        Logger::debug("Dropping undecodable %dB frame from %s", len, macStr);
+        return;
+    }
+    String nodeId(macStr);
     
     // Only log at debug when needed
-    if (mt == MessageType::JOIN_REQUEST) {
+    if (msg->type == MessageType::JOIN_REQUEST) {
         Logger::info("JOIN_REQUEST from %s", macStr);
-        // Deduplicate JOIN within 4s per MAC
+        // A pairing node repeats JOIN_REQUEST every 600 ms, each a new request
+        // with its own token: answer one per 4 s
         uint32_t nowMs = millis();
-        auto it = s_recentJoin.find(String(macStr));
-        if (it != s_recentJoin.end() && (nowMs - it->second) < 4000U) {
-            Logger::debug("Duplicate JOIN_REQUEST ignored for %s", macStr);
-            return;
+        PeerTable::Peer* peer = peerTable.insert(mac);
+        if (peer) {
+            if (peer->lastJoinMs != 0 && (nowMs - peer->lastJoinMs) < 4000U) {
+                Logger::debug("Repeated JOIN_REQUEST ignored for %s", macStr);
+                return;
+            }
+            peer->lastJoinMs = nowMs ? nowMs : 1;
         }
-        s_recentJoin[String(macStr)] = nowMs;
 
         // Always ensure peer exists so we can unicast responses
         addPeer(mac);
 
         if (isPairingEnabled()) {
             if (pairingCallback) {
-                pairingCallback(mac, data, (size_t)len);
+                pairingCallback(mac, static_cast<const JoinRequestMessage&>(*msg));
             } else {
                 Logger::error("Pairing active but no pairingCallback registered");
             }
-        } else {
-        // Forward to general handler so Coordinator can re-accept known nodes
-            if (messageCallback) {
-                String nodeId(macStr);
-                messageCallback(nodeId, (const uint8_t*)payload.c_str(), payload.length());
-            }
+        } else if (messageCallback) {
+            // Forward to general handler so Coordinator can re-accept known nodes
+            messageCallback(nodeId, *msg);
         }
         return;
     }
 
+    if (msg->type == MessageType::ACK) {
+        const CmdIdString& cmdId = static_cast<const AckMessage&>(*msg).cmd_id;
+        if (commands.onAck(mac, cmdId.c_str(), millis())) {
+            Logger::debug("Ack %s from %s", cmdId.c_str(), macStr);
+        }
+    }
+
     // Forward other messages via general callback
     if (messageCallback) {
-        String nodeId(macStr);
-        messageCallback(nodeId, (const uint8_t*)payload.c_str(), payload.length());
+        messageCallback(nodeId, *msg);
     }
 }
 
 bool EspNow::sendToMac(const uint8_t mac[6], const String& json) {
+    return sendBytes(mac, (const uint8_t*)json.c_str(), json.length());
+}
+
+bool EspNow::sendMessage(const uint8_t mac[6], const EspNowMessage& msg) {
+    uint8_t frame[WireCodec::MAX_FRAME_LEN];
+    size_t len = msg.encode(getPeerWireFormat(mac), frame, sizeof(frame), getPeerKeyDictionary(mac));
+    if (len == 0) {
+        Logger::error("Message %s does not fit in %d bytes", msg.msg.c_str(), (int)sizeof(frame));
+        return false;
+    }
+    return sendBytes(mac, frame, len, priorityFor(msg.type));
+}
+
+TxQueue::Priority EspNow::priorityFor(MessageType type) {
+    switch (type) {
+        case MessageType::SET_LIGHT:
+        case MessageType::SET_LIGHT_BATCH:
+        case MessageType::WAVE:
+        case MessageType::JOIN_ACCEPT:
+            return TxQueue::Priority::INTERACTIVE;
+        case MessageType::ACK:
+        case MessageType::BEACON:
+        case MessageType::PING:
+        case MessageType::PAIRING_PING:
+            return TxQueue::Priority::ROUTINE;
+        default:
+            return TxQueue::Priority::BULK;
+    }
+}
+
+bool EspNow::sendBytes(const uint8_t mac[6], const uint8_t* data, size_t len) {
+    return sendBytes(mac, data, len, priorityFor(MessageFactory::getMessageType(data, len)));
+}
+
+bool EspNow::sendBytes(const uint8_t mac[6], const uint8_t* data, size_t len, TxQueue::Priority prio) {
     // ✓ Checklist: Message Size - Verify before sending
-    if (json.length() > 250) {
-        Logger::error("Message too large: %d bytes (max 250)", json.length());
+    if (len > WireCodec::MAX_MESSAGE_LEN) {
+        Logger::error("Message too large: %d bytes (max %d)", (int)len, (int)WireCodec::MAX_MESSAGE_LEN);
         return false;
     }
-    
+    // Numbered as a whole, so fragments are checked once reassembled
+    size_t stamped = stampSeq(mac, data, len);
+    if (stamped) {
+        data = txScratch;
+        len = stamped;
+    }
+    uint16_t maxFrame = getPeerMaxFrame(mac);
+    size_t frames = len <= maxFrame ? 1 : Fragmentation::fragmentCount(len, maxFrame);
+    // All or nothing: a message missing fragments would only time out at the peer
+    if (txQueue.space(mac, prio) < frames) {
+        Logger::warn("TX queue full for %02X:%02X:%02X:%02X:%02X:%02X (%u frame(s) waiting), %dB %s not sent",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (unsigned)txQueue.depth(mac), (int)len,
+                     TxQueue::priorityName(prio));
+        return false;
+    }
+    if (frames == 1) {
+        return sendFrame(mac, data, len, prio);
+    }
+    // Peer cannot take this in one frame: split and let it reassemble
+    bool ok = Fragmentation::send(data, len, maxFrame, ++fragmentSeq,
+                                  [this, mac, prio](const uint8_t* frame, size_t n) { return sendFrame(mac, frame, n, prio); });
+    if (!ok) {
+        Logger::warn("Fragmented send of %dB failed", (int)len);
+    }
+    return ok;
+}
+
+size_t EspNow::stampSeq(const uint8_t mac[6], const uint8_t* data, size_t len) {
+    uint16_t* counter = &broadcastSeq;
+    if (!(mac[0] & 0x01)) {
+        PeerTable::Peer* peer = peerTable.find(mac);
+        if (!peer) return 0; // nobody keeps a window for us yet
+        counter = &peer->txSeq;
+    }
+    size_t n = WireCodec::stampSeq(data, len, *counter, txScratch, sizeof(txScratch));
+    if (n) (*counter)++;
+    return n;
+}
+
+bool EspNow::sendFrame(const uint8_t mac[6], const uint8_t* data, size_t len, TxQueue::Priority prio) {
+    uint32_t now = micros();
+    if (txQueue.enqueue(mac, data, len, now, prio) != TxQueue::Result::QUEUED) {
+        return false;
+    }
+    // Goes straight to the driver when the peer's window is open
+    txQueue.pump(now);
+    return true;
+}
+
+TxQueue::SendStatus EspNow::transmitFrame(const uint8_t mac[6], const uint8_t* data, size_t len) {
+    if (!initialized) return TxQueue::SendStatus::BUSY;
+
+    // Unicast needs the peer registered; swap it in if the LRU let it go
+    bool unicast = (mac[0] & 0x01) == 0;
+    if (unicast) {
+        PeerCache::Result reg = peerCache.ensure(mac, millis());
+        // Every driver slot has frames in flight: wait for a send_cb
+        if (reg == PeerCache::Result::NO_SLOT) return TxQueue::SendStatus::BUSY;
+        if (reg == PeerCache::Result::FAILED) {
+            return initialized ? TxQueue::SendStatus::FAILED : TxQueue::SendStatus::BUSY;
+        }
+    }
+
+    // ✓ Checklist: Error Handling - Check send result
+    esp_err_t res = esp_now_send(mac, data, len);
+    if (res == ESP_OK) return TxQueue::SendStatus::SENT;
+    // Driver queue full: keep the frame, a send_cb will make room
+    if (res == ESP_ERR_ESPNOW_NO_MEM) return TxQueue::SendStatus::BUSY;
+
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    
-    // ✓ Checklist: Error Handling - Check send result
-    esp_err_t res = esp_now_send(mac, (uint8_t*)json.c_str(), json.length());
-    if (res != ESP_OK) {
-        // ESP_ERR_ESPNOW_NOT_INIT (12389) means ESP-NOW was deinitialized!
-        if (res == ESP_ERR_ESPNOW_NOT_INIT || res == 12389) {
-            Logger::error("ESP-NOW not initialized (error %d)! Marking for reinit.", res);
-            initialized = false;
-            return false;
-        }
-        // ESP_ERR_ESPNOW_NOT_FOUND (12393) means peer not registered - try adding
-        if (res == ESP_ERR_ESPNOW_NOT_FOUND) {
-            Logger::info("Peer %s not found in ESP-NOW, adding...", macStr);
-            if (addPeer(mac)) {
-                // Small delay to ensure peer is registered
-                delay(10);
-                // Retry send after adding peer
-                res = esp_now_send(mac, (uint8_t*)json.c_str(), json.length());
-                if (res == ESP_OK) {
-                    Logger::info("Send successful after adding peer %s", macStr);
-                    return true;
-                } else {
-                    Logger::warn("Send to %s failed after adding peer: %d", macStr, res);
-                }
-            } else {
-                Logger::warn("Failed to add peer %s", macStr);
+    // ESP_ERR_ESPNOW_NOT_INIT (12389) means ESP-NOW was deinitialized!
+    if (res == ESP_ERR_ESPNOW_NOT_INIT || res == 12389) {
+        Logger::error("ESP-NOW not initialized (error %d)! Marking for reinit.", res);
+        initialized = false;
+        return TxQueue::SendStatus::BUSY; // held until loop() reinitializes
+    }
+    // ESP_ERR_ESPNOW_NOT_FOUND (12393) means the driver lost the peer behind the
+    // cache's back - register it again. esp_now_add_peer() is synchronous, so
+    // the retry needs no delay.
+    if (res == ESP_ERR_ESPNOW_NOT_FOUND && unicast) {
+        Logger::info("Peer %s not found in ESP-NOW, adding...", macStr);
+        peerCache.forget(mac);
+        if (peerCache.ensure(mac, millis()) == PeerCache::Result::REGISTERED) {
+            res = esp_now_send(mac, data, len);
+            if (res == ESP_OK) {
+                Logger::info("Send successful after adding peer %s", macStr);
+                return TxQueue::SendStatus::SENT;
             }
+            if (res == ESP_ERR_ESPNOW_NO_MEM) return TxQueue::SendStatus::BUSY;
+            Logger::warn("Send to %s failed after adding peer: %d", macStr, res);
+        } else {
+            Logger::warn("Failed to add peer %s", macStr);
         }
-        Logger::warn("ESP-NOW V2 send failed to %s: %d", macStr, res);
-        return false;
     }
-    return true;
+    Logger::warn("ESP-NOW V2 send failed to %s: %d", macStr, res);
+    return TxQueue::SendStatus::FAILED;
+}
+
+void EspNow::setPeerWireFormat(const uint8_t mac[6], WireCodec::Format format) {
+    PeerTable::Peer* peer = peerTable.insert(mac);
+    if (!peer) {
+        Logger::warn("Peer table full, wire format not stored");
+        return;
+    }
+    peer->wire = format;
+    Logger::info("Peer %02X:%02X:%02X:%02X:%02X:%02X wire format: %s",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                 format == WireCodec::Format::BINARY ? "binary" : "json");
+}
+
+uint16_t EspNow::negotiateMaxFrame(const uint8_t mac[6], uint16_t peerMax) {
+    uint16_t local = Fragmentation::localMaxFrameLen();
+    uint16_t agreed = peerMax < local ? peerMax : local;
+    if (agreed < WireCodec::MAX_FRAME_LEN) agreed = WireCodec::MAX_FRAME_LEN;
+    PeerTable::Peer* peer = peerTable.insert(mac);
+    if (!peer) return WireCodec::MAX_FRAME_LEN; // not remembered: stay at the v1 limit
+    peer->maxFrame = agreed;
+    Logger::info("Peer %02X:%02X:%02X:%02X:%02X:%02X max frame: %u bytes",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (unsigned)agreed);
+    return agreed;
+}
+
+uint16_t EspNow::getPeerMaxFrame(const uint8_t mac[6]) const {
+    const PeerTable::Peer* peer = peerTable.find(mac);
+    return peer ? peer->maxFrame : WireCodec::MAX_FRAME_LEN;
+}
+
+uint8_t EspNow::negotiateKeyDictionary(const uint8_t mac[6], const char* fw) {
+    uint8_t dict = KeyDictionary::forFirmware(fw);
+    if (dict > KeyDictionary::LATEST) dict = KeyDictionary::LATEST;
+    PeerTable::Peer* peer = peerTable.insert(mac);
+    if (!peer) return KeyDictionary::NONE; // not remembered: keep long keys
+    peer->keyDict = dict;
+    Logger::info("Peer %02X:%02X:%02X:%02X:%02X:%02X key dictionary: v%u",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (unsigned)dict);
+    return dict;
+}
+
+uint8_t EspNow::getPeerKeyDictionary(const uint8_t mac[6]) const {
+    const PeerTable::Peer* peer = peerTable.find(mac);
+    return peer ? peer->keyDict : KeyDictionary::NONE;
+}
+
+WireCodec::Format EspNow::getPeerWireFormat(const uint8_t mac[6]) const {
+    const PeerTable::Peer* peer = peerTable.find(mac);
+    return peer ? peer->wire : WireCodec::Format::JSON;
+}
+
+void EspNow::setPeerHandle(const uint8_t mac[6], int16_t handle) {
+    if (PeerTable::Peer* peer = peerTable.insert(mac)) peer->nodeHandle = handle;
+}
+
+int16_t EspNow::getPeerHandle(const uint8_t mac[6]) const {
+    const PeerTable::Peer* peer = peerTable.find(mac);
+    return peer ? peer->nodeHandle : -1;
 }
 
 bool EspNow::addPeer(const uint8_t mac[6]) {
@@ -538,73 +957,113 @@ bool EspNow::addPeer(const uint8_t mac[6]) {
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    String smac(macStr);
-    
+
+    PeerTable::Peer* peer = peerTable.insert(mac);
+    if (!peer) {
+        Logger::warn("Peer table full (%u), %s not added", (unsigned)PeerTable::MAX_PEERS, macStr);
+        return false;
+    }
+    if (!peer->paired) {
+        peer->paired = true;
+        peer->channel = 0;
+        peerStore.markDirty(millis());
+    }
+
+    // Register now so the reply to a JOIN goes straight out; the cache may
+    // swap it out later and back in before the next unicast
+    PeerCache::Result reg = peerCache.ensure(mac, millis());
+    if (reg == PeerCache::Result::FAILED) {
+        Logger::warn("✗ Failed to register peer %s with the driver", macStr);
+        return initialized;
+    }
+    Logger::debug("Peer %s %s", macStr,
+                  reg == PeerCache::Result::REGISTERED ? "registered" : "queued for a driver slot");
+    return true;
+}
+
+bool EspNow::registerDriverPeer(const uint8_t mac[6]) {
     // Use channel 0 to communicate on current interface channel
     // This ensures communication works regardless of WiFi channel changes
-    Logger::info("Adding peer %s with channel 0 (auto-current)", macStr);
-    
-    // Always try to add peer to ESP-NOW (it will return EXIST if already there)
     esp_now_peer_info_t peerInfo = {};
     memcpy(peerInfo.peer_addr, mac, 6);
     peerInfo.channel = 0; // Use 0 = current interface channel (adapts to WiFi changes)
     peerInfo.encrypt = false; // ✓ Checklist: Encryption disabled
     peerInfo.ifidx = WIFI_IF_STA;
-    
+
     esp_err_t res = esp_now_add_peer(&peerInfo);
-    if (res == ESP_OK) {
-        // Successfully added - update our cache
-        bool found = false;
-        for (const auto& s : peers) {
-            if (s == smac) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            peers.push_back(smac);
-            savePeersToStorage();
+    if (res == ESP_OK || res == ESP_ERR_ESPNOW_EXIST) {
+        // The driver forgets the rate with the peer; give it the current one
+        if (const PeerTable::Peer* peer = peerTable.find(mac)) {
+            setDriverPeerRate(mac, peer->link.rate());
         }
-        Logger::info("✓ Peer registered: %s (channel 0 = auto)", macStr);
         return true;
-    } else if (res == ESP_ERR_ESPNOW_EXIST) {
-        // Already exists in ESP-NOW - ensure it's in our cache
-        bool found = false;
-        for (const auto& s : peers) {
-            if (s == smac) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            peers.push_back(smac);
-            savePeersToStorage();
-        }
-        Logger::debug("Peer already registered: %s", macStr);
-        return true;
-    } else if (res == ESP_ERR_ESPNOW_NOT_INIT || res == 12389) {
-        Logger::error("ESP-NOW not initialized when adding peer %s! Marking for reinit.", macStr);
+    }
+    if (res == ESP_ERR_ESPNOW_NOT_INIT || res == 12389) {
+        Logger::error("ESP-NOW not initialized when adding peer! Marking for reinit.");
         initialized = false;
-        return false;
     } else {
-        Logger::warn("✗ Failed to add peer %s: error %d", macStr, res);
-        return false;
+        Logger::warn("✗ esp_now_add_peer failed: error %d", res);
     }
+    return false;
 }
 
-bool EspNow::removePeer(const uint8_t mac[6]) {
-    esp_err_t res = esp_now_del_peer(mac);
-    if (res == ESP_OK) {
+bool EspNow::setDriverPeerRate(const uint8_t mac[6], LinkQuality::Rate rate) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+    static const wifi_phy_rate_t PHY_RATE[LinkQuality::RATES] = {
+        WIFI_PHY_RATE_1M_L, WIFI_PHY_RATE_6M, WIFI_PHY_RATE_12M,
+        WIFI_PHY_RATE_24M, WIFI_PHY_RATE_36M, WIFI_PHY_RATE_54M};
+    esp_now_rate_config_t cfg = {};
+    cfg.phymode = rate == LinkQuality::Rate::R1M ? WIFI_PHY_MODE_11B : WIFI_PHY_MODE_11G;
+    cfg.rate = PHY_RATE[(size_t)rate];
+    return esp_now_set_peer_rate_config(mac, &cfg) == ESP_OK;
+#else
+    // No per-peer rates before IDF 5.1: everyone stays at the interface rate
+    (void)mac; (void)rate;
+    return false;
+#endif
+}
+
+void EspNow::applyPeerRate(const PeerTable::Peer& peer) {
+    const uint8_t* mac = peer.mac;
+    Logger::info("Link %02X:%02X:%02X:%02X:%02X:%02X: rate %s (rssi %.1f dBm, per %.2f)",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                 peer.link.rateName(), peer.link.rssi(), peer.link.per());
+    // Peers not registered with the driver get their rate on registration
+    if (peerCache.contains(mac)) setDriverPeerRate(mac, peer.link.rate());
+}
+
+std::vector<std::pair<String, LinkReport>> EspNow::getLinkTable() const {
+    std::vector<std::pair<String, LinkReport>> table;
+    table.reserve(peerTable.pairedCount());
+    for (const PeerTable::Peer& peer : peerTable) {
+        if (!peer.paired) continue;
         char macStr[18];
         snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-        String smac(macStr);
-        peers.erase(std::remove(peers.begin(), peers.end(), smac), peers.end());
-        savePeersToStorage();
-        return true;
+                 peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5]);
+        LinkReport r;
+        r.rssiDbm = peer.link.hasRssi() ? peer.link.rssi() : -127.0f;
+        r.lastRssi = peer.stats.lastRssi;
+        r.per = peer.link.per();
+        r.rate = peer.link.rateName();
+        r.sent = peer.link.sent();
+        r.failed = peer.link.failed();
+        r.received = peer.stats.messageCount;
+        r.lastSeenMs = peer.stats.lastSeenMs;
+        table.emplace_back(String(macStr), r);
     }
-    Logger::warn("Failed to remove peer: %d", res);
-    return false;
+    return table;
+}
+
+bool EspNow::removePeer(const uint8_t mac[6]) {
+    peerCache.forget(mac);
+    txQueue.forget(mac);
+    commands.forget(mac);
+    if (!peerTable.erase(mac)) {
+        Logger::warn("Failed to remove peer: not known");
+        return false;
+    }
+    peerStore.markDirty(millis());
+    return true;
 }
 
 void EspNow::updatePeerChannels() {
@@ -630,20 +1089,19 @@ void EspNow::updatePeerChannels() {
         }
     }
     
-    // Update all registered peers
-    for (const auto& macStr : peers) {
-        uint8_t mac[6];
-        if (macStringToBytes(macStr, mac)) {
-            if (esp_now_get_peer(mac, &peerInfo) == ESP_OK) {
-                if (peerInfo.channel != currentChannel) {
-                    esp_now_del_peer(mac);
-                    memcpy(peerInfo.peer_addr, mac, 6);
-                    peerInfo.channel = currentChannel;
-                    peerInfo.encrypt = false;
-                    peerInfo.ifidx = WIFI_IF_STA;
-                    esp_now_add_peer(&peerInfo);
-                    Logger::debug("  ✓ Peer %s updated to channel %d", macStr.c_str(), currentChannel);
-                }
+    // Peers registered on channel 0 follow the interface already and keep
+    // their PHY rate; only one pinned to a channel is re-registered, through
+    // registerDriverPeer (channel 0, rate restored). Peers not in the driver
+    // register that way when swapped in.
+    for (auto& peer : peerTable) {
+        if (!peer.paired) continue;
+        if (esp_now_get_peer(peer.mac, &peerInfo) == ESP_OK) {
+            peer.channel = currentChannel;
+            if (peerInfo.channel != 0 && peerInfo.channel != currentChannel) {
+                esp_now_del_peer(peer.mac);
+                registerDriverPeer(peer.mac);
+                Logger::debug("  ✓ Peer %02X:%02X:%02X:%02X:%02X:%02X re-registered on channel 0",
+                              peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5]);
             }
         }
     }
@@ -651,27 +1109,21 @@ void EspNow::updatePeerChannels() {
 
 void EspNow::clearAllPeers() {
     Logger::info("Clearing all ESP-NOW peers...");
-    size_t count = peers.size();
+    size_t count = peerTable.pairedCount();
     
     // Remove all peers from ESP-NOW
-    for (const auto& macStr : peers) {
-        uint8_t mac[6];
-        if (macStringToBytes(macStr, mac)) {
-            esp_now_del_peer(mac);
-        }
+    peerCache.clear();
+    for (const auto& peer : peerTable) {
+        txQueue.forget(peer.mac);
+        commands.forget(peer.mac);
     }
     
     // Clear internal lists
-    peers.clear();
-    peerStats.clear();
+    peerTable.clear();
     
-    // Clear storage
-    Preferences p;
-    if (p.begin(PREFS_NS, false)) {
-        p.clear();
-        p.putUInt("count", 0);
-        p.end();
-    }
+    // Clear storage now rather than debounced: an empty blob
+    peerStore.markDirty(millis());
+    savePeersToStorage();
     
     Logger::info("Cleared %d ESP-NOW peers", count);
 }
@@ -680,46 +1132,82 @@ void EspNow::loadPeersFromStorage() {
     Preferences p;
     if (!p.begin(PREFS_NS, true)) {
         Logger::warn("Preferences unavailable - peer list will not persist (NVS not ready)");
-        peers.clear();
         return;
     }
-    uint32_t count = p.getUInt("count", 0);
-    peers.clear(); 
-    peers.reserve(count);
-    for (uint32_t i=0; i<count; i++) {
-        String key = String("mac") + String(i);
-        String mac = p.getString(key.c_str(), "");
-        if (mac.length() == 17) peers.push_back(mac);
+    static uint8_t blob[PeerStore::MAX_BLOB];
+    size_t len = p.getBytesLength(PREFS_KEY);
+    if (len > 0 && len <= sizeof(blob) && p.getBytes(PREFS_KEY, blob, len) == len) {
+        int loaded = PeerStore::decode(blob, len, peerTable);
+        if (loaded < 0) Logger::warn("Stored peer list unreadable (%u bytes), ignored", (unsigned)len);
+    } else {
+        // Older firmware: "count" plus one "macN" string per peer
+        uint32_t count = p.getUInt("count", 0);
+        for (uint32_t i=0; i<count; i++) {
+            String key = String("mac") + String(i);
+            String macStr = p.getString(key.c_str(), "");
+            uint8_t mac[6];
+            if (macStr.length() != 17 || !macStringToBytes(macStr, mac)) continue;
+            PeerTable::Peer* peer = peerTable.insert(mac);
+            if (!peer) break;
+            peer->paired = true;
+        }
+        if (count > 0) {
+            legacyPeerKeys = (uint16_t)count;
+            peerStore.markDirty(millis());
+        }
     }
     p.end();
-    Logger::info("Loaded %d peers from storage", peers.size());
+    Logger::info("Loaded %d peers from storage", peerTable.pairedCount());
 }
 
 void EspNow::savePeersToStorage() {
     Preferences p;
     if (!p.begin(PREFS_NS, false)) {
         Logger::debug("Preferences unavailable - peer list not saved (NVS not ready)");
+        peerStore.onWritten(0, false, millis());
         return;
     }
-    p.clear();
-    p.putUInt("count", peers.size());
-    for (size_t i=0; i<peers.size(); ++i) {
-        String key = String("mac") + String(i);
-        p.putString(key.c_str(), peers[i]);
+    static uint8_t blob[PeerStore::MAX_BLOB];
+    size_t len = PeerStore::encode(peerTable, blob, sizeof(blob));
+    // One key, replaced atomically by NVS
+    bool ok = len > 0 && p.putBytes(PREFS_KEY, blob, len) == len;
+    peerStore.onWritten(len, ok, millis());
+    if (ok && legacyPeerKeys > 0) {
+        // The blob is safely stored; the per-peer keys can go
+        p.remove("count");
+        for (uint16_t i = 0; i < legacyPeerKeys; i++) {
+            String key = String("mac") + String(i);
+            p.remove(key.c_str());
+        }
+        peerStore.countWrites(legacyPeerKeys + 1);
+        legacyPeerKeys = 0;
     }
     p.end();
-    Logger::debug("Saved %d peers to storage", peers.size());
+    if (ok) {
+        Logger::debug("Saved %d peers to storage (%u bytes, %lu NVS writes total)",
+                      peerTable.pairedCount(), (unsigned)len, (unsigned long)peerStore.stats().writes);
+    } else {
+        Logger::warn("Saving peer list failed, retrying in %lu ms", (unsigned long)PeerStore::DEBOUNCE_MS);
+    }
 }
 
 int8_t EspNow::getPeerRssi(const String& macStr) const {
-    auto it = peerStats.find(macStr);
-    return (it != peerStats.end()) ? it->second.lastRssi : -127;
+    return getPeerStats(macStr).lastRssi;
+}
+
+void EspNow::stampClockSync(const uint8_t mac[6], uint32_t nodeTs, AckMessage& ack) const {
+    // The peer's last-seen time is the receive-callback timestamp of the frame
+    // being handled (messages are delivered from loop() right after it is set)
+    const PeerTable::Peer* peer = peerTable.find(mac);
+    if (!peer || nodeTs == 0) return;
+    ack.stampClock(nodeTs, peer->stats.lastSeenMs, millis());
 }
 
 PeerStats EspNow::getPeerStats(const String& macStr) const {
-    auto it = peerStats.find(macStr);
-    if (it != peerStats.end()) {
-        return it->second;
+    uint8_t mac[6];
+    const PeerTable::Peer* peer = macStringToBytes(macStr, mac) ? peerTable.find(mac) : nullptr;
+    if (peer) {
+        return peer->stats;
     }
     return PeerStats{-127, 0, 0, 0};
 }
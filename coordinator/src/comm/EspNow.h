@@ -6,18 +6,54 @@
 #include <functional>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include "../Models.h"
+#include "../../shared/src/WireCodec.h"
+#include "../../shared/src/EspNowMessage.h"
+#include "../../shared/src/Fragmentation.h"
+#include "../../shared/src/SpscRing.h"
+#include "TxQueue.h"
+#include "CommandTracker.h"
+#include "PeerTable.h"
+#include "PeerCache.h"
+#include "PeerStore.h"
 
 // Forward declarations for ESP-NOW v2.0 friend functions
 class EspNow;
 void staticRecvCallback(const esp_now_recv_info_t* recv_info, const uint8_t* data, int len);
 void staticSendCallback(const uint8_t* mac, esp_now_send_status_t status);
 
-struct PeerStats {
-    int8_t lastRssi;
-    uint32_t lastSeenMs;
-    uint32_t messageCount;
-    uint32_t failedCount;
+// One node's colour in a batched set_light (see EspNow::sendColorBatch)
+struct LightBatchEntry {
+    String nodeId;
+    uint8_t r, g, b, w;
+    uint16_t fadeMs;
+    int8_t pixel;
+};
+
+// Frame copied out of the ESP-NOW receive callback, processed in EspNow::loop()
+struct RxFrame {
+    uint8_t mac[6];
+    int8_t rssi;
+    uint16_t len;
+    uint32_t rxMs;
+    uint8_t data[Fragmentation::localMaxFrameLen()];
+};
+
+// Send-callback outcome, applied to peer stats and the TX queue in EspNow::loop()
+struct TxStatus {
+    uint8_t mac[6];
+    bool ok;
+    uint32_t atUs; // when the driver reported it
+};
+
+struct RxQueueStats {
+    uint32_t received;       // frames queued by the receive callback
+    uint32_t droppedFull;    // ring full: loop() fell behind
+    uint32_t droppedInvalid; // bad length or not a protocol frame
+    uint32_t highWater;      // deepest the ring has been
+    uint32_t depth;          // frames waiting now
+    uint32_t capacity;
 };
 
 class EspNow {
@@ -33,14 +69,74 @@ public:
     void loop();
     bool isInitialized() const;
 
-    // Communication
+    // Communication. set_light commands are tracked until the node acks their
+    // cmd_id and retransmitted meanwhile (CommandTracker)
     bool sendLightCommand(const String& nodeId, uint8_t brightness, uint16_t fadeMs = 0, bool overrideStatus = false, uint16_t ttlMs = 1500);
-    bool sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs = 0, bool overrideStatus = false, uint16_t ttlMs = 1500, int8_t pixel = -1);
+    // atMs: apply at this millis() of ours on nodes with a synced clock, 0 = on receipt
+    bool sendColorCommand(const String& nodeId, uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs = 0, bool overrideStatus = false, uint16_t ttlMs = 1500, int8_t pixel = -1, uint32_t atMs = 0);
+    // Many nodes at once: binary-wire nodes share broadcast light_batch frames
+    // (up to SetLightBatchMessage::MAX_ENTRIES each), JSON-wire nodes get a
+    // unicast set_light. With more than one node the change is scheduled
+    // LightSchedule::leadMs() ahead so all of them apply it together.
+    // Returns the number of nodes a frame was sent for.
+    size_t sendColorBatch(const std::vector<LightBatchEntry>& targets, bool overrideStatus = false, uint16_t ttlMs = 1500);
     bool broadcastPairingMessage();
+    // Heartbeat: one broadcast for the whole fleet; assigns seq and time_ms,
+    // and carries the pending channel switch, if any
+    bool sendBeacon(BeaconMessage& beacon);
+    // Move the radio and the whole fleet to another channel without
+    // re-pairing: the switch rides on the next CHANNEL_SWITCH_BEACONS beacons
+    // and everyone retunes at the same instant. Nodes that miss them all find
+    // us by searching once beacons stop. Before the first beacon there is no
+    // fleet to tell and the radio moves at once. False for an invalid channel
+    // or when already there.
+    static constexpr uint8_t CHANNEL_SWITCH_BEACONS = 5;
+    bool announceChannelSwitch(uint8_t channel);
+    bool channelSwitchPending() const { return switchChannel != 0; }
     // Convert a MAC string "AA:BB:CC:DD:EE:FF" to six bytes
     static bool macStringToBytes(const String& macStr, uint8_t out[6]);
     // send JSON blob directly to a MAC (raw bytes)
     bool sendToMac(const uint8_t mac[6], const String& json);
+    // Encode with the wire format negotiated for this peer and send
+    bool sendMessage(const uint8_t mac[6], const EspNowMessage& msg);
+    // Clock sync (TimeSync.h): stamp an ack to the telemetry mac just sent at
+    // its own time nodeTs with when it arrived here and when the ack left
+    void stampClockSync(const uint8_t mac[6], uint32_t nodeTs, AckMessage& ack) const;
+    // Up to WireCodec::MAX_MESSAGE_LEN bytes; fragmented when over the peer's frame limit.
+    // Queued, not sent: false means invalid or no room in the peer's TX queue
+    // (backpressure), in which case nothing of the message was queued.
+    // Queued in the traffic class of its message type (priorityFor()).
+    bool sendBytes(const uint8_t mac[6], const uint8_t* data, size_t len);
+    bool sendBytes(const uint8_t mac[6], const uint8_t* data, size_t len, TxQueue::Priority prio);
+    // Light control first, then acks and heartbeats, then everything else
+    static TxQueue::Priority priorityFor(MessageType type);
+    
+    // Wire format negotiated at join (JSON until the node advertises binary)
+    void setPeerWireFormat(const uint8_t mac[6], WireCodec::Format format);
+    WireCodec::Format getPeerWireFormat(const uint8_t mac[6]) const;
+    // Frame limit: the smaller of what the peer advertised and what we support
+    uint16_t negotiateMaxFrame(const uint8_t mac[6], uint16_t peerMaxFrame);
+    uint16_t getPeerMaxFrame(const uint8_t mac[6]) const;
+    // JSON key dictionary the peer's firmware understands (KeyDictionary.h)
+    uint8_t negotiateKeyDictionary(const uint8_t mac[6], const char* fw);
+    uint8_t getPeerKeyDictionary(const uint8_t mac[6]) const;
+    const Reassembler::Stats& getReassemblyStats() const { return reassembler.stats(); }
+    // Received messages dropped or re-anchored by the per-peer sequence windows
+    const SeqWindow::Stats& getSeqStats() const { return seqStats; }
+    RxQueueStats getRxQueueStats() const;
+    const TxQueue::Stats& getTxStats() const { return txQueue.stats(); }
+    uint32_t getTxLatencyPercentileMs(uint8_t percent) const { return txQueue.latencyPercentileMs(percent); }
+    uint32_t getTxLatencyPercentileMs(TxQueue::Priority prio, uint8_t percent) const {
+        return txQueue.latencyPercentileMs(prio, percent);
+    }
+    // Frames of class prio that can be queued for mac right now
+    size_t getTxQueueSpace(const uint8_t mac[6], TxQueue::Priority prio) const { return txQueue.space(mac, prio); }
+    // Driver peer registrations (only recently used peers stay registered)
+    PeerCache::Stats getPeerCacheStats() const { return peerCache.stats(); }
+    // Averaged RSSI, error rate and unicast PHY rate per paired node
+    std::vector<std::pair<String, LinkReport>> getLinkTable() const;
+    // set_light delivery per node id
+    const std::map<String, CommandDeliveryStats>& getDeliveryStats() const { return commands.stats(); }
     
     // Pairing
     void enablePairingMode(uint32_t durationMs = 30000);
@@ -51,34 +147,83 @@ public:
     bool removePeer(const uint8_t mac[6]);
     void clearAllPeers();
     void loadPeersFromStorage();
+    // Write the paired peers now (changes are otherwise saved debounced from loop())
     void savePeersToStorage();
+    const PeerStore::Stats& getPeerStoreStats() const { return peerStore.stats(); }
     
-    // Callbacks
-    void setMessageCallback(std::function<void(const String& nodeId, const uint8_t* data, size_t len)> callback);
-    void setPairingCallback(std::function<void(const uint8_t* mac, const uint8_t* data, size_t len)> callback);
+    // Callbacks (frames are decoded once at the radio boundary and passed by reference)
+    void setMessageCallback(std::function<void(const String& nodeId, const EspNowMessage& msg)> callback);
+    void setPairingCallback(std::function<void(const uint8_t* mac, const JoinRequestMessage& request)> callback);
     void setSendErrorCallback(std::function<void(const String& nodeId)> callback);
     
     // Connection quality
     int8_t getPeerRssi(const String& macStr) const;
     PeerStats getPeerStats(const String& macStr) const;
+    // Application slot stored with the peer (e.g. a node index), -1 = none
+    void setPeerHandle(const uint8_t mac[6], int16_t handle);
+    int16_t getPeerHandle(const uint8_t mac[6]) const;
 
 private:
     bool initialized;
     bool pairingEnabled;
     uint32_t pairingEndTime;
-    std::function<void(const String& nodeId, const uint8_t* data, size_t len)> messageCallback;
-    std::function<void(const uint8_t* mac, const uint8_t* data, size_t len)> pairingCallback;
+    std::function<void(const String& nodeId, const EspNowMessage& msg)> messageCallback;
+    std::function<void(const uint8_t* mac, const JoinRequestMessage& request)> pairingCallback;
     std::function<void(const String& nodeId)> sendErrorCallback;
 
-    void handleEspNowReceive(const uint8_t* mac, const uint8_t* data, int len);
+    // Driver callbacks only copy into these rings; loop() does the rest
+    static constexpr size_t RX_RING_SIZE = 32;
+    static constexpr size_t TX_STATUS_RING_SIZE = 16;
+    SpscRing<RxFrame, RX_RING_SIZE> rxRing;
+    SpscRing<TxStatus, TX_STATUS_RING_SIZE> txStatusRing;
+    std::atomic<uint32_t> rxDroppedInvalid;
+    // Outgoing frames, released to the driver as send_cb completions come back
+    TxQueue txQueue;
+    CommandTracker commands;
+    uint32_t lastCmdStamp;
+
+    void drainRxRing();
+    void drainTxStatusRing();
+    void handleEspNowReceive(const RxFrame& frame);
     void processReceivedData(const uint8_t* mac, const uint8_t* data, int len);
+    bool broadcastBatch(SetLightBatchMessage& batch);
+    // Assign a fresh cmd_id, send and track until acked
+    bool sendTrackedCommand(const uint8_t mac[6], SetLightMessage& msg);
+    bool sendFrame(const uint8_t mac[6], const uint8_t* data, size_t len, TxQueue::Priority prio);
+    // Copy data into txScratch with mac's next sequence number; 0 if not numbered
+    size_t stampSeq(const uint8_t mac[6], const uint8_t* data, size_t len);
+    TxQueue::SendStatus transmitFrame(const uint8_t mac[6], const uint8_t* data, size_t len);
 
-    // Peer persistence cache
+    // Peer persistence: one PeerStore blob under PREFS_KEY. Older firmware kept
+    // "count" plus a "macN" string per peer; those are migrated on first save.
     static constexpr const char* PREFS_NS = "peers";
-    std::vector<String> peers; // stored as MAC strings
-    
-    // Connection quality tracking
-    std::map<String, PeerStats> peerStats;
+    static constexpr const char* PREFS_KEY = "tbl";
+    PeerStore peerStore;
+    uint16_t legacyPeerKeys;
+
+    // Paired peers, connection quality and negotiated settings, by MAC
+    PeerTable peerTable;
+    // The subset registered with the driver, swapped in before unicasts
+    PeerCache peerCache;
+    bool registerDriverPeer(const uint8_t mac[6]);
+    // Unicast PHY rate for a registered peer (esp_now_set_peer_rate_config)
+    bool setDriverPeerRate(const uint8_t mac[6], LinkQuality::Rate rate);
+    // The peer's link estimate picked a new rate
+    void applyPeerRate(const PeerTable::Peer& peer);
+    Reassembler reassembler;
+    uint8_t fragmentSeq;
+    // Broadcasts are numbered apart from each peer's unicasts
+    uint16_t broadcastSeq;
+    SeqWindow::Stats seqStats;
+    uint8_t txScratch[WireCodec::MAX_MESSAGE_LEN];
+    // Reused decode target for received frames (no per-frame allocation)
+    MessageSlot rxSlot;
+    uint32_t batchSeq;
+    uint16_t beaconSeq;
+    uint16_t beaconPeriodMs;   // of the last beacon sent, 0 = none yet
+    uint8_t switchChannel;     // announced channel switch, 0 = none
+    uint32_t switchAtMs;
+    void moveToChannel(uint8_t channel);
 
 public:
     void updatePeerChannels();
@@ -0,0 +1,106 @@
+#include "LinkQuality.h"
+
+// ESP32-S3 receiver sensitivity (datasheet) plus 10 dB; 1 Mbps takes anything
+const int8_t LinkQuality::MIN_RSSI[LinkQuality::RATES] = {-128, -83, -80, -75, -72, -66};
+const char* const LinkQuality::RATE_NAME[LinkQuality::RATES] = {"1M", "6M", "12M", "24M", "36M", "54M"};
+
+// Data bits per 4 us OFDM symbol; index 0 (DSSS) unused
+static const uint16_t OFDM_BITS_PER_SYMBOL[LinkQuality::RATES] = {0, 24, 48, 96, 144, 216};
+
+LinkQuality::LinkQuality() {
+    reset();
+}
+
+void LinkQuality::reset() {
+    rssiAvg = -127.0f;
+    perAvg = 0.0f;
+    current = Rate::R1M;
+    ceiling = Rate::R54M;
+    samples = 0;
+    sinceCeiling = 0;
+    rssiCount = 0;
+    sentCount = 0;
+    failedCount = 0;
+}
+
+LinkQuality::Rate LinkQuality::supported(int8_t margin) const {
+    size_t best = 0;
+    if (!hasRssi()) return Rate::R1M;
+    for (size_t r = 1; r <= (size_t)ceiling; ++r) {
+        if (rssiAvg >= (float)(MIN_RSSI[r] + margin)) best = r;
+    }
+    return (Rate)best;
+}
+
+void LinkQuality::moveTo(Rate r) {
+    current = r;
+    samples = 0;
+    perAvg = 0.0f; // the old rate's error rate says little about the new one
+}
+
+bool LinkQuality::onRssi(int8_t rssi) {
+    if (rssi == -127) return false; // not reported
+    if (rssiCount == 0) {
+        rssiAvg = rssi;
+    } else {
+        rssiAvg += ALPHA * ((float)rssi - rssiAvg);
+    }
+    if (rssiCount < UINT16_MAX) rssiCount++;
+
+    // First reading places a new peer straight away instead of climbing
+    if (rssiCount == 1 && sentCount == 0) {
+        Rate start = supported(HYSTERESIS_DB);
+        if (start == current) return false;
+        moveTo(start);
+        return true;
+    }
+    // Signal fell below what the current rate needs: drop at once
+    if (current != Rate::R1M && rssiAvg < MIN_RSSI[(size_t)current]) {
+        moveTo(supported(0));
+        return true;
+    }
+    return false;
+}
+
+bool LinkQuality::onSend(bool ok) {
+    sentCount++;
+    if (!ok) failedCount++;
+    perAvg += ALPHA * ((ok ? 0.0f : 1.0f) - perAvg);
+    if (samples < UINT16_MAX) samples++;
+
+    if (ceiling != Rate::R54M && ok && ++sinceCeiling >= CEILING_SAMPLES) {
+        ceiling = Rate::R54M;
+    }
+    if (perAvg > PER_DOWN && current != Rate::R1M) {
+        Rate lower = (Rate)((size_t)current - 1);
+        ceiling = lower;
+        sinceCeiling = 0;
+        moveTo(lower);
+        return true;
+    }
+    if (samples >= MIN_SAMPLES && perAvg < PER_UP) {
+        Rate target = supported(HYSTERESIS_DB);
+        if (target > current) {
+            moveTo(target);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t LinkQuality::airtimeUs(Rate r, size_t payload, bool unicast) {
+    // 43 bytes of vendor action frame around the ESP-NOW payload; the MAC ACK is 14
+    const uint32_t frameBits = (uint32_t)(43 + payload) * 8;
+    if (r == Rate::R1M) {
+        // Long preamble DSSS; the ACK goes at 1 Mbps too
+        uint32_t us = 192 + frameBits;
+        return unicast ? us + 10 + 192 + 14 * 8 : us;
+    }
+    // OFDM: 20 us preamble and SIGNAL, 16 service + 6 tail bits, 6 us signal extension
+    const uint32_t bps = OFDM_BITS_PER_SYMBOL[(size_t)r];
+    uint32_t us = 20 + 4 * ((16 + frameBits + 6 + bps - 1) / bps) + 6;
+    if (!unicast) return us;
+    // ACK at the highest basic rate not above the data rate (6, 12 or 24 Mbps)
+    const uint32_t ackBps = r >= Rate::R24M ? 96 : (r == Rate::R12M ? 48 : 24);
+    return us + 10 + 20 + 4 * ((16 + 14 * 8 + 6 + ackBps - 1) / ackBps) + 6;
+}
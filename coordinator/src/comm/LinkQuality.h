@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Link quality of one peer and the PHY rate unicast frames to it go out at.
+//
+// RSSI comes from every frame the peer sends us, the packet error rate from
+// the send callback of every unicast frame we send it (a failure there means
+// the driver ran out of MAC retries). Both are exponentially weighted moving
+// averages, so one faded frame does not move the rate.
+//
+// The rate is the fastest one whose RSSI floor the averaged RSSI clears:
+// near tiles get short OFDM frames, far tiles keep 1 Mbps DSSS, which reaches
+// furthest. Moving up needs HYSTERESIS_DB above the next floor, MIN_SAMPLES
+// sends at the current rate and a low error rate; a high error rate steps one
+// rate down at once and keeps the rate that failed off limits for
+// CEILING_SAMPLES good sends, so an RSSI that looks better than the link is
+// does not flap between the two. The radio side (esp_now_set_peer_rate_config)
+// stays in EspNow; this class has no dependencies so it can be tested.
+class LinkQuality {
+public:
+    // Rates unicast can use, slowest (longest range) first. 2, 5.5 and 11 Mbps
+    // DSSS are left out: 6 Mbps OFDM is as sensitive as 5.5 and shorter on air.
+    enum class Rate : uint8_t { R1M, R6M, R12M, R24M, R36M, R54M };
+    static constexpr size_t RATES = 6;
+
+    static constexpr float ALPHA = 0.125f;        // weight of each new sample
+    static constexpr int8_t HYSTERESIS_DB = 4;
+    static constexpr uint8_t MIN_SAMPLES = 16;    // sends at a rate before moving up
+    static constexpr uint16_t CEILING_SAMPLES = 256;
+    static constexpr float PER_DOWN = 0.20f;      // step down above this
+    static constexpr float PER_UP = 0.02f;        // step up only below this
+
+    // Averaged RSSI needed for each rate: receiver sensitivity plus ~10 dB fade margin
+    static const int8_t MIN_RSSI[RATES];
+    static const char* const RATE_NAME[RATES];
+
+    LinkQuality();
+    void reset();
+
+    // RSSI of a frame received from the peer; true when rate() changed
+    bool onRssi(int8_t rssi);
+    // Send callback of a unicast frame to the peer; true when rate() changed
+    bool onSend(bool ok);
+
+    bool hasRssi() const { return rssiCount > 0; }
+    float rssi() const { return rssiAvg; }
+    float per() const { return perAvg; }
+    Rate rate() const { return current; }
+    const char* rateName() const { return RATE_NAME[(size_t)current]; }
+    uint32_t sent() const { return sentCount; }
+    uint32_t failed() const { return failedCount; }
+
+    // On-air time of one frame carrying `payload` ESP-NOW bytes at rate r,
+    // MAC ACK included for unicast
+    static uint32_t airtimeUs(Rate r, size_t payload, bool unicast);
+
+private:
+    // Fastest rate the averaged RSSI supports, below any ceiling
+    Rate supported(int8_t margin) const;
+    void moveTo(Rate r);
+
+    float rssiAvg;
+    float perAvg;
+    Rate current;
+    Rate ceiling;           // highest rate allowed; R54M = none
+    uint16_t samples;       // sends since the rate last changed
+    uint16_t sinceCeiling;  // good sends since the ceiling was set
+    uint16_t rssiCount;
+    uint32_t sentCount;
+    uint32_t failedCount;
+};
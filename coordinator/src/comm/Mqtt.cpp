@@ -274,6 +274,7 @@ void Mqtt::publishNodeStatus(const NodeStatusMessage& status) {
     doc["button_pressed"] = status.button_pressed;
     doc["vbat_mv"] = status.vbat_mv;
     doc["fw"] = status.fw.length() > 0 ? status.fw.c_str() : "";
+    doc["clock_err_ms"] = status.clock_err_ms;
     
     String payload;
     serializeJson(doc, payload);
@@ -689,7 +690,7 @@ void Mqtt::processMessage(const String& topic, const String& payload) {
 
 void Mqtt::publishCoordinatorTelemetry(const CoordinatorSensorSnapshot& snapshot) {
     if (!mqttClient.connected()) return;
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<384> doc;
     uint32_t ts = snapshot.timestampMs ? snapshot.timestampMs : millis();
     doc["ts"] = ts / 1000;
     doc["site_id"] = siteId;
@@ -701,11 +702,58 @@ void Mqtt::publishCoordinatorTelemetry(const CoordinatorSensorSnapshot& snapshot
     doc["mmwave_online"] = snapshot.mmWaveOnline;
     doc["wifi_rssi"] = snapshot.wifiConnected ? snapshot.wifiRssi : -127;
     doc["wifi_connected"] = snapshot.wifiConnected;
+    doc["espnow_rx_dropped"] = snapshot.espNowRxDropped;
+    doc["espnow_rx_hwm"] = snapshot.espNowRxHighWater;
     String payload;
     serializeJson(doc, payload);
     mqttClient.publish(coordinatorTelemetryTopic().c_str(), payload.c_str());
 }
 
+// site/{siteId}/node/{nodeId}/delivery: set_light ack rate and latency
+void Mqtt::publishCommandDelivery(const String& nodeId, const CommandDeliveryStats& stats) {
+    if (!mqttClient.connected()) return;
+    StaticJsonDocument<512> doc;
+    doc["ts"] = millis() / 1000;
+    doc["node_id"] = nodeId;
+    doc["commands"] = stats.commands;
+    doc["delivered"] = stats.delivered;
+    doc["expired"] = stats.expired;
+    doc["superseded"] = stats.superseded;
+    doc["retransmits"] = stats.retransmits;
+    // Superseded commands were neither delivered nor lost
+    uint32_t settled = stats.delivered + stats.expired;
+    doc["success_rate"] = settled ? (float)stats.delivered / (float)settled : 1.0f;
+    JsonObject ack = doc.createNestedObject("ack_ms");
+    ack["avg"] = stats.delivered ? stats.ackLatencySumMs / stats.delivered : 0;
+    ack["max"] = stats.ackLatencyMaxMs;
+    JsonArray limits = ack.createNestedArray("le");
+    for (uint16_t limit : CommandDeliveryStats::BUCKET_LIMIT_MS) limits.add(limit);
+    JsonArray counts = ack.createNestedArray("counts");
+    for (uint32_t n : stats.ackLatencyBuckets) counts.add(n);
+    String payload;
+    serializeJson(doc, payload);
+    mqttClient.publish(nodeDeliveryTopic(nodeId).c_str(), payload.c_str());
+}
+
+// site/{siteId}/node/{nodeId}/link: the coordinator's link table, one node per message
+void Mqtt::publishLinkQuality(const String& nodeId, const LinkReport& link) {
+    if (!mqttClient.connected()) return;
+    StaticJsonDocument<384> doc;
+    doc["ts"] = millis() / 1000;
+    doc["node_id"] = nodeId;
+    doc["rssi"] = link.rssiDbm;
+    doc["last_rssi"] = link.lastRssi;
+    doc["per"] = link.per;
+    doc["rate"] = link.rate;
+    doc["sent"] = link.sent;
+    doc["failed"] = link.failed;
+    doc["received"] = link.received;
+    doc["age_s"] = link.lastSeenMs ? (millis() - link.lastSeenMs) / 1000 : 0;
+    String payload;
+    serializeJson(doc, payload);
+    mqttClient.publish(nodeLinkTopic(nodeId).c_str(), payload.c_str());
+}
+
 void Mqtt::publishSerialLog(const String& message, const String& level, const String& tag) {
     if (!mqttClient.connected()) return;
     StaticJsonDocument<512> doc;
@@ -724,6 +772,14 @@ String Mqtt::nodeTelemetryTopic(const String& nodeId) const {
     return "site/" + siteId + "/node/" + nodeId + "/telemetry";
 }
 
+String Mqtt::nodeDeliveryTopic(const String& nodeId) const {
+    return "site/" + siteId + "/node/" + nodeId + "/delivery";
+}
+
+String Mqtt::nodeLinkTopic(const String& nodeId) const {
+    return "site/" + siteId + "/node/" + nodeId + "/link";
+}
+
 String Mqtt::coordinatorTelemetryTopic() const {
     String id = coordId.length() ? coordId : WiFi.macAddress();
     return "site/" + siteId + "/coord/" + id + "/telemetry";
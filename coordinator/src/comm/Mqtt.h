@@ -26,6 +26,8 @@ public:
     void publishMmWaveEvent(const MmWaveEvent& event);
     void publishNodeStatus(const NodeStatusMessage& status);
     void publishCoordinatorTelemetry(const CoordinatorSensorSnapshot& snapshot);
+    void publishCommandDelivery(const String& nodeId, const CommandDeliveryStats& stats);
+    void publishLinkQuality(const String& nodeId, const LinkReport& link);
     void publishSerialLog(const String& message, const String& level = "INFO", const String& tag = "");
     
     // Configuration
@@ -79,6 +81,8 @@ private:
     void runReachabilityProbe();
 
     String nodeTelemetryTopic(const String& nodeId) const;
+    String nodeDeliveryTopic(const String& nodeId) const;
+    String nodeLinkTopic(const String& nodeId) const;
     String coordinatorTelemetryTopic() const;
     String coordinatorCmdTopic() const;
     String coordinatorSerialTopic() const;
@@ -0,0 +1,101 @@
+#include "PeerCache.h"
+
+PeerCache::PeerCache() : capacity(MAX_SLOTS - 1), count(0), addFn(nullptr), removeFn(nullptr), busyFn(nullptr) {
+    for (auto& s : slots) s.used = false;
+    memset(&counters, 0, sizeof(counters));
+}
+
+void PeerCache::setCapacity(size_t slotCount) {
+    capacity = slotCount < MAX_SLOTS ? slotCount : MAX_SLOTS;
+}
+
+PeerCache::Slot* PeerCache::find(const uint8_t mac[6]) {
+    for (auto& s : slots) {
+        if (s.used && memcmp(s.mac, mac, 6) == 0) return &s;
+    }
+    return nullptr;
+}
+
+const PeerCache::Slot* PeerCache::find(const uint8_t mac[6]) const {
+    for (const auto& s : slots) {
+        if (s.used && memcmp(s.mac, mac, 6) == 0) return &s;
+    }
+    return nullptr;
+}
+
+PeerCache::Slot* PeerCache::victim(uint32_t nowMs) {
+    Slot* oldest = nullptr;
+    for (auto& s : slots) {
+        if (!s.used || (busyFn && busyFn(s.mac))) continue;
+        if (!oldest || nowMs - s.lastUsedMs > nowMs - oldest->lastUsedMs) oldest = &s;
+    }
+    return oldest;
+}
+
+PeerCache::Result PeerCache::ensure(const uint8_t mac[6], uint32_t nowMs) {
+    if (Slot* s = find(mac)) {
+        s->lastUsedMs = nowMs;
+        counters.hits++;
+        return Result::REGISTERED;
+    }
+
+    Slot* slot = nullptr;
+    if (count < capacity) {
+        for (auto& s : slots) {
+            if (!s.used) { slot = &s; break; }
+        }
+    } else {
+        slot = victim(nowMs);
+        if (!slot) return Result::NO_SLOT;
+        if (removeFn) removeFn(slot->mac);
+        slot->used = false;
+        count--;
+        counters.evictions++;
+    }
+
+    counters.misses++;
+    if (addFn && !addFn(mac)) {
+        counters.failures++;
+        return Result::FAILED;
+    }
+    slot->used = true;
+    memcpy(slot->mac, mac, 6);
+    slot->lastUsedMs = nowMs;
+    count++;
+    return Result::REGISTERED;
+}
+
+void PeerCache::touch(const uint8_t mac[6], uint32_t nowMs) {
+    if (Slot* s = find(mac)) s->lastUsedMs = nowMs;
+}
+
+bool PeerCache::contains(const uint8_t mac[6]) const {
+    return find(mac) != nullptr;
+}
+
+void PeerCache::forget(const uint8_t mac[6]) {
+    Slot* s = find(mac);
+    if (!s) return;
+    if (removeFn) removeFn(s->mac);
+    s->used = false;
+    count--;
+}
+
+void PeerCache::clear() {
+    for (auto& s : slots) {
+        if (s.used && removeFn) removeFn(s.mac);
+    }
+    reset();
+}
+
+void PeerCache::reset() {
+    for (auto& s : slots) s.used = false;
+    count = 0;
+}
+
+PeerCache::Stats PeerCache::stats() const {
+    Stats st = counters;
+    st.registered = (uint16_t)count;
+    st.capacity = (uint16_t)capacity;
+    return st;
+}
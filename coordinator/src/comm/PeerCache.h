@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+// Which peers are registered with the ESP-NOW driver right now.
+//
+// The driver holds at most ESP_NOW_MAX_TOTAL_PEER_NUM (20) peers, one of them
+// the broadcast address, while a coordinator may own hundreds of tiles. Paired
+// peers live in PeerTable; only the recently used ones are registered with
+// the driver, and ensure() swaps the least recently used one out before a
+// unicast to a peer that is not. A peer with frames in flight (busy) is never
+// evicted, since the driver still owes its send callbacks.
+//
+// Runs on the loop task only.
+class PeerCache {
+public:
+    static constexpr size_t MAX_SLOTS = 20;   // ESP_NOW_MAX_TOTAL_PEER_NUM
+
+    enum class Result : uint8_t {
+        REGISTERED,  // mac is registered with the driver
+        NO_SLOT,     // every slot belongs to a busy peer; try again later
+        FAILED       // the driver refused the peer
+    };
+
+    using Register = std::function<bool(const uint8_t mac[6])>;
+    using Unregister = std::function<void(const uint8_t mac[6])>;
+    using Busy = std::function<bool(const uint8_t mac[6])>;
+
+    struct Stats {
+        uint32_t hits;       // ensure() found the peer registered
+        uint32_t misses;     // ensure() had to register it
+        uint32_t evictions;  // LRU peers unregistered to make room
+        uint32_t failures;   // driver refused a registration
+        uint16_t registered; // peers registered now
+        uint16_t capacity;
+    };
+
+    PeerCache();
+
+    void setDriver(Register add, Unregister remove) { addFn = add; removeFn = remove; }
+    void setBusy(Busy fn) { busyFn = fn; }
+    // Driver slots available to unicast peers (the rest are someone else's)
+    void setCapacity(size_t slots);
+
+    // Make sure mac is registered, evicting the least recently used idle peer
+    Result ensure(const uint8_t mac[6], uint32_t nowMs);
+    // Heard from mac: keep it registered longer if it is
+    void touch(const uint8_t mac[6], uint32_t nowMs);
+    bool contains(const uint8_t mac[6]) const;
+    // Unregister mac
+    void forget(const uint8_t mac[6]);
+    // Unregister everything
+    void clear();
+    // The driver dropped every peer (ESP-NOW reinit): forget them without
+    // unregistering
+    void reset();
+
+    size_t size() const { return count; }
+    Stats stats() const;
+
+private:
+    struct Slot {
+        bool used;
+        uint8_t mac[6];
+        uint32_t lastUsedMs;
+    };
+
+    Slot* find(const uint8_t mac[6]);
+    const Slot* find(const uint8_t mac[6]) const;
+    Slot* victim(uint32_t nowMs);
+
+    Slot slots[MAX_SLOTS];
+    size_t capacity;
+    size_t count;
+    Register addFn;
+    Unregister removeFn;
+    Busy busyFn;
+    Stats counters;
+};
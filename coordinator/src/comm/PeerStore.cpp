@@ -0,0 +1,85 @@
+#include "PeerStore.h"
+
+PeerStore::PeerStore() : dirty(false), firstChangeMs(0), lastChangeMs(0) {
+    memset(&counters, 0, sizeof(counters));
+}
+
+uint32_t PeerStore::crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+size_t PeerStore::encode(const PeerTable& table, uint8_t* out, size_t cap) {
+    size_t count = table.pairedCount();
+    size_t len = HEADER_LEN + count * RECORD_LEN;
+    if (len > cap) return 0;
+
+    uint8_t* rec = out + HEADER_LEN;
+    for (const auto& peer : table) {
+        if (!peer.paired) continue;
+        memcpy(rec, peer.mac, 6);
+        rec += RECORD_LEN;
+    }
+    uint32_t crc = crc32(out + HEADER_LEN, count * RECORD_LEN);
+    out[0] = VERSION;
+    out[1] = RECORD_LEN;
+    out[2] = (uint8_t)count;
+    out[3] = (uint8_t)(count >> 8);
+    out[4] = (uint8_t)crc;
+    out[5] = (uint8_t)(crc >> 8);
+    out[6] = (uint8_t)(crc >> 16);
+    out[7] = (uint8_t)(crc >> 24);
+    return len;
+}
+
+int PeerStore::decode(const uint8_t* data, size_t len, PeerTable& table) {
+    if (len < HEADER_LEN) return -1;
+    uint8_t version = data[0];
+    size_t recordLen = data[1];
+    size_t count = (size_t)data[2] | ((size_t)data[3] << 8);
+    uint32_t crc = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    // Later versions only append per-record fields; anything else is unknown
+    if (version == 0 || version > VERSION || recordLen < RECORD_LEN) return -1;
+    if (len != HEADER_LEN + count * recordLen) return -1;
+    if (crc32(data + HEADER_LEN, count * recordLen) != crc) return -1;
+
+    int loaded = 0;
+    const uint8_t* rec = data + HEADER_LEN;
+    for (size_t i = 0; i < count; ++i, rec += recordLen) {
+        PeerTable::Peer* peer = table.insert(rec);
+        if (!peer) break;
+        peer->paired = true;
+        loaded++;
+    }
+    return loaded;
+}
+
+void PeerStore::markDirty(uint32_t nowMs) {
+    if (!dirty) firstChangeMs = nowMs;
+    dirty = true;
+    lastChangeMs = nowMs;
+    counters.changes++;
+}
+
+bool PeerStore::due(uint32_t nowMs) const {
+    if (!dirty) return false;
+    return nowMs - lastChangeMs >= DEBOUNCE_MS || nowMs - firstChangeMs >= MAX_DELAY_MS;
+}
+
+void PeerStore::onWritten(size_t len, bool ok, uint32_t nowMs) {
+    if (ok) {
+        dirty = false;
+        counters.writes++;
+        counters.bytesWritten += len;
+        return;
+    }
+    counters.failed++;
+    // Leave it dirty and try again after a quiet period
+    firstChangeMs = lastChangeMs = nowMs;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include "PeerTable.h"
+
+// Persisted form of the paired peers: one packed, versioned blob under a
+// single NVS key, written back lazily.
+//
+// NVS writes a new value for a key before it invalidates the old one, so a
+// single putBytes() either lands completely or leaves the previous blob in
+// place - a crash mid-save can never leave a half-written peer list. Changes
+// are coalesced: the blob is written once DEBOUNCE_MS pass without another
+// change, and at the latest MAX_DELAY_MS after the first unsaved one, so a
+// pairing burst costs one flash write instead of one rewrite per peer.
+//
+// Blob layout (little-endian):
+//   [0] version  [1] record length  [2..3] count  [4..7] CRC-32 of the records
+//   then count records: MAC[6] (a newer version may append fields per record)
+class PeerStore {
+public:
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_LEN = 8;
+    static constexpr size_t RECORD_LEN = 6;
+    static constexpr size_t MAX_BLOB = HEADER_LEN + PeerTable::MAX_PEERS * RECORD_LEN;
+    static constexpr uint32_t DEBOUNCE_MS = 2000;
+    static constexpr uint32_t MAX_DELAY_MS = 10000;
+
+    struct Stats {
+        uint32_t writes;       // NVS write operations (blob saves, legacy key removal)
+        uint32_t bytesWritten;
+        uint32_t failed;       // saves NVS refused (retried after DEBOUNCE_MS)
+        uint32_t changes;      // markDirty() calls, i.e. what used to be full rewrites
+    };
+
+    PeerStore();
+
+    // Paired peers of table into out; 0 if cap is too small
+    static size_t encode(const PeerTable& table, uint8_t* out, size_t cap);
+    // Peers in a blob, inserted into table as paired; -1 if the blob is damaged
+    // or from a newer firmware
+    static int decode(const uint8_t* data, size_t len, PeerTable& table);
+
+    // The paired set changed at nowMs
+    void markDirty(uint32_t nowMs);
+    bool isDirty() const { return dirty; }
+    // Time to write the blob back
+    bool due(uint32_t nowMs) const;
+    // A save of len bytes finished (ok) or failed at nowMs
+    void onWritten(size_t len, bool ok, uint32_t nowMs);
+    // Other NVS writes done on the store's behalf
+    void countWrites(uint32_t n) { counters.writes += n; }
+
+    const Stats& stats() const { return counters; }
+
+private:
+    static uint32_t crc32(const uint8_t* data, size_t len);
+
+    bool dirty;
+    uint32_t firstChangeMs;
+    uint32_t lastChangeMs;
+    Stats counters;
+};
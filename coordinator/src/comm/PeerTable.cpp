@@ -0,0 +1,90 @@
+#include "PeerTable.h"
+
+PeerTable::PeerTable() : count(0) {
+    for (auto& slot : index) slot = EMPTY;
+}
+
+size_t PeerTable::probe(uint64_t key) const {
+    size_t i = home(key);
+    while (index[i] != EMPTY && entries[index[i]].key != key) {
+        i = (i + 1) & MASK;
+    }
+    return i;
+}
+
+PeerTable::Peer* PeerTable::find(const uint8_t mac[6]) {
+    int16_t e = index[probe(key(mac))];
+    return e == EMPTY ? nullptr : &entries[e];
+}
+
+const PeerTable::Peer* PeerTable::find(const uint8_t mac[6]) const {
+    int16_t e = index[probe(key(mac))];
+    return e == EMPTY ? nullptr : &entries[e];
+}
+
+PeerTable::Peer* PeerTable::insert(const uint8_t mac[6]) {
+    uint64_t k = key(mac);
+    size_t i = probe(k);
+    if (index[i] != EMPTY) return &entries[index[i]];
+    if (count == MAX_PEERS) return nullptr;
+
+    Peer& p = entries[count];
+    p.key = k;
+    memcpy(p.mac, mac, 6);
+    p.paired = false;
+    p.channel = 0;
+    p.wire = WireCodec::Format::JSON;
+    p.maxFrame = WireCodec::MAX_FRAME_LEN;
+    p.keyDict = 0;
+    p.nodeHandle = -1;
+    p.lastJoinMs = 0;
+    // Random start: a restarted coordinator does not replay numbers the node just saw
+    p.txSeq = (uint16_t)esp_random();
+    p.rxSeq.reset();
+    p.stats = PeerStats{-127, 0, 0, 0};
+    p.link.reset();
+    index[i] = (int16_t)count++;
+    return &p;
+}
+
+bool PeerTable::erase(const uint8_t mac[6]) {
+    size_t i = probe(key(mac));
+    int16_t e = index[i];
+    if (e == EMPTY) return false;
+
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole unless that would move them before their home slot
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & MASK;
+        if (index[j] == EMPTY) break;
+        size_t h = home(entries[index[j]].key);
+        if (((j - h) & MASK) >= ((j - i) & MASK)) {
+            index[i] = index[j];
+            i = j;
+        }
+    }
+    index[i] = EMPTY;
+
+    // Keep entries dense: the last one moves into the freed entry
+    size_t last = count - 1;
+    if ((size_t)e != last) {
+        entries[e] = entries[last];
+        index[probe(entries[e].key)] = e;
+    }
+    count--;
+    return true;
+}
+
+void PeerTable::clear() {
+    for (auto& slot : index) slot = EMPTY;
+    count = 0;
+}
+
+size_t PeerTable::pairedCount() const {
+    size_t n = 0;
+    for (const Peer& p : *this) {
+        if (p.paired) n++;
+    }
+    return n;
+}
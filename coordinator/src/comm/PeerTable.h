@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+#include "../../shared/src/WireCodec.h"
+#include "../../shared/src/SeqWindow.h"
+#include "LinkQuality.h"
+
+struct PeerStats {
+    int8_t lastRssi;
+    uint32_t lastSeenMs;
+    uint32_t messageCount;
+    uint32_t failedCount;
+};
+
+// Everything EspNow knows about a peer, keyed by its MAC as a 48-bit integer.
+//
+// Entries are stored densely (iteration touches only live peers) and found
+// through an open-addressed index of entry numbers with linear probing. The
+// index is kept at most half full and deletes shift the following run back
+// instead of leaving tombstones, so a lookup is a hash, a short probe and one
+// key compare - no String formatting, no allocation. Erasing moves the last
+// entry into the hole, so Peer pointers are only valid until the next
+// insert() or erase().
+class PeerTable {
+public:
+    static constexpr size_t MAX_PEERS = 256;
+    static constexpr size_t INDEX_BITS = 9;
+    static constexpr size_t INDEX_SIZE = (size_t)1 << INDEX_BITS; // >= 2 * MAX_PEERS
+
+    struct Peer {
+        uint64_t key;
+        uint8_t mac[6];
+        bool paired;               // paired and persisted (driver registration: PeerCache)
+        uint8_t channel;           // driver channel, 0 = follow the interface
+        WireCodec::Format wire;    // negotiated at join (JSON until then)
+        uint16_t maxFrame;         // negotiated at join
+        uint8_t keyDict;           // KeyDictionary version, negotiated at join
+        int16_t nodeHandle;        // caller's slot for this node, -1 = none
+        uint32_t lastJoinMs;       // last JOIN_REQUEST answered, 0 = none
+        uint16_t txSeq;            // sequence number of our next message to it
+        SeqWindow rxSeq;           // its sequence numbers we have seen
+        PeerStats stats;
+        LinkQuality link;          // RSSI/PER averages and the unicast PHY rate
+    };
+
+    PeerTable();
+
+    static uint64_t key(const uint8_t mac[6]) {
+        return ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+               ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5];
+    }
+
+    Peer* find(const uint8_t mac[6]);
+    const Peer* find(const uint8_t mac[6]) const;
+    // Existing entry, or a new one with defaults; nullptr when the table is full
+    Peer* insert(const uint8_t mac[6]);
+    bool erase(const uint8_t mac[6]);
+    void clear();
+
+    size_t size() const { return count; }
+    size_t pairedCount() const;
+    Peer* begin() { return entries; }
+    Peer* end() { return entries + count; }
+    const Peer* begin() const { return entries; }
+    const Peer* end() const { return entries + count; }
+
+private:
+    static constexpr int16_t EMPTY = -1;
+    static constexpr size_t MASK = INDEX_SIZE - 1;
+    static_assert(INDEX_SIZE >= 2 * MAX_PEERS, "index must stay at most half full");
+
+    static size_t home(uint64_t key) {
+        // Fibonacci hashing: the vendor OUI in the high bytes is shared by most
+        // of the fleet, so mix everything before taking the top bits
+        return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - INDEX_BITS));
+    }
+    // Index slot holding key, or the empty slot where it would go
+    size_t probe(uint64_t key) const;
+
+    int16_t index[INDEX_SIZE];
+    Peer entries[MAX_PEERS];
+    size_t count;
+};
@@ -0,0 +1,289 @@
+#include "TxQueue.h"
+
+const uint16_t TxQueue::BUCKET_LIMIT_MS[TxQueue::LATENCY_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100};
+// Frames already in the driver go first: a light command waits behind at most
+// two acks, and bulk only goes when the radio is otherwise idle
+const uint8_t TxQueue::IN_FLIGHT_LIMIT[TxQueue::PRIORITIES] = {MAX_IN_FLIGHT, 2, 1};
+// Light control always finds six frames (a light_batch round for 138 nodes)
+const uint8_t TxQueue::POOL_RESERVE[TxQueue::PRIORITIES] = {0, 6, 16};
+
+const char* TxQueue::priorityName(Priority prio) {
+    switch (prio) {
+        case Priority::INTERACTIVE: return "interactive";
+        case Priority::ROUTINE: return "routine";
+        case Priority::BULK: return "bulk";
+    }
+    return "?";
+}
+
+TxQueue::TxQueue() : freeHead(0), freeCount(POOL_FRAMES), cursor{}, transmit(nullptr), expiredOwed(0), counters{} {
+    for (size_t i = 0; i < POOL_FRAMES; ++i) {
+        pool[i].next = (i + 1 < POOL_FRAMES) ? (int16_t)(i + 1) : NONE;
+    }
+    for (auto& p : peers) p.used = false;
+}
+
+int16_t TxQueue::allocFrame() {
+    int16_t idx = freeHead;
+    if (idx != NONE) {
+        freeHead = pool[idx].next;
+        pool[idx].next = NONE;
+        freeCount--;
+    }
+    return idx;
+}
+
+void TxQueue::freeFrame(int16_t idx) {
+    pool[idx].next = freeHead;
+    freeHead = idx;
+    freeCount++;
+}
+
+TxQueue::Peer* TxQueue::find(const uint8_t mac[6]) {
+    for (auto& p : peers) {
+        if (p.used && memcmp(p.mac, mac, 6) == 0) return &p;
+    }
+    return nullptr;
+}
+
+const TxQueue::Peer* TxQueue::find(const uint8_t mac[6]) const {
+    for (const auto& p : peers) {
+        if (p.used && memcmp(p.mac, mac, 6) == 0) return &p;
+    }
+    return nullptr;
+}
+
+TxQueue::Peer* TxQueue::findOrClaim(const uint8_t mac[6]) {
+    Peer* p = find(mac);
+    if (p) return p;
+    for (auto& slot : peers) {
+        if (slot.used) continue;
+        slot.used = true;
+        memcpy(slot.mac, mac, 6);
+        for (size_t c = 0; c < PRIORITIES; ++c) {
+            slot.head[c] = slot.tail[c] = NONE;
+            slot.waitingBy[c] = 0;
+        }
+        slot.flightHead = slot.flightTail = NONE;
+        slot.waiting = 0;
+        slot.inFlight = 0;
+        slot.expired = 0;
+        return &slot;
+    }
+    return nullptr;
+}
+
+void TxQueue::releaseIfIdle(Peer& p) {
+    if (p.waiting == 0 && p.inFlight == 0 && p.expired == 0) p.used = false;
+}
+
+TxQueue::Result TxQueue::enqueue(const uint8_t mac[6], const uint8_t* data, size_t len, uint32_t nowUs,
+                                 Priority prio) {
+    if (len == 0 || len > MAX_FRAME) return Result::TOO_LARGE;
+    const size_t c = (size_t)prio;
+    ClassStats& cs = counters.byClass[c];
+    Peer* p = findOrClaim(mac);
+    if (!p || p->waitingBy[c] >= FRAMES_PER_PEER || freeCount <= POOL_RESERVE[c]) {
+        if (p) releaseIfIdle(*p);
+        counters.dropped++;
+        cs.dropped++;
+        return Result::FULL;
+    }
+    int16_t idx = allocFrame();
+    Frame& f = pool[idx];
+    f.len = (uint16_t)len;
+    f.queuedUs = nowUs;
+    f.prio = (uint8_t)c;
+    memcpy(f.data, data, len);
+    if (p->tail[c] == NONE) p->head[c] = idx; else pool[p->tail[c]].next = idx;
+    p->tail[c] = idx;
+    p->waiting++;
+    p->waitingBy[c]++;
+
+    counters.queued++;
+    cs.queued++;
+    counters.depth++;
+    if (counters.depth > counters.maxDepth) counters.maxDepth = counters.depth;
+    return Result::QUEUED;
+}
+
+size_t TxQueue::space(const uint8_t mac[6], Priority prio) const {
+    const size_t c = (size_t)prio;
+    size_t poolFree = freeCount > POOL_RESERVE[c] ? freeCount - POOL_RESERVE[c] : 0;
+    const Peer* p = find(mac);
+    size_t peerFree = p ? FRAMES_PER_PEER - p->waitingBy[c] : FRAMES_PER_PEER;
+    return peerFree < poolFree ? peerFree : poolFree;
+}
+
+size_t TxQueue::depth(const uint8_t mac[6]) const {
+    const Peer* p = find(mac);
+    return p ? p->waiting : 0;
+}
+
+size_t TxQueue::inFlight(const uint8_t mac[6]) const {
+    const Peer* p = find(mac);
+    return p ? p->inFlight : 0;
+}
+
+void TxQueue::pump(uint32_t nowUs) {
+    expire(nowUs);
+    if (!transmit) return;
+    // A class gets the driver only once nothing above it can go
+    for (size_t c = 0; c < PRIORITIES; ++c) {
+        if (!pumpClass(c, nowUs)) return;
+    }
+}
+
+bool TxQueue::pumpClass(size_t c, uint32_t nowUs) {
+    // One frame per peer per pass, passes repeated until the windows are full
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        size_t start = cursor[c];
+        for (size_t n = 0; n < MAX_PEERS; ++n) {
+            if (counters.inFlight >= IN_FLIGHT_LIMIT[c]) return true;
+            size_t slot = (start + n) % MAX_PEERS;
+            Peer& p = peers[slot];
+            if (!p.used || p.head[c] == NONE || p.inFlight >= PEER_WINDOW) continue;
+
+            int16_t idx = p.head[c];
+            Frame& f = pool[idx];
+            SendStatus st = transmit(p.mac, f.data, f.len);
+            if (st == SendStatus::BUSY) {
+                // Driver queue full: everything waits for the next completion
+                counters.busy++;
+                cursor[c] = slot;
+                return false;
+            }
+            p.head[c] = f.next;
+            if (p.head[c] == NONE) p.tail[c] = NONE;
+            p.waiting--;
+            p.waitingBy[c]--;
+            counters.depth--;
+            f.next = NONE;
+            progress = true;
+
+            if (st == SendStatus::FAILED) {
+                counters.rejected++;
+                freeFrame(idx);
+                releaseIfIdle(p);
+                continue;
+            }
+            f.sentUs = nowUs;
+            if (p.flightTail == NONE) p.flightHead = idx; else pool[p.flightTail].next = idx;
+            p.flightTail = idx;
+            p.inFlight++;
+            counters.inFlight++;
+            counters.sent++;
+            counters.byClass[c].sent++;
+            cursor[c] = (slot + 1) % MAX_PEERS; // next turn starts with the following peer
+        }
+    }
+    return true;
+}
+
+void TxQueue::onComplete(const uint8_t mac[6], bool ok, uint32_t nowUs) {
+    Peer* p = find(mac);
+    if (!p) return; // sent outside the queue
+    if (p->expired > 0) {
+        // Completions come oldest first, so this one is for a frame expire()
+        // already wrote off, not for the frame now at the head
+        p->expired--;
+        expiredOwed--;
+        counters.late++;
+        releaseIfIdle(*p);
+        return;
+    }
+    if (p->flightHead == NONE) return;
+    int16_t idx = p->flightHead;
+    Frame& f = pool[idx];
+    p->flightHead = f.next;
+    if (p->flightHead == NONE) p->flightTail = NONE;
+    p->inFlight--;
+    counters.inFlight--;
+    if (ok) counters.delivered++; else counters.failed++;
+    recordLatency(nowUs - f.queuedUs, f.prio);
+    freeFrame(idx);
+    releaseIfIdle(*p);
+}
+
+void TxQueue::expire(uint32_t nowUs) {
+    if (counters.inFlight == 0 && expiredOwed == 0) return;
+    for (auto& p : peers) {
+        if (!p.used) continue;
+        // Written-off callbacks still missing a timeout later never come
+        // (e.g. ESP-NOW deinit); stop waiting for them
+        if (p.expired > 0 && nowUs - p.expiredUs > COMPLETION_TIMEOUT_US) {
+            expiredOwed -= p.expired;
+            p.expired = 0;
+        }
+        while (p.flightHead != NONE && nowUs - pool[p.flightHead].sentUs > COMPLETION_TIMEOUT_US) {
+            int16_t idx = p.flightHead;
+            p.flightHead = pool[idx].next;
+            if (p.flightHead == NONE) p.flightTail = NONE;
+            p.inFlight--;
+            counters.inFlight--;
+            counters.timedOut++;
+            p.expired++;
+            p.expiredUs = nowUs;
+            expiredOwed++;
+            freeFrame(idx);
+        }
+        releaseIfIdle(p);
+    }
+}
+
+void TxQueue::forget(const uint8_t mac[6]) {
+    Peer* p = find(mac);
+    if (!p) return;
+    for (size_t c = 0; c < PRIORITIES; ++c) {
+        for (int16_t i = p->head[c]; i != NONE;) {
+            int16_t next = pool[i].next;
+            freeFrame(i);
+            i = next;
+        }
+    }
+    for (int16_t i = p->flightHead; i != NONE;) {
+        int16_t next = pool[i].next;
+        freeFrame(i);
+        i = next;
+    }
+    counters.depth -= p->waiting;
+    counters.inFlight -= p->inFlight;
+    expiredOwed -= p->expired;
+    p->used = false;
+}
+
+void TxQueue::recordLatency(uint32_t us, uint8_t prio) {
+    size_t b = 0;
+    while (b < LATENCY_BUCKETS - 1 && us >= (uint32_t)BUCKET_LIMIT_MS[b] * 1000U) ++b;
+    counters.latencyCount++;
+    counters.latencySumUs += us;
+    if (us > counters.latencyMaxUs) counters.latencyMaxUs = us;
+    counters.latencyBuckets[b]++;
+    ClassStats& cs = counters.byClass[prio];
+    cs.latencyCount++;
+    cs.latencySumUs += us;
+    if (us > cs.latencyMaxUs) cs.latencyMaxUs = us;
+    cs.latencyBuckets[b]++;
+}
+
+uint32_t TxQueue::percentileMs(const uint32_t* buckets, uint32_t count, uint32_t maxUs, uint8_t percent) {
+    if (count == 0) return 0;
+    uint64_t want = ((uint64_t)count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS - 1; ++b) {
+        seen += buckets[b];
+        if (seen >= want) return BUCKET_LIMIT_MS[b];
+    }
+    return (maxUs + 999) / 1000;
+}
+
+uint32_t TxQueue::latencyPercentileMs(uint8_t percent) const {
+    return percentileMs(counters.latencyBuckets, counters.latencyCount, counters.latencyMaxUs, percent);
+}
+
+uint32_t TxQueue::latencyPercentileMs(Priority prio, uint8_t percent) const {
+    const ClassStats& cs = counters.byClass[(size_t)prio];
+    return percentileMs(cs.latencyBuckets, cs.latencyCount, cs.latencyMaxUs, percent);
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include "../../shared/src/Fragmentation.h"
+
+// Per-peer transmit queues for ESP-NOW.
+//
+// esp_now_send() only hands a frame to the driver; the outcome arrives later
+// in the send callback, and the driver refuses new frames (NO_MEM) while its
+// own queue is full. Frames are queued here per peer and handed to the driver
+// from pump(): at most PEER_WINDOW frames per peer and MAX_IN_FLIGHT overall
+// wait for a completion, and peers take turns so one long burst cannot starve
+// the others. A frame the driver is too busy for stays at the head of its
+// queue for the next pump(); nothing blocks.
+//
+// Every frame carries a Priority. pump() serves the classes strictly in
+// order, so a queued set_light goes ahead of any ack or log frame still
+// waiting. Frames already handed to the driver cannot be overtaken, so the
+// lower classes only get the driver while few frames are in flight
+// (IN_FLIGHT_LIMIT), and leave part of the pool free (POOL_RESERVE); a light
+// command then waits behind at most a couple of frames, however busy the
+// acks and bulk transfers keep the radio.
+//
+// Frames live in a fixed pool, so enqueue() reports backpressure (FULL)
+// instead of allocating. Not thread-safe: enqueue/pump/onComplete all run on
+// the loop task (send callbacks reach it through EspNow's status ring).
+class TxQueue {
+public:
+    static constexpr size_t MAX_PEERS = 32;         // peers with frames queued or in flight
+    static constexpr size_t POOL_FRAMES = 48;
+    static constexpr size_t FRAMES_PER_PEER = Fragmentation::MAX_FRAGMENTS; // one full fragmented message
+    static constexpr size_t PEER_WINDOW = 2;        // per-peer frames awaiting send_cb
+    static constexpr size_t MAX_IN_FLIGHT = 6;      // all peers
+    static constexpr uint32_t COMPLETION_TIMEOUT_US = 200000;
+    static constexpr size_t LATENCY_BUCKETS = 8;
+    static constexpr size_t MAX_FRAME = Fragmentation::localMaxFrameLen();
+    static constexpr size_t PRIORITIES = 3;
+
+    // Traffic classes, highest first
+    enum class Priority : uint8_t {
+        INTERACTIVE, // light control and join_accept: someone is waiting on it
+        ROUTINE,     // acks, beacons and pings: late is fine, lost is not
+        BULK         // logs, config, OTA: whatever capacity is left
+    };
+    static const char* priorityName(Priority prio);
+
+    enum class Result : uint8_t {
+        QUEUED,
+        FULL,      // peer queue or frame pool exhausted; try again later
+        TOO_LARGE
+    };
+
+    // What the driver did with a frame handed to it
+    enum class SendStatus : uint8_t {
+        SENT,      // accepted; a completion will follow
+        BUSY,      // driver queue full; retry on a later pump()
+        FAILED     // rejected for good; the frame is dropped
+    };
+
+    using Transmit = std::function<SendStatus(const uint8_t mac[6], const uint8_t* data, size_t len)>;
+
+    struct ClassStats {
+        uint32_t queued;
+        uint32_t dropped;
+        uint32_t sent;
+        // Enqueue -> send_cb: waiting here and in the driver, plus airtime
+        uint32_t latencyCount;
+        uint32_t latencyMaxUs;
+        uint64_t latencySumUs;
+        uint32_t latencyBuckets[LATENCY_BUCKETS];
+    };
+
+    struct Stats {
+        uint32_t queued;    // frames accepted by enqueue()
+        uint32_t dropped;   // enqueue() refused: queue or pool full
+        uint32_t sent;      // handed to the driver
+        uint32_t delivered; // send_cb reported success
+        uint32_t failed;    // send_cb reported failure
+        uint32_t rejected;  // driver refused the frame outright
+        uint32_t busy;      // driver NO_MEM, frame retried later
+        uint32_t timedOut;  // no send_cb within COMPLETION_TIMEOUT_US
+        uint32_t late;      // send_cb for a timed-out frame, discarded
+        uint16_t depth;     // frames waiting now (not yet sent)
+        uint16_t maxDepth;  // high-water of depth
+        uint16_t inFlight;  // sent, waiting for send_cb
+        // Enqueue -> send_cb latency
+        uint32_t latencyCount;
+        uint32_t latencyMaxUs;
+        uint64_t latencySumUs;
+        // < 1, 2, 5, 10, 20, 50, 100 ms, and above
+        uint32_t latencyBuckets[LATENCY_BUCKETS];
+        ClassStats byClass[PRIORITIES];
+    };
+
+    TxQueue();
+
+    void setTransmit(Transmit fn) { transmit = fn; }
+
+    // Queue one frame for mac (all frames of a message go through one peer
+    // queue, in one class, so they leave in order)
+    Result enqueue(const uint8_t mac[6], const uint8_t* data, size_t len, uint32_t nowUs, Priority prio);
+    // Frames of class prio that mac can still queue right now
+    size_t space(const uint8_t mac[6], Priority prio) const;
+    // Frames waiting for mac, all classes
+    size_t depth(const uint8_t mac[6]) const;
+    // Frames of mac handed to the driver and still waiting for send_cb
+    size_t inFlight(const uint8_t mac[6]) const;
+
+    // Hand queued frames to the driver while the windows allow
+    void pump(uint32_t nowUs);
+    // Send callback result for mac (oldest in-flight frame of that peer; the
+    // first callbacks after a timeout belong to the timed-out frames)
+    void onComplete(const uint8_t mac[6], bool ok, uint32_t nowUs);
+    // Drop everything queued or in flight for mac
+    void forget(const uint8_t mac[6]);
+
+    const Stats& stats() const { return counters; }
+    // Latency below which `percent` of completions fell, from the buckets (ms)
+    uint32_t latencyPercentileMs(uint8_t percent) const;
+    uint32_t latencyPercentileMs(Priority prio, uint8_t percent) const;
+    static const uint16_t BUCKET_LIMIT_MS[LATENCY_BUCKETS - 1];
+    // A class is handed to the driver only while fewer frames than this are in flight
+    static const uint8_t IN_FLIGHT_LIMIT[PRIORITIES];
+    // Pool frames a class must leave free for the classes above it
+    static const uint8_t POOL_RESERVE[PRIORITIES];
+
+private:
+    static constexpr int16_t NONE = -1;
+
+    struct Frame {
+        int16_t next;
+        uint16_t len;
+        uint32_t queuedUs;
+        uint32_t sentUs;
+        uint8_t prio;
+        uint8_t data[MAX_FRAME];
+    };
+
+    struct Peer {
+        bool used;
+        uint8_t mac[6];
+        int16_t head[PRIORITIES], tail[PRIORITIES]; // waiting frames, per class
+        int16_t flightHead, flightTail; // sent, oldest first
+        uint8_t waiting;                // all classes
+        uint8_t waitingBy[PRIORITIES];
+        uint8_t inFlight;
+        // Frames expire() wrote off whose send_cb may still arrive, and when
+        // the last was; the slot is kept until they come or time out too
+        uint8_t expired;
+        uint32_t expiredUs;
+    };
+
+    Peer* find(const uint8_t mac[6]);
+    const Peer* find(const uint8_t mac[6]) const;
+    Peer* findOrClaim(const uint8_t mac[6]);
+    void releaseIfIdle(Peer& p);
+    int16_t allocFrame();
+    void freeFrame(int16_t idx);
+    // false when the driver is busy
+    bool pumpClass(size_t cls, uint32_t nowUs);
+    void recordLatency(uint32_t us, uint8_t prio);
+    void expire(uint32_t nowUs);
+    static uint32_t percentileMs(const uint32_t* buckets, uint32_t count, uint32_t maxUs, uint8_t percent);
+
+    Frame pool[POOL_FRAMES];
+    int16_t freeHead;
+    size_t freeCount;
+    Peer peers[MAX_PEERS];
+    size_t cursor[PRIORITIES];  // round-robin start for the next pump(), per class
+    Transmit transmit;
+    size_t expiredOwed; // sum of Peer::expired
+    Stats counters;
+};
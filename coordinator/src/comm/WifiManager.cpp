@@ -18,6 +18,9 @@ bool WifiManager::begin() {
 
     WiFi.mode(WIFI_STA);
     WiFi.setSleep(false);
+    // The driver's own reconnect would follow the AP to a new channel and
+    // leave the ESP-NOW fleet behind; loop() reconnects instead
+    WiFi.setAutoReconnect(false);
 
     // Try stored credentials first
     if (!storedSsid.isEmpty()) {
@@ -75,8 +78,26 @@ void WifiManager::loop() {
 
     if (WiFi.status() != WL_CONNECTED) {
         uint32_t now = millis();
+        if (pendingChannel != 0) {
+            // Announced: connect once the radio and the nodes are on it
+            if (espNow && espNow->channelSwitchPending()) return;
+            uint8_t channel = pendingChannel;
+            pendingChannel = 0;
+            lastReconnectAttempt = now;
+            attemptConnect(storedSsid, storedPassword, false, channel, pendingBssid);
+            return;
+        }
         if (now - lastReconnectAttempt > 10000) {
             lastReconnectAttempt = now;
+            // The AP may have moved channel; if so the fleet moves with us
+            uint8_t channel = 0;
+            uint8_t bssid[6];
+            if (espNow && findAccessPoint(storedSsid, channel, bssid) &&
+                espNow->announceChannelSwitch(channel)) {
+                pendingChannel = channel;
+                memcpy(pendingBssid, bssid, 6);
+                return;
+            }
             attemptConnect(storedSsid, storedPassword, false);
         }
     } else {
@@ -98,7 +119,8 @@ bool WifiManager::ensureConnected() {
     return attemptConnect(storedSsid, storedPassword);
 }
 
-bool WifiManager::attemptConnect(const String& ssid, const String& password, bool verbose) {
+bool WifiManager::attemptConnect(const String& ssid, const String& password, bool verbose,
+                                 uint8_t channel, const uint8_t* bssid) {
     if (ssid.isEmpty()) {
         return false;
     }
@@ -112,7 +134,7 @@ bool WifiManager::attemptConnect(const String& ssid, const String& password, boo
     // The second parameter (true) would erase WiFi config AND deinit radio, breaking ESP-NOW!
     WiFi.disconnect(false, false);
     delay(100);
-    WiFi.begin(ssid.c_str(), password.c_str());
+    WiFi.begin(ssid.c_str(), password.c_str(), channel, bssid);
 
     uint32_t start = millis();
     while (WiFi.status() != WL_CONNECTED && (millis() - start) < 20000) {
@@ -143,6 +165,22 @@ bool WifiManager::attemptConnect(const String& ssid, const String& password, boo
     return false;
 }
 
+bool WifiManager::findAccessPoint(const String& ssid, uint8_t& channel, uint8_t bssid[6]) {
+    // Only this SSID, 120 ms per channel: ESP-NOW is off the air meanwhile
+    int count = WiFi.scanNetworks(/*async=*/false, /*hidden=*/false, /*passive=*/false, 120, 0, ssid.c_str());
+    int best = -1;
+    for (int i = 0; i < count; ++i) {
+        if (WiFi.SSID(i) != ssid) continue;
+        if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best)) best = i;
+    }
+    if (best >= 0) {
+        channel = (uint8_t)WiFi.channel(best);
+        memcpy(bssid, WiFi.BSSID(best), 6);
+    }
+    WiFi.scanDelete();
+    return best >= 0;
+}
+
 bool WifiManager::interactiveSetup() {
     while (true) {
         String chosenSsid;
@@ -36,8 +36,16 @@ private:
     Status status;
     uint32_t lastReconnectAttempt;
     class EspNow* espNow = nullptr;
+    // AP found on another channel: the fleet is told first (EspNow's channel
+    // switch) and the connect waits until everyone has moved
+    uint8_t pendingChannel = 0;
+    uint8_t pendingBssid[6] = {};
 
-    bool attemptConnect(const String& ssid, const String& password, bool verbose = true);
+    // channel/bssid: skip the driver's all-channel scan and join this AP
+    bool attemptConnect(const String& ssid, const String& password, bool verbose = true,
+                        uint8_t channel = 0, const uint8_t* bssid = nullptr);
+    // Strongest AP advertising ssid; false when none is in range
+    bool findAccessPoint(const String& ssid, uint8_t& channel, uint8_t bssid[6]);
     bool interactiveSetup();
     bool promptYesNo(const String& prompt);
     String promptLine(const String& prompt, bool allowEmpty = false, bool hide = false);
@@ -2,6 +2,7 @@
 #include "../utils/Logger.h"
 #include "../../shared/src/EspNowMessage.h"
 #include "../../shared/src/ConfigManager.h"
+#include "../../shared/src/TimeSync.h"
 #include "../comm/WifiManager.h"
 #include "../sensors/AmbientLightSensor.h"
 #include <algorithm>
@@ -95,10 +96,8 @@ bool Coordinator::begin() {
     }
 
     // Register message callback for regular node messages
-    espNow->setMessageCallback([this](const String& nodeId, const uint8_t* data, size_t len) {
-        if (data && len > 0) {
-            this->handleNodeMessage(nodeId, data, len);
-        }
+    espNow->setMessageCallback([this](const String& nodeId, const EspNowMessage& msg) {
+        this->handleNodeMessage(nodeId, msg);
     });
 
     // Register send error callback for visual feedback
@@ -109,17 +108,11 @@ bool Coordinator::begin() {
     });
     
     // Register pairing callback to handle join requests coming from nodes
-    espNow->setPairingCallback([this](const uint8_t* mac, const uint8_t* data, size_t len) {
-        if (!mac || !data || len == 0) {
+    espNow->setPairingCallback([this](const uint8_t* mac, const JoinRequestMessage& request) {
+        if (!mac) {
             Logger::warn("Invalid pairing callback parameters");
             return;
         }
-        String payload((const char*)data, len);
-        MessageType mt = MessageFactory::getMessageType(payload);
-        if (mt != MessageType::JOIN_REQUEST) {
-            Logger::warn("Pairing callback: unexpected message type");
-            return;
-        }
 
         // Format MAC string
         char macStr[18];
@@ -154,13 +147,19 @@ bool Coordinator::begin() {
         accept.cfg.pwm_freq = 0; // Not used but set explicitly
         accept.cfg.rx_window_ms = 20;
         accept.cfg.rx_period_ms = 100;
-        String json = accept.toJson();
+        // Negotiate the packed binary codec if the node advertised it
+        accept.bin_wire = request.caps.bin_wire;
+        espNow->setPeerWireFormat(mac, accept.bin_wire ? WireCodec::Format::BINARY : WireCodec::Format::JSON);
+        // ESP-NOW v2 frames if both sides have them, fragmentation otherwise
+        accept.max_frame = espNow->negotiateMaxFrame(mac, request.caps.max_frame);
+        // Short JSON keys if the node's firmware knows the dictionary
+        accept.key_dict = espNow->negotiateKeyDictionary(mac, request.fw.c_str());
         
-        // Debug: log the message we're sending
-        Logger::info("JOIN_ACCEPT message (%d bytes): %s", json.length(), json.c_str());
+        Logger::info("JOIN_ACCEPT -> %s (fw=%s, wire=%s, mtu=%u, keys=v%u)", macStr, request.fw.c_str(),
+                     accept.bin_wire ? "binary" : "json", (unsigned)accept.max_frame, (unsigned)accept.key_dict);
 
         // send back to node mac (will auto-add peer if missing)
-        if (!espNow->sendToMac(mac, json)) {
+        if (!espNow->sendMessage(mac, accept)) {
             Logger::warn("Failed to send join_accept to %s", macStr);
         } else {
             Logger::info("Sent join_accept to %s", macStr);
@@ -380,12 +379,12 @@ void Coordinator::loop() {
         updateLeds();
     }
 
-    // Periodically ping and check staleness
+    // Periodic heartbeat beacon and staleness check
     static uint32_t lastPing = 0;
     static uint32_t lastStaleCheck = 0;
     uint32_t now = millis();
-    if (now - lastPing > 2000) {
-        sendHealthPings();
+    if (now - lastPing >= BEACON_PERIOD_MS) {
+        sendBeacon();
         lastPing = now;
     }
     if (now - lastStaleCheck > 5000) {
@@ -394,6 +393,8 @@ void Coordinator::loop() {
     }
 
     refreshCoordinatorSensors();
+    publishCommandDelivery();
+    publishLinkTable();
     printSerialTelemetry();
 }
 
@@ -414,19 +415,22 @@ void Coordinator::onMmWaveEvent(const MmWaveEvent& event) {
     if (event.zoneOccupied != zoneOccupiedState) {
         zoneOccupiedState = event.zoneOccupied;
         
+        // Entered zone: all node LEDs GREEN; left zone: off (available for manual control)
         auto allNodes = nodes->getAllNodes();
+        std::vector<LightBatchEntry> batch;
+        batch.reserve(allNodes.size());
+        uint8_t g = zoneOccupiedState ? 255 : 0;
+        for (const auto& nodeInfo : allNodes) {
+            batch.push_back({nodeInfo.nodeId, 0, g, 0, 0, 200 /*fadeMs*/, -1});
+        }
+        size_t sent = espNow->sendColorBatch(batch);
+        Logger::info("%s ZONE - %s sent to %u/%u node(s)",
+                     zoneOccupiedState ? "ENTERED" : "LEFT",
+                     zoneOccupiedState ? "GREEN" : "OFF",
+                     (unsigned)sent, (unsigned)allNodes.size());
+
+        // Publish state change to MQTT
         for (const auto& nodeInfo : allNodes) {
-            if (zoneOccupiedState) {
-                // Just entered zone: turn all node LEDs GREEN
-                espNow->sendColorCommand(nodeInfo.nodeId, 0, 255, 0, 0, 200); // Green, 200ms fade
-                Logger::info("ENTERED ZONE - sending GREEN to node %s", nodeInfo.nodeId.c_str());
-            } else {
-                // Just left zone: turn off LEDs (available for manual control)
-                espNow->sendColorCommand(nodeInfo.nodeId, 0, 0, 0, 0, 200); // Off, 200ms fade
-                Logger::info("LEFT ZONE - turning off node %s (manual control available)", nodeInfo.nodeId.c_str());
-            }
-            
-            // Publish state change to MQTT
             mqtt->publishLightState(nodeInfo.lightId, zoneOccupiedState ? 255 : 0);
         }
     }
@@ -481,10 +485,9 @@ void Coordinator::onButtonEvent(const String& buttonId, bool pressed) {
     startPairingWindow(windowMs, "button");
 }
 
-void Coordinator::handleNodeMessage(const String& nodeId, const uint8_t* data, size_t len) {
-    // Parse the JSON payload to detect message type
-    String payload((const char*)data, len);
-    MessageType mt = MessageFactory::getMessageType(payload);
+void Coordinator::handleNodeMessage(const String& nodeId, const EspNowMessage& msg) {
+    // Frame was already decoded by EspNow; dispatch on the typed message
+    MessageType mt = msg.type;
 
     // Auto-accept any node JOIN_REQUEST (no formal pairing required)
     if (mt == MessageType::JOIN_REQUEST && nodes) {
@@ -507,6 +510,9 @@ void Coordinator::handleNodeMessage(const String& nodeId, const uint8_t* data, s
             existingLight = lightId;
             Logger::info("Auto-registered node %s as %s", nodeId.c_str(), lightId.c_str());
         }
+        // A (re)joining node starts its telemetry with a fresh keyframe
+        telemetryBaselines.forget(nodeId);
+        telemetryAcks.forget(nodeId);
         
         // Always respond with join_accept
         JoinAcceptMessage accept;
@@ -520,11 +526,16 @@ void Coordinator::handleNodeMessage(const String& nodeId, const uint8_t* data, s
         accept.wifi_channel = currentChannel;
         accept.cfg.rx_window_ms = 20;
         accept.cfg.rx_period_ms = 100;
-        String json = accept.toJson();
         
         uint8_t mac2[6];
         if (EspNow::macStringToBytes(nodeId, mac2)) {
-            if (!espNow->sendToMac(mac2, json)) {
+            // Negotiate the packed binary codec if the node advertised it
+            const JoinRequestMessage& request = static_cast<const JoinRequestMessage&>(msg);
+            accept.bin_wire = request.caps.bin_wire;
+            espNow->setPeerWireFormat(mac2, accept.bin_wire ? WireCodec::Format::BINARY : WireCodec::Format::JSON);
+            accept.max_frame = espNow->negotiateMaxFrame(mac2, request.caps.max_frame);
+            accept.key_dict = espNow->negotiateKeyDictionary(mac2, request.fw.c_str());
+            if (!espNow->sendMessage(mac2, accept)) {
                 Logger::warn("Failed to send join_accept to %s", nodeId.c_str());
             } else {
                 Logger::info("Sent join_accept to %s", nodeId.c_str());
@@ -552,20 +563,42 @@ void Coordinator::handleNodeMessage(const String& nodeId, const uint8_t* data, s
     }
 
     // Improved logging per node index with MAC
-    Logger::info("[Node %d] %s %s | %d bytes", 
+    bool isTelemetry = mt == MessageType::NODE_STATUS || mt == MessageType::NODE_STATUS_DELTA;
+    Logger::info("[Node %d] %s %s", 
                  idx >= 0 ? idx + 1 : 0,
                  nodeId.c_str(),
-                 mt == MessageType::NODE_STATUS ? "STATUS" : "MESSAGE", 
-                 (int)len);
+                 isTelemetry ? "STATUS" : "MESSAGE");
 
     // Mark last seen on status and log sensor data
-    if (mt == MessageType::NODE_STATUS && nodes) {
+    if (isTelemetry && nodes) {
         nodes->updateNodeStatus(nodeId, 0);
+
+        // Rebuild full telemetry state: keyframes become the node's baseline,
+        // deltas are applied on top of it
+        NodeStatusMessage rebuilt;
+        const NodeStatusMessage* statusMsg = nullptr;
+        AckMessage ack;
+        ack.cmd_id = TelemetryDelta::ACK_CMD;
+        bool keyframe = false;
+        if (mt == MessageType::NODE_STATUS) {
+            statusMsg = static_cast<const NodeStatusMessage*>(&msg);
+            telemetryBaselines.storeKeyframe(nodeId, *statusMsg);
+            // key_id 0: a plain full report (JSON wire), no baseline to confirm
+            keyframe = statusMsg->key_id != 0;
+            if (keyframe) ack.key_id = statusMsg->key_id;
+        } else {
+            const NodeStatusDeltaMessage& delta = static_cast<const NodeStatusDeltaMessage&>(msg);
+            if (telemetryBaselines.apply(nodeId, delta, rebuilt)) {
+                statusMsg = &rebuilt;
+            } else {
+                // Baseline unknown (e.g. coordinator restarted): ask for a keyframe
+                Logger::debug("No telemetry baseline %u for %s, requesting keyframe", delta.base_key, nodeId.c_str());
+                ack.cmd_id = TelemetryDelta::RESYNC_CMD;
+            }
+        }
         
-        // Parse and log sensor data from telemetry
-        EspNowMessage* msg = MessageFactory::createMessage(payload);
-        if (msg && msg->type == MessageType::NODE_STATUS) {
-            NodeStatusMessage* statusMsg = static_cast<NodeStatusMessage*>(msg);
+        // Log sensor data from telemetry
+        if (statusMsg) {
             updateNodeTelemetryCache(nodeId, *statusMsg);
             
             // Log temperature if available
@@ -580,18 +613,21 @@ void Coordinator::handleNodeMessage(const String& nodeId, const uint8_t* data, s
                          idx >= 0 ? idx + 1 : 0,
                          statusMsg->button_pressed ? "PRESSED" : "Released",
                          statusMsg->avg_r, statusMsg->avg_g, statusMsg->avg_b, statusMsg->avg_w);
-            
-            delete msg;
         }
         
-        // Send ACK back to node to keep connection alive
+        // The next beacon acks this report for the node's liveness check; a
+        // unicast ack only when it confirms a keyframe, asks for one, or is
+        // due as the node's clock-sync exchange
         uint8_t mac[6];
         if (EspNow::macStringToBytes(nodeId, mac)) {
-            AckMessage ack;
-            ack.cmd_id = "telemetry_ack";
-            String ackJson = ack.toJson();
-            if (!espNow->sendToMac(mac, ackJson)) {
-                Logger::debug("Failed to send telemetry ACK to %s", nodeId.c_str());
+            nextBeacon.markHeard(mac);
+            if (telemetryAcks.needsUnicast(nodeId, statusMsg, keyframe, millis())) {
+                if (statusMsg) {
+                    espNow->stampClockSync(mac, statusMsg->ts, ack);
+                }
+                if (!espNow->sendMessage(mac, ack)) {
+                    Logger::debug("Failed to send telemetry ACK to %s", nodeId.c_str());
+                }
             }
         }
     }
@@ -732,17 +768,28 @@ void Coordinator::checkStaleConnections() {
     }
 }
 
-void Coordinator::sendHealthPings() {
-    if (!espNow) return;
-    int groupCount = Pins::RgbLed::NUM_PIXELS / 4;
-    for (int g = 0; g < groupCount; ++g) {
-        // Only ping nodes that currently appear connected
-        if (groupToNode[g].length() == 0 || !groupConnected[g]) continue;
+void Coordinator::sendBeacon() {
+    if (!espNow || !nodes) return;
+    BeaconMessage& beacon = nextBeacon;
+    beacon.period_ms = BEACON_PERIOD_MS;
+    // Nodes heard from within the last period have just proven they are alive;
+    // only the quiet ones (including disconnected ones) are asked to reply
+    uint32_t now = millis();
+    size_t asked = 0;
+    for (const auto& node : nodes->getAllNodes()) {
+        if (node.lastSeenMs > 0 && (now - node.lastSeenMs) < BEACON_PERIOD_MS) continue;
         uint8_t mac[6];
-        if (!EspNow::macStringToBytes(groupToNode[g], mac)) continue;
-        const String ping = "{\"msg\":\"ping\"}";
-        espNow->sendToMac(mac, ping);
+        if (!EspNow::macStringToBytes(node.nodeId, mac)) continue;
+        beacon.requestReply(mac);
+        asked++;
+    }
+    if (espNow->sendBeacon(beacon) && asked > 0) {
+        Logger::debug("Beacon %u: %u node(s) asked to reply", (unsigned)beacon.seq, (unsigned)asked);
     }
+    // Reports heard from now on go in the next one; a beacon that was not
+    // queued loses its acks, the nodes catch the following one
+    beacon.clearReplies();
+    beacon.clearHeard();
 }
 
 void Coordinator::startFlashAll() {
@@ -782,12 +829,16 @@ void Coordinator::flashAllTick(uint32_t now) {
 
     // Send white on/off to all connected nodes with short TTL and override_status
     auto all = nodes->getAllNodes();
+    std::vector<LightBatchEntry> batch;
+    uint8_t level = flashOn ? 128 : 0; // 50% brightness
     for (const auto& n : all) {
         int gi = getGroupIndexForNode(n.nodeId);
         if (gi < 0 || !groupConnected[gi]) continue;
-        uint8_t level = flashOn ? 128 : 0; // 50% brightness
         // quick fade for nicer blink
-        espNow->sendLightCommand(n.nodeId, level, 60 /*fadeMs*/, true /*override*/, 500 /*ttl*/);
+        batch.push_back({n.nodeId, 0, 0, 0, level, 60 /*fadeMs*/, -1});
+    }
+    if (!batch.empty()) {
+        espNow->sendColorBatch(batch, true /*override*/, 500 /*ttl*/);
     }
 }
 
@@ -817,24 +868,40 @@ void Coordinator::triggerNodeWaveTest() {
         return a.nodeId < b.nodeId;
     });
 
+    // start_at is in our millis(); nodes hold it in their synced copy of our
+    // clock (TimeSync), so it is the same instant on every synced node
     const uint32_t now = millis();
     const uint32_t startAt = now + 300; // 300ms in the future to allow delivery jitter
     const uint16_t periodMs = 1200;
     const uint16_t durationMs = 4000;
 
+    int unsynced = 0;
+    for (const auto& node : connected) {
+        uint8_t err = getNodeClockErrorMs(node.nodeId);
+        if (err == 0 || err >= TimeSync::TARGET_ERROR_MS) unsynced++;
+    }
+    if (unsynced > 0) {
+        Logger::warn("Wave: %d node(s) without a synced clock will start out of step", unsynced);
+    }
+
+    WaveMessage wave;
+    wave.period_ms = periodMs;
+    wave.duration_ms = durationMs;
+    wave.start_at = startAt;
     for (const auto& node : connected) {
         uint8_t mac[6];
         if (!EspNow::macStringToBytes(node.nodeId, mac)) continue;
-        // Include start_at to coordinate across nodes
-        String wave = String("{\"msg\":\"wave\",\"period_ms\":") + String(periodMs) +
-                      ",\"duration_ms\":" + String(durationMs) +
-                      ",\"start_at\":" + String(startAt) + "}";
-        espNow->sendToMac(mac, wave);
+        espNow->sendMessage(mac, wave);
     }
 
     Logger::info("Wave command sent");
 }
 
+uint8_t Coordinator::getNodeClockErrorMs(const String& nodeId) const {
+    auto it = nodeTelemetry.find(nodeId);
+    return it == nodeTelemetry.end() ? 0 : it->second.clockErrMs;
+}
+
 void Coordinator::handleMqttCommand(const String& topic, const String& payload) {
     StaticJsonDocument<256> doc;
     DeserializationError err = deserializeJson(doc, payload);
@@ -873,7 +940,7 @@ void Coordinator::handleMqttCommand(const String& topic, const String& payload)
         uint16_t fadeMs = doc["fade_ms"] | 200;
         int8_t pixel = doc["pixel"] | -1;
         bool overrideStatus = doc["override"] | false;
-        uint16_t ttlMs = doc["ttl_ms"] | 1500;
+        uint16_t ttlMs = doc["ttl_ms"] | Defaults::CMD_TTL_MS;
         
         Logger::info("set_light -> node=%s RGBW(%d,%d,%d,%d) pixel=%d fade=%dms",
                      nodeId.c_str(), r, g, b, w, pixel, fadeMs);
@@ -984,6 +1051,7 @@ void Coordinator::updateNodeTelemetryCache(const String& nodeId, const NodeStatu
     snapshot.avgW = statusMsg.avg_w;
     snapshot.temperatureC = statusMsg.temperature;
     snapshot.buttonPressed = statusMsg.button_pressed;
+    snapshot.clockErrMs = statusMsg.clock_err_ms;
     snapshot.lastUpdateMs = millis();
     nodeTelemetry[nodeId] = snapshot;
 
@@ -1030,11 +1098,41 @@ void Coordinator::refreshCoordinatorSensors() {
         coordinatorSensors.wifiRssi = coordinatorSensors.wifiConnected ? WiFi.RSSI() : -127;
     }
 
+    if (espNow) {
+        RxQueueStats rx = espNow->getRxQueueStats();
+        coordinatorSensors.espNowRxDropped = rx.droppedFull + rx.droppedInvalid;
+        coordinatorSensors.espNowRxHighWater = rx.highWater;
+    }
+
     if (mqtt) {
         mqtt->publishCoordinatorTelemetry(coordinatorSensors);
     }
 }
 
+void Coordinator::publishCommandDelivery() {
+    uint32_t now = millis();
+    if (now - lastDeliveryPublishMs < 30000) {
+        return;
+    }
+    lastDeliveryPublishMs = now;
+    if (!espNow || !mqtt) return;
+    for (const auto& kv : espNow->getDeliveryStats()) {
+        mqtt->publishCommandDelivery(kv.first, kv.second);
+    }
+}
+
+void Coordinator::publishLinkTable() {
+    uint32_t now = millis();
+    if (now - lastLinkPublishMs < 30000) {
+        return;
+    }
+    lastLinkPublishMs = now;
+    if (!espNow || !mqtt) return;
+    for (const auto& kv : espNow->getLinkTable()) {
+        mqtt->publishLinkQuality(kv.first, kv.second);
+    }
+}
+
 void Coordinator::printSerialTelemetry() {
     uint32_t now = millis();
     if (now - lastSerialPrintMs < 3000) {
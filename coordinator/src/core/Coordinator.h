@@ -11,9 +11,11 @@
 #include "../input/ButtonControl.h"
 #include "../sensors/ThermalControl.h"
 #include "../utils/StatusLed.h"
+#include "../../shared/src/TelemetryDelta.h"
 
 class WifiManager;
 class AmbientLightSensor;
+struct EspNowMessage;
 struct NodeStatusMessage;
 
 class Coordinator {
@@ -50,15 +52,22 @@ private:
         uint8_t avgW = 0;
         float temperatureC = 0.0f;
         bool buttonPressed = false;
+        uint8_t clockErrMs = 0; // node's coordinator-time error bound, 0 = not synced
         uint32_t lastUpdateMs = 0;
     };
     std::map<String, NodeTelemetrySnapshot> nodeTelemetry;
+    // Last acked telemetry keyframe per node; status_delta frames are applied to it
+    TelemetryBaselines telemetryBaselines;
+    // Reports that still need a unicast ack; the rest ride on the next beacon
+    TelemetryAcks telemetryAcks;
     CoordinatorSensorSnapshot coordinatorSensors;
     MmWaveEvent lastMmWaveEvent;
     bool haveMmWaveSample = false;
     bool zoneOccupiedState = false;
     uint32_t lastSensorSampleMs = 0;
     uint32_t lastSerialPrintMs = 0;
+    uint32_t lastDeliveryPublishMs = 0;
+    uint32_t lastLinkPublishMs = 0;
 
     // Per-node LED group mapping (4 pixels per group)
     std::map<String, int> nodeToGroup;         // nodeId -> group index (0..groups-1)
@@ -74,7 +83,13 @@ private:
     void flashLedForNode(const String& nodeId, uint32_t durationMs);
     void logConnectedNodes();
     void checkStaleConnections();
-    void sendHealthPings();
+    // Heartbeat beacon; nodes quiet for a period are asked to reply
+    static constexpr uint32_t BEACON_PERIOD_MS = 2000;
+    // Next beacon, collecting the nodes heard from until it goes out
+    BeaconMessage nextBeacon;
+    void sendBeacon();
+    void publishCommandDelivery();
+    void publishLinkTable();
 
     // Button/flash state
     bool buttonDown = false;
@@ -109,8 +124,10 @@ private:
     void onMmWaveEvent(const MmWaveEvent& event);
     void onThermalEvent(const String& nodeId, const NodeThermalData& data);
     void onButtonEvent(const String& buttonId, bool pressed);
-    void handleNodeMessage(const String& nodeId, const uint8_t* data, size_t len);
+    void handleNodeMessage(const String& nodeId, const EspNowMessage& msg);
     void triggerNodeWaveTest();
+    // Error bound the node reports on its copy of our clock, 0 = not synced
+    uint8_t getNodeClockErrorMs(const String& nodeId) const;
     void handleMqttCommand(const String& topic, const String& payload);
     void startPairingWindow(uint32_t durationMs, const char* reason);
     void updateNodeTelemetryCache(const String& nodeId, const NodeStatusMessage& statusMsg);
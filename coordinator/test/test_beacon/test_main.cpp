@@ -0,0 +1,538 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+#include "TelemetryDelta.h"
+#include "TimeSync.h"
+
+// beacon: one broadcast heartbeat per period with a reply bitmap, against a
+// unicast ping per node, and the heard map that acks telemetry for the whole
+// fleet, against a unicast ack per report. Airtime is estimated for ESP-NOW's
+// default 1 Mbps PHY. Last, the channel switch announced in the beacon,
+// against nodes finding a moved coordinator by re-pairing.
+
+static void macFor(int i, uint8_t mac[6]) {
+    const uint8_t base[6] = {0x34, 0x85, 0x18, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[4] = (uint8_t)(i >> 8);
+    mac[5] = (uint8_t)i;
+}
+
+// 192 us PLCP, 8 us per byte, 43 bytes of vendor action frame around the
+// payload; unicast adds SIFS and a 14-byte MAC ACK, broadcast is not acked.
+static uint32_t broadcastAirtimeUs(size_t payload) {
+    return 192 + (uint32_t)(43 + payload) * 8;
+}
+
+static uint32_t unicastAirtimeUs(size_t payload) {
+    return broadcastAirtimeUs(payload) + 10 + 192 + 14 * 8;
+}
+
+void test_beacon_round_trip() {
+    BeaconMessage beacon;
+    beacon.seq = 513;
+    beacon.time_ms = 123456789;
+    beacon.period_ms = 2000;
+    uint8_t mac[6];
+    macFor(7, mac);
+    beacon.requestReply(mac);
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = beacon.toBinary(buf, sizeof(buf));
+    // Only the bitmap bytes up to the highest requested slot go on the wire
+    size_t used = BeaconMessage::replySlot(mac) / 8 + 1;
+    TEST_ASSERT_EQUAL(MessageSchema::maxBinarySize<BeaconMessage>() + 1 + used, n);
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::BEACON, m->type);
+    const BeaconMessage& in = *static_cast<BeaconMessage*>(m);
+    TEST_ASSERT_EQUAL_UINT16(513, in.seq);
+    TEST_ASSERT_EQUAL_UINT32(123456789, in.time_ms);
+    TEST_ASSERT_EQUAL_UINT16(2000, in.period_ms);
+    TEST_ASSERT_TRUE(in.wantsReply(mac));
+
+    CmdIdString id;
+    in.replyId(id);
+    TEST_ASSERT_EQUAL_STRING("hb513", id.c_str());
+
+    // A later beacon decoded into the same slot does not inherit old requests
+    BeaconMessage quiet;
+    n = quiet.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(MessageSchema::maxBinarySize<BeaconMessage>() + 1, n);
+    m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_FALSE(static_cast<BeaconMessage*>(m)->wantsReply(mac));
+
+    // Truncated bitmap is rejected
+    n = beacon.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_NULL(slot.decode(buf, n - 1));
+
+    // The heard map follows the reply bitmap, only when a bit is set
+    uint8_t other[6];
+    macFor(8, other);
+    beacon.markHeard(other);
+    size_t withHeard = beacon.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(n + 1 + BeaconMessage::replySlot(other) / 8 + 1, withHeard);
+    TEST_ASSERT_TRUE(withHeard <= BeaconMessage::maxFrameSize());
+    m = slot.decode(buf, withHeard);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_TRUE(static_cast<BeaconMessage*>(m)->heardFrom(other));
+    TEST_ASSERT_TRUE(static_cast<BeaconMessage*>(m)->wantsReply(mac));
+    TEST_ASSERT_NULL(slot.decode(buf, withHeard - 1));
+    // Without it (older coordinator) nobody counts as heard
+    m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_FALSE(static_cast<BeaconMessage*>(m)->heardFrom(other));
+}
+
+void test_channel_switch_round_trip() {
+    BeaconMessage beacon;
+    beacon.time_ms = 50000;
+    beacon.period_ms = 2000;
+    beacon.switch_channel = 11;
+    beacon.switch_at_ms = 57000;
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = beacon.toBinary(buf, sizeof(buf));
+    // Empty reply bitmap, empty heard map (written to keep the switch in its place)
+    TEST_ASSERT_EQUAL(MessageSchema::maxBinarySize<BeaconMessage>() + 1 + 1 + 5, n);
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    const BeaconMessage& in = *static_cast<BeaconMessage*>(m);
+    TEST_ASSERT_EQUAL_UINT8(11, in.switch_channel);
+    TEST_ASSERT_EQUAL_UINT32(57000, in.switch_at_ms);
+    uint8_t mac[6];
+    macFor(3, mac);
+    TEST_ASSERT_FALSE(in.heardFrom(mac));
+
+    // Beside full bitmaps it is still one frame
+    memset(beacon.reply, 0xFF, sizeof(beacon.reply));
+    memset(beacon.heard, 0xFF, sizeof(beacon.heard));
+    n = beacon.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(BeaconMessage::maxFrameSize(), n);
+    m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_TRUE(static_cast<BeaconMessage*>(m)->heardFrom(mac));
+    TEST_ASSERT_EQUAL_UINT8(11, static_cast<BeaconMessage*>(m)->switch_channel);
+
+    // The same beacon from a coordinator without the switch: none is pending,
+    // including in a slot that last held one
+    m = slot.decode(buf, n - 5);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_UINT8(0, static_cast<BeaconMessage*>(m)->switch_channel);
+    TEST_ASSERT_TRUE(static_cast<BeaconMessage*>(m)->heardFrom(mac));
+
+    // No switch, no bytes for it
+    BeaconMessage quiet;
+    TEST_ASSERT_EQUAL(MessageSchema::maxBinarySize<BeaconMessage>() + 1, quiet.toBinary(buf, sizeof(buf)));
+}
+
+void test_reply_bitmap_addresses_nodes() {
+    BeaconMessage beacon;
+    uint8_t mac[6];
+    for (int i = 0; i < 250; i += 2) {
+        macFor(i, mac);
+        beacon.requestReply(mac);
+    }
+    // Every requested node replies; unrequested ones only on a shared slot
+    int extra = 0;
+    for (int i = 0; i < 250; ++i) {
+        macFor(i, mac);
+        if (i % 2 == 0) {
+            TEST_ASSERT_TRUE(beacon.wantsReply(mac));
+        } else if (beacon.wantsReply(mac)) {
+            extra++;
+        }
+    }
+    // Consecutive NICs spread over the slots rather than piling up
+    TEST_ASSERT_TRUE(extra < 125 / 2);
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = beacon.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_TRUE(n <= BeaconMessage::maxFrameSize());
+    char msg[96];
+    snprintf(msg, sizeof(msg), "125 of 250 nodes asked: %u-byte beacon, %d unasked node(s) share a slot",
+             (unsigned)n, extra);
+    TEST_MESSAGE(msg);
+}
+
+// Heartbeat airtime per period: the old health check unicast {"msg":"ping"}
+// to every connected node; the beacon is one broadcast, plus an ack from each
+// node asked to reply (those quiet for a whole period).
+void test_heartbeat_airtime_vs_fleet_size() {
+    const char* ping = "{\"msg\":\"ping\"}";
+    const size_t pingLen = strlen(ping);
+    AckMessage reply;
+    reply.cmd_id = "hb65535";
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    const size_t replyLen = reply.toBinary(buf, sizeof(buf));
+    const int fleets[] = {20, 100, 250};
+
+    for (int f = 0; f < 3; ++f) {
+        const int nodes = fleets[f];
+        uint32_t pingsUs = (uint32_t)nodes * unicastAirtimeUs(pingLen);
+
+        // Telemetry every 2 s keeps most nodes heard from; say 5% are quiet
+        BeaconMessage beacon;
+        uint8_t mac[6];
+        int quiet = (nodes + 19) / 20;
+        for (int i = 0; i < quiet; ++i) {
+            macFor(i * 20, mac);
+            beacon.requestReply(mac);
+        }
+        size_t len = beacon.toBinary(buf, sizeof(buf));
+        uint32_t beaconUs = broadcastAirtimeUs(len);
+        uint32_t repliesUs = (uint32_t)quiet * unicastAirtimeUs(replyLen);
+
+        BeaconMessage idle;
+        uint32_t idleUs = broadcastAirtimeUs(idle.toBinary(buf, sizeof(buf)));
+        TEST_ASSERT_TRUE(beaconUs + repliesUs < pingsUs);
+        // The beacon itself grows by at most the bitmap
+        TEST_ASSERT_TRUE(beaconUs <= idleUs + BeaconMessage::REPLY_BYTES * 8);
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%3d nodes: pings %lu us/period, beacon %lu us (+%d replies %lu us)",
+                 nodes, (unsigned long)pingsUs, (unsigned long)beaconUs, quiet, (unsigned long)repliesUs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+// ---- Coalesced telemetry acks on a simulated fleet ----
+
+static uint32_t s_rng = 2024;
+static uint32_t randBelow(uint32_t n) {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return (s_rng >> 8) % n;
+}
+
+struct SimNode {
+    uint8_t mac[6];
+    String id;
+    uint32_t nextReportMs;
+    uint32_t lastKeyframeMs;
+    bool baselineAcked;
+    uint8_t clockAcks;       // stamped acks received; synced after a few
+    uint32_t lastLivenessMs; // last ack or heard bit received
+    uint32_t maxGapMs;
+};
+
+struct FleetResult {
+    uint32_t acks;
+    uint32_t beacons;
+    uint64_t airtimeUs;
+    uint32_t maxGapMs;
+    uint32_t unsyncedAtEnd;
+};
+
+static const uint32_t SIM_MS = 300000;
+static const uint32_t REPORT_MS = 1000;   // Defaults::TELEMETRY_INTERVAL_S
+static const uint32_t KEYFRAME_MS = 30000; // Defaults::TELEMETRY_KEYFRAME_S
+static const uint32_t BEACON_MS = 2000;    // Coordinator::BEACON_PERIOD_MS
+static const uint32_t LOSS_PCT = 5;        // each direction, per frame
+
+static void noteLiveness(SimNode& n, uint32_t nowMs) {
+    uint32_t gap = nowMs - n.lastLivenessMs;
+    if (gap > n.maxGapMs) n.maxGapMs = gap;
+    n.lastLivenessMs = nowMs;
+}
+
+// Telemetry from every node once a second, acked per report (coalesce off)
+// or through TelemetryAcks and the beacon's heard map (coalesce on)
+static void runFleet(int count, bool coalesce, FleetResult& out) {
+    static SimNode nodes[250];
+    TelemetryAcks policy;
+    BeaconMessage beacon;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    AckMessage ack;
+    ack.cmd_id = TelemetryDelta::ACK_CMD;
+    ack.stampClock(123456, 123400, 123460);
+    const size_t ackLen = ack.toBinary(buf, sizeof(buf));
+
+    for (int i = 0; i < count; ++i) {
+        SimNode& n = nodes[i];
+        macFor(i, n.mac);
+        char id[18];
+        snprintf(id, sizeof(id), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 n.mac[0], n.mac[1], n.mac[2], n.mac[3], n.mac[4], n.mac[5]);
+        n.id = id;
+        n.nextReportMs = randBelow(REPORT_MS);
+        n.lastKeyframeMs = 0;
+        n.baselineAcked = false;
+        n.clockAcks = 0;
+        n.lastLivenessMs = 0;
+        n.maxGapMs = 0;
+    }
+    out = FleetResult{};
+    for (uint32_t now = 0; now < SIM_MS; ++now) {
+        for (int i = 0; i < count; ++i) {
+            SimNode& n = nodes[i];
+            if (now != n.nextReportMs) continue;
+            n.nextReportMs = now + REPORT_MS + randBelow(20);
+            bool keyframe = !n.baselineAcked || now - n.lastKeyframeMs >= KEYFRAME_MS;
+            if (keyframe) { n.baselineAcked = false; n.lastKeyframeMs = now; }
+            if (randBelow(100) < LOSS_PCT) continue;
+
+            NodeStatusMessage status;
+            status.clock_err_ms = n.clockAcks >= 3 ? 4 : 0;
+            bool unicast = true;
+            if (coalesce) {
+                beacon.markHeard(n.mac);
+                unicast = policy.needsUnicast(n.id, &status, keyframe, now);
+            }
+            if (!unicast) continue;
+            out.acks++;
+            out.airtimeUs += unicastAirtimeUs(ackLen);
+            if (randBelow(100) < LOSS_PCT) continue;
+            if (keyframe) n.baselineAcked = true;
+            if (n.clockAcks < 255) n.clockAcks++;
+            noteLiveness(n, now);
+        }
+        if (now % BEACON_MS == BEACON_MS - 1) {
+            out.beacons++;
+            out.airtimeUs += broadcastAirtimeUs(beacon.toBinary(buf, sizeof(buf)));
+            for (int i = 0; i < count; ++i) {
+                if (randBelow(100) >= LOSS_PCT && beacon.heardFrom(nodes[i].mac)) noteLiveness(nodes[i], now);
+            }
+            beacon.clearHeard();
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        noteLiveness(nodes[i], SIM_MS);
+        if (nodes[i].maxGapMs > out.maxGapMs) out.maxGapMs = nodes[i].maxGapMs;
+        if (nodes[i].clockAcks < 3) out.unsyncedAtEnd++;
+    }
+}
+
+void test_coalesced_ack_tx_rate() {
+    const int fleets[] = {20, 100, 250};
+    char msg[200];
+    snprintf(msg, sizeof(msg), "coordinator TX for telemetry + heartbeat, %lu s, %lu%% loss each way:",
+             (unsigned long)(SIM_MS / 1000), (unsigned long)LOSS_PCT);
+    TEST_MESSAGE(msg);
+    for (int f = 0; f < 3; ++f) {
+        FleetResult before, after;
+        runFleet(fleets[f], false, before);
+        runFleet(fleets[f], true, after);
+        const float secs = SIM_MS / 1000.0f;
+        float fpsBefore = (before.acks + before.beacons) / secs;
+        float fpsAfter = (after.acks + after.beacons) / secs;
+
+        // Keyframes and clock refreshes still get their ack: well under a
+        // third of the reports
+        TEST_ASSERT_TRUE(fpsAfter * 3 < fpsBefore);
+        TEST_ASSERT_TRUE(after.airtimeUs * 2 < before.airtimeUs);
+        TEST_ASSERT_EQUAL_UINT32(0, after.unsyncedAtEnd);
+        // Liveness confirmations keep coming: far inside the node's
+        // 5-minute re-pair timeout
+        TEST_ASSERT_TRUE(after.maxGapMs < 20000);
+
+        snprintf(msg, sizeof(msg),
+                 "  %3d nodes: per-report acks %6.1f frames/s (%5.1f%% air), coalesced %5.1f frames/s (%4.1f%% air), "
+                 "longest liveness gap %lu -> %lu ms",
+                 fleets[f], fpsBefore, before.airtimeUs / (secs * 1e4f), fpsAfter, after.airtimeUs / (secs * 1e4f),
+                 (unsigned long)before.maxGapMs, (unsigned long)after.maxGapMs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+// ---- Fleet channel switch ----
+
+// The coordinator's AP moves from channel 1 to 11. Unannounced (before), the
+// coordinator just follows it and each node, hearing nothing more, re-pairs
+// COORDINATOR_TIMEOUT_MS after the last beacon: it hops channels every HOP_MS
+// in the node's order, sending a JOIN_REQUEST every JOIN_MS, until one sent on
+// channel 11 is answered. Announced (after), EspNow puts the switch in every
+// beacon until it is due (EspNow::announceChannelSwitch); a node takes the
+// time from the last one it decoded and moves on its next loop pass. A node
+// that misses them all stops hearing beacons and searches the channels,
+// BEACON_LOSS_PERIODS after the last one (node checkBeaconLoss).
+static const int SWITCH_FLEET = 100;
+static const uint8_t OLD_CHANNEL = 1;
+static const uint8_t NEW_CHANNEL = 11;
+static const uint32_t SWITCH_BEACONS = 5;         // EspNow::CHANNEL_SWITCH_BEACONS
+static const uint32_t BEACON_LOSS_PERIODS = 5;    // node
+static const uint32_t REPAIR_TIMEOUT_MS = 300000; // node COORDINATOR_TIMEOUT_MS
+static const uint32_t HOP_MS = 500;               // node handlePairing
+static const uint32_t JOIN_MS = 600;
+static const uint8_t HOP_ORDER[] = {1, 6, 11, 2, 3, 4, 5, 7, 8, 9, 10};
+static const uint32_t NODE_LOOP_MS = 10;          // node loop() delay
+static const uint32_t TRANSIT_MS = 4;             // air + RX callback, at most
+
+struct SwitchResult {
+    uint32_t announced;    // moved on the announcement
+    uint32_t searched;     // found the coordinator by searching
+    uint32_t repaired;     // neither: re-paired after the timeout
+    uint32_t spreadMs;     // latest announced node after the coordinator
+    uint32_t p50Ms, maxMs; // until each node hears the coordinator again
+};
+
+// ms after the last beacon heard until a node that lost the coordinator is
+// paired again
+static uint32_t repairMs(uint32_t lossPct) {
+    uint32_t t = REPAIR_TIMEOUT_MS + randBelow(NODE_LOOP_MS);
+    size_t idx = randBelow(sizeof(HOP_ORDER));
+    uint32_t nextHop = t, nextJoin = t;
+    for (;; ++t) {
+        if (t >= nextHop) {
+            idx = (idx + 1) % sizeof(HOP_ORDER);
+            nextHop = t + HOP_MS + 1;
+        }
+        if (t >= nextJoin) {
+            nextJoin = t + JOIN_MS + 1;
+            if (HOP_ORDER[idx] == NEW_CHANNEL && randBelow(100) >= lossPct && randBelow(100) >= lossPct) {
+                return t + TRANSIT_MS;
+            }
+        }
+    }
+}
+
+static int compareU32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Beacons at every multiple of BEACON_MS from 0; the AP moves at moveMs, a
+// random point after the first beacon
+static void runSwitch(bool announce, uint32_t lossPct, SwitchResult& out) {
+    static uint32_t recovery[SWITCH_FLEET];
+    out = SwitchResult{};
+    const uint32_t moveMs = BEACON_MS + 1 + randBelow(BEACON_MS - 1);
+    const uint32_t lead = SWITCH_BEACONS * BEACON_MS + BEACON_MS / 2;
+    const uint32_t coordSwitch = announce ? moveMs + lead : moveMs;
+    BeaconMessage beacon;
+    beacon.period_ms = BEACON_MS;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    MessageSlot slot;
+
+    for (int i = 0; i < SWITCH_FLEET; ++i) {
+        uint8_t channel = OLD_CHANNEL;
+        uint32_t lastBeacon = 0;
+        bool pending = false, searching = false, viaAnnouncement = false;
+        uint32_t dueMs = 0, dwellUntil = 0;
+        uint8_t searchChannel = 0;
+        const uint32_t loopPhase = randBelow(NODE_LOOP_MS);
+        uint32_t backMs = 0;
+
+        for (uint32_t t = 0; backMs == 0; ++t) {
+            const uint8_t coordChannel = t < coordSwitch ? OLD_CHANNEL : NEW_CHANNEL;
+            if (t % BEACON_MS == 0 && channel == coordChannel && randBelow(100) >= lossPct) {
+                uint32_t rx = t + 1 + randBelow(TRANSIT_MS);
+                lastBeacon = t;
+                searching = false;
+                if (t >= coordSwitch) {
+                    backMs = rx;
+                    break;
+                }
+                if (announce && t >= moveMs) {
+                    beacon.time_ms = t;
+                    beacon.switch_channel = NEW_CHANNEL;
+                    beacon.switch_at_ms = coordSwitch;
+                    EspNowMessage* m = slot.decode(buf, beacon.toBinary(buf, sizeof(buf)));
+                    TEST_ASSERT_NOT_NULL(m);
+                    const BeaconMessage& in = *static_cast<BeaconMessage*>(m);
+                    pending = in.switch_channel == NEW_CHANNEL;
+                    dueMs = rx + (in.switch_at_ms - in.time_ms);
+                }
+            }
+            if ((t + loopPhase) % NODE_LOOP_MS != 0) continue;
+
+            if (pending && t >= dueMs) {
+                // runChannelSwitch
+                pending = false;
+                channel = NEW_CHANNEL;
+                viaAnnouncement = true;
+                backMs = t;
+                break;
+            }
+            if (!announce) {
+                // Before: no search, only the re-pair timeout
+                if (t >= coordSwitch + BEACON_MS) {
+                    backMs = lastBeacon + repairMs(lossPct);
+                    out.repaired++;
+                }
+                continue;
+            }
+            // checkBeaconLoss
+            if (!pending && !searching && t - lastBeacon >= BEACON_LOSS_PERIODS * BEACON_MS) {
+                searching = true;
+                searchChannel = channel;
+                dwellUntil = t;
+            }
+            if (searching && t >= dwellUntil) {
+                searchChannel = searchChannel % 13 + 1;
+                channel = searchChannel;
+                dwellUntil = t + BEACON_MS + BEACON_MS / 4;
+            }
+            if (t - lastBeacon >= REPAIR_TIMEOUT_MS) {
+                backMs = lastBeacon + repairMs(lossPct);
+                out.repaired++;
+            }
+        }
+        if (viaAnnouncement) {
+            out.announced++;
+            if (backMs - coordSwitch > out.spreadMs) out.spreadMs = backMs - coordSwitch;
+        } else if (announce && backMs - lastBeacon < REPAIR_TIMEOUT_MS) {
+            out.searched++;
+        }
+        recovery[i] = backMs - coordSwitch;
+    }
+    qsort(recovery, SWITCH_FLEET, sizeof(recovery[0]), compareU32);
+    out.p50Ms = recovery[SWITCH_FLEET / 2];
+    out.maxMs = recovery[SWITCH_FLEET - 1];
+}
+
+void test_fleet_channel_switch_recovery() {
+    const uint32_t losses[] = {5, 30, 50};
+    char msg[220];
+    snprintf(msg, sizeof(msg), "%d nodes, AP moves channel %u -> %u, %lu ms beacons:", SWITCH_FLEET,
+             (unsigned)OLD_CHANNEL, (unsigned)NEW_CHANNEL, (unsigned long)BEACON_MS);
+    TEST_MESSAGE(msg);
+    for (int l = 0; l < 3; ++l) {
+        SwitchResult before, after;
+        runSwitch(false, losses[l], before);
+        runSwitch(true, losses[l], after);
+
+        TEST_ASSERT_EQUAL_UINT32(SWITCH_FLEET, before.repaired);
+        TEST_ASSERT_TRUE(before.p50Ms > REPAIR_TIMEOUT_MS);
+        // Nobody re-pairs: the announcement moves nodes within one beacon
+        // interval of the coordinator, the search finds the rest
+        TEST_ASSERT_EQUAL_UINT32(0, after.repaired);
+        TEST_ASSERT_EQUAL_UINT32(SWITCH_FLEET, after.announced + after.searched);
+        TEST_ASSERT_TRUE(after.spreadMs < BEACON_MS);
+        TEST_ASSERT_TRUE(after.p50Ms < BEACON_MS);
+        TEST_ASSERT_TRUE(after.maxMs < REPAIR_TIMEOUT_MS / 3);
+        if (losses[l] <= 30) {
+            TEST_ASSERT_EQUAL_UINT32(SWITCH_FLEET, after.announced);
+            TEST_ASSERT_TRUE(after.maxMs < BEACON_MS);
+        }
+
+        snprintf(msg, sizeof(msg),
+                 "  %2lu%% loss: re-pairing p50 %5.1f s, max %5.1f s | announced: %3lu moved within %lu ms, "
+                 "%lu found by search, %lu re-paired, p50 %lu ms, max %lu ms",
+                 (unsigned long)losses[l], before.p50Ms / 1000.0, before.maxMs / 1000.0,
+                 (unsigned long)after.announced, (unsigned long)after.spreadMs, (unsigned long)after.searched,
+                 (unsigned long)after.repaired, (unsigned long)after.p50Ms, (unsigned long)after.maxMs);
+        TEST_MESSAGE(msg);
+    }
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_beacon_round_trip);
+    RUN_TEST(test_channel_switch_round_trip);
+    RUN_TEST(test_reply_bitmap_addresses_nodes);
+    RUN_TEST(test_heartbeat_airtime_vs_fleet_size);
+    RUN_TEST(test_coalesced_ack_tx_rate);
+    RUN_TEST(test_fleet_channel_switch_recovery);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
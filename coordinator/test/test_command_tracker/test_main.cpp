@@ -0,0 +1,217 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../../src/comm/CommandTracker.h"
+
+// set_light delivery: ack matching by cmd_id, exponential-backoff retransmits,
+// ttl_ms expiry and supersession, plus a lossy-link simulation.
+
+static const uint8_t MAC_A[6] = {0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x01};
+static const char* NODE_A = "AA:BB:CC:00:00:01";
+
+static uint32_t s_resendAt[16];
+static size_t s_resends = 0;
+static uint32_t s_nowMs = 0;
+
+static bool recordResend(const uint8_t mac[6], const SetLightMessage& msg) {
+    (void)mac; (void)msg;
+    if (s_resends < 16) s_resendAt[s_resends] = s_nowMs;
+    s_resends++;
+    return true;
+}
+
+static SetLightMessage makeCommand(const char* cmdId, uint16_t ttlMs = 1500) {
+    SetLightMessage msg;
+    msg.cmd_id = cmdId;
+    msg.w = 200;
+    msg.ttl_ms = ttlMs;
+    return msg;
+}
+
+void test_ack_matches_cmd_id() {
+    CommandTracker t;
+    t.track(MAC_A, makeCommand("100-000001"), 1000);
+    TEST_ASSERT_EQUAL(1, t.pending());
+    TEST_ASSERT_FALSE(t.onAck(MAC_A, "99-000001", 1010));
+    TEST_ASSERT_TRUE(t.onAck(MAC_A, "100-000001", 1030));
+    TEST_ASSERT_EQUAL(0, t.pending());
+    // A duplicate ack (node re-acked a retransmit) matches nothing
+    TEST_ASSERT_FALSE(t.onAck(MAC_A, "100-000001", 1040));
+
+    const CommandDeliveryStats& st = t.stats().at(String(NODE_A));
+    TEST_ASSERT_EQUAL_UINT32(1, st.commands);
+    TEST_ASSERT_EQUAL_UINT32(1, st.delivered);
+    TEST_ASSERT_EQUAL_UINT32(30, st.ackLatencyMaxMs);
+    TEST_ASSERT_EQUAL_UINT32(1, st.ackLatencyBuckets[2]); // 25..50 ms
+}
+
+void test_backoff_then_ttl_expiry() {
+    CommandTracker t;
+    t.setResend(recordResend);
+    s_resends = 0;
+    t.track(MAC_A, makeCommand("200-000001"), 0);
+    for (s_nowMs = 0; s_nowMs <= 2000; s_nowMs += 10) t.poll(s_nowMs);
+
+    // RETRY_COUNT retransmits, the gap doubling each time
+    TEST_ASSERT_EQUAL(3, s_resends);
+    TEST_ASSERT_EQUAL_UINT32(150, s_resendAt[0]);
+    TEST_ASSERT_EQUAL_UINT32(450, s_resendAt[1]);
+    TEST_ASSERT_EQUAL_UINT32(1050, s_resendAt[2]);
+    TEST_ASSERT_EQUAL(0, t.pending());
+    const CommandDeliveryStats& st = t.stats().at(String(NODE_A));
+    TEST_ASSERT_EQUAL_UINT32(1, st.expired);
+    TEST_ASSERT_EQUAL_UINT32(3, st.retransmits);
+
+    // A short ttl_ms cuts the schedule short
+    s_resends = 0;
+    t.track(MAC_A, makeCommand("201-000001", 400), 5000);
+    for (s_nowMs = 5000; s_nowMs <= 6000; s_nowMs += 10) t.poll(s_nowMs);
+    TEST_ASSERT_EQUAL(1, s_resends);
+    TEST_ASSERT_EQUAL_UINT32(2, t.stats().at(String(NODE_A)).expired);
+}
+
+void test_newer_command_supersedes() {
+    CommandTracker t;
+    t.setResend(recordResend);
+    s_resends = 0;
+    t.track(MAC_A, makeCommand("300-000001"), 0);
+    t.track(MAC_A, makeCommand("301-000001"), 50);
+    TEST_ASSERT_EQUAL(1, t.pending());
+    // Ack for the old command arrives late: ignored, the new one stays pending
+    TEST_ASSERT_FALSE(t.onAck(MAC_A, "300-000001", 60));
+    TEST_ASSERT_TRUE(t.onAck(MAC_A, "301-000001", 70));
+    const CommandDeliveryStats& st = t.stats().at(String(NODE_A));
+    TEST_ASSERT_EQUAL_UINT32(2, st.commands);
+    TEST_ASSERT_EQUAL_UINT32(1, st.superseded);
+    TEST_ASSERT_EQUAL_UINT32(1, st.delivered);
+
+    // A batch frame for the node also ends retransmission of the older command
+    t.track(MAC_A, makeCommand("302-000001"), 100);
+    t.supersede(MAC_A);
+    for (s_nowMs = 100; s_nowMs <= 2000; s_nowMs += 10) t.poll(s_nowMs);
+    TEST_ASSERT_EQUAL(0, s_resends);
+    TEST_ASSERT_EQUAL_UINT32(2, t.stats().at(String(NODE_A)).superseded);
+}
+
+// ---- Lossy link ----
+
+// Each frame (command or ack) is lost with probability LOSS_PCT; a node acks
+// every set_light it receives after ACK_DELAY_MS (its RX window plus loop time).
+static const int SIM_NODES = 20;
+static const int SIM_COMMANDS = 50;          // per node
+static const uint32_t COMMAND_GAP_MS = 2000; // longer than ttl_ms
+static const int LOSS_PCT = 20;
+static const uint32_t ACK_DELAY_MS = 30;
+
+struct SimAck {
+    uint8_t node;
+    uint32_t atMs;
+    CmdIdString cmdId;
+};
+static SimAck s_acks[256];
+static size_t s_ackCount = 0;
+static uint32_t s_rng = 12345;
+
+static bool lost() {
+    s_rng = s_rng * 1103515245u + 12345u;
+    return (int)((s_rng >> 16) % 100) < LOSS_PCT;
+}
+
+static void simMac(int node, uint8_t out[6]) {
+    const uint8_t base[6] = {0xAA, 0xBB, 0xCC, 0x20, 0x00, 0x00};
+    memcpy(out, base, 6);
+    out[5] = (uint8_t)node;
+}
+
+static bool simSend(const uint8_t mac[6], const SetLightMessage& msg) {
+    if (lost() || lost()) return true; // command or its ack lost (ack loss decided up front)
+    if (s_ackCount < 256) s_acks[s_ackCount++] = SimAck{mac[5], s_nowMs + ACK_DELAY_MS, msg.cmd_id};
+    return true;
+}
+
+static void runLossySim(uint8_t retries, uint32_t& delivered, uint32_t& expired, uint32_t& retransmits,
+                        uint32_t& avgMs, uint32_t& maxMs) {
+    static CommandTracker t;
+    t = CommandTracker();
+    t.setResend(simSend);
+    t.setMaxRetries(retries);
+    s_ackCount = 0;
+    s_rng = 12345;
+    char cmdId[24];
+    for (int c = 0; c < SIM_COMMANDS; ++c) {
+        uint32_t start = (uint32_t)c * COMMAND_GAP_MS;
+        for (int n = 0; n < SIM_NODES; ++n) {
+            uint8_t mac[6];
+            simMac(n, mac);
+            s_nowMs = start + (uint32_t)n;
+            snprintf(cmdId, sizeof(cmdId), "%lu-%02X", (unsigned long)s_nowMs, n);
+            SetLightMessage msg = makeCommand(cmdId);
+            simSend(mac, msg);
+            t.track(mac, msg, s_nowMs);
+        }
+        for (s_nowMs = start + SIM_NODES; s_nowMs < start + COMMAND_GAP_MS; ++s_nowMs) {
+            size_t keep = 0;
+            for (size_t i = 0; i < s_ackCount; ++i) {
+                if (s_acks[i].atMs <= s_nowMs) {
+                    uint8_t mac[6];
+                    simMac(s_acks[i].node, mac);
+                    t.onAck(mac, s_acks[i].cmdId.c_str(), s_nowMs);
+                } else {
+                    s_acks[keep++] = s_acks[i];
+                }
+            }
+            s_ackCount = keep;
+            t.poll(s_nowMs);
+        }
+    }
+    delivered = expired = retransmits = maxMs = 0;
+    uint64_t sum = 0;
+    for (const auto& kv : t.stats()) {
+        delivered += kv.second.delivered;
+        expired += kv.second.expired;
+        retransmits += kv.second.retransmits;
+        sum += kv.second.ackLatencySumMs;
+        if (kv.second.ackLatencyMaxMs > maxMs) maxMs = kv.second.ackLatencyMaxMs;
+    }
+    avgMs = delivered ? (uint32_t)(sum / delivered) : 0;
+}
+
+void test_lossy_link_delivery() {
+    const uint32_t total = SIM_NODES * SIM_COMMANDS;
+    uint32_t d0, e0, r0, avg0, max0;
+    uint32_t d3, e3, r3, avg3, max3;
+    runLossySim(0, d0, e0, r0, avg0, max0);
+    runLossySim(3, d3, e3, r3, avg3, max3);
+
+    TEST_ASSERT_EQUAL_UINT32(total, d0 + e0);
+    TEST_ASSERT_EQUAL_UINT32(total, d3 + e3);
+    TEST_ASSERT_EQUAL_UINT32(0, r0);
+    TEST_ASSERT_TRUE(d3 > d0);
+    // 4 attempts at a 36% round-trip loss leave under 2% undelivered
+    TEST_ASSERT_TRUE(e3 * 50 < total);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d%% loss each way, %lu commands: no retry %lu.%lu%% acked (avg %lums)",
+             LOSS_PCT, (unsigned long)total, (unsigned long)(d0 * 100 / total), (unsigned long)(d0 * 1000 / total % 10),
+             (unsigned long)avg0);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "3 retries: %lu.%lu%% acked, %lu retransmits, ack latency avg %lums max %lums",
+             (unsigned long)(d3 * 100 / total), (unsigned long)(d3 * 1000 / total % 10),
+             (unsigned long)r3, (unsigned long)avg3, (unsigned long)max3);
+    TEST_MESSAGE(msg);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_ack_matches_cmd_id);
+    RUN_TEST(test_backoff_then_ttl_expiry);
+    RUN_TEST(test_newer_command_supersedes);
+    RUN_TEST(test_lossy_link_delivery);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
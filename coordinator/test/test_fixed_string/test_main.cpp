@@ -0,0 +1,87 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+void test_assign_and_compare() {
+    MacString mac = "AA:BB:CC:DD:EE:FF";
+    TEST_ASSERT_EQUAL(17, mac.length());
+    TEST_ASSERT_TRUE(mac == "AA:BB:CC:DD:EE:FF");
+    TEST_ASSERT_TRUE(mac == String("AA:BB:CC:DD:EE:FF"));
+    TEST_ASSERT_TRUE(mac != "AA:BB:CC:DD:EE:00");
+
+    IdString id;
+    TEST_ASSERT_TRUE(id.isEmpty());
+    id = String("LDDEEFF");
+    TEST_ASSERT_EQUAL_STRING("LDDEEFF", id.c_str());
+    String back = id;
+    TEST_ASSERT_EQUAL_STRING("LDDEEFF", back.c_str());
+}
+
+void test_overlong_input_is_truncated() {
+    TagString tag = "a-status-mode-that-is-too-long";
+    TEST_ASSERT_EQUAL(TagString::capacity(), tag.length());
+    TEST_ASSERT_EQUAL_STRING("a-status-mode-t", tag.c_str());
+    tag.assign(nullptr);
+    TEST_ASSERT_TRUE(tag.isEmpty());
+}
+
+void test_messages_copy_by_value() {
+    SetLightMessage in;
+    in.cmd_id = "1234567-DDEEFF";
+    in.light_id = "LDDEEFF";
+    in.g = 200;
+
+    // Trivially copyable: a raw byte copy is a valid message
+    uint8_t raw[sizeof(SetLightMessage)];
+    memcpy(raw, &in, sizeof(in));
+    SetLightMessage out;
+    memcpy(&out, raw, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("1234567-DDEEFF", out.cmd_id.c_str());
+    TEST_ASSERT_EQUAL_STRING("LDDEEFF", out.light_id.c_str());
+    TEST_ASSERT_EQUAL(200, out.g);
+    TEST_ASSERT_EQUAL(MessageType::SET_LIGHT, out.type);
+}
+
+void test_binary_string_longer_than_field_is_truncated() {
+    // A peer with larger fields must not overrun ours
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    WireCodec::Writer wr(buf, sizeof(buf));
+    wr.header((uint8_t)MessageType::ACK);
+    const char* longId = "0123456789012345678901234567890123456789-overflow";
+    wr.str(longId, strlen(longId));
+    AckMessage ack;
+    TEST_ASSERT_TRUE(ack.fromBinary(buf, wr.length()));
+    TEST_ASSERT_EQUAL(CmdIdString::capacity(), ack.cmd_id.length());
+}
+
+void test_message_sizes() {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "sizeof: join_request %u join_accept %u set_light %u node_status %u ack %u slot %u",
+             (unsigned)sizeof(JoinRequestMessage), (unsigned)sizeof(JoinAcceptMessage),
+             (unsigned)sizeof(SetLightMessage), (unsigned)sizeof(NodeStatusMessage),
+             (unsigned)sizeof(AckMessage), (unsigned)sizeof(MessageSlot));
+    TEST_MESSAGE(line);
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_assign_and_compare);
+    RUN_TEST(test_overlong_input_is_truncated);
+    RUN_TEST(test_messages_copy_by_value);
+    RUN_TEST(test_binary_string_longer_than_field_is_truncated);
+    RUN_TEST(test_message_sizes);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
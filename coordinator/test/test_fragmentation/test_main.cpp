@@ -0,0 +1,205 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+#include "Fragmentation.h"
+
+// Large-payload transport: fragmentation/reassembly against v1 peers and a
+// throughput comparison with single ESP-NOW v2 frames over a simulated link.
+
+static const uint8_t MAC_A[6] = {0x34, 0x85, 0x18, 0x00, 0x00, 0x01};
+static const uint8_t MAC_B[6] = {0x34, 0x85, 0x18, 0x00, 0x00, 0x02};
+
+// Simulated radio: records frames in send order and their airtime at 1 Mbps
+// (192 us preamble, 43 bytes of vendor action frame overhead, MAC ACK after SIFS)
+struct SimLink {
+    static const int MAX_FRAMES = 8;
+    uint8_t frames[MAX_FRAMES][WireCodec::MAX_FRAME_LEN_V2];
+    size_t lens[MAX_FRAMES];
+    int count = 0;
+    uint64_t airtimeUs = 0;
+
+    bool send(const uint8_t* data, size_t len) {
+        if (count >= MAX_FRAMES) return false;
+        memcpy(frames[count], data, len);
+        lens[count++] = len;
+        airtimeUs += 192 + (43 + len) * 8 + 10 + 192 + 14 * 8;
+        return true;
+    }
+    void clear() { count = 0; }
+};
+
+static SimLink s_link;
+
+static void fillPattern(uint8_t* buf, size_t len, uint8_t seed) {
+    for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)(seed + i * 7);
+}
+
+static bool sendFragmented(const uint8_t* data, size_t len, uint8_t msgId, size_t mtu = WireCodec::MAX_FRAME_LEN) {
+    return Fragmentation::send(data, len, mtu, msgId,
+                               [](const uint8_t* f, size_t n) { return s_link.send(f, n); });
+}
+
+void test_round_trip_all_sizes() {
+    static uint8_t msg[WireCodec::MAX_MESSAGE_LEN];
+    const size_t sizes[] = {1, 200, 241, 242, 250, 600, 1000, 1469, 1470};
+    Reassembler rx;
+    uint8_t id = 0;
+    for (size_t len : sizes) {
+        fillPattern(msg, len, (uint8_t)len);
+        s_link.clear();
+        TEST_ASSERT_TRUE(sendFragmented(msg, len, ++id));
+        TEST_ASSERT_EQUAL(Fragmentation::fragmentCount(len, WireCodec::MAX_FRAME_LEN), s_link.count);
+
+        const uint8_t* out = nullptr;
+        size_t outLen = 0;
+        // Deliver in reverse order; only the last delivered fragment completes it
+        for (int i = s_link.count - 1; i >= 0; --i) {
+            TEST_ASSERT_TRUE(s_link.lens[i] <= WireCodec::MAX_FRAME_LEN);
+            out = rx.accept(MAC_A, s_link.frames[i], s_link.lens[i], 0, outLen);
+            if (i > 0) TEST_ASSERT_NULL(out);
+        }
+        TEST_ASSERT_NOT_NULL(out);
+        TEST_ASSERT_EQUAL(len, outLen);
+        TEST_ASSERT_EQUAL_MEMORY(msg, out, len);
+    }
+    TEST_ASSERT_EQUAL(0, rx.inFlight());
+    TEST_ASSERT_FALSE(sendFragmented(msg, WireCodec::MAX_MESSAGE_LEN + 1, ++id));
+}
+
+void test_interleaved_peers_and_duplicates() {
+    static uint8_t a[900], b[900];
+    fillPattern(a, sizeof(a), 1);
+    fillPattern(b, sizeof(b), 2);
+    static SimLink linkA, linkB;
+    linkA.clear(); linkB.clear();
+    Fragmentation::send(a, sizeof(a), WireCodec::MAX_FRAME_LEN, 7, [](const uint8_t* f, size_t n) { return linkA.send(f, n); });
+    Fragmentation::send(b, sizeof(b), WireCodec::MAX_FRAME_LEN, 7, [](const uint8_t* f, size_t n) { return linkB.send(f, n); });
+
+    Reassembler rx;
+    size_t outLen = 0;
+    int done = 0;
+    for (int i = 0; i < linkA.count; ++i) {
+        // Same msg id from two peers, and every fragment of A twice
+        const uint8_t* m = rx.accept(MAC_A, linkA.frames[i], linkA.lens[i], 0, outLen);
+        if (m) { TEST_ASSERT_EQUAL_MEMORY(a, m, sizeof(a)); done++; }
+        if (i + 1 < linkA.count) TEST_ASSERT_NULL(rx.accept(MAC_A, linkA.frames[i], linkA.lens[i], 0, outLen));
+        m = rx.accept(MAC_B, linkB.frames[i], linkB.lens[i], 0, outLen);
+        if (m) { TEST_ASSERT_EQUAL_MEMORY(b, m, sizeof(b)); done++; }
+    }
+    TEST_ASSERT_EQUAL(2, done);
+}
+
+void test_bounded_pool_evicts_and_expires() {
+    static uint8_t msg[600];
+    fillPattern(msg, sizeof(msg), 3);
+    Reassembler rx;
+    size_t outLen = 0;
+
+    // Start one more message than there are buffers; first fragment only
+    for (size_t i = 0; i <= Reassembler::SLOTS; ++i) {
+        s_link.clear();
+        sendFragmented(msg, sizeof(msg), (uint8_t)(100 + i));
+        TEST_ASSERT_NULL(rx.accept(MAC_A, s_link.frames[0], s_link.lens[0], i, outLen));
+    }
+    TEST_ASSERT_EQUAL(Reassembler::SLOTS, rx.inFlight());
+    TEST_ASSERT_EQUAL_UINT32(1, rx.stats().evicted);
+
+    // Nothing more arrives: all partial messages time out
+    s_link.clear();
+    sendFragmented(msg, sizeof(msg), 200);
+    rx.accept(MAC_B, s_link.frames[0], s_link.lens[0], Fragmentation::REASSEMBLY_TIMEOUT_MS + 100, outLen);
+    TEST_ASSERT_EQUAL_UINT32(Reassembler::SLOTS, rx.stats().expired);
+    TEST_ASSERT_EQUAL(1, rx.inFlight());
+}
+
+void test_malformed_fragments_rejected() {
+    static uint8_t msg[600];
+    fillPattern(msg, sizeof(msg), 4);
+    s_link.clear();
+    sendFragmented(msg, sizeof(msg), 9);
+    Reassembler rx;
+    size_t outLen = 0;
+
+    // Truncated chunk
+    TEST_ASSERT_NULL(rx.accept(MAC_A, s_link.frames[0], s_link.lens[0] - 1, 0, outLen));
+    // Index beyond count
+    uint8_t bad[WireCodec::MAX_FRAME_LEN];
+    memcpy(bad, s_link.frames[0], s_link.lens[0]);
+    bad[WireCodec::HEADER_LEN + 1] = 9;
+    TEST_ASSERT_NULL(rx.accept(MAC_A, bad, s_link.lens[0], 0, outLen));
+    // Not a fragment at all
+    AckMessage ack;
+    size_t n = ack.toBinary(bad, sizeof(bad));
+    TEST_ASSERT_FALSE(Fragmentation::isFragment(bad, n));
+    TEST_ASSERT_NULL(rx.accept(MAC_A, bad, n, 0, outLen));
+    TEST_ASSERT_EQUAL_UINT32(3, rx.stats().rejected);
+    TEST_ASSERT_EQUAL(0, rx.inFlight());
+}
+
+void test_throughput_v2_vs_fragmented() {
+    static uint8_t msg[WireCodec::MAX_MESSAGE_LEN];
+    const size_t sizes[] = {500, 1000, 1470};
+    const int ITER = 200;
+    Reassembler rx;
+    uint8_t id = 0;
+
+    for (size_t len : sizes) {
+        fillPattern(msg, len, 5);
+
+        // ESP-NOW v2: one frame, no reassembly
+        s_link.clear();
+        s_link.airtimeUs = 0;
+        s_link.send(msg, len);
+        uint64_t v2Air = s_link.airtimeUs;
+
+        // v1 peer: fragments, reassembled on the far side
+        uint64_t fragAir = 0;
+        int frames = 0;
+        uint32_t t0 = micros();
+        for (int it = 0; it < ITER; ++it) {
+            s_link.clear();
+            s_link.airtimeUs = 0;
+            TEST_ASSERT_TRUE(sendFragmented(msg, len, ++id));
+            size_t outLen = 0;
+            const uint8_t* out = nullptr;
+            for (int i = 0; i < s_link.count; ++i) {
+                out = rx.accept(MAC_A, s_link.frames[i], s_link.lens[i], 0, outLen);
+            }
+            TEST_ASSERT_NOT_NULL(out);
+            TEST_ASSERT_EQUAL(len, outLen);
+            fragAir = s_link.airtimeUs;
+            frames = s_link.count;
+        }
+        uint32_t cpuNs = (uint32_t)((micros() - t0) * 1000ULL / ITER);
+
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "%4u B: v2 1 frame %5.2f ms %6.1f kB/s | v1 %d frames %5.2f ms %6.1f kB/s | split+reassemble %lu ns",
+                 (unsigned)len, v2Air / 1000.0, len * 1000.0 / v2Air,
+                 frames, fragAir / 1000.0, len * 1000.0 / fragAir, (unsigned long)cpuNs);
+        TEST_MESSAGE(line);
+        if (len > WireCodec::MAX_FRAME_LEN) TEST_ASSERT_TRUE(v2Air < fragAir);
+    }
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip_all_sizes);
+    RUN_TEST(test_interleaved_peers_and_duplicates);
+    RUN_TEST(test_bounded_pool_evicts_and_expires);
+    RUN_TEST(test_malformed_fragments_rejected);
+    RUN_TEST(test_throughput_v2_vs_fragmented);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,177 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+// JSON key dictionary: version selection, round trips in both key forms and
+// the frame-size reduction over a recorded JSON-wire traffic trace.
+
+// 20 s of one JSON-wire node after join, recorded off the air: telemetry once
+// a second with its acks, three set_light commands with acks, one error.
+static const char* const kTrace[] = {
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":0,\"avg_g\":0,\"avg_b\":0,\"avg_w\":128,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.41,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":184005}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":0,\"avg_g\":0,\"avg_b\":0,\"avg_w\":128,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.4,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":185011}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":0,\"avg_g\":0,\"avg_b\":0,\"avg_w\":128,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.38,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":186012}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":0,\"avg_g\":0,\"avg_b\":0,\"avg_w\":128,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.39,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":187013}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"set_light\",\"cmd_id\":\"187985-4A1CE0\",\"light_id\":\"\",\"r\":109,\"g\":19,\"b\":44,\"w\":0,\"value\":0,\"fade_ms\":200,\"override_status\":false,\"ttl_ms\":1500,\"pixel\":-1}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"187985-4A1CE0\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.38,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":188022}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.4,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":189028}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.4,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":190029}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.38,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":191030}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.37,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":192036}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.36,\"button_pressed\":true,\"fw\":\"c3-1.1.0\",\"ts\":193045}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":109,\"avg_g\":19,\"avg_b\":44,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.34,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":194048}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"set_light\",\"cmd_id\":\"195011-4A1CE0\",\"light_id\":\"\",\"r\":203,\"g\":25,\"b\":113,\"w\":0,\"value\":0,\"fade_ms\":200,\"override_status\":false,\"ttl_ms\":1500,\"pixel\":2}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"195011-4A1CE0\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":203,\"avg_g\":25,\"avg_b\":113,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.32,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":195048}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":203,\"avg_g\":25,\"avg_b\":113,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.3,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":196048}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":203,\"avg_g\":25,\"avg_b\":113,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.31,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":197050}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"error\",\"node_id\":\"34:85:18:4A:1C:E0\",\"code\":\"tmp117\",\"info\":\"sensor read timeout\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":203,\"avg_g\":25,\"avg_b\":113,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.31,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":198056}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":203,\"avg_g\":25,\"avg_b\":113,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.3,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":199064}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"set_light\",\"cmd_id\":\"200036-4A1CE0\",\"light_id\":\"\",\"r\":92,\"g\":52,\"b\":96,\"w\":0,\"value\":0,\"fade_ms\":200,\"override_status\":true,\"ttl_ms\":1500,\"pixel\":-1}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"200036-4A1CE0\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":92,\"avg_g\":52,\"avg_b\":96,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.31,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":200073}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":92,\"avg_g\":52,\"avg_b\":96,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.3,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":201078}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":92,\"avg_g\":52,\"avg_b\":96,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.29,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":202086}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"node_status\",\"node_id\":\"34:85:18:4A:1C:E0\",\"light_id\":\"L4A1CE0\",\"avg_r\":92,\"avg_g\":52,\"avg_b\":96,\"avg_w\":0,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":22.28,\"button_pressed\":false,\"fw\":\"c3-1.1.0\",\"ts\":203095}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+};
+static const size_t kTraceLen = sizeof(kTrace) / sizeof(kTrace[0]);
+
+void test_firmware_selects_dictionary() {
+    TEST_ASSERT_EQUAL(KeyDictionary::NONE, KeyDictionary::forFirmware("c3-1.0.0"));
+    TEST_ASSERT_EQUAL(KeyDictionary::NONE, KeyDictionary::forFirmware("c3-0.9.12"));
+    TEST_ASSERT_EQUAL(KeyDictionary::V1, KeyDictionary::forFirmware("c3-1.1.0"));
+    TEST_ASSERT_EQUAL(KeyDictionary::V1, KeyDictionary::forFirmware("c3-1.12.3"));
+    TEST_ASSERT_EQUAL(KeyDictionary::V1, KeyDictionary::forFirmware("s3-2.0.0"));
+    TEST_ASSERT_EQUAL(KeyDictionary::V1, KeyDictionary::forFirmware("1.1"));
+    TEST_ASSERT_EQUAL(KeyDictionary::NONE, KeyDictionary::forFirmware(""));
+    TEST_ASSERT_EQUAL(KeyDictionary::NONE, KeyDictionary::forFirmware("c3-dev"));
+    TEST_ASSERT_EQUAL(KeyDictionary::NONE, KeyDictionary::forFirmware(nullptr));
+
+    TEST_ASSERT_EQUAL_STRING("os", KeyDictionary::tokenFor("override_status"));
+    TEST_ASSERT_EQUAL_STRING("fw", KeyDictionary::tokenFor("fw"));
+}
+
+void test_compact_frames_round_trip() {
+    NodeStatusMessage st;
+    st.node_id = "34:85:18:4A:1C:E0";
+    st.light_id = "L4A1CE0";
+    st.avg_w = 128;
+    st.status_mode = "operational";
+    st.temperature = 22.41f;
+    st.button_pressed = true;
+    st.fw = "c3-1.1.0";
+
+    String compact = st.toJson(KeyDictionary::V1);
+    TEST_ASSERT_TRUE(compact.indexOf("\"msg\":\"node_status\"") >= 0);
+    TEST_ASSERT_TRUE(compact.indexOf("\"bp\":true") >= 0);
+    TEST_ASSERT_TRUE(compact.indexOf("button_pressed") < 0);
+    TEST_ASSERT_TRUE(compact.length() < st.toJson().length());
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode((const uint8_t*)compact.c_str(), compact.length());
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, m->type);
+    TEST_ASSERT_TRUE(MessageSchema::equal(st, *static_cast<NodeStatusMessage*>(m)));
+
+    // Nested group keys are shortened too
+    JoinAcceptMessage accept;
+    accept.node_id = "34:85:18:4A:1C:E0";
+    accept.wifi_channel = 6;
+    accept.cfg.rx_window_ms = 30;
+    accept.key_dict = KeyDictionary::V1;
+    compact = accept.toJson(KeyDictionary::V1);
+    TEST_ASSERT_TRUE(compact.indexOf("\"cf\":{") >= 0);
+    m = slot.decode((const uint8_t*)compact.c_str(), compact.length());
+    TEST_ASSERT_NOT_NULL(m);
+    const JoinAcceptMessage& in = *static_cast<JoinAcceptMessage*>(m);
+    TEST_ASSERT_EQUAL(30, in.cfg.rx_window_ms);
+    TEST_ASSERT_EQUAL(KeyDictionary::V1, in.key_dict);
+    TEST_ASSERT_TRUE(MessageSchema::equal(accept, in));
+}
+
+void test_long_keys_still_accepted() {
+    // Firmware without the dictionary keeps sending long keys
+    const char* frame = kTrace[0];
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode((const uint8_t*)frame, strlen(frame));
+    TEST_ASSERT_NOT_NULL(m);
+    const NodeStatusMessage& st = *static_cast<NodeStatusMessage*>(m);
+    TEST_ASSERT_EQUAL_STRING("34:85:18:4A:1C:E0", st.node_id.c_str());
+    TEST_ASSERT_EQUAL(128, st.avg_w);
+    TEST_ASSERT_EQUAL_STRING("operational", st.status_mode.c_str());
+}
+
+void test_trace_frame_size_reduction() {
+    MessageSlot slot;
+    size_t fullBytes = 0, compactBytes = 0;
+    size_t statusFull = 0, statusCompact = 0, statusFrames = 0;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+
+    for (size_t i = 0; i < kTraceLen; ++i) {
+        EspNowMessage* m = slot.decode((const uint8_t*)kTrace[i], strlen(kTrace[i]));
+        TEST_ASSERT_NOT_NULL(m);
+        size_t full = m->encode(WireCodec::Format::JSON, buf, sizeof(buf), KeyDictionary::NONE);
+        size_t compact = m->encode(WireCodec::Format::JSON, buf, sizeof(buf), KeyDictionary::V1);
+        TEST_ASSERT_GREATER_THAN(0, compact);
+        TEST_ASSERT_TRUE(compact <= full);
+        fullBytes += full;
+        compactBytes += compact;
+        if (m->type == MessageType::NODE_STATUS) {
+            statusFull += full;
+            statusCompact += compact;
+            statusFrames++;
+        }
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "trace %u frames: avg %.1f B -> %.1f B (-%.1f%%), node_status %.1f B -> %.1f B (-%.1f%%)",
+             (unsigned)kTraceLen, (double)fullBytes / kTraceLen, (double)compactBytes / kTraceLen,
+             100.0 * (fullBytes - compactBytes) / fullBytes,
+             (double)statusFull / statusFrames, (double)statusCompact / statusFrames,
+             100.0 * (statusFull - statusCompact) / statusFull);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(compactBytes * 5 < fullBytes * 4); // at least 20% smaller
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_firmware_selects_dictionary);
+    RUN_TEST(test_compact_frames_round_trip);
+    RUN_TEST(test_long_keys_still_accepted);
+    RUN_TEST(test_trace_frame_size_reduction);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
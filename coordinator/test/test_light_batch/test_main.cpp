@@ -0,0 +1,143 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+// light_batch: one broadcast frame carrying set_light entries for many nodes
+
+static void macFor(int i, uint8_t mac[6]) {
+    const uint8_t base[6] = {0x34, 0x85, 0x18, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[4] = (uint8_t)(i >> 8);
+    mac[5] = (uint8_t)i;
+}
+
+void test_batch_round_trip_and_extract() {
+    SetLightBatchMessage batch;
+    batch.batch_id = 42;
+    batch.ttl_ms = 500;
+    batch.override_status = true;
+    uint8_t mac[6];
+    for (int i = 0; i < 5; ++i) {
+        macFor(i, mac);
+        TEST_ASSERT_TRUE(batch.add(mac, i, 10 + i, 20 + i, 30 + i, 60 + i, i == 3 ? 2 : -1));
+    }
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = batch.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(MessageSchema::maxBinarySize<SetLightBatchMessage>() + 1 + 5 * SetLightBatchMessage::ENTRY_WIRE_LEN, n);
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::SET_LIGHT_BATCH, m->type);
+    const SetLightBatchMessage& in = *static_cast<SetLightBatchMessage*>(m);
+    TEST_ASSERT_EQUAL(5, in.count);
+
+    // Each node finds only its own entry
+    SetLightMessage cmd;
+    macFor(3, mac);
+    TEST_ASSERT_TRUE(in.extract(mac, cmd));
+    TEST_ASSERT_EQUAL(3, cmd.r);
+    TEST_ASSERT_EQUAL(33, cmd.w);
+    TEST_ASSERT_EQUAL(63, cmd.fade_ms);
+    TEST_ASSERT_EQUAL(2, cmd.pixel);
+    TEST_ASSERT_EQUAL(500, cmd.ttl_ms);
+    TEST_ASSERT_TRUE(cmd.override_status);
+    TEST_ASSERT_EQUAL_STRING("b42", cmd.cmd_id.c_str());
+    TEST_ASSERT_TRUE(cmd.light_id.isEmpty());
+
+    macFor(9, mac);
+    TEST_ASSERT_FALSE(in.extract(mac, cmd));
+}
+
+void test_batch_capacity_fits_one_frame() {
+    SetLightBatchMessage batch;
+    uint8_t mac[6];
+    for (size_t i = 0; i < SetLightBatchMessage::MAX_ENTRIES; ++i) {
+        macFor((int)i, mac);
+        TEST_ASSERT_TRUE(batch.add(mac, 1, 2, 3, 4, 200));
+    }
+    TEST_ASSERT_TRUE(batch.isFull());
+    TEST_ASSERT_FALSE(batch.add(mac, 1, 2, 3, 4, 200));
+
+    // Largest frame: every entry plus an execute-at time
+    batch.at_ms = 1000;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = batch.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(SetLightBatchMessage::maxFrameSize(), n);
+    TEST_ASSERT_TRUE(n <= WireCodec::MAX_FRAME_LEN);
+}
+
+void test_malformed_batch_is_rejected() {
+    SetLightBatchMessage batch;
+    uint8_t mac[6];
+    macFor(1, mac);
+    batch.add(mac, 1, 2, 3, 4, 200);
+    batch.add(mac, 1, 2, 3, 4, 200);
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = batch.toBinary(buf, sizeof(buf));
+
+    SetLightBatchMessage out;
+    // Truncated inside the last entry
+    TEST_ASSERT_FALSE(out.fromBinary(buf, n - 1));
+    // Count larger than the struct can hold
+    buf[n - 2 * SetLightBatchMessage::ENTRY_WIRE_LEN - 1] = SetLightBatchMessage::MAX_ENTRIES + 1;
+    TEST_ASSERT_FALSE(out.fromBinary(buf, n));
+}
+
+void test_zone_change_frame_count() {
+    // A zone-wide colour change: one unicast set_light per node vs batches
+    const int counts[] = {8, 20, 50};
+    for (int nodes : counts) {
+        size_t unicastBytes = 0;
+        uint8_t buf[WireCodec::MAX_FRAME_LEN];
+        uint8_t mac[6];
+        for (int i = 0; i < nodes; ++i) {
+            SetLightMessage cmd;
+            cmd.cmd_id = "1234567-0000FF";
+            cmd.g = 255;
+            cmd.fade_ms = 200;
+            unicastBytes += cmd.encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+        }
+        size_t batchBytes = 0, frames = 0;
+        SetLightBatchMessage batch;
+        for (int i = 0; i < nodes; ++i) {
+            if (batch.isFull()) {
+                batchBytes += batch.toBinary(buf, sizeof(buf));
+                frames++;
+                batch.count = 0;
+            }
+            macFor(i, mac);
+            batch.add(mac, 0, 255, 0, 0, 200);
+        }
+        batchBytes += batch.toBinary(buf, sizeof(buf));
+        frames++;
+        TEST_ASSERT_EQUAL((nodes + SetLightBatchMessage::MAX_ENTRIES - 1) / SetLightBatchMessage::MAX_ENTRIES, frames);
+
+        char line[128];
+        snprintf(line, sizeof(line), "%2d nodes: unicast %2d frames %4u B | batch %u frame(s) %4u B",
+                 nodes, nodes, (unsigned)unicastBytes, (unsigned)frames, (unsigned)batchBytes);
+        TEST_MESSAGE(line);
+    }
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_batch_round_trip_and_extract);
+    RUN_TEST(test_batch_capacity_fits_one_frame);
+    RUN_TEST(test_malformed_batch_is_rejected);
+    RUN_TEST(test_zone_change_frame_count);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
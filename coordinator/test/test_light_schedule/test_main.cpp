@@ -0,0 +1,292 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+#include "LightSchedule.h"
+#include "TimeSync.h"
+
+// Execute-at light commands: at_ms on the wire, the node's schedule queue,
+// and a simulated multi-tile transition measuring how far apart the tiles
+// change colour, sent as unicast set_light and as light_batch broadcasts,
+// with and without an execute-at time.
+
+static uint32_t s_rng = 777;
+static uint32_t nextRand() {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return s_rng >> 8;
+}
+static uint32_t randBelow(uint32_t n) { return nextRand() % n; }
+
+void test_at_ms_on_the_wire() {
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    MessageSlot slot;
+
+    SetLightMessage cmd;
+    cmd.cmd_id = "c1";
+    cmd.w = 200;
+    cmd.at_ms = 123456;
+    size_t n = cmd.toBinary(buf, sizeof(buf));
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_UINT32(123456, static_cast<SetLightMessage*>(m)->at_ms);
+    // From a coordinator that predates the field
+    m = slot.decode(buf, n - 4);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<SetLightMessage*>(m)->at_ms);
+
+    SetLightBatchMessage batch;
+    uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x01, 0x02, 0x03};
+    batch.add(mac, 1, 2, 3, 4, 100);
+    size_t plain = batch.toBinary(buf, sizeof(buf));
+    batch.at_ms = 0xFFFFFF00u;
+    n = batch.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(plain + 4, n);
+    TEST_ASSERT_TRUE(n <= SetLightBatchMessage::maxFrameSize());
+    m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    SetLightMessage mine;
+    TEST_ASSERT_TRUE(static_cast<SetLightBatchMessage*>(m)->extract(mac, mine));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFF00u, mine.at_ms);
+    // Nodes that stop after the entries still get their command
+    m = slot.decode(buf, plain);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL_UINT32(0, static_cast<SetLightBatchMessage*>(m)->at_ms);
+}
+
+static LightSchedule::Action actionAt(uint32_t dueMs, uint8_t w) {
+    LightSchedule::Action a;
+    a.dueMs = dueMs;
+    a.r = a.g = a.b = 0;
+    a.w = w;
+    a.fade_ms = 0;
+    a.pixel = -1;
+    return a;
+}
+
+void test_schedule_runs_in_due_order() {
+    LightSchedule sched;
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, sched.msUntilNext(0));
+    // Near the 32-bit wrap of millis()
+    const uint32_t now = 0xFFFFFFF0u;
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 40, 1), now));
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 10, 2), now));
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 40, 3), now)); // same instant: after 1
+    TEST_ASSERT_EQUAL_UINT32(10, sched.msUntilNext(now));
+
+    LightSchedule::Action out;
+    TEST_ASSERT_FALSE(sched.popDue(now + 9, out));
+    TEST_ASSERT_TRUE(sched.popDue(now + 10, out));
+    TEST_ASSERT_EQUAL(2, out.w);
+    TEST_ASSERT_TRUE(sched.popDue(now + 45, out));
+    TEST_ASSERT_EQUAL(1, out.w);
+    TEST_ASSERT_TRUE(sched.popDue(now + 45, out));
+    TEST_ASSERT_EQUAL(3, out.w);
+    TEST_ASSERT_EQUAL(0, sched.size());
+
+    // Already due, late, too far out: the caller applies at once
+    TEST_ASSERT_FALSE(sched.add(actionAt(now, 4), now));
+    TEST_ASSERT_FALSE(sched.add(actionAt(now - 5, 4), now));
+    TEST_ASSERT_FALSE(sched.add(actionAt(now + LightSchedule::MAX_LEAD_MS + 1, 4), now));
+    TEST_ASSERT_EQUAL_UINT32(1, sched.stats().late);
+    for (size_t i = 0; i < LightSchedule::CAPACITY; ++i) {
+        TEST_ASSERT_TRUE(sched.add(actionAt(now + 100 + i, 5), now));
+    }
+    TEST_ASSERT_FALSE(sched.add(actionAt(now + 50, 6), now));
+    TEST_ASSERT_EQUAL_UINT32(2, sched.stats().refused);
+    sched.clear();
+    TEST_ASSERT_EQUAL(0, sched.size());
+}
+
+// The node's order: a command applied at once (no time, no synced clock,
+// late, or queue full) supersedes what is held, so a stale held colour
+// cannot come due afterwards and overwrite it
+void test_immediate_command_supersedes_held() {
+    LightSchedule sched;
+    const uint32_t now = 1000;
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 50, 1), now));
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 80, 2), now));
+
+    // Newer command with no at_ms, 10 ms later: applied now
+    LightSchedule::Action applied = actionAt(now + 10, 3);
+    TEST_ASSERT_FALSE(sched.add(applied, now + 10));
+    sched.supersede();
+    TEST_ASSERT_EQUAL(0, sched.size());
+    TEST_ASSERT_EQUAL_UINT32(2, sched.stats().superseded);
+
+    // Nothing comes due over it
+    LightSchedule::Action out;
+    TEST_ASSERT_FALSE(sched.popDue(now + 200, out));
+
+    // Later scheduled commands are held as before
+    TEST_ASSERT_TRUE(sched.add(actionAt(now + 300, 4), now + 200));
+    TEST_ASSERT_TRUE(sched.popDue(now + 300, out));
+    TEST_ASSERT_EQUAL(4, out.w);
+}
+
+// ---- Simulated transition ----
+
+struct SimClock {
+    double rate;
+    double offsetUs;
+
+    uint32_t millisAt(uint64_t trueUs) const {
+        return (uint32_t)(uint64_t)((trueUs * rate + offsetUs) / 1000.0);
+    }
+    // First true instant at which millis() reads ms
+    uint64_t trueAt(uint32_t ms, uint64_t nearUs) const {
+        // Unwrap ms against the reading near nearUs
+        double nearLocal = nearUs * rate + offsetUs;
+        double local = nearLocal + (double)(int32_t)(ms - (uint32_t)(uint64_t)(nearLocal / 1000.0)) * 1000.0;
+        local = (double)(uint64_t)(local / 1000.0) * 1000.0;
+        return (uint64_t)((local - offsetUs) / rate + 0.999);
+    }
+};
+
+static uint64_t legDelayUs(uint32_t queueUs) {
+    uint64_t d = 1200 + randBelow(1500) + randBelow(queueUs + 1);
+    if (randBelow(100) < 10) d += 3000 + randBelow(30000);
+    if (randBelow(1000) < 15) d += 80000 + randBelow(150000);
+    return d;
+}
+
+static const int TILES = 24;
+static const int RUNS = 200;
+static const uint32_t LOOP_US = 10300;   // delay(10) plus a pass through loop()
+
+struct SimTile {
+    SimClock clock;
+    TimeSync sync;
+    uint64_t nextExchangeUs;
+};
+
+static SimTile s_tiles[TILES];
+static SimClock s_coord;
+
+// Telemetry acks up to trueUs keep each tile's clock estimate current
+static void runClockSync(uint64_t trueUs) {
+    for (int i = 0; i < TILES; ++i) {
+        SimTile& t = s_tiles[i];
+        while (t.nextExchangeUs <= trueUs) {
+            uint64_t sendUs = t.nextExchangeUs;
+            t.nextExchangeUs += 1000000 + randBelow(20000);
+            if (randBelow(100) < 10) continue;
+            uint64_t rxUs = sendUs + legDelayUs(2000);
+            uint64_t ackUs = rxUs + 500 + randBelow(25000);
+            uint64_t backUs = ackUs + legDelayUs(15000);
+            t.sync.addExchange(t.clock.millisAt(sendUs), s_coord.millisAt(rxUs),
+                               s_coord.millisAt(ackUs), t.clock.millisAt(backUs));
+        }
+    }
+}
+
+// Serialised TX: each frame waits for the one before it; unicast frames
+// are retried now and then, broadcasts are not
+static void deliver(uint64_t startUs, bool unicast, int frames, uint64_t* arriveUs) {
+    uint64_t t = startUs;
+    for (int f = 0; f < frames; ++f) {
+        t += 900 + randBelow(600) + (unicast ? 500 : 2000);
+        if (unicast && randBelow(100) < 10) t += 2000 + randBelow(4000);
+        arriveUs[f] = t + 100 + randBelow(300);
+    }
+}
+
+struct Skew {
+    uint32_t us[RUNS];
+    int n = 0;
+    uint32_t late = 0;
+
+    uint32_t pct(int p) {
+        uint32_t sorted[RUNS];
+        memcpy(sorted, us, sizeof(sorted));
+        for (int i = 1; i < n; ++i) {
+            for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; --j) {
+                uint32_t x = sorted[j]; sorted[j] = sorted[j - 1]; sorted[j - 1] = x;
+            }
+        }
+        return sorted[(n - 1) * p / 100];
+    }
+};
+
+// One transition to every tile; returns the spread of the moments they change
+static uint32_t transition(uint64_t t0, bool unicast, bool scheduled, uint32_t& late) {
+    const int frames = unicast ? TILES
+                               : (TILES + SetLightBatchMessage::MAX_ENTRIES - 1) / SetLightBatchMessage::MAX_ENTRIES;
+    uint64_t arrive[TILES];
+    deliver(t0, unicast, frames, arrive);
+    uint32_t atMs = s_coord.millisAt(t0) + LightSchedule::leadMs(frames);
+
+    uint64_t first = UINT64_MAX, last = 0;
+    for (int i = 0; i < TILES; ++i) {
+        SimTile& tile = s_tiles[i];
+        uint64_t rx = unicast ? arrive[i] : arrive[i / SetLightBatchMessage::MAX_ENTRIES];
+        // The RX ring is drained on the next pass through loop()
+        uint64_t handled = rx + randBelow(LOOP_US);
+        uint64_t applied = handled;
+        uint32_t local = tile.clock.millisAt(handled);
+        if (scheduled && tile.sync.synced(local)) {
+            LightSchedule sched;
+            LightSchedule::Action a = actionAt(tile.sync.toLocal(atMs), 255);
+            if (sched.add(a, local)) {
+                // loop() sleeps until millis() reaches the due time, then runs it
+                applied = tile.clock.trueAt(a.dueMs, handled) + randBelow(500);
+            } else if (sched.stats().late) {
+                late++;
+            }
+        }
+        if (applied < first) first = applied;
+        if (applied > last) last = applied;
+    }
+    return (uint32_t)(last - first);
+}
+
+void test_transition_skew() {
+    s_coord = SimClock{1.0 + 8e-6, 5.0e9};
+    for (int i = 0; i < TILES; ++i) {
+        double ppm = (double)((int)randBelow(81) - 40);
+        s_tiles[i].clock = SimClock{1.0 + ppm * 1e-6, (double)randBelow(600000) * 1000.0};
+        s_tiles[i].sync.reset();
+        s_tiles[i].nextExchangeUs = randBelow(1000000);
+    }
+
+    const char* names[4] = {"unicast set_light    ", "unicast + execute-at ", "light_batch          ", "light_batch + exec-at"};
+    static Skew skew[4];
+    for (int k = 0; k < 4; ++k) skew[k] = Skew();
+    for (int run = 0; run < RUNS; ++run) {
+        uint64_t t0 = 10000000ULL + (uint64_t)run * 2000000ULL + randBelow(500000);
+        runClockSync(t0);
+        for (int k = 0; k < 4; ++k) {
+            skew[k].us[skew[k].n++] = transition(t0 + k * 400000ULL, k < 2, k % 2 == 1, skew[k].late);
+        }
+    }
+
+    // Scheduled transitions land within a frame of each other (~10 ms)
+    TEST_ASSERT_TRUE(skew[1].pct(95) < 10000);
+    TEST_ASSERT_TRUE(skew[3].pct(95) < 10000);
+    TEST_ASSERT_TRUE(skew[1].pct(50) * 3 < skew[0].pct(50));
+    TEST_ASSERT_TRUE(skew[3].pct(50) < skew[2].pct(50));
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d tiles, %d transitions, inter-tile skew (p50 / p95 / max):", TILES, RUNS);
+    TEST_MESSAGE(msg);
+    for (int k = 0; k < 4; ++k) {
+        snprintf(msg, sizeof(msg), "  %s %5.1f / %5.1f / %5.1f ms, %lu late arrival(s)",
+                 names[k], skew[k].pct(50) / 1000.0, skew[k].pct(95) / 1000.0, skew[k].pct(100) / 1000.0,
+                 (unsigned long)skew[k].late);
+        TEST_MESSAGE(msg);
+    }
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_at_ms_on_the_wire);
+    RUN_TEST(test_schedule_runs_in_due_order);
+    RUN_TEST(test_immediate_command_supersedes_held);
+    RUN_TEST(test_transition_skew);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,237 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include "../../src/comm/LinkQuality.h"
+
+// Per-peer link estimate and PHY rate choice: rate against RSSI, hysteresis,
+// stepping down on send failures, the airtime model, and a simulated fleet
+// sent to at a fixed 1 Mbps against adaptive rates.
+
+typedef LinkQuality::Rate Rate;
+
+static uint32_t s_rng = 99;
+static uint32_t randBelow(uint32_t n) {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return (s_rng >> 8) % n;
+}
+static float randUniform(float lo, float hi) {
+    return lo + (hi - lo) * (float)randBelow(10001) / 10000.0f;
+}
+
+static void feedRssi(LinkQuality& q, int8_t rssi, int n) {
+    for (int i = 0; i < n; ++i) q.onRssi(rssi);
+}
+
+void test_rate_follows_rssi() {
+    LinkQuality q;
+    TEST_ASSERT_EQUAL(Rate::R1M, q.rate());
+    // First reading places the peer at once
+    TEST_ASSERT_TRUE(q.onRssi(-50));
+    TEST_ASSERT_EQUAL(Rate::R54M, q.rate());
+
+    LinkQuality far;
+    far.onRssi(-92);
+    TEST_ASSERT_EQUAL(Rate::R1M, far.rate());
+
+    // Hysteresis: -78 clears 12M's floor (-80) but not by HYSTERESIS_DB
+    LinkQuality mid;
+    mid.onRssi(-78);
+    TEST_ASSERT_EQUAL(Rate::R6M, mid.rate());
+
+    // Signal fading away: the average sinks below the floor and the rate follows
+    size_t changes = 0;
+    for (int i = 0; i < 60; ++i) {
+        if (q.onRssi(-86)) changes++;
+    }
+    TEST_ASSERT_EQUAL(Rate::R1M, q.rate());
+    TEST_ASSERT_TRUE(changes >= 1 && changes <= LinkQuality::RATES - 1);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, -86.0f, q.rssi());
+
+    // Back up only after MIN_SAMPLES clean sends at each step
+    feedRssi(q, -60, 60);
+    TEST_ASSERT_EQUAL(Rate::R1M, q.rate());
+    for (int i = 0; i < LinkQuality::MIN_SAMPLES - 1; ++i) TEST_ASSERT_FALSE(q.onSend(true));
+    TEST_ASSERT_TRUE(q.onSend(true));
+    TEST_ASSERT_EQUAL(Rate::R54M, q.rate());
+}
+
+void test_no_flapping_at_a_threshold() {
+    LinkQuality q;
+    q.onRssi(-73);
+    Rate start = q.rate();
+    int changes = 0;
+    // RSSI wandering a few dB either side of 24M's floor, every send delivered
+    for (int i = 0; i < 2000; ++i) {
+        if (q.onRssi((int8_t)(-75 + (int)randBelow(7) - 3))) changes++;
+        if (q.onSend(true)) changes++;
+    }
+    TEST_ASSERT_TRUE(changes <= 2);
+    TEST_ASSERT_TRUE(q.rate() == start || q.rate() == Rate::R12M);
+}
+
+void test_failures_step_down_and_hold() {
+    LinkQuality q;
+    q.onRssi(-45);
+    TEST_ASSERT_EQUAL(Rate::R54M, q.rate());
+    for (int i = 0; i < 40; ++i) q.onSend(true);
+    // One failure is noise; a second close behind it is not
+    TEST_ASSERT_FALSE(q.onSend(false));
+    TEST_ASSERT_TRUE(q.onSend(false));
+    TEST_ASSERT_EQUAL(Rate::R36M, q.rate());
+    TEST_ASSERT_EQUAL_UINT32(2, q.failed());
+
+    // RSSI still says 54M, but the failed rate stays off limits for a while
+    feedRssi(q, -45, 20);
+    int sends = 0;
+    while (q.rate() == Rate::R36M && sends < 1000) {
+        q.onSend(true);
+        sends++;
+    }
+    TEST_ASSERT_EQUAL(Rate::R54M, q.rate());
+    TEST_ASSERT_EQUAL(LinkQuality::CEILING_SAMPLES, sends);
+
+    // Failing all the way down stops at 1 Mbps
+    for (int i = 0; i < 100; ++i) q.onSend(false);
+    TEST_ASSERT_EQUAL(Rate::R1M, q.rate());
+}
+
+void test_airtime_model() {
+    // 1 Mbps matches the model the other suites use
+    TEST_ASSERT_EQUAL_UINT32(192 + (43 + 100) * 8, LinkQuality::airtimeUs(Rate::R1M, 100, false));
+    TEST_ASSERT_EQUAL_UINT32(192 + (43 + 100) * 8 + 10 + 192 + 14 * 8, LinkQuality::airtimeUs(Rate::R1M, 100, true));
+    uint32_t prev = UINT32_MAX;
+    for (size_t r = 0; r < LinkQuality::RATES; ++r) {
+        uint32_t us = LinkQuality::airtimeUs((Rate)r, 100, true);
+        TEST_ASSERT_TRUE(us < prev);
+        prev = us;
+    }
+    char msg[160];
+    snprintf(msg, sizeof(msg), "100 B unicast on air: 1M %lu us, 6M %lu us, 24M %lu us, 54M %lu us",
+             (unsigned long)LinkQuality::airtimeUs(Rate::R1M, 100, true),
+             (unsigned long)LinkQuality::airtimeUs(Rate::R6M, 100, true),
+             (unsigned long)LinkQuality::airtimeUs(Rate::R24M, 100, true),
+             (unsigned long)LinkQuality::airtimeUs(Rate::R54M, 100, true));
+    TEST_MESSAGE(msg);
+}
+
+// ---- Simulated fleet ----
+
+// Indoor log-distance path loss (exponent 3) with a fixed shadowing offset per
+// tile and per-frame fading. An attempt fails along a logistic curve around
+// the rate's sensitivity (MIN_RSSI less the 10 dB margin); the driver tries a
+// frame ATTEMPTS times before send_cb reports failure. Partway through, five
+// far tiles lose another 12 dB (a door closes).
+static const int TILES = 30;
+static const int SIM_S = 600;
+static const int DOWNLINK_PER_S = 3;  // set_light, acks
+static const size_t FRAME_LEN = 60;
+static const int ATTEMPTS = 5;
+static const int OBSTRUCT_AT_S = 300;
+
+struct SimTile {
+    float meanRssi;
+    bool obstructed;
+    LinkQuality link;
+};
+
+struct FleetResult {
+    uint64_t airtimeUs;
+    uint32_t sent, delivered;
+    uint32_t farSent, farDelivered;
+    uint32_t atRate[LinkQuality::RATES];
+};
+
+static float frameRssi(const SimTile& t, int second) {
+    float extra = (t.obstructed && second >= OBSTRUCT_AT_S) ? 12.0f : 0.0f;
+    return t.meanRssi - extra + randUniform(-5.0f, 3.0f);
+}
+
+static bool attempt(Rate r, float rssi) {
+    float sens = (float)LinkQuality::MIN_RSSI[(size_t)r] - 10.0f;
+    if (r == Rate::R1M) sens = -98.0f;
+    float pFail = 1.0f / (1.0f + expf((rssi - sens) / 1.5f));
+    if (randBelow(1000) < 10) return false; // interference
+    return randUniform(0.0f, 1.0f) >= pFail;
+}
+
+static void runFleet(SimTile* tiles, bool adaptive, FleetResult& out) {
+    out = FleetResult{};
+    for (int i = 0; i < TILES; ++i) tiles[i].link.reset();
+    for (int second = 0; second < SIM_S; ++second) {
+        for (int i = 0; i < TILES; ++i) {
+            SimTile& t = tiles[i];
+            // Telemetry up: the RSSI sample
+            t.link.onRssi((int8_t)lroundf(frameRssi(t, second)));
+            for (int k = 0; k < DOWNLINK_PER_S; ++k) {
+                Rate r = adaptive ? t.link.rate() : Rate::R1M;
+                bool ok = false;
+                for (int a = 0; a < ATTEMPTS && !ok; ++a) {
+                    out.airtimeUs += LinkQuality::airtimeUs(r, FRAME_LEN, true);
+                    ok = attempt(r, frameRssi(t, second));
+                }
+                t.link.onSend(ok);
+                out.sent++;
+                if (ok) out.delivered++;
+                if (t.meanRssi < -80.0f || (t.obstructed && second >= OBSTRUCT_AT_S)) {
+                    out.farSent++;
+                    if (ok) out.farDelivered++;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < TILES; ++i) out.atRate[(size_t)tiles[i].link.rate()]++;
+}
+
+void test_fleet_airtime_and_reach() {
+    static SimTile tiles[TILES];
+    for (int i = 0; i < TILES; ++i) {
+        float d = 1.0f + 29.0f * i / (TILES - 1); // 1 to 30 m
+        tiles[i].meanRssi = -40.0f - 30.0f * log10f(d) + randUniform(-4.0f, 4.0f);
+        tiles[i].obstructed = i >= 10 && i % 4 == 0;
+    }
+    FleetResult fixed, adaptive;
+    runFleet(tiles, false, fixed);
+    runFleet(tiles, true, adaptive);
+
+    float fixedRatio = (float)fixed.delivered / fixed.sent;
+    float adaptiveRatio = (float)adaptive.delivered / adaptive.sent;
+    float farFixed = (float)fixed.farDelivered / fixed.farSent;
+    float farAdaptive = (float)adaptive.farDelivered / adaptive.farSent;
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "%d tiles at 1-30 m, %d x %u B unicast/s each for %d s:", TILES, DOWNLINK_PER_S,
+             (unsigned)FRAME_LEN, SIM_S);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  fixed 1M:  airtime %5.1f ms/s, delivered %.2f%% (far/obstructed tiles %.2f%%)",
+             fixed.airtimeUs / 1000.0 / SIM_S, fixedRatio * 100, farFixed * 100);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  adaptive:  airtime %5.1f ms/s, delivered %.2f%% (far/obstructed tiles %.2f%%)",
+             adaptive.airtimeUs / 1000.0 / SIM_S, adaptiveRatio * 100, farAdaptive * 100);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  rates at the end: 1M %lu, 6M %lu, 12M %lu, 24M %lu, 36M %lu, 54M %lu",
+             (unsigned long)adaptive.atRate[0], (unsigned long)adaptive.atRate[1], (unsigned long)adaptive.atRate[2],
+             (unsigned long)adaptive.atRate[3], (unsigned long)adaptive.atRate[4], (unsigned long)adaptive.atRate[5]);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_TRUE(adaptive.airtimeUs * 2 < fixed.airtimeUs);
+    TEST_ASSERT_TRUE(adaptiveRatio > fixedRatio - 0.005f);
+    TEST_ASSERT_TRUE(farAdaptive > farFixed - 0.01f);
+    TEST_ASSERT_TRUE(adaptive.atRate[(size_t)Rate::R1M] > 0);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_rate_follows_rssi);
+    RUN_TEST(test_no_flapping_at_a_threshold);
+    RUN_TEST(test_failures_step_down_and_hold);
+    RUN_TEST(test_airtime_model);
+    RUN_TEST(test_fleet_airtime_and_reach);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,139 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+// Frames as recorded off the air from coordinator and node firmware
+static const char* const kRecordedFrames[] = {
+    "{\"msg\":\"join_request\",\"mac\":\"AA:BB:CC:DD:EE:FF\",\"fw\":\"c3-1.0.0\",\"caps\":{\"rgbw\":true,\"led_count\":4,\"temp_i2c\":true,\"deep_sleep\":false,\"button\":true,\"bin\":true},\"token\":\"\"}",
+    "{\"msg\":\"join_accept\",\"node_id\":\"AA:BB:CC:DD:EE:FF\",\"light_id\":\"LDDEEFF\",\"lmk\":\"\",\"wifi_channel\":6,\"cfg\":{\"pwm_freq\":0,\"rx_window_ms\":20,\"rx_period_ms\":100}}",
+    "{\"msg\":\"set_light\",\"cmd_id\":\"1234567-DDEEFF\",\"light_id\":\"\",\"r\":0,\"g\":255,\"b\":0,\"w\":0,\"value\":0,\"fade_ms\":200,\"override_status\":false,\"ttl_ms\":1500}",
+    "{\"msg\":\"node_status\",\"node_id\":\"AA:BB:CC:DD:EE:FF\",\"light_id\":\"LDDEEFF\",\"avg_r\":0,\"avg_g\":0,\"avg_b\":0,\"avg_w\":128,\"status_mode\":\"operational\",\"vbat_mv\":3700,\"temperature\":23.5,\"button_pressed\":false,\"fw\":\"c3-1.0.0\",\"ts\":123456}",
+    "{\"msg\":\"ack\",\"cmd_id\":\"telemetry_ack\"}",
+    "{\"msg\":\"error\",\"code\":\"E01\",\"reason\":\"bad frame\"}",
+    "{\"msg\":\"ping\"}",
+    "{\"msg\":\"pairing_ping\"}",
+    "{\"msg\":\"wave\",\"period_ms\":4000,\"duration_ms\":12000,\"start_at\":56789}",
+};
+
+static const MessageType kRecordedTypes[] = {
+    MessageType::JOIN_REQUEST,
+    MessageType::JOIN_ACCEPT,
+    MessageType::SET_LIGHT,
+    MessageType::NODE_STATUS,
+    MessageType::ACK,
+    MessageType::ERROR,
+    MessageType::PING,
+    MessageType::PAIRING_PING,
+    MessageType::WAVE,
+};
+
+static const size_t kFrameCount = sizeof(kRecordedFrames) / sizeof(kRecordedFrames[0]);
+
+static MessageType classify(const char* frame) {
+    return MessageFactory::getMessageType((const uint8_t*)frame, strlen(frame));
+}
+
+// Previous implementation: filtered ArduinoJson parse on a String copy
+static MessageType legacyGetMessageType(const uint8_t* data, size_t len) {
+    String json((const char*)data, len);
+    DynamicJsonDocument filter(48);
+    filter["msg"] = true;
+    DynamicJsonDocument doc(256);
+    DeserializationError err = deserializeJson(doc, json, DeserializationOption::Filter(filter));
+    if (err) return MessageType::UNKNOWN;
+    return MessageFactory::typeFromName(doc["msg"] | "");
+}
+
+void test_classifies_every_recorded_frame() {
+    for (size_t i = 0; i < kFrameCount; ++i) {
+        TEST_ASSERT_EQUAL_MESSAGE(kRecordedTypes[i], classify(kRecordedFrames[i]), kRecordedFrames[i]);
+    }
+}
+
+void test_tolerates_whitespace_and_key_order() {
+    TEST_ASSERT_EQUAL(MessageType::SET_LIGHT, classify("{ \"cmd_id\" : \"x\", \"msg\" : \"set_light\" }"));
+    TEST_ASSERT_EQUAL(MessageType::ACK, classify("{\n\t\"msg\":\t\"ack\"\n}"));
+    // "msg" appearing as a value must not be mistaken for the key
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, classify("{\"reason\":\"msg\",\"msg\":\"node_status\"}"));
+}
+
+void test_rejects_unknown_and_malformed() {
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":\"set_lights\"}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":\"pin\"}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":\"\"}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":\"ack"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":\"a\\\"ck\"}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"msg\":42}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("{\"type\":\"ack\"}"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, classify("not json"));
+    TEST_ASSERT_EQUAL(MessageType::UNKNOWN, MessageFactory::getMessageType(nullptr, 0));
+}
+
+void test_binary_frames_use_type_byte() {
+    AckMessage ack;
+    ack.cmd_id = "telemetry_ack";
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = ack.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(MessageType::ACK, MessageFactory::getMessageType(buf, n));
+}
+
+// ---- Benchmark: classifier vs the previous filtered-parse implementation ----
+
+static const int BENCH_ROUNDS = 200;
+
+void test_benchmark_classifier() {
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t t0 = micros();
+    int hits = 0;
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        for (size_t i = 0; i < kFrameCount; ++i) {
+            hits += classify(kRecordedFrames[i]) == kRecordedTypes[i];
+        }
+    }
+    uint32_t fastUs = micros() - t0;
+    uint32_t heapAfter = ESP.getFreeHeap();
+
+    t0 = micros();
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        for (size_t i = 0; i < kFrameCount; ++i) {
+            const char* f = kRecordedFrames[i];
+            legacyGetMessageType((const uint8_t*)f, strlen(f));
+        }
+    }
+    uint32_t legacyUs = micros() - t0;
+
+    const uint32_t calls = BENCH_ROUNDS * kFrameCount;
+    char line[160];
+    snprintf(line, sizeof(line),
+             "classify: scan+hash %lu ns/frame | filtered parse %lu ns/frame | heap delta %ld B",
+             (unsigned long)(fastUs * 1000UL / calls),
+             (unsigned long)(legacyUs * 1000UL / calls),
+             (long)heapBefore - (long)heapAfter);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(calls, hits);
+    TEST_ASSERT_EQUAL(heapBefore, heapAfter);
+    TEST_ASSERT_LESS_THAN(legacyUs, fastUs);
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_classifies_every_recorded_frame);
+    RUN_TEST(test_tolerates_whitespace_and_key_order);
+    RUN_TEST(test_rejects_unknown_and_malformed);
+    RUN_TEST(test_binary_frames_use_type_byte);
+    RUN_TEST(test_benchmark_classifier);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
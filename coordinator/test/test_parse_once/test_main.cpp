@@ -0,0 +1,130 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+static NodeStatusMessage sampleNodeStatus() {
+    NodeStatusMessage m;
+    m.node_id = "AA:BB:CC:DD:EE:FF";
+    m.light_id = "LDDEEFF";
+    m.avg_r = 1; m.avg_g = 2; m.avg_b = 3; m.avg_w = 4;
+    m.status_mode = "operational";
+    m.vbat_mv = 3700;
+    m.temperature = 22.5f;
+    m.fw = "c3-1.0.0";
+    return m;
+}
+
+void test_json_frame_parsed_once() {
+    String json = sampleNodeStatus().toJson();
+    MessageFactory::resetParseCount();
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode((const uint8_t*)json.c_str(), json.length());
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, m->type);
+    TEST_ASSERT_EQUAL_STRING("LDDEEFF", static_cast<NodeStatusMessage*>(m)->light_id.c_str());
+
+    TEST_ASSERT_EQUAL_UINT32(1, MessageFactory::getParseCount());
+}
+
+void test_binary_frame_parsed_once() {
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = sampleNodeStatus().encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    MessageFactory::resetParseCount();
+
+    MessageSlot slot;
+    TEST_ASSERT_NOT_NULL(slot.decode(buf, n));
+
+    TEST_ASSERT_EQUAL_UINT32(1, MessageFactory::getParseCount());
+}
+
+void test_classify_then_decode_costs_one() {
+    // Classification scans the raw bytes and never deserializes
+    String json = sampleNodeStatus().toJson();
+    MessageFactory::resetParseCount();
+
+    MessageType t = MessageFactory::getMessageType(json);
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode((const uint8_t*)json.c_str(), json.length());
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, t);
+    TEST_ASSERT_NOT_NULL(m);
+
+    TEST_ASSERT_EQUAL_UINT32(1, MessageFactory::getParseCount());
+}
+
+void test_garbage_frame_counts_one_parse_and_is_dropped() {
+    // Classifies as ack, then fails to deserialize
+    const char* junk = "{\"msg\":\"ack\",\"cmd_id\":";
+    MessageSlot slot;
+    MessageFactory::resetParseCount();
+    EspNowMessage* m = slot.decode((const uint8_t*)junk, strlen(junk));
+    TEST_ASSERT_NULL(m);
+    TEST_ASSERT_EQUAL_UINT32(1, MessageFactory::getParseCount());
+}
+
+void test_unknown_type_is_dropped_unparsed() {
+    MessageSlot slot;
+    MessageFactory::resetParseCount();
+    // A newer message type, garbage and a binary frame of an unknown type do
+    // not come back as an error message
+    const char* newer = "{\"msg\":\"firmware_offer\",\"url\":\"x\"}";
+    TEST_ASSERT_NULL(slot.decode((const uint8_t*)newer, strlen(newer)));
+    const char* junk = "not a frame";
+    TEST_ASSERT_NULL(slot.decode((const uint8_t*)junk, strlen(junk)));
+    const uint8_t binary[] = {WireCodec::MAGIC, WireCodec::VERSION, 0x7F, 0x00, 0x01};
+    TEST_ASSERT_NULL(slot.decode(binary, sizeof(binary)));
+    TEST_ASSERT_EQUAL_UINT32(0, MessageFactory::getParseCount());
+
+    // A real one still does
+    const char* error = "{\"msg\":\"error\",\"code\":\"E01\",\"reason\":\"bad frame\"}";
+    EspNowMessage* m = slot.decode((const uint8_t*)error, strlen(error));
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::ERROR, m->type);
+}
+
+void test_wave_frame_decodes() {
+    // The coordinator's wave test frame, JSON even to binary-wire nodes
+    WaveMessage wave;
+    wave.period_ms = 1200;
+    wave.duration_ms = 4000;
+    wave.start_at = 56789;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = wave.encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_FALSE(WireCodec::isBinaryFrame(buf, n));
+
+    MessageSlot slot;
+    MessageFactory::resetParseCount();
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::WAVE, m->type);
+    const WaveMessage* in = static_cast<WaveMessage*>(m);
+    TEST_ASSERT_EQUAL_UINT16(1200, in->period_ms);
+    TEST_ASSERT_EQUAL_UINT16(4000, in->duration_ms);
+    TEST_ASSERT_EQUAL_UINT32(56789, in->start_at);
+    TEST_ASSERT_EQUAL_UINT32(1, MessageFactory::getParseCount());
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_json_frame_parsed_once);
+    RUN_TEST(test_binary_frame_parsed_once);
+    RUN_TEST(test_classify_then_decode_costs_one);
+    RUN_TEST(test_garbage_frame_counts_one_parse_and_is_dropped);
+    RUN_TEST(test_unknown_type_is_dropped_unparsed);
+    RUN_TEST(test_wave_frame_decodes);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
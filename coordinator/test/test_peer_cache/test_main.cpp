@@ -0,0 +1,208 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../../src/comm/PeerCache.h"
+
+// Driver peer registrations: LRU eviction, busy peers kept, and a fleet far
+// larger than the driver limit through a simulated driver that enforces it.
+
+// Simulated ESP-NOW driver: ESP_NOW_MAX_TOTAL_PEER_NUM slots, one taken by the
+// broadcast peer; add fails when full, send fails for unregistered peers.
+struct SimDriver {
+    static constexpr size_t LIMIT = 20;
+    uint8_t macs[LIMIT][6];
+    size_t count = 0;
+    size_t maxCount = 0;
+    uint32_t adds = 0;
+    uint32_t dels = 0;
+
+    int indexOf(const uint8_t mac[6]) const {
+        for (size_t i = 0; i < count; ++i) {
+            if (memcmp(macs[i], mac, 6) == 0) return (int)i;
+        }
+        return -1;
+    }
+    bool add(const uint8_t mac[6]) {
+        if (indexOf(mac) >= 0) return true;   // ESP_ERR_ESPNOW_EXIST
+        if (count == LIMIT) return false;     // ESP_ERR_ESPNOW_FULL
+        memcpy(macs[count++], mac, 6);
+        if (count > maxCount) maxCount = count;
+        adds++;
+        return true;
+    }
+    void del(const uint8_t mac[6]) {
+        int i = indexOf(mac);
+        if (i < 0) return;
+        memcpy(macs[i], macs[--count], 6);
+        dels++;
+    }
+    bool send(const uint8_t mac[6]) const { return indexOf(mac) >= 0; }
+    void reset() {
+        count = maxCount = 0;
+        adds = dels = 0;
+        const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+        add(bcast);
+    }
+};
+
+static SimDriver s_driver;
+static uint8_t s_busyMac[6];
+static bool s_busy = false;
+
+static void attach(PeerCache& cache) {
+    cache.setCapacity(SimDriver::LIMIT - 1);
+    cache.setDriver([](const uint8_t mac[6]) { return s_driver.add(mac); },
+                    [](const uint8_t mac[6]) { s_driver.del(mac); });
+    cache.setBusy([](const uint8_t mac[6]) { return s_busy && memcmp(mac, s_busyMac, 6) == 0; });
+}
+
+static void nodeMac(int node, uint8_t out[6]) {
+    const uint8_t base[6] = {0x24, 0x6F, 0x28, 0x10, 0x00, 0x00};
+    memcpy(out, base, 6);
+    out[4] = (uint8_t)(node >> 8);
+    out[5] = (uint8_t)node;
+}
+
+void test_evicts_least_recently_used() {
+    static PeerCache cache;
+    s_driver.reset();
+    s_busy = false;
+    attach(cache);
+    cache.setCapacity(3);
+    uint8_t a[6], b[6], c[6], d[6];
+    nodeMac(1, a); nodeMac(2, b); nodeMac(3, c); nodeMac(4, d);
+
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(a, 10));
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(b, 20));
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(c, 30));
+    cache.touch(a, 40);   // heard from a: b is now the oldest
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(d, 50));
+    TEST_ASSERT_TRUE(cache.contains(a));
+    TEST_ASSERT_FALSE(cache.contains(b));
+    TEST_ASSERT_FALSE(s_driver.send(b));
+    TEST_ASSERT_TRUE(s_driver.send(d));
+    TEST_ASSERT_EQUAL(3, cache.size());
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().evictions);
+    TEST_ASSERT_EQUAL_UINT32(4, cache.stats().misses);
+
+    // A hit costs no driver call
+    uint32_t adds = s_driver.adds;
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(d, 60));
+    TEST_ASSERT_EQUAL_UINT32(adds, s_driver.adds);
+    TEST_ASSERT_EQUAL_UINT32(1, cache.stats().hits);
+
+    cache.forget(d);
+    TEST_ASSERT_FALSE(s_driver.send(d));
+    cache.clear();
+    TEST_ASSERT_EQUAL(0, cache.size());
+    TEST_ASSERT_EQUAL(1, s_driver.count);   // broadcast only
+}
+
+void test_busy_peer_is_not_evicted() {
+    static PeerCache cache;
+    s_driver.reset();
+    attach(cache);
+    cache.setCapacity(2);
+    uint8_t a[6], b[6], c[6];
+    nodeMac(1, a); nodeMac(2, b); nodeMac(3, c);
+
+    cache.ensure(a, 10);
+    cache.ensure(b, 20);
+    // a is the oldest but still has frames in flight: b goes instead
+    memcpy(s_busyMac, a, 6);
+    s_busy = true;
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(c, 30));
+    TEST_ASSERT_TRUE(cache.contains(a));
+    TEST_ASSERT_FALSE(cache.contains(b));
+
+    // Only busy peers left to evict: the caller retries later
+    cache.setCapacity(1);
+    cache.forget(c);
+    TEST_ASSERT_EQUAL(PeerCache::Result::NO_SLOT, cache.ensure(b, 40));
+    s_busy = false;
+    TEST_ASSERT_EQUAL(PeerCache::Result::REGISTERED, cache.ensure(b, 50));
+    TEST_ASSERT_FALSE(cache.contains(a));
+}
+
+// ---- Fleet beyond the driver limit ----
+
+// SIM_NODES tiles: most traffic goes to a working set (the tiles in the zone
+// being lit), the rest to tiles anywhere in the fleet (status polls, config).
+static const int SIM_NODES = 250;
+static const int WORKING_SET = 12;
+static const int SIM_SENDS = 20000;
+static const int WORKING_SET_PCT = 85;
+static uint32_t s_rng = 1;
+
+static uint32_t nextRandom() {
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+static int pickNode(int setBase) {
+    if ((int)(nextRandom() % 100) < WORKING_SET_PCT) return setBase + (int)(nextRandom() % WORKING_SET);
+    return (int)(nextRandom() % SIM_NODES);
+}
+
+void test_fleet_beyond_driver_limit() {
+    // Before: every stored peer added at boot, re-added on NOT_FOUND; the
+    // driver refuses everything past its limit
+    s_driver.reset();
+    for (int n = 0; n < SIM_NODES; ++n) {
+        uint8_t mac[6];
+        nodeMac(n, mac);
+        s_driver.add(mac);
+    }
+    s_rng = 3;
+    uint32_t before = 0;
+    for (int i = 0; i < SIM_SENDS; ++i) {
+        uint8_t mac[6];
+        // The working set drifts across the fleet as zones are lit
+        nodeMac(pickNode((i / 2000) * 20 % (SIM_NODES - WORKING_SET)), mac);
+        if (s_driver.send(mac) || (s_driver.add(mac) && s_driver.send(mac))) before++;
+    }
+    TEST_ASSERT_TRUE(s_driver.maxCount <= SimDriver::LIMIT);
+
+    // After: the cache swaps peers in on demand
+    static PeerCache cache;
+    s_driver.reset();
+    s_busy = false;
+    attach(cache);
+    s_rng = 3;
+    uint32_t after = 0;
+    for (int i = 0; i < SIM_SENDS; ++i) {
+        uint8_t mac[6];
+        nodeMac(pickNode((i / 2000) * 20 % (SIM_NODES - WORKING_SET)), mac);
+        if (cache.ensure(mac, (uint32_t)i) == PeerCache::Result::REGISTERED && s_driver.send(mac)) after++;
+    }
+    TEST_ASSERT_TRUE(s_driver.maxCount <= SimDriver::LIMIT);
+    TEST_ASSERT_EQUAL_UINT32(SIM_SENDS, after);
+    PeerCache::Stats st = cache.stats();
+    TEST_ASSERT_EQUAL(SimDriver::LIMIT - 1, st.registered);
+    TEST_ASSERT_EQUAL_UINT32(0, st.failures);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d nodes, driver limit %u: register-all delivers %lu.%lu%%, LRU cache %lu.%lu%%",
+             SIM_NODES, (unsigned)SimDriver::LIMIT,
+             (unsigned long)(before * 100 / SIM_SENDS), (unsigned long)(before * 1000 / SIM_SENDS % 10),
+             (unsigned long)(after * 100 / SIM_SENDS), (unsigned long)(after * 1000 / SIM_SENDS % 10));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "LRU cache: hit rate %lu.%lu%%, %lu swaps over %d sends",
+             (unsigned long)(st.hits * 100 / SIM_SENDS), (unsigned long)(st.hits * 1000 / SIM_SENDS % 10),
+             (unsigned long)st.evictions, SIM_SENDS);
+    TEST_MESSAGE(msg);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_evicts_least_recently_used);
+    RUN_TEST(test_busy_peer_is_not_evicted);
+    RUN_TEST(test_fleet_beyond_driver_limit);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,177 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../../src/comm/PeerStore.h"
+
+// Peer persistence: blob round trip, rejection of damaged or newer blobs,
+// debounced write-back, and NVS writes for a pairing burst against the old
+// clear-and-rewrite-every-key scheme.
+
+static void nodeMac(int node, uint8_t out[6]) {
+    const uint8_t base[6] = {0x24, 0x6F, 0x28, 0x30, 0x00, 0x00};
+    memcpy(out, base, 6);
+    out[4] = (uint8_t)(node >> 8);
+    out[5] = (uint8_t)node;
+}
+
+static uint8_t s_blob[PeerStore::MAX_BLOB + 64];
+
+void test_blob_round_trip() {
+    static PeerTable src, dst;
+    src.clear();
+    dst.clear();
+    for (int n = 0; n < 40; ++n) {
+        uint8_t mac[6];
+        nodeMac(n, mac);
+        // Heard-from but unpaired peers are not persisted
+        src.insert(mac)->paired = (n % 4) != 0;
+    }
+    size_t len = PeerStore::encode(src, s_blob, sizeof(s_blob));
+    TEST_ASSERT_EQUAL(PeerStore::HEADER_LEN + 30 * PeerStore::RECORD_LEN, len);
+    TEST_ASSERT_EQUAL(30, PeerStore::decode(s_blob, len, dst));
+    TEST_ASSERT_EQUAL(30, dst.pairedCount());
+    for (const auto& p : src) {
+        const PeerTable::Peer* q = dst.find(p.mac);
+        TEST_ASSERT_EQUAL(p.paired, q != nullptr);
+    }
+
+    // Too small a buffer: nothing encoded
+    TEST_ASSERT_EQUAL(0, PeerStore::encode(src, s_blob, 16));
+    // Empty set still makes a valid blob
+    dst.clear();
+    len = PeerStore::encode(dst, s_blob, sizeof(s_blob));
+    TEST_ASSERT_EQUAL(PeerStore::HEADER_LEN, len);
+    TEST_ASSERT_EQUAL(0, PeerStore::decode(s_blob, len, dst));
+}
+
+void test_rejects_damaged_and_newer_blobs() {
+    static PeerTable src, dst;
+    src.clear();
+    for (int n = 0; n < 5; ++n) {
+        uint8_t mac[6];
+        nodeMac(n, mac);
+        src.insert(mac)->paired = true;
+    }
+    size_t len = PeerStore::encode(src, s_blob, sizeof(s_blob));
+
+    dst.clear();
+    TEST_ASSERT_EQUAL(-1, PeerStore::decode(s_blob, len - 1, dst));     // torn
+    s_blob[PeerStore::HEADER_LEN + 3] ^= 0x40;
+    TEST_ASSERT_EQUAL(-1, PeerStore::decode(s_blob, len, dst));         // bit flip
+    s_blob[PeerStore::HEADER_LEN + 3] ^= 0x40;
+    s_blob[0] = PeerStore::VERSION + 1;
+    TEST_ASSERT_EQUAL(-1, PeerStore::decode(s_blob, len, dst));         // newer layout
+    s_blob[0] = PeerStore::VERSION;
+    TEST_ASSERT_EQUAL(5, PeerStore::decode(s_blob, len, dst));
+}
+
+void test_debounce_coalesces_changes() {
+    PeerStore store;
+    TEST_ASSERT_FALSE(store.due(0));
+    store.markDirty(1000);
+    store.markDirty(1500);
+    TEST_ASSERT_FALSE(store.due(1500 + PeerStore::DEBOUNCE_MS - 1));
+    TEST_ASSERT_TRUE(store.due(1500 + PeerStore::DEBOUNCE_MS));
+    store.onWritten(20, true, 3500);
+    TEST_ASSERT_FALSE(store.isDirty());
+
+    // Continuous churn is still saved within MAX_DELAY_MS
+    uint32_t t = 10000;
+    uint32_t first = t;
+    while (!store.due(t)) {
+        store.markDirty(t);
+        t += 500;
+    }
+    TEST_ASSERT_TRUE(t - first <= PeerStore::MAX_DELAY_MS + 500);
+
+    // A failed save is retried after a quiet period
+    store.onWritten(0, false, t);
+    TEST_ASSERT_TRUE(store.isDirty());
+    TEST_ASSERT_FALSE(store.due(t + 1));
+    TEST_ASSERT_TRUE(store.due(t + PeerStore::DEBOUNCE_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, store.stats().failed);
+}
+
+// ---- Pairing burst ----
+
+// SIM_PEERS nodes join PAIR_GAP_MS apart (a pairing session), then a few are
+// removed one by one. The old savePeersToStorage() ran on every change:
+// clear() + putString per peer + putUInt("count").
+static const int SIM_PEERS = 50;
+static const uint32_t PAIR_GAP_MS = 400;
+static const int SIM_REMOVALS = 5;
+
+void test_pairing_burst_nvs_writes() {
+    static PeerTable table;
+    table.clear();
+    PeerStore store;
+    uint32_t legacyWrites = 0;
+    uint32_t legacyBytes = 0;
+    uint32_t now = 0;
+
+    auto save = [&](uint32_t atMs) {
+        size_t len = PeerStore::encode(table, s_blob, sizeof(s_blob));
+        store.onWritten(len, len > 0, atMs);
+    };
+    auto legacySave = [&]() {
+        size_t n = table.pairedCount();
+        legacyWrites += 1 + n + 1;
+        legacyBytes += n * 18;
+    };
+    auto runLoop = [&](uint32_t untilMs) {
+        for (; now < untilMs; now += 10) {
+            if (store.due(now)) save(now);
+        }
+    };
+
+    for (int i = 0; i < SIM_PEERS; ++i) {
+        runLoop(now + PAIR_GAP_MS);
+        uint8_t mac[6];
+        nodeMac(i, mac);
+        table.insert(mac)->paired = true;
+        store.markDirty(now);
+        legacySave();
+    }
+    runLoop(now + 30000);
+    for (int i = 0; i < SIM_REMOVALS; ++i) {
+        uint8_t mac[6];
+        nodeMac(i * 7, mac);
+        table.erase(mac);
+        store.markDirty(now);
+        legacySave();
+        runLoop(now + 5000);
+    }
+    TEST_ASSERT_FALSE(store.isDirty());
+
+    // What is stored is what the table holds
+    static PeerTable restored;
+    restored.clear();
+    size_t len = PeerStore::encode(table, s_blob, sizeof(s_blob));
+    TEST_ASSERT_EQUAL(SIM_PEERS - SIM_REMOVALS, PeerStore::decode(s_blob, len, restored));
+
+    const PeerStore::Stats& st = store.stats();
+    TEST_ASSERT_EQUAL_UINT32(SIM_PEERS + SIM_REMOVALS, st.changes);
+    TEST_ASSERT_TRUE(st.writes * 20 < legacyWrites);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d pairings %lums apart + %d removals: NVS writes %lu -> %lu, bytes %lu -> %lu",
+             SIM_PEERS, (unsigned long)PAIR_GAP_MS, SIM_REMOVALS,
+             (unsigned long)legacyWrites, (unsigned long)st.writes,
+             (unsigned long)legacyBytes, (unsigned long)st.bytesWritten);
+    TEST_MESSAGE(msg);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_blob_round_trip);
+    RUN_TEST(test_rejects_damaged_and_newer_blobs);
+    RUN_TEST(test_debounce_coalesces_changes);
+    RUN_TEST(test_pairing_burst_nvs_writes);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
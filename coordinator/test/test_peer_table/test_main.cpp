@@ -0,0 +1,221 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <map>
+#include <vector>
+#include "../../src/comm/PeerTable.h"
+
+// MAC-keyed peer table: insert/find/erase against a reference map, the full
+// table, dense iteration, and lookup/insert cost against the String maps and
+// peer vector EspNow used before.
+
+static uint32_t s_rng = 1;
+
+static uint32_t nextRandom() {
+    s_rng = s_rng * 1103515245u + 12345u;
+    return s_rng >> 8;
+}
+
+// Fleet-like MACs: one vendor OUI, random NIC bytes
+static void randomMac(uint8_t out[6]) {
+    uint32_t r = nextRandom();
+    out[0] = 0x24; out[1] = 0x6F; out[2] = 0x28;
+    out[3] = (uint8_t)(r >> 16); out[4] = (uint8_t)(r >> 8); out[5] = (uint8_t)r;
+}
+
+static void macFromKey(uint64_t key, uint8_t out[6]) {
+    for (int i = 5; i >= 0; --i) { out[i] = (uint8_t)key; key >>= 8; }
+}
+
+void test_insert_find_erase_matches_reference() {
+    static PeerTable t;
+    t.clear();
+    std::map<uint64_t, uint32_t> ref;   // key -> messageCount
+    s_rng = 7;
+    for (int op = 0; op < 20000; ++op) {
+        uint8_t mac[6];
+        // Small key space so erases hit and probe runs get reshuffled
+        uint64_t k = 0x246F28000000ULL | (nextRandom() % 400);
+        macFromKey(k, mac);
+        if (nextRandom() % 3 == 0) {
+            TEST_ASSERT_EQUAL(ref.erase(k) == 1, t.erase(mac));
+        } else if (ref.size() < PeerTable::MAX_PEERS || ref.count(k)) {
+            PeerTable::Peer* p = t.insert(mac);
+            TEST_ASSERT_NOT_NULL(p);
+            p->stats.messageCount++;
+            ref[k]++;
+        }
+        TEST_ASSERT_EQUAL(ref.size(), t.size());
+    }
+    for (uint64_t k = 0x246F28000000ULL; k < 0x246F28000000ULL + 400; ++k) {
+        uint8_t mac[6];
+        macFromKey(k, mac);
+        const PeerTable::Peer* p = static_cast<const PeerTable&>(t).find(mac);
+        auto it = ref.find(k);
+        if (it == ref.end()) {
+            TEST_ASSERT_NULL(p);
+        } else {
+            TEST_ASSERT_NOT_NULL(p);
+            TEST_ASSERT_EQUAL_MEMORY(mac, p->mac, 6);
+            TEST_ASSERT_EQUAL_UINT32(it->second, p->stats.messageCount);
+        }
+    }
+}
+
+void test_defaults_full_table_and_iteration() {
+    static PeerTable t;
+    t.clear();
+    uint8_t mac[6] = {0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x00};
+    for (size_t i = 0; i < PeerTable::MAX_PEERS; ++i) {
+        mac[4] = (uint8_t)(i >> 8);
+        mac[5] = (uint8_t)i;
+        PeerTable::Peer* p = t.insert(mac);
+        TEST_ASSERT_NOT_NULL(p);
+        TEST_ASSERT_FALSE(p->paired);
+        TEST_ASSERT_EQUAL(WireCodec::Format::JSON, p->wire);
+        TEST_ASSERT_EQUAL_UINT16(WireCodec::MAX_FRAME_LEN, p->maxFrame);
+        TEST_ASSERT_EQUAL_INT16(-1, p->nodeHandle);
+        TEST_ASSERT_EQUAL_INT8(-127, p->stats.lastRssi);
+        p->paired = (i % 2) == 0;
+    }
+    // Full: new MACs are refused, existing ones still found
+    mac[3] = 0x01;
+    TEST_ASSERT_NULL(t.insert(mac));
+    mac[3] = 0x00; mac[4] = 0x00; mac[5] = 0x05;
+    TEST_ASSERT_NOT_NULL(t.insert(mac));
+    TEST_ASSERT_EQUAL(PeerTable::MAX_PEERS / 2, t.pairedCount());
+
+    // Erasing keeps the entries dense and every survivor reachable
+    TEST_ASSERT_TRUE(t.erase(mac));
+    TEST_ASSERT_FALSE(t.erase(mac));
+    size_t seen = 0;
+    for (const auto& p : t) {
+        TEST_ASSERT_TRUE(t.find(p.mac) == &p);
+        seen++;
+    }
+    TEST_ASSERT_EQUAL(PeerTable::MAX_PEERS - 1, seen);
+}
+
+// ---- Benchmark ----
+
+// What EspNow did per received frame and per addPeer() before: format the MAC
+// into a String, look it up in a std::map<String, ...>, and scan a
+// std::vector<String> of paired peers.
+struct LegacyPeers {
+    std::vector<String> peers;
+    std::map<String, PeerStats> peerStats;
+
+    static String macString(const uint8_t mac[6]) {
+        char macStr[18];
+        snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        return String(macStr);
+    }
+    void onReceive(const uint8_t mac[6], int8_t rssi) {
+        auto& stats = peerStats[macString(mac)];
+        stats.lastRssi = rssi;
+        stats.messageCount++;
+    }
+    void addPeer(const uint8_t mac[6]) {
+        String smac = macString(mac);
+        for (const auto& s : peers) {
+            if (s == smac) return;
+        }
+        peers.push_back(smac);
+    }
+};
+
+static void onReceive(PeerTable& t, const uint8_t mac[6], int8_t rssi) {
+    if (PeerTable::Peer* p = t.insert(mac)) {
+        p->stats.lastRssi = rssi;
+        p->stats.messageCount++;
+    }
+}
+
+static void addPeer(PeerTable& t, const uint8_t mac[6]) {
+    if (PeerTable::Peer* p = t.insert(mac)) p->paired = true;
+}
+
+static const int BENCH_LOOKUPS = 20000;
+static const int BENCH_ROUNDS = 20;
+
+static void benchmark(size_t peerCount) {
+    static uint8_t macs[PeerTable::MAX_PEERS][6];
+    s_rng = 99;
+    for (size_t i = 0; i < peerCount; ++i) randomMac(macs[i]);
+
+    // Insert: register every peer (addPeer) and see its first frame, from empty
+    static PeerTable table;
+    LegacyPeers* legacy = nullptr;
+    uint32_t legacyInsertUs = 0, tableInsertUs = 0;
+    for (int round = 0; round < BENCH_ROUNDS; ++round) {
+        delete legacy;
+        legacy = new LegacyPeers();
+        uint32_t t0 = micros();
+        for (size_t i = 0; i < peerCount; ++i) {
+            legacy->addPeer(macs[i]);
+            legacy->onReceive(macs[i], -60);
+        }
+        legacyInsertUs += micros() - t0;
+        t0 = micros();
+        table.clear();
+        for (size_t i = 0; i < peerCount; ++i) {
+            addPeer(table, macs[i]);
+            onReceive(table, macs[i], -60);
+        }
+        tableInsertUs += micros() - t0;
+    }
+
+    // Lookup: frames arriving from random known peers, plus a re-add
+    // (the reinit path) every 16th frame
+    s_rng = 5;
+    uint32_t t0 = micros();
+    for (int i = 0; i < BENCH_LOOKUPS; ++i) {
+        const uint8_t* mac = macs[nextRandom() % peerCount];
+        legacy->onReceive(mac, -61);
+        if ((i & 15) == 0) legacy->addPeer(mac);
+    }
+    uint32_t legacyLookupUs = micros() - t0;
+    s_rng = 5;
+    t0 = micros();
+    for (int i = 0; i < BENCH_LOOKUPS; ++i) {
+        const uint8_t* mac = macs[nextRandom() % peerCount];
+        onReceive(table, mac, -61);
+        if ((i & 15) == 0) addPeer(table, mac);
+    }
+    uint32_t tableLookupUs = micros() - t0;
+
+    TEST_ASSERT_EQUAL(peerCount, table.pairedCount());
+    TEST_ASSERT_EQUAL(peerCount, legacy->peers.size());
+    delete legacy;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%3u peers: insert %lu -> %lu ns/peer, lookup %lu -> %lu ns/frame (String map -> PeerTable)",
+             (unsigned)peerCount,
+             (unsigned long)(legacyInsertUs * 1000UL / (peerCount * BENCH_ROUNDS)),
+             (unsigned long)(tableInsertUs * 1000UL / (peerCount * BENCH_ROUNDS)),
+             (unsigned long)(legacyLookupUs * 1000UL / BENCH_LOOKUPS), (unsigned long)(tableLookupUs * 1000UL / BENCH_LOOKUPS));
+    TEST_MESSAGE(msg);
+    // Per-frame cost must not grow with the fleet the way the String map does
+    TEST_ASSERT_TRUE(tableLookupUs <= legacyLookupUs);
+}
+
+void test_benchmark_20_100_250_peers() {
+    benchmark(20);
+    benchmark(100);
+    benchmark(250);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_find_erase_matches_reference);
+    RUN_TEST(test_defaults_full_table_and_iteration);
+    RUN_TEST(test_benchmark_20_100_250_peers);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
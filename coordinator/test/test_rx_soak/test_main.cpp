@@ -0,0 +1,129 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <esp_heap_caps.h>
+#include "EspNowMessage.h"
+
+// Simulated 24h soak of the RX decode path: 20 nodes reporting every 5 s,
+// interleaved with acks and the odd set_light echo, fed through a single
+// MessageSlot. Heap is sampled once per simulated hour.
+
+static const int SOAK_NODES = 20;
+static const uint32_t TELEMETRY_PERIOD_MS = 5000;
+static const uint32_t SIM_HOURS = 24;
+static const uint32_t FRAMES_PER_HOUR = (3600000UL / TELEMETRY_PERIOD_MS) * SOAK_NODES;
+
+static const int FRAME_POOL = 48;
+static uint8_t s_frames[FRAME_POOL][WireCodec::MAX_FRAME_LEN];
+static size_t s_frameLen[FRAME_POOL];
+
+// Pre-encode a mix of frames so the soak loop itself only decodes
+static void buildFramePool() {
+    for (int i = 0; i < FRAME_POOL; ++i) {
+        char mac[18];
+        snprintf(mac, sizeof(mac), "AA:BB:CC:00:%02X:%02X", i / SOAK_NODES, i % SOAK_NODES);
+        WireCodec::Format fmt = (i % 2) ? WireCodec::Format::BINARY : WireCodec::Format::JSON;
+        if (i % 8 == 7) {
+            AckMessage ack;
+            ack.cmd_id = String("cmd-") + String(i * 7919);
+            s_frameLen[i] = ack.encode(fmt, s_frames[i], WireCodec::MAX_FRAME_LEN);
+        } else if (i % 8 == 3) {
+            SetLightMessage cmd;
+            cmd.cmd_id = String(millis() + i) + "-" + String(i);
+            cmd.light_id = String("L") + String(i);
+            cmd.r = i * 5; cmd.g = 255 - i; cmd.fade_ms = 100 + i;
+            s_frameLen[i] = cmd.encode(fmt, s_frames[i], WireCodec::MAX_FRAME_LEN);
+        } else {
+            NodeStatusMessage st;
+            st.node_id = mac;
+            st.light_id = String("L") + String(mac).substring(9);
+            st.avg_w = i * 3;
+            st.status_mode = (i % 5) ? "operational" : "pairing";
+            st.vbat_mv = 3300 + i * 10;
+            st.temperature = 20.0f + i * 0.25f;
+            st.fw = "c3-1.0.0";
+            st.ts = 1000UL * i;
+            s_frameLen[i] = st.encode(fmt, s_frames[i], WireCodec::MAX_FRAME_LEN);
+        }
+        TEST_ASSERT_GREATER_THAN(0, s_frameLen[i]);
+    }
+}
+
+void test_soak_24h_flat_heap() {
+    buildFramePool();
+    MessageSlot slot;
+
+    // Warm-up: first pass settles the slot's JSON document pool
+    for (int i = 0; i < FRAME_POOL; ++i) {
+        TEST_ASSERT_NOT_NULL(slot.decode(s_frames[i], s_frameLen[i]));
+    }
+
+    uint32_t baseFree = ESP.getFreeHeap();
+    uint32_t baseLargest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    uint32_t minFree = baseFree, maxFree = baseFree;
+    uint32_t minLargest = baseLargest;
+    uint32_t decoded = 0;
+    int idx = 0;
+
+    for (uint32_t hour = 1; hour <= SIM_HOURS; ++hour) {
+        for (uint32_t f = 0; f < FRAMES_PER_HOUR; ++f) {
+            EspNowMessage* m = slot.decode(s_frames[idx], s_frameLen[idx]);
+            if (m) decoded++;
+            if (++idx == FRAME_POOL) idx = 0;
+        }
+        uint32_t freeNow = ESP.getFreeHeap();
+        uint32_t largestNow = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        if (freeNow < minFree) minFree = freeNow;
+        if (freeNow > maxFree) maxFree = freeNow;
+        if (largestNow < minLargest) minLargest = largestNow;
+
+        char line[128];
+        snprintf(line, sizeof(line), "soak h%02lu free %lu B largest block %lu B",
+                 (unsigned long)hour, (unsigned long)freeNow, (unsigned long)largestNow);
+        TEST_MESSAGE(line);
+        yield();
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(SIM_HOURS * FRAMES_PER_HOUR, decoded);
+    // Flat heap: no net drift and no shrinking of the largest free block
+    TEST_ASSERT_EQUAL_UINT32(baseFree, minFree);
+    TEST_ASSERT_EQUAL_UINT32(baseFree, maxFree);
+    TEST_ASSERT_EQUAL_UINT32(baseLargest, minLargest);
+}
+
+void test_slot_reuses_storage_per_type() {
+    MessageSlot slot;
+    NodeStatusMessage st;
+    st.node_id = "AA:BB:CC:DD:EE:FF";
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = st.encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+
+    EspNowMessage* first = slot.decode(buf, n);
+    EspNowMessage* second = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_EQUAL_PTR(first, second);
+
+    // Control frames without a message struct are rejected without parsing
+    const char* ping = "{\"msg\":\"ping\"}";
+    MessageFactory::resetParseCount();
+    TEST_ASSERT_NULL(slot.decode((const uint8_t*)ping, strlen(ping)));
+    TEST_ASSERT_EQUAL_UINT32(0, MessageFactory::getParseCount());
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_slot_reuses_storage_per_type);
+    RUN_TEST(test_soak_24h_flat_heap);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
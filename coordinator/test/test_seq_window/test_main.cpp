@@ -0,0 +1,234 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include <algorithm>
+#include "EspNowMessage.h"
+#include "Fragmentation.h"
+#include "SeqWindow.h"
+
+// Sequence numbers and duplicate suppression: stamping binary and JSON
+// messages, the sliding window's verdicts (reordering, duplicates, wrap,
+// a restarted sender), and a simulated link that duplicates, reorders and
+// replays frames, with and without the window.
+
+static uint32_t s_rng = 4242;
+static uint32_t nextRand() {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return s_rng >> 8;
+}
+static uint32_t randBelow(uint32_t n) { return nextRand() % n; }
+
+void test_stamp_and_read() {
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    uint8_t stamped[WireCodec::MAX_MESSAGE_LEN];
+    MessageSlot slot;
+    uint16_t seq = 0;
+
+    SetLightMessage cmd;
+    cmd.cmd_id = "c7";
+    cmd.w = 99;
+    size_t n = cmd.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_FALSE(WireCodec::readSeq(buf, n, seq));
+    size_t m = WireCodec::stampSeq(buf, n, 0xBEEF, stamped, sizeof(stamped));
+    TEST_ASSERT_EQUAL(n + WireCodec::SEQ_LEN, m);
+    TEST_ASSERT_TRUE(WireCodec::readSeq(stamped, m, seq));
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, seq);
+    TEST_ASSERT_EQUAL(MessageType::SET_LIGHT, MessageFactory::getMessageType(stamped, m));
+    // The body decodes as before; numbering twice is refused
+    EspNowMessage* msg = slot.decode(stamped, m);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL(99, static_cast<SetLightMessage*>(msg)->w);
+    TEST_ASSERT_EQUAL_STRING("c7", static_cast<SetLightMessage*>(msg)->cmd_id.c_str());
+    TEST_ASSERT_EQUAL(0, WireCodec::stampSeq(stamped, m, 1, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, WireCodec::stampSeq(buf, n, 1, stamped, n + 1)); // no room
+
+    const char* json = "{\"msg\":\"set_light\",\"cmd_id\":\"c8\"}";
+    size_t jn = strlen(json);
+    m = WireCodec::stampSeq((const uint8_t*)json, jn, 65535, stamped, sizeof(stamped));
+    TEST_ASSERT_EQUAL(jn + WireCodec::JSON_SEQ_LEN, m);
+    TEST_ASSERT_EQUAL_STRING_LEN("{\"sq\":65535,\"msg\":\"set_light\"", (const char*)stamped, 29);
+    TEST_ASSERT_TRUE(WireCodec::readSeq(stamped, m, seq));
+    TEST_ASSERT_EQUAL_UINT16(65535, seq);
+    TEST_ASSERT_EQUAL(MessageType::SET_LIGHT, MessageFactory::getMessageType(stamped, m));
+    m = WireCodec::stampSeq((const uint8_t*)json, jn, 7, stamped, sizeof(stamped));
+    TEST_ASSERT_TRUE(WireCodec::readSeq(stamped, m, seq));
+    TEST_ASSERT_EQUAL_UINT16(7, seq);
+    TEST_ASSERT_FALSE(WireCodec::readSeq((const uint8_t*)json, jn, seq));
+    TEST_ASSERT_EQUAL(0, WireCodec::stampSeq((const uint8_t*)"{}", 2, 7, stamped, sizeof(stamped)));
+}
+
+void test_stamped_message_survives_fragmenting() {
+    // A v1 peer gets a numbered status in fragments; the number comes out once
+    NodeStatusMessage status;
+    status.node_id = "AA:BB:CC:DD:EE:FF";
+    status.avg_r = 10;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    uint8_t stamped[WireCodec::MAX_MESSAGE_LEN];
+    size_t n = status.toBinary(buf, sizeof(buf));
+    size_t m = WireCodec::stampSeq(buf, n, 321, stamped, sizeof(stamped));
+    TEST_ASSERT_TRUE(m > 0);
+
+    static Reassembler rx;
+    const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+    const uint8_t* whole = nullptr;
+    size_t wholeLen = 0;
+    int frames = 0;
+    TEST_ASSERT_TRUE(Fragmentation::send(stamped, m, 40, 9, [&](const uint8_t* f, size_t fl) {
+        frames++;
+        uint16_t seq = 0;
+        TEST_ASSERT_FALSE(WireCodec::readSeq(f, fl, seq)); // fragments travel unnumbered
+        whole = rx.accept(mac, f, fl, 0, wholeLen);
+        return true;
+    }));
+    TEST_ASSERT_TRUE(frames > 1);
+    TEST_ASSERT_NOT_NULL(whole);
+    uint16_t seq = 0;
+    TEST_ASSERT_TRUE(WireCodec::readSeq(whole, wholeLen, seq));
+    TEST_ASSERT_EQUAL_UINT16(321, seq);
+    MessageSlot slot;
+    EspNowMessage* msg = slot.decode(whole, wholeLen);
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL(10, static_cast<NodeStatusMessage*>(msg)->avg_r);
+}
+
+void test_window_verdicts() {
+    typedef SeqWindow::Verdict V;
+    SeqWindow w;
+    TEST_ASSERT_EQUAL(V::FRESH, w.accept(100));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, w.accept(100));
+    TEST_ASSERT_EQUAL(V::FRESH, w.accept(103));
+    // Reordered: 101 and 102 arrive after 103
+    TEST_ASSERT_EQUAL(V::FRESH, w.accept(102));
+    TEST_ASSERT_EQUAL(V::FRESH, w.accept(101));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, w.accept(102));
+    // Edge of the window
+    TEST_ASSERT_EQUAL(V::FRESH, w.accept(103 + SeqWindow::WINDOW - 1));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, w.accept(103));
+    TEST_ASSERT_EQUAL(V::STALE, w.accept(102));
+
+    // Across the 16-bit wrap
+    SeqWindow wrap;
+    TEST_ASSERT_EQUAL(V::FRESH, wrap.accept(65534));
+    TEST_ASSERT_EQUAL(V::FRESH, wrap.accept(1));
+    TEST_ASSERT_EQUAL(V::FRESH, wrap.accept(65535));
+    TEST_ASSERT_EQUAL(V::FRESH, wrap.accept(0));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, wrap.accept(65534));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, wrap.accept(1));
+
+    // A sender that restarted far behind: dropped until RESYNC_AFTER in a row
+    SeqWindow restart;
+    restart.accept(20000);
+    SeqWindow::Stats stats = {};
+    for (uint16_t s = 5; s < 5 + SeqWindow::RESYNC_AFTER - 1; ++s) {
+        V v = restart.accept(s);
+        SeqWindow::count(v, stats);
+        TEST_ASSERT_EQUAL(V::STALE, v);
+    }
+    V v = restart.accept(5 + SeqWindow::RESYNC_AFTER - 1);
+    SeqWindow::count(v, stats);
+    TEST_ASSERT_EQUAL(V::RESYNC, v);
+    TEST_ASSERT_TRUE(SeqWindow::handle(v));
+    TEST_ASSERT_EQUAL(V::FRESH, restart.accept(5 + SeqWindow::RESYNC_AFTER));
+    TEST_ASSERT_EQUAL(V::DUPLICATE, restart.accept(5 + SeqWindow::RESYNC_AFTER - 1));
+    TEST_ASSERT_EQUAL_UINT32(SeqWindow::RESYNC_AFTER - 1, stats.stale);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.resyncs);
+
+    // A stale frame between fresh ones does not count towards a resync
+    SeqWindow noisy;
+    noisy.accept(1000);
+    for (int i = 0; i < 10; ++i) {
+        TEST_ASSERT_EQUAL(V::STALE, noisy.accept(500));
+        TEST_ASSERT_EQUAL(V::FRESH, noisy.accept((uint16_t)(1001 + i)));
+    }
+    noisy.reset();
+    TEST_ASSERT_EQUAL(V::FRESH, noisy.accept(500));
+}
+
+// ---- Simulated link ----
+
+// One sender numbering MESSAGES messages, sent 10 ms apart. The priority
+// queue moves a message up to 8 slots; 2% are lost; 3% arrive twice within a
+// few frames (the ACK was lost and the radio sent it again); 0.2% turn up
+// again 0.3-2 s later. The sender reboots halfway, is silent for the 3 s that
+// takes, and counts on from a random number.
+static const uint32_t MESSAGES = 100000;
+
+struct Arrival {
+    uint32_t atMs;
+    uint32_t message;
+    uint16_t seq;
+};
+
+void test_duplicate_link() {
+    static std::vector<Arrival> arrivals;
+    arrivals.clear();
+    arrivals.reserve(MESSAGES * 11 / 10);
+    uint16_t seq = (uint16_t)nextRand();
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < MESSAGES; ++i) {
+        if (i == MESSAGES / 2) seq = (uint16_t)nextRand(); // reboot
+        uint16_t s = seq++;
+        uint32_t at = i * 10 + (i >= MESSAGES / 2 ? 3000 : 0) + randBelow(80);
+        if (randBelow(100) < 2) continue;
+        sent++;
+        arrivals.push_back(Arrival{at, i, s});
+        if (randBelow(100) < 3) arrivals.push_back(Arrival{at + 1 + randBelow(30), i, s});
+        if (randBelow(1000) < 2) arrivals.push_back(Arrival{at + 300 + randBelow(1700), i, s});
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [](const Arrival& a, const Arrival& b) { return a.atMs < b.atMs; });
+
+    static std::vector<uint8_t> handledPlain, handledFiltered;
+    handledPlain.assign(MESSAGES, 0);
+    handledFiltered.assign(MESSAGES, 0);
+    SeqWindow window;
+    SeqWindow::Stats stats = {};
+    for (const Arrival& a : arrivals) {
+        handledPlain[a.message]++;
+        SeqWindow::Verdict v = window.accept(a.seq);
+        SeqWindow::count(v, stats);
+        if (SeqWindow::handle(v)) handledFiltered[a.message]++;
+    }
+
+    uint32_t twicePlain = 0, twiceFiltered = 0, missed = 0;
+    for (uint32_t i = 0; i < MESSAGES; ++i) {
+        if (handledPlain[i] > 1) twicePlain += handledPlain[i] - 1;
+        if (handledFiltered[i] > 1) twiceFiltered += handledFiltered[i] - 1;
+        if (handledPlain[i] && !handledFiltered[i]) missed++;
+    }
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%lu messages, %lu delivered as %lu frames (reordered by up to 8):",
+             (unsigned long)MESSAGES, (unsigned long)sent, (unsigned long)arrivals.size());
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  no filter:   %lu handled twice or more", (unsigned long)twicePlain);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  seq window:  %lu handled twice, %lu never handled (%lu duplicate, %lu stale, %lu resync)",
+             (unsigned long)twiceFiltered, (unsigned long)missed, (unsigned long)stats.duplicates,
+             (unsigned long)stats.stale, (unsigned long)stats.resyncs);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  state per sender: %u bytes", (unsigned)sizeof(SeqWindow));
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_TRUE(twicePlain > MESSAGES / 50);
+    TEST_ASSERT_EQUAL_UINT32(0, twiceFiltered);
+    // Only the reboot may cost messages: those before the window resyncs
+    TEST_ASSERT_TRUE(missed < SeqWindow::RESYNC_AFTER);
+    TEST_ASSERT_TRUE(sizeof(SeqWindow) <= 16);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_stamp_and_read);
+    RUN_TEST(test_stamped_message_survives_fragmenting);
+    RUN_TEST(test_window_verdicts);
+    RUN_TEST(test_duplicate_link);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,127 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include <thread>
+#include "SpscRing.h"
+#include "Fragmentation.h"
+
+// RX hand-off ring between the ESP-NOW receive callback and loop()
+
+struct Frame {
+    uint32_t seq;
+    uint16_t len;
+    uint8_t data[Fragmentation::localMaxFrameLen()];
+};
+
+void test_fifo_order_and_wraparound() {
+    SpscRing<uint32_t, 8> ring;
+    TEST_ASSERT_NULL(ring.front());
+    uint32_t next = 0, expect = 0;
+    // Several laps around the ring with a varying fill level
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 1 + round % 8; ++i) TEST_ASSERT_TRUE(ring.push(next++));
+        while (uint32_t* v = ring.front()) {
+            TEST_ASSERT_EQUAL_UINT32(expect++, *v);
+            ring.pop();
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(next, expect);
+    TEST_ASSERT_EQUAL_UINT32(next, ring.stats().pushed);
+    TEST_ASSERT_EQUAL_UINT32(8, ring.stats().highWater);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.stats().dropped);
+}
+
+void test_full_ring_drops_and_counts() {
+    SpscRing<uint32_t, 4> ring;
+    for (uint32_t i = 0; i < 4; ++i) TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_FALSE(ring.push(99));
+    TEST_ASSERT_NULL(ring.acquire());
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL_UINT32(2, ring.stats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(4, ring.stats().highWater);
+
+    // Oldest frames are kept; the overflow is what gets lost
+    TEST_ASSERT_EQUAL_UINT32(0, *ring.front());
+    ring.pop();
+    TEST_ASSERT_TRUE(ring.push(4));
+    for (uint32_t i = 1; i <= 4; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(i, *ring.front());
+        ring.pop();
+    }
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+// Producer on its own task (as the Wi-Fi driver), bursts of frames filled in
+// place; consumer drains like EspNow::loop(). Every frame is either delivered
+// intact and in order or counted as dropped.
+void test_concurrent_producer_consumer() {
+    static SpscRing<Frame, 32> ring;
+    const uint32_t FRAMES = 200000;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&]() {
+        for (uint32_t seq = 0; seq < FRAMES; ++seq) {
+            Frame* f = ring.acquire();
+            if (!f) {
+                if (seq % 64 == 0) std::this_thread::yield();
+                continue;
+            }
+            f->seq = seq;
+            f->len = (uint16_t)(20 + seq % 200);
+            for (uint16_t i = 0; i < f->len; ++i) f->data[i] = (uint8_t)(seq + i);
+            ring.publish();
+        }
+        done.store(true);
+    });
+
+    uint32_t received = 0, corrupt = 0, reordered = 0;
+    int64_t last = -1;
+    while (!done.load() || ring.front()) {
+        Frame* f = ring.front();
+        if (!f) {
+            std::this_thread::yield();
+            continue;
+        }
+        if ((int64_t)f->seq <= last) reordered++;
+        last = f->seq;
+        if (f->len != 20 + f->seq % 200) corrupt++;
+        for (uint16_t i = 0; i < f->len && corrupt == 0; ++i) {
+            if (f->data[i] != (uint8_t)(f->seq + i)) corrupt++;
+        }
+        received++;
+        ring.pop();
+    }
+    producer.join();
+
+    auto st = ring.stats();
+    char line[128];
+    snprintf(line, sizeof(line), "%lu frames: delivered %lu, dropped %lu, high-water %lu/%u",
+             (unsigned long)FRAMES, (unsigned long)received, (unsigned long)st.dropped,
+             (unsigned long)st.highWater, (unsigned)ring.capacity());
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(0, corrupt);
+    TEST_ASSERT_EQUAL_UINT32(0, reordered);
+    TEST_ASSERT_EQUAL_UINT32(st.pushed, received);
+    TEST_ASSERT_EQUAL_UINT32(FRAMES, st.pushed + st.dropped);
+    TEST_ASSERT_TRUE(st.highWater <= ring.capacity());
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fifo_order_and_wraparound);
+    RUN_TEST(test_full_ring_drops_and_counts);
+    RUN_TEST(test_concurrent_producer_consumer);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,244 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+#include "TelemetryDelta.h"
+
+// Delta telemetry: codec checks plus a simulated fleet of 50 nodes reporting
+// once a second for 10 minutes, sent once as full node_status frames and once
+// through TelemetryEncoder / TelemetryBaselines with lossy acks and a
+// coordinator restart. Airtime is estimated for ESP-NOW's default 1 Mbps PHY.
+
+static const int FLEET_NODES = 50;
+static const uint32_t REPORT_PERIOD_MS = 1000;
+static const uint32_t SIM_SECONDS = 600;
+static const uint32_t KEYFRAME_MS = 30000;
+
+// 802.11b long preamble at 1 Mbps: 192 us PLCP, 8 us per byte. ESP-NOW wraps
+// the payload in a vendor action frame (MAC header, category, OUI, element
+// header, FCS: 43 bytes) and the receiver answers with a 14-byte MAC ACK
+// after SIFS.
+static uint32_t airtimeUs(size_t payload) {
+    const uint32_t frame = 192 + (uint32_t)(43 + payload) * 8;
+    const uint32_t macAck = 10 + 192 + 14 * 8;
+    return frame + macAck;
+}
+
+// Small deterministic PRNG so runs are comparable
+static uint32_t s_rng = 12345;
+static uint32_t nextRand() {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return s_rng >> 8;
+}
+
+struct SimNode {
+    NodeStatusMessage status;
+    TelemetryEncoder encoder{KEYFRAME_MS};
+    float tempBase;
+};
+
+static SimNode s_nodes[FLEET_NODES];
+
+static void initNode(SimNode& n, int i) {
+    char mac[18];
+    snprintf(mac, sizeof(mac), "AA:BB:CC:00:%02X:%02X", i / 256, i % 256);
+    n.status.node_id = mac;
+    n.status.light_id = mac;
+    n.status.status_mode = "operational";
+    n.status.fw = "c3-1.0.0";
+    n.status.vbat_mv = 3700;
+    n.tempBase = 21.0f + (i % 7) * 0.5f;
+    n.encoder.reset();
+}
+
+// One report's worth of change: sensor noise every time, colour and button rarely
+static void stepNode(SimNode& n, uint32_t nowMs) {
+    NodeStatusMessage& s = n.status;
+    s.ts = nowMs;
+    // TMP117 steps of 1/128 C around a slowly drifting base
+    n.tempBase += ((int)(nextRand() % 3) - 1) * 0.002f;
+    s.temperature = n.tempBase + ((int)(nextRand() % 5) - 2) / 128.0f;
+    if (nextRand() % 60 == 0) { // set_light roughly once a minute per node
+        s.avg_r = nextRand() % 256; s.avg_g = nextRand() % 256;
+        s.avg_b = nextRand() % 256; s.avg_w = nextRand() % 256;
+    }
+    if (nextRand() % 300 == 0) s.button_pressed = !s.button_pressed;
+}
+
+void test_delta_round_trip_carries_only_changed_fields() {
+    NodeStatusMessage base;
+    base.node_id = "AA:BB:CC:DD:EE:FF";
+    base.light_id = "AA:BB:CC:DD:EE:FF";
+    base.status_mode = "operational";
+    base.fw = "c3-1.0.0";
+    base.key_id = 7;
+
+    NodeStatusDeltaMessage delta;
+    delta.base_key = 7;
+    delta.fields = base;
+    delta.fields.avg_w = 200;
+    delta.fields.temperature = 23.5f;
+    delta.mask = (uint16_t)MessageSchema::changedMask(base, delta.fields);
+    TEST_ASSERT_EQUAL_UINT32(2, __builtin_popcount(delta.mask));
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = delta.encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+    // header + base + mask + u8 + centi
+    TEST_ASSERT_EQUAL(WireCodec::HEADER_LEN + 3 + 1 + 2, n);
+
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS_DELTA, m->type);
+
+    TelemetryBaselines baselines;
+    baselines.storeKeyframe("node", base);
+    NodeStatusMessage rebuilt;
+    TEST_ASSERT_TRUE(baselines.apply("node", *static_cast<NodeStatusDeltaMessage*>(m), rebuilt));
+    TEST_ASSERT_TRUE(MessageSchema::equal(delta.fields, rebuilt));
+    TEST_ASSERT_EQUAL_STRING("c3-1.0.0", rebuilt.fw.c_str());
+}
+
+void test_encoder_keyframes_until_acked_and_resyncs() {
+    TelemetryEncoder enc(KEYFRAME_MS);
+    NodeStatusMessage st;
+    st.node_id = "n1";
+
+    // No baseline yet: every report is a keyframe with a fresh key
+    const EspNowMessage& k1 = enc.next(st, 0);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, k1.type);
+    uint8_t key1 = static_cast<const NodeStatusMessage&>(k1).key_id;
+    const EspNowMessage& k2 = enc.next(st, 1000);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, k2.type);
+    uint8_t key2 = static_cast<const NodeStatusMessage&>(k2).key_id;
+    TEST_ASSERT_TRUE(key1 != key2);
+
+    // A late ack for the superseded keyframe is ignored
+    AckMessage ack;
+    ack.cmd_id = TelemetryDelta::ACK_CMD;
+    ack.key_id = key1;
+    enc.onAck(ack);
+    TEST_ASSERT_EQUAL(0, enc.baselineKey());
+
+    ack.key_id = key2;
+    enc.onAck(ack);
+    TEST_ASSERT_EQUAL(key2, enc.baselineKey());
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS_DELTA, enc.next(st, 2000).type);
+
+    // Keyframe interval elapsed
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, enc.next(st, 1000 + KEYFRAME_MS).type);
+
+    // Coordinator lost the baseline
+    AckMessage resync;
+    resync.cmd_id = TelemetryDelta::RESYNC_CMD;
+    enc.onAck(resync);
+    TEST_ASSERT_EQUAL(0, enc.baselineKey());
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, enc.next(st, 1000 + KEYFRAME_MS + 1).type);
+}
+
+void test_fleet_airtime_full_vs_delta() {
+    for (int i = 0; i < FLEET_NODES; ++i) initNode(s_nodes[i], i);
+
+    MessageSlot slot;
+    TelemetryBaselines baselines;
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    uint8_t fullBuf[WireCodec::MAX_FRAME_LEN];
+    char nodeKey[8];
+
+    uint64_t fullBytes = 0, deltaBytes = 0;
+    uint64_t fullAir = 0, deltaAir = 0;
+    uint32_t frames = 0, keyframes = 0, resyncs = 0, mismatches = 0;
+
+    for (uint32_t sec = 0; sec < SIM_SECONDS; ++sec) {
+        uint32_t now = sec * REPORT_PERIOD_MS;
+        // Coordinator restarts half way through and loses every baseline
+        if (sec == SIM_SECONDS / 2) {
+            for (int i = 0; i < FLEET_NODES; ++i) {
+                snprintf(nodeKey, sizeof(nodeKey), "n%d", i);
+                baselines.forget(nodeKey);
+            }
+        }
+        for (int i = 0; i < FLEET_NODES; ++i) {
+            SimNode& node = s_nodes[i];
+            stepNode(node, now + i * 17);
+            snprintf(nodeKey, sizeof(nodeKey), "n%d", i);
+
+            size_t full = node.status.encode(WireCodec::Format::BINARY, fullBuf, sizeof(fullBuf));
+            fullBytes += full;
+            fullAir += airtimeUs(full);
+
+            size_t n = node.encoder.next(node.status, now).encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+            TEST_ASSERT_GREATER_THAN(0, n);
+            deltaBytes += n;
+            deltaAir += airtimeUs(n);
+            frames++;
+
+            // Coordinator side, as in Coordinator::handleNodeMessage
+            EspNowMessage* m = slot.decode(buf, n);
+            TEST_ASSERT_NOT_NULL(m);
+            AckMessage ack;
+            ack.cmd_id = TelemetryDelta::ACK_CMD;
+            NodeStatusMessage rebuilt;
+            bool haveState = false;
+            if (m->type == MessageType::NODE_STATUS) {
+                const NodeStatusMessage& key = *static_cast<NodeStatusMessage*>(m);
+                baselines.storeKeyframe(nodeKey, key);
+                ack.key_id = key.key_id;
+                rebuilt = key;
+                haveState = true;
+                keyframes++;
+            } else if (baselines.apply(nodeKey, *static_cast<NodeStatusDeltaMessage*>(m), rebuilt)) {
+                haveState = true;
+            } else {
+                ack.cmd_id = TelemetryDelta::RESYNC_CMD;
+                resyncs++;
+            }
+            if (haveState) {
+                rebuilt.key_id = node.status.key_id;
+                if (!MessageSchema::equal(rebuilt, node.status)) mismatches++;
+            }
+
+            // 5% of acks never reach the node
+            if (nextRand() % 20 != 0) node.encoder.onAck(ack);
+        }
+        yield();
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "fleet %d nodes x %lus: %lu frames, %lu keyframes, %lu resyncs",
+             FLEET_NODES, (unsigned long)SIM_SECONDS, (unsigned long)frames,
+             (unsigned long)keyframes, (unsigned long)resyncs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "payload: full %lu B (%.1f B/frame), delta %lu B (%.1f B/frame)",
+             (unsigned long)fullBytes, (double)fullBytes / frames,
+             (unsigned long)deltaBytes, (double)deltaBytes / frames);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "airtime @1Mbps: full %.2f s, delta %.2f s, saved %.1f%% (channel use %.2f%% -> %.2f%%)",
+             fullAir / 1e6, deltaAir / 1e6, 100.0 * (double)(fullAir - deltaAir) / fullAir,
+             100.0 * fullAir / (SIM_SECONDS * 1e6), 100.0 * deltaAir / (SIM_SECONDS * 1e6));
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_TRUE(resyncs > 0);
+    TEST_ASSERT_TRUE(deltaBytes * 2 < fullBytes);
+    TEST_ASSERT_TRUE(deltaAir < fullAir);
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_delta_round_trip_carries_only_changed_fields);
+    RUN_TEST(test_encoder_keyframes_until_acked_and_resyncs);
+    RUN_TEST(test_fleet_airtime_full_vs_delta);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
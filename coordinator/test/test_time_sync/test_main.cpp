@@ -0,0 +1,273 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+#include "TelemetryDelta.h"
+#include "TimeSync.h"
+
+// Clock sync: the telemetry ack's stamps on the wire, the estimator's guards,
+// and a simulated node/coordinator pair with drifting crystals, jittery links,
+// lost acks and an outage, measured against the true coordinator clock.
+
+static uint32_t s_rng = 4242;
+static uint32_t nextRand() {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return s_rng >> 8;
+}
+static uint32_t randBelow(uint32_t n) { return nextRand() % n; }
+
+void test_ack_carries_clock_stamps() {
+    AckMessage ack;
+    ack.cmd_id = TelemetryDelta::ACK_CMD;
+    ack.stampClock(5000, 90000, 90007);
+    TEST_ASSERT_TRUE(ack.hasClock());
+
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = ack.toBinary(buf, sizeof(buf));
+    MessageSlot slot;
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    const AckMessage& in = *static_cast<AckMessage*>(m);
+    TEST_ASSERT_EQUAL_UINT32(5000, in.echo_ts);
+    TEST_ASSERT_EQUAL_UINT32(90007, in.coord_ms);
+    TEST_ASSERT_EQUAL_UINT16(7, in.hold_ms);
+
+    // Command acks stay as they were in JSON
+    AckMessage plain;
+    plain.cmd_id = "abc";
+    String json = plain.toJson();
+    TEST_ASSERT_NULL(strstr(json.c_str(), "cms"));
+    TEST_ASSERT_NULL(strstr(json.c_str(), "ets"));
+
+    // An ack from a peer built before the fields existed decodes without them
+    n = plain.toBinary(buf, sizeof(buf));
+    m = slot.decode(buf, n - 10);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_FALSE(static_cast<AckMessage*>(m)->hasClock());
+}
+
+// The coordinator answers a status_delta with the ts the delta carried, so
+// the rebuilt status must hold the new ts rather than the keyframe's
+void test_delta_telemetry_carries_ts() {
+    TelemetryEncoder encoder(30000);
+    TelemetryBaselines baselines;
+    NodeStatusMessage status;
+    status.node_id = "AA:BB:CC:00:00:01";
+    status.ts = 1000;
+    const EspNowMessage& key = encoder.next(status, 1000);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, key.type);
+    const NodeStatusMessage& keyframe = static_cast<const NodeStatusMessage&>(key);
+    baselines.storeKeyframe(status.node_id, keyframe);
+    AckMessage ack;
+    ack.cmd_id = TelemetryDelta::ACK_CMD;
+    ack.key_id = keyframe.key_id;
+    encoder.onAck(ack);
+
+    status.ts = 2000;
+    const EspNowMessage& next = encoder.next(status, 2000);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS_DELTA, next.type);
+    NodeStatusMessage rebuilt;
+    TEST_ASSERT_TRUE(baselines.apply(status.node_id,
+                                     static_cast<const NodeStatusDeltaMessage&>(next), rebuilt));
+    TEST_ASSERT_EQUAL_UINT32(2000, rebuilt.ts);
+}
+
+void test_estimator_guards() {
+    TimeSync sync;
+    TEST_ASSERT_FALSE(sync.hasEstimate());
+    TEST_ASSERT_FALSE(sync.synced(0));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, sync.errorMs(0));
+
+    // Node 1000 ms behind, 4 ms each way, 2 ms hold
+    TEST_ASSERT_TRUE(sync.addExchange(100, 1104, 1106, 110));
+    TEST_ASSERT_EQUAL_INT32(1000, sync.offsetMs(110));
+    TEST_ASSERT_EQUAL_UINT32(8, sync.bestRttMs());
+    TEST_ASSERT_EQUAL_UINT32(1210, sync.toCoordinator(210));
+    TEST_ASSERT_EQUAL_UINT32(210, sync.toLocal(1210));
+    TEST_ASSERT_TRUE(sync.synced(110));
+
+    // Round trips past MAX_RTT_MS (an ack answering a stale ts) are ignored
+    TEST_ASSERT_FALSE(sync.addExchange(200, 1500, 1502, 600));
+    TEST_ASSERT_EQUAL_UINT32(1, sync.stats().rejected);
+
+    // A slow exchange does not pull the offset by its asymmetry
+    TEST_ASSERT_TRUE(sync.addExchange(1000, 2004, 2006, 1060));
+    TEST_ASSERT_EQUAL_INT32(1000, sync.offsetMs(1060));
+
+    // Coordinator reboot: its clock restarts near zero
+    TEST_ASSERT_TRUE(sync.addExchange(2000, 24, 26, 2010));
+    TEST_ASSERT_EQUAL_UINT32(1, sync.stats().restarts);
+    TEST_ASSERT_EQUAL_INT32(-1980, sync.offsetMs(2010));
+
+    // Offsets across the 32-bit wrap of either clock
+    TimeSync wrap;
+    uint32_t c = 0xFFFFFFF0u;
+    TEST_ASSERT_TRUE(wrap.addExchange(500, c + 4, c + 6, 510));
+    TEST_ASSERT_EQUAL_UINT32(c + 6 + 4 + 100, wrap.toCoordinator(610));
+}
+
+// ---- Simulated pair ----
+
+// Clocks run from true time in microseconds; millis() truncates
+struct SimClock {
+    double rate;      // 1 + drift
+    double offsetUs;
+
+    uint32_t millisAt(uint64_t trueUs) const {
+        return (uint32_t)(uint64_t)((trueUs * rate + offsetUs) / 1000.0);
+    }
+};
+
+// One leg of ESP-NOW delivery: air and stack time, scheduling jitter, MAC
+// retries now and then, rarely a long stall (busy loop, Wi-Fi scan)
+static uint64_t legDelayUs(uint32_t queueUs) {
+    uint64_t d = 1200 + randBelow(1500) + randBelow(queueUs + 1);
+    if (randBelow(100) < 10) d += 3000 + randBelow(30000);
+    if (randBelow(1000) < 15) d += 80000 + randBelow(150000);
+    return d;
+}
+
+static const uint32_t SIM_SECONDS = 1800;
+static const uint32_t REPORT_MS = 1000;
+static const uint32_t OUTAGE_START_S = 900;
+static const uint32_t OUTAGE_S = 120;
+static const uint32_t CONVERGE_MS = 5000;
+
+struct ErrorStats {
+    uint32_t samples = 0;
+    uint32_t maxAbs = 0;
+    uint64_t sumAbs = 0;
+    uint32_t over[2] = {0, 0}; // >= 5 ms, >= 10 ms
+
+    void add(int32_t err) {
+        uint32_t a = (uint32_t)(err < 0 ? -err : err);
+        samples++;
+        sumAbs += a;
+        if (a > maxAbs) maxAbs = a;
+        if (a >= 5) over[0]++;
+        if (a >= 10) over[1]++;
+    }
+};
+
+void test_fleet_timebase_under_jitter() {
+    // Coordinator up for weeks (its millis() wraps mid-run), node just booted,
+    // crystals 50 ppm apart
+    SimClock coord{1.0 - 15e-6, (double)(0xFFFFFFFFu - 400000u) * 1000.0};
+    SimClock node{1.0 + 35e-6, 3000.0 * 1000.0};
+
+    TimeSync sync;
+    ErrorStats timeSync;
+    ErrorStats beaconOffset;
+    uint32_t boundMisses = 0;
+    uint32_t unsyncedChecks = 0;
+    uint32_t unsyncedInOutageMs = 0;
+    uint64_t firstSyncedUs = 0;
+    int32_t beaconOffsetMs = 0; // the old per-beacon coordinatorClockOffsetMs
+    bool haveBeacon = false;
+    uint32_t lostAcks = 0;
+    uint32_t exchanges = 0;
+
+    uint64_t nextReportUs = 200000;
+    uint64_t nextBeaconUs = 700000;
+    const uint64_t endUs = (uint64_t)SIM_SECONDS * 1000000ULL;
+    for (uint64_t t = 0; t < endUs; t += 50000) {
+        while (nextReportUs <= t) {
+            uint64_t sendUs = nextReportUs;
+            nextReportUs += (uint64_t)REPORT_MS * 1000 + randBelow(20000);
+            uint32_t s = (uint32_t)(sendUs / 1000000ULL);
+            bool outage = s >= OUTAGE_START_S && s < OUTAGE_START_S + OUTAGE_S;
+            if (outage || randBelow(100) < 10) {
+                lostAcks++;
+                continue;
+            }
+            uint32_t t1 = node.millisAt(sendUs);
+            uint64_t rxUs = sendUs + legDelayUs(2000);
+            uint32_t t2 = coord.millisAt(rxUs);
+            // Coordinator loop gets to it, then the ack waits in the TX queue
+            uint64_t ackUs = rxUs + 500 + randBelow(25000);
+            AckMessage ack;
+            ack.stampClock(t1, t2, coord.millisAt(ackUs));
+            uint64_t backUs = ackUs + legDelayUs(15000);
+            if (sync.addExchange(ack.echo_ts, ack.coord_ms - ack.hold_ms, ack.coord_ms, node.millisAt(backUs))) {
+                exchanges++;
+            }
+        }
+        while (nextBeaconUs <= t) {
+            // Broadcast: no MAC retries, but the same queueing and stalls
+            uint64_t rx = nextBeaconUs + legDelayUs(15000);
+            beaconOffsetMs = (int32_t)(coord.millisAt(nextBeaconUs) - node.millisAt(rx));
+            haveBeacon = true;
+            nextBeaconUs += 2000000;
+        }
+        if (t < CONVERGE_MS * 1000ULL) continue;
+
+        uint32_t local = node.millisAt(t);
+        uint32_t truth = coord.millisAt(t);
+        int32_t err = (int32_t)(sync.toCoordinator(local) - truth);
+        timeSync.add(err);
+        if ((uint32_t)(err < 0 ? -err : err) > sync.errorMs(local)) boundMisses++;
+        // Without acks the bound widens by the assumed drift until it passes
+        // the target; that is the only time the node may report unsynced
+        if (sync.synced(local)) {
+            if (firstSyncedUs == 0) firstSyncedUs = t;
+        } else if (firstSyncedUs != 0) {
+            uint32_t s = (uint32_t)(t / 1000000ULL);
+            if (s >= OUTAGE_START_S && s < OUTAGE_START_S + OUTAGE_S + 2) unsyncedInOutageMs += 50;
+            else unsyncedChecks++;
+        }
+        if (haveBeacon) beaconOffset.add((int32_t)(local + (uint32_t)beaconOffsetMs - truth));
+    }
+
+    // The shared timebase holds within 10 ms everywhere, outage included
+    TEST_ASSERT_TRUE(timeSync.maxAbs < TimeSync::TARGET_ERROR_MS);
+    TEST_ASSERT_EQUAL_UINT32(0, boundMisses);
+    TEST_ASSERT_EQUAL_UINT32(0, unsyncedChecks);
+    TEST_ASSERT_TRUE(firstSyncedUs > 0 && firstSyncedUs < 15000000ULL);
+    TEST_ASSERT_TRUE(sync.driftPpm() < -40.0f && sync.driftPpm() > -60.0f);
+    TEST_ASSERT_TRUE(timeSync.maxAbs < beaconOffset.maxAbs);
+
+    char msg[192];
+    snprintf(msg, sizeof(msg), "%lus, ack every ~%lums, %lu exchanges, %lu acks lost (%lus outage):",
+             (unsigned long)SIM_SECONDS, (unsigned long)REPORT_MS, (unsigned long)exchanges,
+             (unsigned long)lostAcks, (unsigned long)OUTAGE_S);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  beacon one-way offset: mean %lu.%lu ms, max %lu ms, >=5 ms %lu.%lu%%, >=10 ms %lu.%lu%%",
+             (unsigned long)(beaconOffset.sumAbs / beaconOffset.samples),
+             (unsigned long)(beaconOffset.sumAbs * 10 / beaconOffset.samples % 10),
+             (unsigned long)beaconOffset.maxAbs,
+             (unsigned long)(beaconOffset.over[0] * 100 / beaconOffset.samples),
+             (unsigned long)(beaconOffset.over[0] * 1000 / beaconOffset.samples % 10),
+             (unsigned long)(beaconOffset.over[1] * 100 / beaconOffset.samples),
+             (unsigned long)(beaconOffset.over[1] * 1000 / beaconOffset.samples % 10));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  TimeSync:              mean %lu.%lu ms, max %lu ms, >=5 ms %lu.%lu%%, drift %.1f ppm (true -50.0)",
+             (unsigned long)(timeSync.sumAbs / timeSync.samples),
+             (unsigned long)(timeSync.sumAbs * 10 / timeSync.samples % 10),
+             (unsigned long)timeSync.maxAbs,
+             (unsigned long)(timeSync.over[0] * 100 / timeSync.samples),
+             (unsigned long)(timeSync.over[0] * 1000 / timeSync.samples % 10),
+             sync.driftPpm());
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  synced (error bound < %lu ms) %lu.%lu s after boot",
+             (unsigned long)TimeSync::TARGET_ERROR_MS, (unsigned long)(firstSyncedUs / 1000000ULL),
+             (unsigned long)(firstSyncedUs / 100000ULL % 10));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "  error bound passed %lu ms for the last %lu ms of the outage",
+             (unsigned long)TimeSync::TARGET_ERROR_MS, (unsigned long)unsyncedInOutageMs);
+    TEST_MESSAGE(msg);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_ack_carries_clock_stamps);
+    RUN_TEST(test_delta_telemetry_carries_ts);
+    RUN_TEST(test_estimator_guards);
+    RUN_TEST(test_fleet_timebase_under_jitter);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
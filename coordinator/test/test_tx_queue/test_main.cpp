@@ -0,0 +1,493 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../../src/comm/TxQueue.h"
+
+// Per-peer ESP-NOW TX queues: windows, backpressure, driver NO_MEM retries,
+// completion timeouts, traffic classes, a burst through a simulated driver,
+// and light-command delay under growing ack load with and without classes.
+
+static const uint8_t MAC_A[6] = {0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x01};
+static const uint8_t MAC_B[6] = {0xAA, 0xBB, 0xCC, 0x00, 0x00, 0x02};
+
+// Frames the transmit hook saw: first byte is the peer tag, second the sequence
+struct Sent {
+    uint8_t peer;
+    uint8_t seq;
+};
+static Sent s_sent[64];
+static size_t s_sentCount = 0;
+static int s_busyLeft = 0;   // answer BUSY this many times
+static int s_failLeft = 0;   // answer FAILED this many times
+
+static TxQueue::SendStatus recordTransmit(const uint8_t mac[6], const uint8_t* data, size_t len) {
+    (void)mac; (void)len;
+    if (s_busyLeft > 0) { s_busyLeft--; return TxQueue::SendStatus::BUSY; }
+    if (s_failLeft > 0) { s_failLeft--; return TxQueue::SendStatus::FAILED; }
+    if (s_sentCount < 64) s_sent[s_sentCount++] = Sent{data[0], data[1]};
+    return TxQueue::SendStatus::SENT;
+}
+
+static void resetRecorder() {
+    s_sentCount = 0;
+    s_busyLeft = 0;
+    s_failLeft = 0;
+}
+
+static TxQueue::Result queueFrame(TxQueue& q, const uint8_t mac[6], uint8_t peer, uint8_t seq, uint32_t nowUs = 0,
+                                  TxQueue::Priority prio = TxQueue::Priority::INTERACTIVE) {
+    uint8_t frame[32] = {peer, seq};
+    return q.enqueue(mac, frame, sizeof(frame), nowUs, prio);
+}
+
+void test_per_peer_order_and_windows() {
+    static TxQueue q;
+    resetRecorder();
+    q.setTransmit(recordTransmit);
+    for (uint8_t i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(q, MAC_A, 'A', i));
+        TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(q, MAC_B, 'B', i));
+    }
+    q.pump(0);
+    // PEER_WINDOW frames each, peers taking turns
+    TEST_ASSERT_EQUAL(2 * TxQueue::PEER_WINDOW, s_sentCount);
+    const Sent expect[] = {{'A', 0}, {'B', 0}, {'A', 1}, {'B', 1}};
+    for (size_t i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(expect[i].peer, s_sent[i].peer);
+        TEST_ASSERT_EQUAL_UINT8(expect[i].seq, s_sent[i].seq);
+    }
+    TEST_ASSERT_EQUAL(3, q.depth(MAC_A));
+
+    // A completion opens exactly one slot in that peer's window
+    q.onComplete(MAC_A, true, 1000);
+    q.pump(1000);
+    TEST_ASSERT_EQUAL(5, s_sentCount);
+    TEST_ASSERT_EQUAL_UINT8('A', s_sent[4].peer);
+    TEST_ASSERT_EQUAL_UINT8(2, s_sent[4].seq);
+
+    // Drain everything; each peer's frames leave in order
+    uint32_t now = 1000;
+    while (q.stats().inFlight > 0) {
+        now += 1000;
+        q.onComplete(MAC_A, true, now);
+        q.onComplete(MAC_B, true, now);
+        q.pump(now);
+    }
+    TEST_ASSERT_EQUAL(10, s_sentCount);
+    uint8_t nextA = 0, nextB = 0;
+    for (size_t i = 0; i < s_sentCount; ++i) {
+        uint8_t& next = s_sent[i].peer == 'A' ? nextA : nextB;
+        TEST_ASSERT_EQUAL_UINT8(next++, s_sent[i].seq);
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, q.stats().delivered);
+    TEST_ASSERT_EQUAL(0, q.stats().depth);
+    TEST_ASSERT_EQUAL(TxQueue::FRAMES_PER_PEER, q.space(MAC_A, TxQueue::Priority::INTERACTIVE));
+}
+
+void test_backpressure_when_full() {
+    static TxQueue q;
+    resetRecorder();
+    // No transmit hook: nothing leaves, the queues only fill
+    for (uint8_t i = 0; i < TxQueue::FRAMES_PER_PEER; ++i) {
+        TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(q, MAC_A, 'A', i));
+    }
+    TEST_ASSERT_EQUAL(0, q.space(MAC_A, TxQueue::Priority::INTERACTIVE));
+    TEST_ASSERT_EQUAL(TxQueue::Result::FULL, queueFrame(q, MAC_A, 'A', 99));
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().dropped);
+    // Another peer is unaffected, and so is another class of the same peer
+    TEST_ASSERT_EQUAL(TxQueue::FRAMES_PER_PEER, q.space(MAC_B, TxQueue::Priority::INTERACTIVE));
+    TEST_ASSERT_EQUAL(TxQueue::FRAMES_PER_PEER, q.space(MAC_A, TxQueue::Priority::ROUTINE));
+
+    // Fill the shared pool through more peers; light control may use all of it
+    uint8_t mac[6] = {0x02, 0, 0, 0, 0, 0};
+    size_t queued = TxQueue::FRAMES_PER_PEER;
+    while (queued < TxQueue::POOL_FRAMES) {
+        mac[5]++;
+        for (size_t i = 0; i < TxQueue::FRAMES_PER_PEER && queued < TxQueue::POOL_FRAMES; ++i, ++queued) {
+            TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(q, mac, 'X', (uint8_t)i));
+        }
+    }
+    TEST_ASSERT_EQUAL(0, q.space(MAC_B, TxQueue::Priority::INTERACTIVE));
+    TEST_ASSERT_EQUAL(TxQueue::Result::FULL, queueFrame(q, MAC_B, 'B', 0));
+    TEST_ASSERT_EQUAL(TxQueue::POOL_FRAMES, q.stats().maxDepth);
+
+    uint8_t big[TxQueue::MAX_FRAME + 1] = {0};
+    q.forget(MAC_A);
+    TEST_ASSERT_EQUAL(TxQueue::Result::TOO_LARGE, q.enqueue(MAC_B, big, sizeof(big), 0, TxQueue::Priority::INTERACTIVE));
+    TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(q, MAC_B, 'B', 0));
+}
+
+void test_busy_driver_keeps_frames() {
+    static TxQueue q;
+    resetRecorder();
+    q.setTransmit(recordTransmit);
+    for (uint8_t i = 0; i < 3; ++i) queueFrame(q, MAC_A, 'A', i);
+
+    s_busyLeft = 2;
+    q.pump(0);
+    TEST_ASSERT_EQUAL(0, s_sentCount);
+    q.pump(100);
+    TEST_ASSERT_EQUAL(0, s_sentCount);
+    q.pump(200);
+    TEST_ASSERT_EQUAL(2, s_sentCount);
+    TEST_ASSERT_EQUAL_UINT32(2, q.stats().busy);
+    TEST_ASSERT_EQUAL_UINT8(0, s_sent[0].seq);
+
+    // A hard failure drops that frame only
+    q.onComplete(MAC_A, true, 300);
+    q.onComplete(MAC_A, false, 300);
+    s_failLeft = 1;
+    q.pump(300);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().rejected);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().delivered);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().failed);
+    TEST_ASSERT_EQUAL(0, q.depth(MAC_A));
+}
+
+void test_missing_completion_times_out() {
+    static TxQueue q;
+    resetRecorder();
+    q.setTransmit(recordTransmit);
+    for (uint8_t i = 0; i < 3; ++i) queueFrame(q, MAC_A, 'A', i);
+    q.pump(0);
+    TEST_ASSERT_EQUAL(2, s_sentCount);
+
+    // No send_cb ever arrives (e.g. ESP-NOW deinit): the window reopens
+    q.pump(TxQueue::COMPLETION_TIMEOUT_US);
+    TEST_ASSERT_EQUAL(2, s_sentCount);
+    q.pump(TxQueue::COMPLETION_TIMEOUT_US + 1);
+    TEST_ASSERT_EQUAL_UINT32(2, q.stats().timedOut);
+    TEST_ASSERT_EQUAL(3, s_sentCount);
+    TEST_ASSERT_EQUAL_UINT8(2, s_sent[2].seq);
+
+    // Late completions for the timed-out frames are theirs, not the one now
+    // in flight: it keeps its window slot until its own send_cb
+    q.onComplete(MAC_A, true, TxQueue::COMPLETION_TIMEOUT_US + 2);
+    q.onComplete(MAC_A, true, TxQueue::COMPLETION_TIMEOUT_US + 3);
+    TEST_ASSERT_EQUAL_UINT32(2, q.stats().late);
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats().delivered);
+    TEST_ASSERT_EQUAL(1, q.inFlight(MAC_A));
+    q.onComplete(MAC_A, true, TxQueue::COMPLETION_TIMEOUT_US + 4000);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().delivered);
+    TEST_ASSERT_EQUAL_UINT32(4000 + TxQueue::COMPLETION_TIMEOUT_US, q.stats().latencyMaxUs);
+    TEST_ASSERT_EQUAL(0, q.stats().inFlight);
+
+    // Written-off callbacks that never come stop being waited for after
+    // another timeout, so the next real completion counts again
+    const uint32_t t0 = 10 * TxQueue::COMPLETION_TIMEOUT_US;
+    queueFrame(q, MAC_A, 'A', 3, t0);
+    q.pump(t0);
+    q.pump(t0 + TxQueue::COMPLETION_TIMEOUT_US + 1);
+    TEST_ASSERT_EQUAL_UINT32(3, q.stats().timedOut);
+    queueFrame(q, MAC_A, 'A', 4, t0 + 3 * TxQueue::COMPLETION_TIMEOUT_US);
+    q.pump(t0 + 3 * TxQueue::COMPLETION_TIMEOUT_US);
+    q.onComplete(MAC_A, true, t0 + 3 * TxQueue::COMPLETION_TIMEOUT_US + 1000);
+    TEST_ASSERT_EQUAL_UINT32(2, q.stats().late);
+    TEST_ASSERT_EQUAL_UINT32(2, q.stats().delivered);
+    TEST_ASSERT_EQUAL(0, q.stats().inFlight);
+}
+
+static void peerMac(uint8_t n, uint8_t out[6]) {
+    const uint8_t base[6] = {0xAA, 0xBB, 0xCC, 0x20, 0x00, 0x00};
+    memcpy(out, base, 6);
+    out[5] = n;
+}
+
+void test_classes_preempt_and_reserve() {
+    static TxQueue q;
+    resetRecorder();
+    q.setTransmit(recordTransmit);
+    const TxQueue::Priority INTERACTIVE = TxQueue::Priority::INTERACTIVE;
+    const TxQueue::Priority ROUTINE = TxQueue::Priority::ROUTINE;
+    const TxQueue::Priority BULK = TxQueue::Priority::BULK;
+    // Queued lowest class first, one peer per frame so windows stay open
+    uint8_t mac[6];
+    for (uint8_t i = 0; i < 3; ++i) { peerMac(i, mac); queueFrame(q, mac, 'L', i, 0, BULK); }
+    for (uint8_t i = 0; i < 3; ++i) { peerMac(10 + i, mac); queueFrame(q, mac, 'R', i, 0, ROUTINE); }
+    for (uint8_t i = 0; i < 2; ++i) { peerMac(20 + i, mac); queueFrame(q, mac, 'I', i, 0, INTERACTIVE); }
+    q.pump(0);
+    // Light control first; acks only up to their in-flight limit, bulk not at all
+    const size_t afterFirst = TxQueue::IN_FLIGHT_LIMIT[(size_t)ROUTINE];
+    TEST_ASSERT_EQUAL(afterFirst, s_sentCount);
+    TEST_ASSERT_EQUAL_UINT8('I', s_sent[0].peer);
+    TEST_ASSERT_EQUAL_UINT8('I', s_sent[1].peer);
+    for (size_t i = 2; i < afterFirst; ++i) TEST_ASSERT_EQUAL_UINT8('R', s_sent[i].peer);
+
+    // A light command queued now goes ahead of the acks and bulk still waiting
+    peerMac(30, mac);
+    queueFrame(q, mac, 'I', 9, 0, INTERACTIVE);
+    q.pump(0);
+    TEST_ASSERT_EQUAL(afterFirst + 1, s_sentCount);
+    TEST_ASSERT_EQUAL_UINT8('I', s_sent[afterFirst].peer);
+
+    // Drain: every ack leaves before any bulk frame
+    uint32_t now = 0;
+    while (q.stats().inFlight > 0) {
+        now += 1000;
+        for (uint8_t n = 0; n < 40; ++n) { peerMac(n, mac); q.onComplete(mac, true, now); }
+        q.pump(now);
+    }
+    TEST_ASSERT_EQUAL(9, s_sentCount);
+    for (size_t i = 6; i < 9; ++i) TEST_ASSERT_EQUAL_UINT8('L', s_sent[i].peer);
+    TEST_ASSERT_EQUAL_UINT32(3, q.stats().byClass[(size_t)INTERACTIVE].sent);
+    TEST_ASSERT_EQUAL_UINT32(3, q.stats().byClass[(size_t)ROUTINE].latencyCount);
+    TEST_ASSERT_EQUAL_UINT32(3, q.stats().byClass[(size_t)BULK].sent);
+
+    // Bulk cannot take the pool frames reserved for the classes above it
+    static TxQueue full;
+    size_t bulk = 0;
+    for (uint8_t n = 0; n < 40; ++n) {
+        peerMac(n, mac);
+        while (queueFrame(full, mac, 'L', 0, 0, BULK) == TxQueue::Result::QUEUED) bulk++;
+    }
+    TEST_ASSERT_EQUAL(TxQueue::POOL_FRAMES - TxQueue::POOL_RESERVE[(size_t)BULK], bulk);
+    TEST_ASSERT_EQUAL(0, full.space(mac, BULK));
+    size_t acks = 0;
+    for (uint8_t n = 0; n < 40; ++n) {
+        peerMac(n, mac);
+        while (queueFrame(full, mac, 'R', 0, 0, ROUTINE) == TxQueue::Result::QUEUED) acks++;
+    }
+    TEST_ASSERT_EQUAL(TxQueue::POOL_RESERVE[(size_t)BULK] - TxQueue::POOL_RESERVE[(size_t)ROUTINE], acks);
+    TEST_ASSERT_EQUAL(TxQueue::POOL_RESERVE[(size_t)ROUTINE], full.space(mac, INTERACTIVE));
+    TEST_ASSERT_EQUAL(TxQueue::Result::QUEUED, queueFrame(full, mac, 'I', 0, 0, INTERACTIVE));
+    TEST_ASSERT_EQUAL_UINT32(40, full.stats().byClass[(size_t)BULK].dropped);
+}
+
+// ---- Burst through a simulated driver ----
+
+// The driver holds a few frames (SLOTS is a guess, the IDF does not document
+// its ESP-NOW queue depth) and puts them on air one after another; each
+// frame's send_cb fires when its airtime (1 Mbps, ACK included) has passed.
+struct SimDriver {
+    static constexpr size_t SLOTS = 4;
+    uint8_t mac[SLOTS][6];
+    uint32_t doneUs[SLOTS];
+    size_t head = 0, count = 0;
+    uint32_t airFreeUs = 0;
+    uint32_t nowUs = 0;
+    uint32_t accepted = 0, noMem = 0;
+
+    static uint32_t airtimeUs(size_t len) {
+        return 192 + (uint32_t)(43 + len) * 8 + 10 + 192 + 14 * 8;
+    }
+
+    TxQueue::SendStatus send(const uint8_t* dst, size_t len) {
+        if (count == SLOTS) { noMem++; return TxQueue::SendStatus::BUSY; }
+        size_t i = (head + count++) % SLOTS;
+        memcpy(mac[i], dst, 6);
+        uint32_t start = airFreeUs > nowUs ? airFreeUs : nowUs;
+        airFreeUs = doneUs[i] = start + airtimeUs(len);
+        accepted++;
+        return TxQueue::SendStatus::SENT;
+    }
+
+    // Completions due by nowUs, oldest first
+    template <typename F>
+    void complete(F&& onDone) {
+        while (count > 0 && doneUs[head] <= nowUs) {
+            onDone(mac[head], doneUs[head]);
+            head = (head + 1) % SLOTS;
+            count--;
+        }
+    }
+};
+
+static const size_t BURST_NODES = 20;
+static const size_t BURST_FRAMES_PER_NODE = 2;   // set_light, then a correction
+static const size_t BURST_FRAME_LEN = 120;
+static const uint32_t CALL_US = 40;               // CPU cost of one esp_now_send()
+static const uint32_t LOOP_US = 500;              // loop() period
+
+static void burstMac(size_t node, uint8_t out[6]) {
+    const uint8_t base[6] = {0xAA, 0xBB, 0xCC, 0x10, 0x00, 0x00};
+    memcpy(out, base, 6);
+    out[5] = (uint8_t)node;
+}
+
+void test_burst_benchmark() {
+    uint8_t frame[BURST_FRAME_LEN] = {0};
+    const size_t total = BURST_NODES * BURST_FRAMES_PER_NODE;
+
+    // Before: esp_now_send() back to back, NO_MEM means the frame is gone
+    SimDriver oldDrv;
+    uint32_t oldLost = 0;
+    for (size_t f = 0; f < BURST_FRAMES_PER_NODE; ++f) {
+        for (size_t n = 0; n < BURST_NODES; ++n) {
+            uint8_t mac[6];
+            burstMac(n, mac);
+            oldDrv.complete([](const uint8_t*, uint32_t) {});
+            if (oldDrv.send(mac, sizeof(frame)) != TxQueue::SendStatus::SENT) oldLost++;
+            oldDrv.nowUs += CALL_US;
+        }
+    }
+
+    // After: the same burst queued, released by loop() as completions arrive
+    static SimDriver drv;
+    static TxQueue q;
+    q.setTransmit([](const uint8_t mac[6], const uint8_t*, size_t len) { return drv.send(mac, len); });
+    uint32_t refused = 0;
+    for (size_t f = 0; f < BURST_FRAMES_PER_NODE; ++f) {
+        for (size_t n = 0; n < BURST_NODES; ++n) {
+            uint8_t mac[6];
+            burstMac(n, mac);
+            if (q.enqueue(mac, frame, sizeof(frame), drv.nowUs, TxQueue::Priority::INTERACTIVE) != TxQueue::Result::QUEUED) {
+                refused++;
+            }
+            q.pump(drv.nowUs);
+            drv.nowUs += CALL_US;
+        }
+    }
+    while (q.stats().depth > 0 || q.stats().inFlight > 0) {
+        drv.nowUs += LOOP_US;
+        drv.complete([](const uint8_t* mac, uint32_t atUs) { q.onComplete(mac, true, atUs); });
+        q.pump(drv.nowUs);
+        TEST_ASSERT_TRUE(drv.nowUs < 1000000);
+    }
+
+    const TxQueue::Stats& st = q.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, refused);
+    TEST_ASSERT_EQUAL_UINT32(total, st.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, st.timedOut);
+    TEST_ASSERT_TRUE(oldLost > 0);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "burst %u frames: back-to-back lost %lu (NO_MEM), queued lost 0 (busy retries %lu)",
+             (unsigned)total, (unsigned long)oldLost, (unsigned long)st.busy);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "queue depth hwm %u, enqueue->send_cb avg %lu us, p95 <= %lu ms, max %lu us, burst done in %lu us",
+             (unsigned)st.maxDepth, (unsigned long)(st.latencySumUs / st.latencyCount),
+             (unsigned long)q.latencyPercentileMs(95), (unsigned long)st.latencyMaxUs, (unsigned long)drv.nowUs);
+    TEST_MESSAGE(msg);
+}
+
+// ---- Light commands under ack load ----
+
+// Coordinator traffic for LOAD_NODES tiles over LOAD_SECONDS: a set_light to
+// a random tile every 25 ms and a light_batch every 500 ms, an ack for every
+// telemetry frame at ackPerSec, a beacon a second, and a config/log transfer
+// to one tile that always has frames waiting. "Classes off" queues everything
+// as one class, which is how the queue behaved before.
+static uint32_t s_rng = 4242;
+static uint32_t randBelow(uint32_t n) {
+    s_rng = s_rng * 1664525UL + 1013904223UL;
+    return (s_rng >> 8) % n;
+}
+
+static const uint8_t LOAD_NODES = 30;
+static const uint32_t LOAD_SECONDS = 5;
+static SimDriver* s_loadDrv = nullptr;
+
+struct LoadResult {
+    uint32_t avgUs[TxQueue::PRIORITIES];
+    uint32_t p95Ms[TxQueue::PRIORITIES];
+    uint32_t maxUs[TxQueue::PRIORITIES];
+    uint32_t dropped[TxQueue::PRIORITIES];
+};
+
+static void runLoad(uint32_t ackPerSec, bool classes, LoadResult& out) {
+    SimDriver drv;
+    s_loadDrv = &drv;
+    TxQueue* q = new TxQueue();
+    q->setTransmit([](const uint8_t mac[6], const uint8_t*, size_t len) { return s_loadDrv->send(mac, len); });
+    const uint8_t bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    uint8_t frame[200] = {0};
+    auto send = [&](const uint8_t mac[6], size_t len, TxQueue::Priority prio) {
+        q->enqueue(mac, frame, len, drv.nowUs, classes ? prio : TxQueue::Priority::INTERACTIVE);
+        q->pump(drv.nowUs);
+    };
+
+    const uint32_t endUs = LOAD_SECONDS * 1000000U;
+    uint32_t nextLightUs = 0, nextBatchUs = 0, nextBeaconUs = 0;
+    uint32_t ackCarry = 0;
+    uint8_t mac[6];
+    while (drv.nowUs < endUs) {
+        drv.nowUs += LOOP_US;
+        drv.complete([q](const uint8_t* m, uint32_t atUs) { q->onComplete(m, true, atUs); });
+        // Telemetry acks, spread evenly over the loop passes
+        ackCarry += ackPerSec * LOOP_US;
+        while (ackCarry >= 1000000U) {
+            ackCarry -= 1000000U;
+            peerMac((uint8_t)(1 + randBelow(LOAD_NODES)), mac);
+            send(mac, 30 + randBelow(10), TxQueue::Priority::ROUTINE);
+        }
+        if (drv.nowUs >= nextBeaconUs) {
+            nextBeaconUs += 1000000;
+            send(bcast, 60, TxQueue::Priority::ROUTINE);
+        }
+        peerMac(0, mac);
+        while (q->depth(mac) < 4) send(mac, 200, TxQueue::Priority::BULK);
+        if (drv.nowUs >= nextLightUs) {
+            nextLightUs += 25000;
+            peerMac((uint8_t)(1 + randBelow(LOAD_NODES)), mac);
+            send(mac, 40, TxQueue::Priority::INTERACTIVE);
+        }
+        if (drv.nowUs >= nextBatchUs) {
+            nextBatchUs += 500000;
+            send(bcast, 180, TxQueue::Priority::INTERACTIVE);
+        }
+        q->pump(drv.nowUs);
+    }
+
+    const TxQueue::Stats& st = q->stats();
+    for (size_t c = 0; c < TxQueue::PRIORITIES; ++c) {
+        const TxQueue::ClassStats& cs = st.byClass[c];
+        out.avgUs[c] = cs.latencyCount ? (uint32_t)(cs.latencySumUs / cs.latencyCount) : 0;
+        out.p95Ms[c] = q->latencyPercentileMs((TxQueue::Priority)c, 95);
+        out.maxUs[c] = cs.latencyMaxUs;
+        out.dropped[c] = cs.dropped;
+    }
+    delete q;
+}
+
+void test_light_delay_under_ack_load() {
+    const uint32_t loads[] = {0, 200, 400, 600};
+    const size_t LOADS = sizeof(loads) / sizeof(loads[0]);
+    const size_t I = (size_t)TxQueue::Priority::INTERACTIVE;
+    LoadResult before[LOADS], after[LOADS];
+    char msg[200];
+    TEST_MESSAGE("set_light/light_batch enqueue->send_cb delay (avg / p95 / max), acks and bulk alongside:");
+    for (size_t i = 0; i < LOADS; ++i) {
+        runLoad(loads[i], false, before[i]);
+        runLoad(loads[i], true, after[i]);
+        snprintf(msg, sizeof(msg),
+                 "  %3lu acks/s  one class: %5lu us / <=%3lu ms / %6lu us   classes: %5lu us / <=%lu ms / %5lu us",
+                 (unsigned long)loads[i],
+                 (unsigned long)before[i].avgUs[I], (unsigned long)before[i].p95Ms[I], (unsigned long)before[i].maxUs[I],
+                 (unsigned long)after[i].avgUs[I], (unsigned long)after[i].p95Ms[I], (unsigned long)after[i].maxUs[I]);
+        TEST_MESSAGE(msg);
+    }
+    for (size_t i = 0; i < LOADS; ++i) {
+        snprintf(msg, sizeof(msg), "  %3lu acks/s  with classes: routine avg %lu us p95 <=%lu ms, bulk avg %lu us, dropped %lu/%lu/%lu",
+                 (unsigned long)loads[i],
+                 (unsigned long)after[i].avgUs[1], (unsigned long)after[i].p95Ms[1], (unsigned long)after[i].avgUs[2],
+                 (unsigned long)after[i].dropped[0], (unsigned long)after[i].dropped[1], (unsigned long)after[i].dropped[2]);
+        TEST_MESSAGE(msg);
+    }
+
+    const LoadResult& idle = after[0];
+    const LoadResult& busiest = after[LOADS - 1];
+    // Flat: the ack load adds at most about a frame's airtime to light control
+    TEST_ASSERT_TRUE(busiest.avgUs[I] < idle.avgUs[I] + 1500);
+    TEST_ASSERT_TRUE(busiest.p95Ms[I] <= 5);
+    TEST_ASSERT_EQUAL_UINT32(0, busiest.dropped[I]);
+    // One class: light control queues behind the acks
+    TEST_ASSERT_TRUE(before[LOADS - 1].avgUs[I] > 2 * busiest.avgUs[I]);
+}
+
+void setup() {
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_per_peer_order_and_windows);
+    RUN_TEST(test_backpressure_when_full);
+    RUN_TEST(test_busy_driver_keeps_frames);
+    RUN_TEST(test_missing_completion_times_out);
+    RUN_TEST(test_classes_preempt_and_reserve);
+    RUN_TEST(test_burst_benchmark);
+    RUN_TEST(test_light_delay_under_ack_load);
+    UNITY_END();
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,205 @@
+#ifdef UNIT_TEST
+
+#include <Arduino.h>
+#include <unity.h>
+#include "EspNowMessage.h"
+
+// Representative frames as produced by the coordinator and nodes today
+static SetLightMessage sampleSetLight() {
+    SetLightMessage m;
+    m.cmd_id = "1234567-DDEEFF";
+    m.light_id = "";
+    m.r = 0; m.g = 255; m.b = 0; m.w = 0;
+    m.fade_ms = 200;
+    m.override_status = false;
+    m.ttl_ms = 1500;
+    m.pixel = -1;
+    return m;
+}
+
+static NodeStatusMessage sampleNodeStatus() {
+    NodeStatusMessage m;
+    m.node_id = "AA:BB:CC:DD:EE:FF";
+    m.light_id = "AA:BB:CC:DD:EE:FF";
+    m.avg_r = 12; m.avg_g = 34; m.avg_b = 56; m.avg_w = 255;
+    m.status_mode = "operational";
+    m.vbat_mv = 3700;
+    m.temperature = 23.45f;
+    m.button_pressed = true;
+    m.fw = "c3-1.0.0";
+    m.ts = 987654321UL;
+    return m;
+}
+
+static JoinAcceptMessage sampleJoinAccept() {
+    JoinAcceptMessage m;
+    m.node_id = "AA:BB:CC:DD:EE:FF";
+    m.light_id = "LDDEEFF";
+    m.lmk = "";
+    m.wifi_channel = 6;
+    m.cfg.rx_window_ms = 20;
+    m.cfg.rx_period_ms = 100;
+    m.bin_wire = true;
+    return m;
+}
+
+void test_set_light_binary_round_trip() {
+    SetLightMessage in = sampleSetLight();
+    in.pixel = 2;
+    in.override_status = true;
+    in.reason = "zone";
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = in.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_TRUE(WireCodec::isBinaryFrame(buf, n));
+
+    SetLightMessage out;
+    TEST_ASSERT_TRUE(out.fromBinary(buf, n));
+    TEST_ASSERT_EQUAL_STRING(in.cmd_id.c_str(), out.cmd_id.c_str());
+    TEST_ASSERT_EQUAL(in.g, out.g);
+    TEST_ASSERT_EQUAL(in.fade_ms, out.fade_ms);
+    TEST_ASSERT_EQUAL(in.ttl_ms, out.ttl_ms);
+    TEST_ASSERT_EQUAL(in.pixel, out.pixel);
+    TEST_ASSERT_TRUE(out.override_status);
+    TEST_ASSERT_EQUAL_STRING("zone", out.reason.c_str());
+}
+
+void test_node_status_binary_round_trip() {
+    NodeStatusMessage in = sampleNodeStatus();
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = in.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, n);
+
+    NodeStatusMessage out;
+    TEST_ASSERT_TRUE(out.fromBinary(buf, n));
+    TEST_ASSERT_EQUAL_STRING(in.node_id.c_str(), out.node_id.c_str());
+    TEST_ASSERT_EQUAL_STRING(in.status_mode.c_str(), out.status_mode.c_str());
+    TEST_ASSERT_EQUAL_STRING(in.fw.c_str(), out.fw.c_str());
+    TEST_ASSERT_EQUAL(in.avg_w, out.avg_w);
+    TEST_ASSERT_EQUAL(in.vbat_mv, out.vbat_mv);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, in.temperature, out.temperature);
+    TEST_ASSERT_TRUE(out.button_pressed);
+    TEST_ASSERT_EQUAL_UINT32(in.ts, out.ts);
+}
+
+void test_join_accept_and_ack_round_trip() {
+    JoinAcceptMessage in = sampleJoinAccept();
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = in.toBinary(buf, sizeof(buf));
+    JoinAcceptMessage out;
+    TEST_ASSERT_TRUE(out.fromBinary(buf, n));
+    TEST_ASSERT_EQUAL_STRING(in.light_id.c_str(), out.light_id.c_str());
+    TEST_ASSERT_EQUAL(6, out.wifi_channel);
+    TEST_ASSERT_EQUAL(100, out.cfg.rx_period_ms);
+    TEST_ASSERT_TRUE(out.bin_wire);
+
+    AckMessage ack;
+    ack.cmd_id = "telemetry_ack";
+    n = ack.toBinary(buf, sizeof(buf));
+    AckMessage ackOut;
+    TEST_ASSERT_TRUE(ackOut.fromBinary(buf, n));
+    TEST_ASSERT_EQUAL_STRING("telemetry_ack", ackOut.cmd_id.c_str());
+}
+
+void test_factory_accepts_both_codecs() {
+    NodeStatusMessage in = sampleNodeStatus();
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+
+    MessageSlot slot;
+
+    size_t n = in.encode(WireCodec::Format::BINARY, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, MessageFactory::getMessageType(buf, n));
+    EspNowMessage* m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, m->type);
+
+    n = in.encode(WireCodec::Format::JSON, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(WireCodec::isJsonFrame(buf, n));
+    m = slot.decode(buf, n);
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_EQUAL(MessageType::NODE_STATUS, m->type);
+}
+
+void test_truncated_binary_frame_rejected() {
+    SetLightMessage in = sampleSetLight();
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    size_t n = in.toBinary(buf, sizeof(buf));
+    SetLightMessage out;
+    TEST_ASSERT_FALSE(out.fromBinary(buf, n - 3));
+    // A frame of another type must not decode as set_light
+    AckMessage ack;
+    n = ack.toBinary(buf, sizeof(buf));
+    TEST_ASSERT_FALSE(out.fromBinary(buf, n));
+    // Encoding into a too-small buffer reports failure instead of truncating
+    TEST_ASSERT_EQUAL(0, in.toBinary(buf, 8));
+}
+
+// ---- Benchmark: bytes/frame and encode/decode time for both codecs ----
+
+static const int BENCH_ITERATIONS = 500;
+
+template <typename Msg>
+static void benchCodec(const char* name, const Msg& msg) {
+    uint8_t buf[WireCodec::MAX_FRAME_LEN];
+    Msg out;
+
+    String json = msg.toJson();
+    uint32_t t0 = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) json = msg.toJson();
+    uint32_t jsonEnc = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) out.fromJson(json);
+    uint32_t jsonDec = micros() - t0;
+
+    size_t binLen = msg.toBinary(buf, sizeof(buf));
+    t0 = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) binLen = msg.toBinary(buf, sizeof(buf));
+    uint32_t binEnc = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i) out.fromBinary(buf, binLen);
+    uint32_t binDec = micros() - t0;
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%-12s json %3u B enc %6lu ns dec %6lu ns | bin %3u B enc %6lu ns dec %6lu ns",
+             name,
+             (unsigned)json.length(),
+             (unsigned long)(jsonEnc * 1000UL / BENCH_ITERATIONS),
+             (unsigned long)(jsonDec * 1000UL / BENCH_ITERATIONS),
+             (unsigned)binLen,
+             (unsigned long)(binEnc * 1000UL / BENCH_ITERATIONS),
+             (unsigned long)(binDec * 1000UL / BENCH_ITERATIONS));
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_LESS_THAN(json.length(), binLen);
+}
+
+void test_benchmark_codecs() {
+    benchCodec("set_light", sampleSetLight());
+    benchCodec("node_status", sampleNodeStatus());
+    benchCodec("join_accept", sampleJoinAccept());
+    AckMessage ack;
+    ack.cmd_id = "telemetry_ack";
+    benchCodec("ack", ack);
+}
+
+void setup() {
+    delay(2000); // Wait for serial
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_set_light_binary_round_trip);
+    RUN_TEST(test_node_status_binary_round_trip);
+    RUN_TEST(test_join_accept_and_ack_round_trip);
+    RUN_TEST(test_factory_accepts_both_codecs);
+    RUN_TEST(test_truncated_binary_frame_rejected);
+    RUN_TEST(test_benchmark_codecs);
+
+    UNITY_END();
+}
+
+void loop() {
+    // Nothing to do here
+}
+
+#endif // UNIT_TEST
@@ -193,9 +193,17 @@ void loop() { app.loop(); }
 #include <esp_now.h>
 #include <esp_sleep.h>
 #include <esp_random.h>
+#include <esp_timer.h>
+#include <atomic>
 
 #include "EspNowMessage.h"
 #include "ConfigManager.h"
+#include "TelemetryDelta.h"
+#include "Fragmentation.h"
+#include "SpscRing.h"
+#include "TimeSync.h"
+#include "LightSchedule.h"
+#include "SeqWindow.h"
 // RGBW LED + button
 #include "led/LedController.h"
 #include "input/ButtonInput.h"
@@ -205,6 +213,30 @@ void loop() { app.loop(); }
 // Node state machine
 enum class NodeState { PAIRING, OPERATIONAL, UPDATE, REBOOT };
 
+// Frame copied out of the ESP-NOW receive callback, handled in loop()
+struct RxFrame {
+    uint8_t mac[6];
+    uint8_t channel;  // channel it arrived on, 0 if the driver did not say
+    bool broadcast;   // sent to FF:FF:FF:FF:FF:FF rather than to us
+    uint16_t len;
+    uint32_t rxMs;
+    uint8_t data[Fragmentation::localMaxFrameLen()];
+};
+
+// Time spent inside the receive callback (Wi-Fi task). Written by the callback,
+// read by loop() for the periodic RX stats line.
+struct CallbackTiming {
+    std::atomic<uint32_t> calls{0};
+    std::atomic<uint32_t> totalUs{0};
+    std::atomic<uint32_t> maxUs{0};
+
+    void record(uint32_t us) {
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        totalUs.store(totalUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+    }
+};
+
 // Forward declarations for ESP-NOW v2 static callbacks
 class SmartTileNode;
 static SmartTileNode* gNodeInstance = nullptr;
@@ -218,6 +250,7 @@ private:
     
     // ESP-NOW
     uint8_t coordinatorMac[6];
+    uint8_t selfMac[6] = {};         // station MAC; addresses our entry in light_batch frames
     bool espNowInitialized;
     uint8_t currentScanChannel;      // Current index in channel scan order
     uint32_t lastChannelScanTime;    // Last time we switched channels
@@ -244,6 +277,8 @@ private:
     // Channel management
     bool channelLocked = false; // Set to true once we find coordinator
     uint8_t lockedChannel = 0;  // The channel we locked to
+    uint8_t pendingChannel = 0; // Channel switch announced in the beacon, 0 = none
+    uint32_t channelSwitchAtMs = 0; // our millis() to switch at
     
     // Button
     ButtonInput button;
@@ -259,12 +294,76 @@ private:
     String lastCmdId;
     uint32_t lastCommandTime;
     
+    // Wire format negotiated in JOIN_ACCEPT (JSON until coordinator accepts binary)
+    bool binaryWire = false;
+    // Frame limit negotiated in JOIN_ACCEPT; larger messages go out as fragments
+    uint16_t coordinatorMaxFrame = WireCodec::MAX_FRAME_LEN;
+    // Short JSON keys once the coordinator has picked a dictionary for our firmware
+    uint8_t keyDict = KeyDictionary::NONE;
+    uint8_t fragmentSeq = 0;
+    Reassembler reassembler;
+    // Sequence numbers: ours (one count for everything we send), and windows
+    // over the coordinator's, which numbers broadcasts apart from unicasts
+    uint16_t txSeq = 0;
+    SeqWindow coordinatorSeq;
+    SeqWindow coordinatorBroadcastSeq;
+    SeqWindow::Stats seqStats = {};
+    uint8_t txScratch[WireCodec::MAX_MESSAGE_LEN];
+
+    // Reused decode target for received frames (no per-frame allocation)
+    MessageSlot rxSlot;
+    SetLightMessage batchCommand; // our entry expanded from a light_batch frame
+
+    // Coordinator heartbeat (beacon): last sequence seen
+    uint16_t lastBeaconSeq = 0;
+    uint32_t lastBeaconMs = 0;
+    uint16_t beaconPeriodMs = 0; // from the last beacon, 0 = none heard
+
+    // Beacons gone for BEACON_LOSS_PERIODS: the coordinator may have moved
+    // channel while we missed every announcement. Listen on each channel in
+    // turn for a little over a beacon period until one is heard, rather than
+    // waiting out COORDINATOR_TIMEOUT_MS and re-pairing.
+    static const uint8_t BEACON_LOSS_PERIODS = 5;
+    bool beaconSearch = false;
+    uint8_t searchChannel = 0;
+    uint32_t searchDwellUntilMs = 0;
+
+    // Coordinator timebase, refined by every telemetry ack
+    TimeSync coordinatorClock;
+    uint32_t rxFrameMs = 0; // receive time of the frame being processed
+    // set_light commands with an execute-at time, applied from loop()
+    LightSchedule lightSchedule;
+    // Wave test pattern, run from loop() from waveStartMs (local millis())
+    bool waveActive = false;
+    uint32_t waveStartMs = 0;
+    uint16_t wavePeriodMs = 0;
+    uint16_t waveDurationMs = 0;
+    uint8_t waveLevel = 0;
+
+    // The receive callback only copies frames in here; loop() does peer
+    // registration, NVS, LEDs and logging. Build with -DNODE_RX_INLINE to
+    // process inside the callback instead (for comparing callback time).
+    static constexpr size_t RX_QUEUE_SIZE = 8;
+    SpscRing<RxFrame, RX_QUEUE_SIZE> rxQueue;
+    CallbackTiming rxCallbackTiming;
+    std::atomic<uint32_t> txOk{0};
+    std::atomic<uint32_t> txFailed{0};
+    uint32_t txFailedReported = 0;
+    uint32_t lastRxStatsLog = 0;
+
+    // Delta telemetry against the last keyframe the coordinator acked (binary wire only)
+    TelemetryEncoder telemetryDelta{Defaults::TELEMETRY_KEYFRAME_S * 1000UL};
+    
 public:
     SmartTileNode();
     ~SmartTileNode();
     
     bool begin();
     void loop();
+
+    // Whether coordinator millis() is known to within
+    // TimeSync::TARGET_ERROR_MS (start_at / execute-at times are in it)
+    bool clockSynced() const { return coordinatorClock.synced(millis()); }
     
 private:
     // State machine
@@ -277,16 +376,33 @@ private:
     // ESP-NOW
     bool initEspNow();
 public:
-    // Expose callbacks for static trampolines
-    void onDataRecv(const uint8_t* mac, const uint8_t* data, int len);
+    // Expose callbacks for static trampolines (run in the Wi-Fi task)
+    void onDataRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len);
     void onDataSent(const uint8_t* mac, esp_now_send_status_t status);
 private:
+    void receiveFrame(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+    void drainRxQueue();
+    void handleReceivedFrame(const RxFrame& frame);
+    bool isDuplicate(const RxFrame& frame, const uint8_t* data, size_t len);
+    void logRxStats();
     bool sendMessage(const EspNowMessage& message, const uint8_t* destMac = nullptr);
-    void processReceivedMessage(const String& json);
+    bool sendBytes(const uint8_t* data, size_t len, const uint8_t* destMac = nullptr);
+    bool sendFrame(const uint8_t* target, const uint8_t* data, size_t len);
+    void processReceivedMessage(const uint8_t* data, size_t len);
     bool ensureEncryptedPeer(const uint8_t mac[6], const String& lmkHex);
+    // Retune and re-register the broadcast and coordinator peers there
+    void moveToChannel(uint8_t channel);
+    void runChannelSwitch();
+    void checkBeaconLoss();
     static bool parseHex16(const String& hex, uint8_t out[16]);
     
     // LED control
+    // ack = false for light_batch entries, which the coordinator does not track
+    void handleSetLight(const SetLightMessage& setLight, bool ack = true);
+    void applyLight(const LightSchedule::Action& action);
+    void runLightSchedule();
+    void startWave(const WaveMessage& wave);
+    void runWave();
     void applyColor(uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs);
     
     // Temperature sensing removed
@@ -335,7 +451,7 @@ SmartTileNode::SmartTileNode()
     , telemetryInterval(2)  // 2 seconds - balance between real-time updates and channel load
     , pairingStartTime(0)
     , inPairingMode(false)
-    , firmwareVersion("c3-1.0.0")
+    , firmwareVersion("c3-1.1.0")
     , lastCommandTime(0)
     , lastCoordinatorResponse(0)
     , telemetrySentCount(0) {
@@ -422,7 +538,11 @@ bool SmartTileNode::begin() {
 }
 
 void SmartTileNode::loop() {
+    drainRxQueue();
+    runChannelSwitch();
     handleButton();
+    runLightSchedule();
+    runWave();
     leds.update();
     
     switch (currentState) {
@@ -431,6 +551,7 @@ void SmartTileNode::loop() {
             break;
         case NodeState::OPERATIONAL:
             handleOperational();
+            checkBeaconLoss();
             checkCoordinatorConnection(); // Check if coordinator is still responsive
             break;
         // Derate state removed; coordinator handles thermal clamping
@@ -449,6 +570,8 @@ void SmartTileNode::loop() {
         telemetrySentCount++;
     }
     
+    logRxStats();
+    
     // Power management DISABLED - light sleep causes USB disconnect/reboot behavior
     // TODO: Re-enable for battery-powered nodes without USB
     // bool animating = leds.isAnimating();
@@ -458,8 +581,11 @@ void SmartTileNode::loop() {
     //     }
     // }
 
-    // Smaller delay when animating for smoother visuals
-    delay(leds.isAnimating() ? 1 : 10);
+    // Smaller delay when animating for smoother visuals, and wake in time
+    // for the next scheduled command
+    uint32_t idleMs = leds.isAnimating() ? 1 : 10;
+    uint32_t untilScheduled = lightSchedule.msUntilNext(millis());
+    delay(untilScheduled < idleMs ? untilScheduled : idleMs);
 }
 
 void SmartTileNode::handlePairing() {
@@ -517,6 +643,8 @@ void SmartTileNode::handlePairing() {
         joinReq.caps.temp_i2c = false;
         joinReq.caps.deep_sleep = true;
         joinReq.caps.button = true;
+        joinReq.caps.bin_wire = true;
+        joinReq.caps.max_frame = Fragmentation::localMaxFrameLen();
         joinReq.token = String(esp_random(), HEX);
 
         String payload = joinReq.toJson();
@@ -547,11 +675,23 @@ void SmartTileNode::handlePairing() {
             esp_now_add_peer(&peerInfo);
         }
         
-        esp_err_t result = esp_now_send(broadcastMac, (uint8_t*)payload.c_str(), payload.length());
+        // Numbered like everything else; the coordinator starts a new window
+        // for us on each JOIN_REQUEST, and we start one for whoever answers
+        coordinatorSeq.reset();
+        coordinatorBroadcastSeq.reset();
+        const uint8_t* frame = (const uint8_t*)payload.c_str();
+        size_t frameLen = WireCodec::stampSeq(frame, payload.length(), txSeq, txScratch, WireCodec::MAX_FRAME_LEN);
+        if (frameLen) {
+            txSeq++;
+            frame = txScratch;
+        } else {
+            frameLen = payload.length();
+        }
+        esp_err_t result = esp_now_send(broadcastMac, frame, frameLen);
         
         lastJoinRequest = millis();
         if (result == ESP_OK) {
-            logMessage("INFO", String("JOIN_REQUEST sent successfully (") + String(payload.length()) + " bytes)");
+            logMessage("INFO", String("JOIN_REQUEST sent successfully (") + String((int)frameLen) + " bytes)");
         } else {
             logMessage("ERROR", String("JOIN_REQUEST send failed: ") + String((int)result));
         }
@@ -597,6 +737,7 @@ bool SmartTileNode::initEspNow() {
     logMessage("INFO", "[2/9] Getting MAC address...");
     uint8_t mac[6];
     WiFi.macAddress(mac);
+    memcpy(selfMac, mac, sizeof(selfMac));
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -680,24 +821,115 @@ bool SmartTileNode::initEspNow() {
     logMessage("INFO", "[9/9] ESP-NOW v2.0 initialization complete");
     logMessage("INFO", "===========================================");
     
+    // Random start: after a reboot our numbers do not replay ones the coordinator just saw
+    txSeq = (uint16_t)esp_random();
     espNowInitialized = true;
     return true;
 }
 
-void SmartTileNode::onDataRecv(const uint8_t* mac, const uint8_t* data, int len) {
+void SmartTileNode::onDataRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+    int64_t start = esp_timer_get_time();
+    receiveFrame(info, data, len);
+    rxCallbackTiming.record((uint32_t)(esp_timer_get_time() - start));
+}
+
+void SmartTileNode::receiveFrame(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+    if (!info || !info->src_addr || !data || len <= 0 || len > (int)sizeof(RxFrame::data)) return;
+#ifdef NODE_RX_INLINE
+    static RxFrame inlineFrame;
+    RxFrame* frame = &inlineFrame;
+#else
+    RxFrame* frame = rxQueue.acquire();
+    if (!frame) return; // loop() is behind; counted by the queue
+#endif
+    memcpy(frame->mac, info->src_addr, 6);
+    frame->channel = info->rx_ctrl ? (uint8_t)info->rx_ctrl->channel : 0;
+    frame->broadcast = info->des_addr && (info->des_addr[0] & 0x01);
+    frame->len = (uint16_t)len;
+    frame->rxMs = millis();
+    memcpy(frame->data, data, len);
+#ifdef NODE_RX_INLINE
+    handleReceivedFrame(*frame);
+#else
+    rxQueue.publish();
+#endif
+}
+
+void SmartTileNode::onDataSent(const uint8_t* mac, esp_now_send_status_t status) {
+    std::atomic<uint32_t>& counter = (status == ESP_NOW_SEND_SUCCESS) ? txOk : txFailed;
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void SmartTileNode::drainRxQueue() {
+    while (RxFrame* frame = rxQueue.front()) {
+        handleReceivedFrame(*frame);
+        rxQueue.pop();
+    }
+}
+
+void SmartTileNode::logRxStats() {
+    uint32_t failed = txFailed.load(std::memory_order_relaxed);
+    if (failed != txFailedReported) {
+        logMessage("WARN", String("Message send failed (") + String(failed - txFailedReported) + " new, " +
+                   String(txOk.load(std::memory_order_relaxed)) + " ok total)");
+        txFailedReported = failed;
+    }
+    
+    if (millis() - lastRxStatsLog < 30000) return;
+    lastRxStatsLog = millis();
+    uint32_t calls = rxCallbackTiming.calls.load(std::memory_order_relaxed);
+    if (calls == 0) return;
+    auto q = rxQueue.stats();
+    char line[128];
+    snprintf(line, sizeof(line), "RX callback: %lu calls, avg %lu us, max %lu us | queue hwm %lu/%u, dropped %lu",
+             (unsigned long)calls,
+             (unsigned long)(rxCallbackTiming.totalUs.load(std::memory_order_relaxed) / calls),
+             (unsigned long)rxCallbackTiming.maxUs.load(std::memory_order_relaxed),
+             (unsigned long)q.highWater, (unsigned)rxQueue.capacity(), (unsigned long)q.dropped);
+    logMessage("INFO", line);
+    if (coordinatorClock.hasEstimate()) {
+        snprintf(line, sizeof(line), "Clock: offset %ld ms, drift %.1f ppm, error <= %lu ms, best rtt %lu ms",
+                 (long)coordinatorClock.offsetMs(millis()), coordinatorClock.driftPpm(),
+                 (unsigned long)coordinatorClock.errorMs(millis()),
+                 (unsigned long)coordinatorClock.bestRttMs());
+        logMessage("INFO", line);
+    }
+    if (seqStats.duplicates + seqStats.stale + seqStats.resyncs > 0) {
+        snprintf(line, sizeof(line), "Sequence: %lu duplicate(s) and %lu stale message(s) dropped, %lu resync(s)",
+                 (unsigned long)seqStats.duplicates, (unsigned long)seqStats.stale, (unsigned long)seqStats.resyncs);
+        logMessage("INFO", line);
+    }
+    const LightSchedule::Stats& sched = lightSchedule.stats();
+    if (sched.queued + sched.late + sched.refused > 0) {
+        snprintf(line, sizeof(line), "Scheduled set_light: %lu held, %lu late, %lu refused, %lu superseded",
+                 (unsigned long)sched.queued, (unsigned long)sched.late, (unsigned long)sched.refused,
+                 (unsigned long)sched.superseded);
+        logMessage("INFO", line);
+    }
+}
+
+void SmartTileNode::handleReceivedFrame(const RxFrame& frame) {
+    const uint8_t* mac = frame.mac;
+    const uint8_t* data = frame.data;
+    int len = frame.len;
+    rxFrameMs = frame.rxMs;
+
     // Log every received message for debugging
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     logMessage("DEBUG", String("RX ") + String(len) + "B from " + String(macStr));
-    
-    String message = String((char*)data, len);
-    logMessage("DEBUG", String("RX data: ") + message);
+    if (WireCodec::isJsonFrame(data, len)) {
+        logMessage("DEBUG", String("RX data: ") + String((const char*)data, len));
+    }
     
     // Get the channel we received this message on - this is the coordinator's channel!
-    uint8_t rxChannel = 0;
-    wifi_second_chan_t sec;
-    esp_wifi_get_channel(&rxChannel, &sec);
+    // Taken in the callback: during pairing we may have hopped since.
+    uint8_t rxChannel = frame.channel;
+    if (rxChannel == 0) {
+        wifi_second_chan_t sec;
+        esp_wifi_get_channel(&rxChannel, &sec);
+    }
     
     // Lock channel once we receive from coordinator (stops channel hopping)
     if (!channelLocked && rxChannel > 0) {
@@ -714,6 +946,8 @@ void SmartTileNode::onDataRecv(const uint8_t* mac, const uint8_t* data, int len)
     if (mac) {
         if (isNewCoordinator) {
             memcpy(coordinatorMac, mac, 6);
+            coordinatorSeq.reset();
+            coordinatorBroadcastSeq.reset();
             logMessage("INFO", String("Learned coordinator MAC: ") + String(macStr) + " on channel " + String(rxChannel));
         }
         
@@ -742,30 +976,46 @@ void SmartTileNode::onDataRecv(const uint8_t* mac, const uint8_t* data, int len)
         }
     }
     
-    // mark RX window and coordinator response
+    // mark RX window; the coordinator response (liveness) is only counted
+    // when it confirms our reports: a unicast ACK or our bit in a beacon
     lastRxWindow = millis();
-    lastCoordinatorResponse = millis();
-    telemetrySentCount = 0; // Reset counter on any response
     
-    processReceivedMessage(message);
+    // Fragments are held until the whole message is in
+    if (Fragmentation::isFragment(data, len)) {
+        size_t full = 0;
+        const uint8_t* message = reassembler.accept(mac, data, len, frame.rxMs, full);
+        if (message && !isDuplicate(frame, message, full)) processReceivedMessage(message, full);
+        return;
+    }
+    
+    if (!isDuplicate(frame, data, len)) processReceivedMessage(data, len);
 }
 
-void SmartTileNode::onDataSent(const uint8_t* mac, esp_now_send_status_t status) {
-    if (status == ESP_NOW_SEND_SUCCESS) {
-        logMessage("DEBUG", "Message sent successfully");
-    } else {
-        logMessage("WARN", "Message send failed");
-    }
+// A coordinator message we already handled (SeqWindow.h); messages sent
+// without a sequence number are always new. Only the coordinator's own count
+// is tracked: other tiles broadcast too (JOIN_REQUEST while pairing), each
+// with its own numbering, and must not move the coordinator's windows.
+bool SmartTileNode::isDuplicate(const RxFrame& frame, const uint8_t* data, size_t len) {
+    if (memcmp(frame.mac, coordinatorMac, 6) != 0) return false;
+    uint16_t seq = 0;
+    if (!WireCodec::readSeq(data, len, seq)) return false;
+    SeqWindow& window = frame.broadcast ? coordinatorBroadcastSeq : coordinatorSeq;
+    SeqWindow::Verdict verdict = window.accept(seq);
+    SeqWindow::count(verdict, seqStats);
+    if (SeqWindow::handle(verdict)) return false;
+    logMessage("DEBUG", String(verdict == SeqWindow::Verdict::DUPLICATE ? "Duplicate" : "Stale") +
+               " seq " + String(seq) + (frame.broadcast ? " (broadcast)" : "") + " dropped");
+    return true;
 }
 
-void SmartTileNode::processReceivedMessage(const String& json) {
+void SmartTileNode::processReceivedMessage(const uint8_t* data, size_t len) {
     // Ignore health check pings from coordinator (not part of ESP-NOW message protocol)
-    if (json.indexOf("\"ping\"") >= 0 || json.indexOf("\"pairing_ping\"") >= 0) {
+    MessageType kind = MessageFactory::getMessageType(data, len);
+    if (kind == MessageType::PING || kind == MessageType::PAIRING_PING) {
         // Silently ignore - these are just keep-alive messages
         return;
     }
-    
-    EspNowMessage* message = MessageFactory::createMessage(json);
+    EspNowMessage* message = rxSlot.decode(data, len);
     if (!message) {
         logMessage("ERROR", "Failed to parse message");
         return;
@@ -776,6 +1026,10 @@ void SmartTileNode::processReceivedMessage(const String& json) {
             JoinAcceptMessage* accept = static_cast<JoinAcceptMessage*>(message);
             nodeId = accept->node_id;
             lightId = accept->light_id;
+            binaryWire = accept->bin_wire;
+            coordinatorMaxFrame = accept->max_frame;
+            keyDict = accept->key_dict;
+            telemetryDelta.reset(); // coordinator dropped our baseline on join
             
             config.setString(ConfigKeys::NODE_ID, nodeId);
             config.setString(ConfigKeys::LIGHT_ID, lightId);
@@ -788,34 +1042,7 @@ void SmartTileNode::processReceivedMessage(const String& json) {
             // CRITICAL: Switch to coordinator's WiFi channel
             if (accept->wifi_channel > 0 && accept->wifi_channel <= 13) {
                 logMessage("INFO", String("Switching to coordinator's WiFi channel: ") + String(accept->wifi_channel));
-                esp_wifi_set_promiscuous(true);
-                esp_wifi_set_channel(accept->wifi_channel, WIFI_SECOND_CHAN_NONE);
-                esp_wifi_set_promiscuous(false);
-                
-                // Remove ALL peers before switching
-                uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-                esp_now_del_peer(broadcast);
-                if (coordinatorMac[0] != 0) {
-                    esp_now_del_peer(coordinatorMac);
-                }
-                
-                // Re-add broadcast peer on new channel
-                esp_now_peer_info_t bcastPeer = {};
-                memcpy(bcastPeer.peer_addr, broadcast, 6);
-                bcastPeer.channel = accept->wifi_channel;
-                bcastPeer.encrypt = false;
-                bcastPeer.ifidx = WIFI_IF_STA;
-                esp_now_add_peer(&bcastPeer);
-                
-                // Re-add coordinator peer on new channel
-                esp_now_peer_info_t coordPeer = {};
-                memcpy(coordPeer.peer_addr, coordinatorMac, 6);
-                coordPeer.channel = accept->wifi_channel;
-                coordPeer.encrypt = false;
-                coordPeer.ifidx = WIFI_IF_STA;
-                esp_now_add_peer(&coordPeer);
-                
-                logMessage("INFO", String("All peers updated to channel ") + String(accept->wifi_channel));
+                moveToChannel(accept->wifi_channel);
             } else {
                 // No channel switch needed, just ensure coordinator peer exists
                 ensureEncryptedPeer(coordinatorMac, accept->lmk);
@@ -837,62 +1064,67 @@ void SmartTileNode::processReceivedMessage(const String& json) {
             break;
         }
         case MessageType::SET_LIGHT: {
-            SetLightMessage* setLight = static_cast<SetLightMessage*>(message);
-            // Accept command if light_id matches OR if light_id is empty (broadcast/any)
-            if (setLight->light_id == lightId || setLight->light_id.isEmpty()) {
-                // Only transition to OPERATIONAL if we have valid credentials (received JOIN_ACCEPT before)
-                // This prevents incorrect transitions from stray broadcasts
-                if ((currentState == NodeState::PAIRING || inPairingMode) && !lightId.isEmpty()) {
-                    logMessage("INFO", "Received command while pairing with valid credentials - switching to OPERATIONAL");
-                    currentState = NodeState::OPERATIONAL;
-                    stopPairing();
-                } else if (currentState == NodeState::PAIRING && lightId.isEmpty()) {
-                    // Ignore commands if we don't have a lightId yet - wait for JOIN_ACCEPT
-                    logMessage("WARN", "Ignoring set_light - no lightId yet, waiting for JOIN_ACCEPT");
-                    delete message;
-                    return;
-                }
-                
-                // Always clear status animation when receiving manual commands
-                leds.setStatus(LedController::StatusMode::None);
-                statusOverrideActive = true;
-                statusOverrideUntilMs = millis() + (setLight->ttl_ms > 0 ? setLight->ttl_ms : 10000);
-
-                uint8_t r = setLight->r, g = setLight->g, b = setLight->b, w = setLight->w;
-                if (r == 0 && g == 0 && b == 0 && w == 0) {
-                    // fallback: map value to white channel
-                    w = setLight->value;
-                }
-                
-                // Check if this is a per-pixel command or all pixels
-                if (setLight->pixel >= 0 && setLight->pixel < leds.numPixels()) {
-                    // Per-pixel control
-                    leds.setPixelColor(setLight->pixel, r, g, b, w);
-                    leds.show();
-                    // Update current color tracking (use this pixel's color for telemetry)
-                    curR = r; curG = g; curB = b; curW = w;
-                    logMessage("INFO", String("Set pixel ") + String(setLight->pixel) + " to RGBW(" + String(r) + "," + String(g) + "," + String(b) + "," + String(w) + ")");
-                } else {
-                    // All pixels
-                    applyColor(r, g, b, w, setLight->fade_ms);
-                }
-                
-                lastCmdId = setLight->cmd_id;
-                lastCommandTime = millis();
-                
-                // Send acknowledgment
+            handleSetLight(*static_cast<SetLightMessage*>(message));
+            break;
+        }
+        case MessageType::SET_LIGHT_BATCH: {
+            // Broadcast to many nodes; apply only the entry addressed to us
+            SetLightBatchMessage* batch = static_cast<SetLightBatchMessage*>(message);
+            if (batch->extract(selfMac, batchCommand)) {
+                handleSetLight(batchCommand, false);
+            }
+            break;
+        }
+        case MessageType::BEACON: {
+            // Heartbeat: coordinator MAC/channel were taken from the frame
+            // itself; answer only if the coordinator asked us. Hearing a beacon
+            // proves only the downlink, so liveness needs our heard bit
+            BeaconMessage* beacon = static_cast<BeaconMessage*>(message);
+            lastBeaconSeq = beacon->seq;
+            lastBeaconMs = millis();
+            beaconPeriodMs = beacon->period_ms;
+            if (beaconSearch) {
+                beaconSearch = false;
+                logMessage("INFO", String("Coordinator found on channel ") + String(searchChannel));
+            }
+            if (beacon->heardFrom(selfMac)) {
+                // Coalesced telemetry ack: the coordinator still hears us
+                lastCoordinatorResponse = millis();
+                telemetrySentCount = 0;
+            }
+            if (currentState == NodeState::OPERATIONAL && beacon->wantsReply(selfMac)) {
                 AckMessage ack;
-                ack.cmd_id = setLight->cmd_id;
+                beacon->replyId(ack.cmd_id);
                 sendMessage(ack);
-                
-                logMessage("INFO", "Received set_light command");
             }
+            // Announced channel switch: at the same instant as the coordinator,
+            // counted from this beacon's timestamp (every repeat names the same one)
+            uint32_t lead = beacon->switch_at_ms - beacon->time_ms;
+            if (beacon->switch_channel >= 1 && beacon->switch_channel <= 13 &&
+                lead <= BeaconMessage::MAX_SWITCH_LEAD_MS) {
+                if (pendingChannel != beacon->switch_channel) {
+                    logMessage("INFO", String("Channel switch to ") + String(beacon->switch_channel) +
+                               " in " + String(lead) + " ms");
+                }
+                pendingChannel = beacon->switch_channel;
+                channelSwitchAtMs = rxFrameMs + lead;
+            }
+            break;
+        }
+        case MessageType::WAVE: {
+            startWave(*static_cast<WaveMessage*>(message));
             break;
         }
         case MessageType::ACK: {
             // Coordinator acknowledged our telemetry - reset connection timeout
             lastCoordinatorResponse = millis();
             telemetrySentCount = 0;
+            AckMessage* ack = static_cast<AckMessage*>(message);
+            telemetryDelta.onAck(*ack);
+            // Telemetry acks close a round trip: our ts out, coordinator stamps back
+            if (ack->hasClock() && ack->echo_ts != 0) {
+                coordinatorClock.addExchange(ack->echo_ts, ack->coord_ms - ack->hold_ms, ack->coord_ms, rxFrameMs);
+            }
             logMessage("DEBUG", "Received ACK from coordinator");
             break;
         }
@@ -900,8 +1132,145 @@ void SmartTileNode::processReceivedMessage(const String& json) {
             logMessage("WARN", "Unknown message type received");
             break;
     }
-    
-    delete message;
+}
+
+void SmartTileNode::handleSetLight(const SetLightMessage& setLight, bool ack) {
+    // Accept command if light_id matches OR if light_id is empty (broadcast/any)
+    if (setLight.light_id == lightId || setLight.light_id.isEmpty()) {
+        // Only transition to OPERATIONAL if we have valid credentials (received JOIN_ACCEPT before)
+        // This prevents incorrect transitions from stray broadcasts
+        if ((currentState == NodeState::PAIRING || inPairingMode) && !lightId.isEmpty()) {
+            logMessage("INFO", "Received command while pairing with valid credentials - switching to OPERATIONAL");
+            currentState = NodeState::OPERATIONAL;
+            stopPairing();
+        } else if (currentState == NodeState::PAIRING && lightId.isEmpty()) {
+            // Ignore commands if we don't have a lightId yet - wait for JOIN_ACCEPT
+            logMessage("WARN", "Ignoring set_light - no lightId yet, waiting for JOIN_ACCEPT");
+            return;
+        }
+        
+        // Retransmit of a command already applied (our ack was lost): ack again only
+        if (!setLight.cmd_id.isEmpty() && setLight.cmd_id == lastCmdId) {
+            if (ack) {
+                AckMessage reply;
+                reply.cmd_id = setLight.cmd_id;
+                sendMessage(reply);
+            }
+            return;
+        }
+        
+        LightSchedule::Action action;
+        action.r = setLight.r; action.g = setLight.g; action.b = setLight.b; action.w = setLight.w;
+        if (action.r == 0 && action.g == 0 && action.b == 0 && action.w == 0) {
+            // fallback: map value to white channel
+            action.w = setLight.value;
+        }
+        action.fade_ms = setLight.fade_ms;
+        action.pixel = setLight.pixel;
+
+        // Execute-at commands wait for their instant in the coordinator
+        // timebase; without a synced clock we cannot tell when that is
+        uint32_t now = millis();
+        bool held = false;
+        action.dueMs = now;
+        if (setLight.at_ms != 0 && clockSynced()) {
+            action.dueMs = coordinatorClock.toLocal(setLight.at_ms);
+            held = lightSchedule.add(action, now);
+        }
+
+        // Always clear status animation when receiving manual commands
+        leds.setStatus(LedController::StatusMode::None);
+        statusOverrideActive = true;
+        statusOverrideUntilMs = (held ? action.dueMs : now) + (setLight.ttl_ms > 0 ? setLight.ttl_ms : 10000);
+
+        if (!held) {
+            // Newest command wins: older held ones must not overwrite it later
+            lightSchedule.supersede();
+            applyLight(action);
+        }
+        
+        lastCmdId = setLight.cmd_id;
+        lastCommandTime = millis();
+        
+        // Send acknowledgment
+        if (ack) {
+            AckMessage reply;
+            reply.cmd_id = setLight.cmd_id;
+            sendMessage(reply);
+        }
+        
+        logMessage("INFO", "Received set_light command");
+    }
+}
+
+void SmartTileNode::applyLight(const LightSchedule::Action& action) {
+    // A light command ends a running wave
+    waveActive = false;
+    // Check if this is a per-pixel command or all pixels
+    if (action.pixel >= 0 && action.pixel < leds.numPixels()) {
+        // Per-pixel control
+        leds.setPixelColor(action.pixel, action.r, action.g, action.b, action.w);
+        leds.show();
+        // Update current color tracking (use this pixel's color for telemetry)
+        curR = action.r; curG = action.g; curB = action.b; curW = action.w;
+        logMessage("INFO", String("Set pixel ") + String(action.pixel) + " to RGBW(" + String(action.r) + "," +
+                   String(action.g) + "," + String(action.b) + "," + String(action.w) + ")");
+    } else {
+        // All pixels
+        applyColor(action.r, action.g, action.b, action.w, action.fade_ms);
+    }
+}
+
+void SmartTileNode::runLightSchedule() {
+    LightSchedule::Action action;
+    while (lightSchedule.popDue(millis(), action)) {
+        applyLight(action);
+    }
+}
+
+void SmartTileNode::startWave(const WaveMessage& wave) {
+    if (lightId.isEmpty() || wave.period_ms == 0) return;
+    // start_at is the same instant on every synced node, held like an
+    // execute-at set_light; without a synced clock (or a start implausibly
+    // far out) start on receipt, out of step with the others
+    uint32_t now = millis();
+    waveStartMs = now;
+    if (wave.start_at != 0 && clockSynced()) {
+        uint32_t due = coordinatorClock.toLocal(wave.start_at);
+        if ((int32_t)(due - now) <= (int32_t)LightSchedule::MAX_LEAD_MS) waveStartMs = due;
+    }
+    wavePeriodMs = wave.period_ms;
+    waveDurationMs = wave.duration_ms;
+    waveLevel = 0;
+    waveActive = true;
+    // Held light commands would cut the wave short
+    lightSchedule.supersede();
+
+    leds.setStatus(LedController::StatusMode::None);
+    statusOverrideActive = true;
+    statusOverrideUntilMs = waveStartMs + waveDurationMs;
+    logMessage("INFO", String("Wave in ") + String((int32_t)(waveStartMs - now)) + " ms for " +
+               String(waveDurationMs) + " ms");
+}
+
+void SmartTileNode::runWave() {
+    if (!waveActive) return;
+    int32_t elapsed = (int32_t)(millis() - waveStartMs);
+    if (elapsed < 0) return;
+    if ((uint32_t)elapsed >= waveDurationMs) {
+        // Back to the last commanded color
+        waveActive = false;
+        leds.setColor(curR, curG, curB, curW);
+        return;
+    }
+    // Triangle wave 0..1..0 on the white channel, one cycle per period
+    float t = ((uint32_t)elapsed % wavePeriodMs) / (float)wavePeriodMs;
+    float tri = t < 0.5f ? (t * 2.0f) : (2.0f - t * 2.0f);
+    uint8_t level = (uint8_t)(tri * 255);
+    if (level != waveLevel) {
+        waveLevel = level;
+        leds.setColor(0, 0, 0, level);
+    }
 }
 
 void SmartTileNode::applyColor(uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs) {
@@ -977,7 +1346,17 @@ void SmartTileNode::sendTelemetry() {
         logMessage("WARN", "TMP117 not available - reporting 0.0C");
     }
     
-    sendMessage(status);
+    uint32_t clockErr = coordinatorClock.errorMs(millis());
+    status.clock_err_ms = clockErr == UINT32_MAX ? 0 : (clockErr > 255 ? 255 : (uint8_t)clockErr);
+    // Stamped last: the coordinator's ack measures the round trip from here
+    status.ts = millis();
+    
+    // Binary peers get keyframes plus deltas; JSON peers keep the full message
+    if (binaryWire) {
+        sendMessage(telemetryDelta.next(status, millis()));
+    } else {
+        sendMessage(status);
+    }
 }
 
 uint16_t SmartTileNode::readBatteryVoltage() {
@@ -1017,14 +1396,32 @@ String SmartTileNode::getMacAddress() {
 }
 
 bool SmartTileNode::sendMessage(const EspNowMessage& message, const uint8_t* destMac) {
-    String json = message.toJson();
+    uint8_t frame[WireCodec::MAX_FRAME_LEN];
+    size_t len = message.encode(binaryWire ? WireCodec::Format::BINARY : WireCodec::Format::JSON,
+                                frame, sizeof(frame), keyDict);
     
     // ✓ Checklist: Message Size - Check before sending
-    if (json.length() > 250) {
-        logMessage("ERROR", String("Message too large: ") + String(json.length()) + " bytes");
+    if (len == 0) {
+        logMessage("ERROR", String("Message too large: ") + message.msg.c_str() + " exceeds " + String((int)sizeof(frame)) + " bytes");
+        return false;
+    }
+    return sendBytes(frame, len, destMac);
+}
+
+bool SmartTileNode::sendBytes(const uint8_t* data, size_t len, const uint8_t* destMac) {
+    if (len > WireCodec::MAX_MESSAGE_LEN) {
+        logMessage("ERROR", String("Payload too large: ") + String((int)len) + " bytes");
         return false;
     }
     
+    // Numbered as a whole, so fragments are checked once reassembled
+    size_t stamped = WireCodec::stampSeq(data, len, txSeq, txScratch, sizeof(txScratch));
+    if (stamped) {
+        txSeq++;
+        data = txScratch;
+        len = stamped;
+    }
+    
     const uint8_t* target = destMac;
     uint8_t broadcast[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
     if (!target) {
@@ -1033,6 +1430,16 @@ bool SmartTileNode::sendMessage(const EspNowMessage& message, const uint8_t* des
         target = known ? coordinatorMac : broadcast;
     }
     
+    // Frame limit only applies to the coordinator; anyone else gets v1-sized frames
+    size_t maxFrame = (memcmp(target, coordinatorMac, 6) == 0) ? coordinatorMaxFrame : WireCodec::MAX_FRAME_LEN;
+    if (len <= maxFrame) {
+        return sendFrame(target, data, len);
+    }
+    return Fragmentation::send(data, len, maxFrame, ++fragmentSeq,
+                               [this, target](const uint8_t* frame, size_t n) { return sendFrame(target, frame, n); });
+}
+
+bool SmartTileNode::sendFrame(const uint8_t* target, const uint8_t* data, size_t len) {
     // CRITICAL: Ensure peer exists before sending
     if (!esp_now_is_peer_exist(target)) {
         // Add peer if it doesn't exist
@@ -1051,7 +1458,7 @@ bool SmartTileNode::sendMessage(const EspNowMessage& message, const uint8_t* des
     }
     
     // ✓ Checklist: Use native ESP-NOW v2 API
-    esp_err_t res = esp_now_send(target, (uint8_t*)json.c_str(), json.length());
+    esp_err_t res = esp_now_send(target, data, len);
     if (res != ESP_OK) {
         logMessage("WARN", String("esp_now_send failed: ") + String((int)res));
         return false;
@@ -1085,6 +1492,72 @@ bool SmartTileNode::ensureEncryptedPeer(const uint8_t mac[6], const String& /*lm
     return false;
 }
 
+void SmartTileNode::moveToChannel(uint8_t channel) {
+    esp_wifi_set_promiscuous(true);
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    esp_wifi_set_promiscuous(false);
+    
+    // Remove ALL peers before switching
+    uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    esp_now_del_peer(broadcast);
+    if (coordinatorMac[0] != 0) {
+        esp_now_del_peer(coordinatorMac);
+    }
+    
+    // Re-add broadcast peer on new channel
+    esp_now_peer_info_t bcastPeer = {};
+    memcpy(bcastPeer.peer_addr, broadcast, 6);
+    bcastPeer.channel = channel;
+    bcastPeer.encrypt = false;
+    bcastPeer.ifidx = WIFI_IF_STA;
+    esp_now_add_peer(&bcastPeer);
+    
+    // Re-add coordinator peer on new channel
+    esp_now_peer_info_t coordPeer = {};
+    memcpy(coordPeer.peer_addr, coordinatorMac, 6);
+    coordPeer.channel = channel;
+    coordPeer.encrypt = false;
+    coordPeer.ifidx = WIFI_IF_STA;
+    esp_now_add_peer(&coordPeer);
+    
+    if (channelLocked) lockedChannel = channel;
+    logMessage("INFO", String("All peers updated to channel ") + String(channel));
+}
+
+void SmartTileNode::runChannelSwitch() {
+    if (pendingChannel == 0 || (int32_t)(millis() - channelSwitchAtMs) < 0) return;
+    uint8_t channel = pendingChannel;
+    pendingChannel = 0;
+    uint8_t current = 0;
+    wifi_second_chan_t second = WIFI_SECOND_CHAN_NONE;
+    esp_wifi_get_channel(&current, &second);
+    if (channel == current) return;
+    logMessage("INFO", String("Coordinated channel switch: ") + String(current) + " -> " + String(channel));
+    moveToChannel(channel);
+}
+
+void SmartTileNode::checkBeaconLoss() {
+    // Nothing to go by until a beacon has told us the period; an announced
+    // switch already says where the coordinator is going
+    if (beaconPeriodMs == 0 || pendingChannel != 0) return;
+    uint32_t now = millis();
+    if (!beaconSearch) {
+        if (now - lastBeaconMs < (uint32_t)BEACON_LOSS_PERIODS * beaconPeriodMs) return;
+        uint8_t current = 0;
+        wifi_second_chan_t second = WIFI_SECOND_CHAN_NONE;
+        esp_wifi_get_channel(&current, &second);
+        logMessage("WARN", String("No beacon for ") + String(now - lastBeaconMs) + " ms, searching channels");
+        beaconSearch = true;
+        searchChannel = current;
+        searchDwellUntilMs = now;
+    }
+    if ((int32_t)(now - searchDwellUntilMs) < 0) return;
+    // Every channel the coordinator can announce, starting after the current one
+    searchChannel = searchChannel % 13 + 1;
+    moveToChannel(searchChannel);
+    searchDwellUntilMs = now + beaconPeriodMs + beaconPeriodMs / 4;
+}
+
 bool SmartTileNode::parseHex16(const String& hex, uint8_t out[16]) {
     if (!out) return false;
     String s = hex;
@@ -1124,6 +1597,11 @@ void SmartTileNode::checkCoordinatorConnection() {
         // Reset counters
         lastCoordinatorResponse = millis();
         telemetrySentCount = 0;
+        // The coordinator may have moved channel without us (a missed switch
+        // announcement): hop again to find it
+        channelLocked = false;
+        beaconSearch = false;
+        beaconPeriodMs = 0;
         
         // Switch to pairing mode
         currentState = NodeState::PAIRING;
@@ -1166,9 +1644,7 @@ void loop() {
 
 // Static trampolines for ESP-NOW v2 callbacks
 static void espnowRecv(const esp_now_recv_info_t* recv_info, const uint8_t* data, int len) {
-    if (gNodeInstance && recv_info && recv_info->src_addr) {
-        gNodeInstance->onDataRecv(recv_info->src_addr, data, len);
-    }
+    if (gNodeInstance) gNodeInstance->onDataRecv(recv_info, data, len);
 }
 static void espnowSent(const uint8_t* mac, esp_now_send_status_t status) {
     if (gNodeInstance) gNodeInstance->onDataSent(mac, status);
@@ -39,6 +39,7 @@ namespace Defaults {
     static constexpr int PWM_FREQ_HZ         = 1000;
     static constexpr int PWM_RESOLUTION_BITS = 12;
     static constexpr int TELEMETRY_INTERVAL_S= 1;
+    static constexpr int TELEMETRY_KEYFRAME_S= 30; // full node_status between deltas
     static constexpr int RX_WINDOW_MS        = 20;
     static constexpr int RX_PERIOD_MS        = 100;
     static constexpr float DERATE_START_C    = 70.0f;
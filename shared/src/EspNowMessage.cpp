@@ -1,260 +1,499 @@
 #include "EspNowMessage.h"
 
-// --- JoinRequest ---
-JoinRequestMessage::JoinRequestMessage() {
-	type = MessageType::JOIN_REQUEST;
-	msg = "join_request";
-	ts = millis();
+namespace {
+	uint32_t s_parseCount = 0;
+
+	// ---- Message name classifier ----
+	// Every "msg" value the firmware sends, hashed at compile time into a
+	// 16-slot table. The seed is searched for by the compiler so adding a name
+	// that collides fails the build instead of misclassifying at runtime.
+	struct MessageName {
+		const char* name;
+		uint8_t len;
+		MessageType type;
+	};
+
+	constexpr MessageName kMessageNames[] = {
+		{"join_request", 12, MessageType::JOIN_REQUEST},
+		{"join_accept", 11, MessageType::JOIN_ACCEPT},
+		{"set_light", 9, MessageType::SET_LIGHT},
+		{"node_status", 11, MessageType::NODE_STATUS},
+		{"error", 5, MessageType::ERROR},
+		{"ack", 3, MessageType::ACK},
+		{"ping", 4, MessageType::PING},
+		{"pairing_ping", 12, MessageType::PAIRING_PING},
+		{"wave", 4, MessageType::WAVE},
+		{"status_delta", 12, MessageType::NODE_STATUS_DELTA},
+		{"light_batch", 11, MessageType::SET_LIGHT_BATCH},
+		{"beacon", 6, MessageType::BEACON},
+	};
+	constexpr size_t kNameCount = sizeof(kMessageNames) / sizeof(kMessageNames[0]);
+	constexpr size_t kNameTableSize = 16;
+	constexpr size_t kMaxNameLen = 16;
+	constexpr uint8_t kEmptySlot = 0xFF;
+
+	constexpr size_t nameHash(const char* s, size_t n, uint32_t seed) {
+		uint32_t h = seed ^ (uint32_t)n;
+		h = h * 31u + (uint8_t)s[0];
+		h = h * 31u + (uint8_t)s[n / 2];
+		h = h * 31u + (uint8_t)s[n - 1];
+		return (h ^ (h >> 7)) & (kNameTableSize - 1);
+	}
+
+	constexpr bool seedIsPerfect(uint32_t seed) {
+		bool used[kNameTableSize] = {};
+		for (size_t i = 0; i < kNameCount; ++i) {
+			size_t slot = nameHash(kMessageNames[i].name, kMessageNames[i].len, seed);
+			if (used[slot]) return false;
+			used[slot] = true;
+		}
+		return true;
+	}
+
+	constexpr uint32_t findSeed() {
+		for (uint32_t seed = 0; seed < 4096; ++seed) {
+			if (seedIsPerfect(seed)) return seed;
+		}
+		return 0xFFFFFFFFu;
+	}
+
+	constexpr uint32_t kNameSeed = findSeed();
+	static_assert(kNameSeed != 0xFFFFFFFFu, "no perfect hash seed for message names");
+
+	struct NameTable {
+		uint8_t slot[kNameTableSize];
+	};
+
+	constexpr NameTable buildNameTable() {
+		NameTable t = {};
+		for (size_t i = 0; i < kNameTableSize; ++i) t.slot[i] = kEmptySlot;
+		for (size_t i = 0; i < kNameCount; ++i) {
+			t.slot[nameHash(kMessageNames[i].name, kMessageNames[i].len, kNameSeed)] = (uint8_t)i;
+		}
+		return t;
+	}
+
+	constexpr NameTable kNameTable = buildNameTable();
+
+	MessageType lookupName(const char* s, size_t n) {
+		if (!s || n == 0 || n > kMaxNameLen) return MessageType::UNKNOWN;
+		uint8_t idx = kNameTable.slot[nameHash(s, n, kNameSeed)];
+		if (idx == kEmptySlot) return MessageType::UNKNOWN;
+		const MessageName& e = kMessageNames[idx];
+		if (e.len != n || memcmp(e.name, s, n) != 0) return MessageType::UNKNOWN;
+		return e.type;
+	}
+
+	inline bool isJsonSpace(uint8_t c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	// Find the "msg" key in a JSON frame and return its string value in place.
+	// Values with escapes are rejected; no message name needs them.
+	const char* findMsgValue(const uint8_t* data, size_t len, size_t& outLen) {
+		outLen = 0;
+		for (size_t i = 0; i + 5 <= len; ++i) {
+			if (data[i] != '"' || data[i + 1] != 'm' || data[i + 2] != 's' ||
+			    data[i + 3] != 'g' || data[i + 4] != '"') {
+				continue;
+			}
+			size_t p = i + 5;
+			while (p < len && isJsonSpace(data[p])) ++p;
+			if (p >= len || data[p] != ':') continue; // "msg" used as a value
+			++p;
+			while (p < len && isJsonSpace(data[p])) ++p;
+			if (p >= len || data[p] != '"') return nullptr;
+			size_t start = ++p;
+			while (p < len && data[p] != '"') {
+				if (data[p] == '\\') return nullptr;
+				if (p - start > kMaxNameLen) return nullptr;
+				++p;
+			}
+			if (p >= len) return nullptr;
+			outLen = p - start;
+			return (const char*)(data + start);
+		}
+		return nullptr;
+	}
+
+	// Validate a binary header of the expected type
+	bool readHeader(WireCodec::Reader& r, MessageType expected) {
+		MessageFactory::noteParse();
+		uint8_t t = 0, flags = 0;
+		if (!r.header(t, flags)) return false;
+		return t == (uint8_t)expected;
+	}
+
+	template <typename Msg>
+	void initMessage(Msg& m) {
+		m.type = Msg::TYPE;
+		m.msg = Msg::NAME;
+		MessageSchema::reset(m);
+		m.ts = millis();
+	}
+
+	template <typename Msg>
+	String jsonOf(const Msg& m, uint8_t dict) {
+		DynamicJsonDocument doc(512);
+		MessageSchema::writeJson(m, doc, dict);
+		String out; serializeJson(doc, out); return out;
+	}
+
+	template <typename Msg>
+	size_t binaryOf(const Msg& m, uint8_t* out, size_t cap) {
+		if (!Msg::HAS_BINARY) return 0;
+		WireCodec::Writer wr(out, cap);
+		wr.header((uint8_t)Msg::TYPE);
+		MessageSchema::writeBinary(m, wr);
+		return wr.length();
+	}
+
+	template <typename Msg>
+	bool readBinaryFrame(Msg& m, const uint8_t* data, size_t len) {
+		if (!Msg::HAS_BINARY) return false;
+		WireCodec::Reader rd(data, len);
+		if (!readHeader(rd, Msg::TYPE)) return false;
+		return MessageSchema::readBinary(m, rd);
+	}
+
+	// status_delta: base key and field mask, then only the masked fields
+	size_t binaryOf(const NodeStatusDeltaMessage& m, uint8_t* out, size_t cap) {
+		WireCodec::Writer wr(out, cap);
+		wr.header((uint8_t)NodeStatusDeltaMessage::TYPE);
+		MessageSchema::writeBinary(m, wr);
+		MessageSchema::writeMasked(m.fields, m.mask, wr);
+		return wr.length();
+	}
+
+	bool readBinaryFrame(NodeStatusDeltaMessage& m, const uint8_t* data, size_t len) {
+		WireCodec::Reader rd(data, len);
+		if (!readHeader(rd, NodeStatusDeltaMessage::TYPE)) return false;
+		if (!MessageSchema::readBinary(m, rd)) return false;
+		return MessageSchema::readMasked(m.fields, m.mask, rd);
+	}
+
+	// light_batch: batch fields, entry count, fixed-size entries, then at_ms if
+	// set (older nodes stop after the entries and apply on receipt)
+	size_t binaryOf(const SetLightBatchMessage& m, uint8_t* out, size_t cap) {
+		WireCodec::Writer wr(out, cap);
+		wr.header((uint8_t)SetLightBatchMessage::TYPE);
+		MessageSchema::writeBinary(m, wr);
+		uint8_t n = m.count < SetLightBatchMessage::MAX_ENTRIES ? m.count : SetLightBatchMessage::MAX_ENTRIES;
+		wr.u8(n);
+		for (uint8_t i = 0; i < n; ++i) {
+			const SetLightBatchMessage::Entry& e = m.entries[i];
+			wr.u8(e.node[0]); wr.u8(e.node[1]); wr.u8(e.node[2]);
+			wr.u8(e.r); wr.u8(e.g); wr.u8(e.b); wr.u8(e.w);
+			wr.u16(e.fade_ms);
+			wr.i8(e.pixel);
+		}
+		if (m.at_ms != 0) wr.u32(m.at_ms);
+		return wr.length();
+	}
+
+	bool readBinaryFrame(SetLightBatchMessage& m, const uint8_t* data, size_t len) {
+		WireCodec::Reader rd(data, len);
+		if (!readHeader(rd, SetLightBatchMessage::TYPE)) return false;
+		if (!MessageSchema::readBinary(m, rd)) return false;
+		m.count = rd.u8();
+		if (m.count > SetLightBatchMessage::MAX_ENTRIES) return false;
+		for (uint8_t i = 0; i < m.count; ++i) {
+			SetLightBatchMessage::Entry& e = m.entries[i];
+			e.node[0] = rd.u8(); e.node[1] = rd.u8(); e.node[2] = rd.u8();
+			e.r = rd.u8(); e.g = rd.u8(); e.b = rd.u8(); e.w = rd.u8();
+			e.fade_ms = rd.u16();
+			e.pixel = rd.i8();
+		}
+		m.at_ms = rd.remaining() >= 4 ? rd.u32() : 0;
+		return rd.ok();
+	}
+
+	// beacon: scalar fields, then the reply bitmap without its trailing zero
+	// bytes, the heard map likewise, and the channel switch when one is pending
+	size_t binaryOf(const BeaconMessage& m, uint8_t* out, size_t cap) {
+		WireCodec::Writer wr(out, cap);
+		wr.header((uint8_t)BeaconMessage::TYPE);
+		MessageSchema::writeBinary(m, wr);
+		uint8_t n = BeaconMessage::REPLY_BYTES;
+		while (n > 0 && m.reply[n - 1] == 0) --n;
+		wr.u8(n);
+		for (uint8_t i = 0; i < n; ++i) wr.u8(m.reply[i]);
+		n = BeaconMessage::REPLY_BYTES;
+		while (n > 0 && m.heard[n - 1] == 0) --n;
+		if (n > 0 || m.switch_channel != 0) {
+			wr.u8(n);
+			for (uint8_t i = 0; i < n; ++i) wr.u8(m.heard[i]);
+		}
+		if (m.switch_channel != 0) {
+			wr.u8(m.switch_channel);
+			wr.u32(m.switch_at_ms);
+		}
+		return wr.length();
+	}
+
+	bool readBinaryFrame(BeaconMessage& m, const uint8_t* data, size_t len) {
+		WireCodec::Reader rd(data, len);
+		if (!readHeader(rd, BeaconMessage::TYPE)) return false;
+		if (!MessageSchema::readBinary(m, rd)) return false;
+		uint8_t n = rd.u8();
+		if (n > BeaconMessage::REPLY_BYTES) return false;
+		m.clearReplies();
+		for (uint8_t i = 0; i < n; ++i) m.reply[i] = rd.u8();
+		// Coordinators that predate the heard map stop after the reply bitmap
+		m.clearHeard();
+		if (rd.remaining() > 0) {
+			n = rd.u8();
+			if (n > BeaconMessage::REPLY_BYTES) return false;
+			for (uint8_t i = 0; i < n; ++i) m.heard[i] = rd.u8();
+		}
+		// Likewise the channel switch, for coordinators that cannot announce one
+		m.switch_channel = 0;
+		m.switch_at_ms = 0;
+		if (rd.remaining() >= 5) {
+			m.switch_channel = rd.u8();
+			m.switch_at_ms = rd.u32();
+		}
+		return rd.ok();
+	}
+
+	// Call f with the message cast to its concrete type
+	template <typename F>
+	auto visit(EspNowMessage& m, F&& f) {
+		switch (m.type) {
+			case MessageType::JOIN_REQUEST: return f(static_cast<JoinRequestMessage&>(m));
+			case MessageType::JOIN_ACCEPT:  return f(static_cast<JoinAcceptMessage&>(m));
+			case MessageType::SET_LIGHT:    return f(static_cast<SetLightMessage&>(m));
+			case MessageType::NODE_STATUS:  return f(static_cast<NodeStatusMessage&>(m));
+			case MessageType::NODE_STATUS_DELTA: return f(static_cast<NodeStatusDeltaMessage&>(m));
+			case MessageType::SET_LIGHT_BATCH: return f(static_cast<SetLightBatchMessage&>(m));
+			case MessageType::BEACON:       return f(static_cast<BeaconMessage&>(m));
+			case MessageType::WAVE:         return f(static_cast<WaveMessage&>(m));
+			case MessageType::ERROR:        return f(static_cast<ErrorMessage&>(m));
+			default:                        return f(static_cast<AckMessage&>(m));
+		}
+	}
+
+	template <typename F>
+	auto visitConst(const EspNowMessage& m, F&& f) {
+		switch (m.type) {
+			case MessageType::JOIN_REQUEST: return f(static_cast<const JoinRequestMessage&>(m));
+			case MessageType::JOIN_ACCEPT:  return f(static_cast<const JoinAcceptMessage&>(m));
+			case MessageType::SET_LIGHT:    return f(static_cast<const SetLightMessage&>(m));
+			case MessageType::NODE_STATUS:  return f(static_cast<const NodeStatusMessage&>(m));
+			case MessageType::NODE_STATUS_DELTA: return f(static_cast<const NodeStatusDeltaMessage&>(m));
+			case MessageType::SET_LIGHT_BATCH: return f(static_cast<const SetLightBatchMessage&>(m));
+			case MessageType::BEACON:       return f(static_cast<const BeaconMessage&>(m));
+			case MessageType::WAVE:         return f(static_cast<const WaveMessage&>(m));
+			case MessageType::ERROR:        return f(static_cast<const ErrorMessage&>(m));
+			default:                        return f(static_cast<const AckMessage&>(m));
+		}
+	}
 }
 
-String JoinRequestMessage::toJson() const {
-	DynamicJsonDocument doc(512);
-	doc["msg"] = msg;
-	doc["mac"] = mac;
-	doc["fw"] = fw;
-	doc["caps"]["rgbw"] = caps.rgbw;
-	doc["caps"]["led_count"] = caps.led_count;
-	doc["caps"]["temp_i2c"] = caps.temp_i2c;
-	doc["caps"]["deep_sleep"] = caps.deep_sleep;
-	doc["caps"]["button"] = caps.button;
-	doc["token"] = token;
-	String out; serializeJson(doc, out); return out;
+String EspNowMessage::toJson(uint8_t dict) const {
+	return visitConst(*this, [dict](const auto& m) { return jsonOf(m, dict); });
 }
 
-bool JoinRequestMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(512);
+bool EspNowMessage::readJson(JsonVariantConst doc) {
+	return visit(*this, [doc](auto& m) { return MessageSchema::readJson(m, doc); });
+}
+
+size_t EspNowMessage::toBinary(uint8_t* out, size_t cap) const {
+	return visitConst(*this, [out, cap](const auto& m) { return binaryOf(m, out, cap); });
+}
+
+bool EspNowMessage::fromBinary(const uint8_t* data, size_t len) {
+	return visit(*this, [data, len](auto& m) { return readBinaryFrame(m, data, len); });
+}
+
+size_t EspNowMessage::encode(WireCodec::Format format, uint8_t* out, size_t cap, uint8_t dict) const {
+	if (format == WireCodec::Format::BINARY) {
+		size_t n = toBinary(out, cap);
+		if (n > 0) return n;
+	}
+	String json = toJson(dict);
+	if (json.length() > cap) return 0;
+	memcpy(out, json.c_str(), json.length());
+	return json.length();
+}
+
+bool EspNowMessage::fromJson(const String& json) {
+	DynamicJsonDocument doc(768);
 	DeserializationError err = deserializeJson(doc, json);
+	MessageFactory::noteParse();
 	if (err) return false;
-	msg = doc["msg"].as<String>();
-	mac = doc["mac"].as<String>();
-	fw = doc["fw"].as<String>();
-	caps.rgbw = doc["caps"]["rgbw"].as<bool>();
-	caps.led_count = doc["caps"]["led_count"].as<uint8_t>();
-	caps.temp_i2c = doc["caps"]["temp_i2c"] | false;
-	caps.deep_sleep = doc["caps"]["deep_sleep"].as<bool>();
-	caps.button = doc["caps"]["button"] | false;
-	token = doc["token"].as<String>();
-	return true;
+	return readJson(doc.as<JsonVariantConst>());
 }
 
-// --- JoinAccept ---
-JoinAcceptMessage::JoinAcceptMessage() {
-	type = MessageType::JOIN_ACCEPT;
-	msg = "join_accept";
-	ts = millis();
-	wifi_channel = 1; // Default to channel 1
-	// Initialize config struct with defaults
-	cfg.pwm_freq = 0;
-	cfg.rx_window_ms = 20;
-	cfg.rx_period_ms = 100;
+JoinRequestMessage::JoinRequestMessage() { initMessage(*this); }
+JoinAcceptMessage::JoinAcceptMessage() { initMessage(*this); }
+SetLightMessage::SetLightMessage() { initMessage(*this); }
+NodeStatusMessage::NodeStatusMessage() { initMessage(*this); }
+NodeStatusDeltaMessage::NodeStatusDeltaMessage() { initMessage(*this); }
+SetLightBatchMessage::SetLightBatchMessage() : count(0), at_ms(0) { initMessage(*this); }
+BeaconMessage::BeaconMessage() : switch_channel(0), switch_at_ms(0) { initMessage(*this); clearReplies(); clearHeard(); }
+WaveMessage::WaveMessage() { initMessage(*this); }
+ErrorMessage::ErrorMessage() { initMessage(*this); }
+AckMessage::AckMessage() { initMessage(*this); }
+
+void AckMessage::stampClock(uint32_t nodeTs, uint32_t rxMs, uint32_t nowMs) {
+	uint32_t hold = nowMs - rxMs;
+	echo_ts = nodeTs;
+	coord_ms = nowMs != 0 ? nowMs : 1; // 0 means "no clock fields"
+	hold_ms = hold > 0xFFFF ? 0xFFFF : (uint16_t)hold;
 }
 
-String JoinAcceptMessage::toJson() const {
-	DynamicJsonDocument doc(256);
-	doc["msg"] = msg;
-	doc["node_id"] = node_id;
-	doc["light_id"] = light_id;
-	doc["lmk"] = lmk;
-	doc["wifi_channel"] = wifi_channel;
-	doc["cfg"]["pwm_freq"] = cfg.pwm_freq;
-	doc["cfg"]["rx_window_ms"] = cfg.rx_window_ms;
-	doc["cfg"]["rx_period_ms"] = cfg.rx_period_ms;
-	String out; serializeJson(doc, out); return out;
+bool SetLightBatchMessage::add(const uint8_t mac[6], uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs, int8_t pixel) {
+	if (isFull()) return false;
+	Entry& e = entries[count++];
+	memcpy(e.node, mac + 3, 3);
+	e.r = r; e.g = g; e.b = b; e.w = w;
+	e.fade_ms = fadeMs;
+	e.pixel = pixel;
+	return true;
 }
 
-bool JoinAcceptMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(768); // Increased to handle full join_accept with nested config
-	DeserializationError err = deserializeJson(doc, json);
-	if (err) {
-		Serial.printf("JoinAccept parse error: %s (buffer may be too small)\n", err.c_str());
-		Serial.printf("  Message length: %d bytes\n", json.length());
-		return false;
+const SetLightBatchMessage::Entry* SetLightBatchMessage::find(const uint8_t mac[6]) const {
+	for (uint8_t i = 0; i < count && i < MAX_ENTRIES; ++i) {
+		if (memcmp(entries[i].node, mac + 3, 3) == 0) return &entries[i];
 	}
-	msg = doc["msg"].as<String>();
-	node_id = doc["node_id"].as<String>();
-	light_id = doc["light_id"].as<String>();
-	lmk = doc["lmk"].as<String>();
-	wifi_channel = doc["wifi_channel"] | 1; // Default to 1 if missing
-	cfg.pwm_freq = doc["cfg"]["pwm_freq"].as<int>();
-	cfg.rx_window_ms = doc["cfg"]["rx_window_ms"].as<int>();
-	cfg.rx_period_ms = doc["cfg"]["rx_period_ms"].as<int>();
+	return nullptr;
+}
+
+bool SetLightBatchMessage::extract(const uint8_t mac[6], SetLightMessage& out) const {
+	const Entry* e = find(mac);
+	if (!e) return false;
+	char id[16];
+	snprintf(id, sizeof(id), "b%lu", (unsigned long)batch_id);
+	out = SetLightMessage();
+	out.cmd_id = id;
+	out.r = e->r; out.g = e->g; out.b = e->b; out.w = e->w;
+	out.fade_ms = e->fade_ms;
+	out.pixel = e->pixel;
+	out.override_status = override_status;
+	out.ttl_ms = ttl_ms;
+	out.at_ms = at_ms;
 	return true;
 }
 
-// --- SetLight ---
-SetLightMessage::SetLightMessage() {
-	type = MessageType::SET_LIGHT;
-	msg = "set_light";
-	ts = millis();
+uint8_t BeaconMessage::replySlot(const uint8_t mac[6]) {
+	// Same MAC bytes light_batch addresses by, mixed so consecutive NICs spread out
+	uint32_t h = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+	return (uint8_t)((h * 2654435761u) >> 24);
 }
 
-String SetLightMessage::toJson() const {
-	DynamicJsonDocument doc(384);
-	doc["msg"] = msg;
-	doc["cmd_id"] = cmd_id;
-	doc["light_id"] = light_id;
-	doc["r"] = r; doc["g"] = g; doc["b"] = b; doc["w"] = w;
-	doc["value"] = value;
-	doc["fade_ms"] = fade_ms;
-	doc["override_status"] = override_status;
-	doc["ttl_ms"] = ttl_ms;
-	doc["pixel"] = pixel; // -1 = all pixels, 0-3 = specific pixel
-	if (reason.length()) doc["reason"] = reason;
-	String out; serializeJson(doc, out); return out;
+void BeaconMessage::requestReply(const uint8_t mac[6]) {
+	uint8_t slot = replySlot(mac);
+	reply[slot >> 3] |= (uint8_t)(1u << (slot & 7));
 }
 
-bool SetLightMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(384);
-	DeserializationError err = deserializeJson(doc, json);
-	if (err) return false;
-	msg = doc["msg"].as<String>();
-	cmd_id = doc["cmd_id"].as<String>();
-	light_id = doc["light_id"].as<String>();
-	// Fix: Use ternary operator or explicit checks instead of logical OR for default values
-	r = doc.containsKey("r") ? doc["r"].as<uint8_t>() : 0;
-	g = doc.containsKey("g") ? doc["g"].as<uint8_t>() : 0;
-	b = doc.containsKey("b") ? doc["b"].as<uint8_t>() : 0;
-	w = doc.containsKey("w") ? doc["w"].as<uint8_t>() : 0;
-	value = doc.containsKey("value") ? doc["value"].as<uint8_t>() : 0;
-	fade_ms = doc.containsKey("fade_ms") ? doc["fade_ms"].as<uint16_t>() : 0;
-	override_status = doc["override_status"] | false;
-	ttl_ms = doc.containsKey("ttl_ms") ? doc["ttl_ms"].as<uint16_t>() : 1500;
-	reason = doc["reason"].as<String>();
-	pixel = doc.containsKey("pixel") ? doc["pixel"].as<int8_t>() : -1;
-	return true;
+bool BeaconMessage::wantsReply(const uint8_t mac[6]) const {
+	uint8_t slot = replySlot(mac);
+	return (reply[slot >> 3] & (1u << (slot & 7))) != 0;
 }
 
-// --- NodeStatus ---
-NodeStatusMessage::NodeStatusMessage() {
-	type = MessageType::NODE_STATUS;
-	msg = "node_status";
-	ts = millis();
+void BeaconMessage::clearReplies() {
+	memset(reply, 0, sizeof(reply));
 }
 
-String NodeStatusMessage::toJson() const {
-	DynamicJsonDocument doc(384);
-	doc["msg"] = msg;
-	doc["node_id"] = node_id;
-	doc["light_id"] = light_id;
-	doc["avg_r"] = avg_r;
-	doc["avg_g"] = avg_g;
-	doc["avg_b"] = avg_b;
-	doc["avg_w"] = avg_w;
-	doc["status_mode"] = status_mode;
-	doc["vbat_mv"] = vbat_mv;
-	doc["temperature"] = temperature;
-	doc["button_pressed"] = button_pressed;
-	doc["fw"] = fw;
-	doc["ts"] = ts;
-	String out; serializeJson(doc, out); return out;
+void BeaconMessage::markHeard(const uint8_t mac[6]) {
+	uint8_t slot = replySlot(mac);
+	heard[slot >> 3] |= (uint8_t)(1u << (slot & 7));
 }
 
-bool NodeStatusMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(384); // Increased from 256 to handle 220-byte payload + overhead
-	DeserializationError err = deserializeJson(doc, json);
-	if (err) return false;
-	msg = doc["msg"].as<String>();
-	node_id = doc["node_id"].as<String>();
-	light_id = doc["light_id"].as<String>();
-	// Fix: Use proper default value checks
-	avg_r = doc.containsKey("avg_r") ? doc["avg_r"].as<uint8_t>() : 0;
-	avg_g = doc.containsKey("avg_g") ? doc["avg_g"].as<uint8_t>() : 0;
-	avg_b = doc.containsKey("avg_b") ? doc["avg_b"].as<uint8_t>() : 0;
-	avg_w = doc.containsKey("avg_w") ? doc["avg_w"].as<uint8_t>() : 0;
-	status_mode = doc["status_mode"].as<String>();
-	vbat_mv = doc.containsKey("vbat_mv") ? doc["vbat_mv"].as<uint16_t>() : 0;
-	temperature = doc.containsKey("temperature") ? doc["temperature"].as<float>() : 0.0f;
-	button_pressed = doc.containsKey("button_pressed") ? doc["button_pressed"].as<bool>() : false;
-	fw = doc["fw"].as<String>();
-	ts = doc.containsKey("ts") ? doc["ts"].as<uint32_t>() : millis();
-	return true;
+bool BeaconMessage::heardFrom(const uint8_t mac[6]) const {
+	uint8_t slot = replySlot(mac);
+	return (heard[slot >> 3] & (1u << (slot & 7))) != 0;
 }
 
-// --- Error ---
-ErrorMessage::ErrorMessage() {
-	type = MessageType::ERROR;
-	msg = "error";
-	ts = millis();
+void BeaconMessage::clearHeard() {
+	memset(heard, 0, sizeof(heard));
 }
 
-String ErrorMessage::toJson() const {
-	DynamicJsonDocument doc(192);
-	doc["msg"] = msg;
-	doc["node_id"] = node_id;
-	doc["code"] = code;
-	doc["info"] = info;
-	String out; serializeJson(doc, out); return out;
+void BeaconMessage::replyId(CmdIdString& out) const {
+	char id[12];
+	snprintf(id, sizeof(id), "hb%u", (unsigned)seq);
+	out = id;
 }
 
-bool ErrorMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(192);
-	DeserializationError err = deserializeJson(doc, json);
-	if (err) return false;
-	msg = doc["msg"].as<String>();
-	node_id = doc["node_id"].as<String>();
-	code = doc["code"].as<String>();
-	info = doc["info"].as<String>();
-	return true;
+// --- Factory ---
+MessageType MessageFactory::getMessageType(const String& json) {
+	return getMessageType((const uint8_t*)json.c_str(), json.length());
 }
 
-// --- Ack ---
-AckMessage::AckMessage() {
-	type = MessageType::ACK;
-	msg = "ack";
-	ts = millis();
+MessageType MessageFactory::typeFromName(const char* name) {
+	return name ? lookupName(name, strlen(name)) : MessageType::UNKNOWN;
 }
 
-String AckMessage::toJson() const {
-	DynamicJsonDocument doc(96);
-	doc["msg"] = msg;
-	doc["cmd_id"] = cmd_id;
-	String out; serializeJson(doc, out); return out;
+MessageType MessageFactory::typeFromName(const char* name, size_t len) {
+	return lookupName(name, len);
 }
 
-bool AckMessage::fromJson(const String& json) {
-	DynamicJsonDocument doc(96);
-	DeserializationError err = deserializeJson(doc, json);
-	if (err) return false;
-	msg = doc["msg"].as<String>();
-	cmd_id = doc["cmd_id"].as<String>();
-	return true;
+MessageType MessageFactory::getMessageType(const uint8_t* data, size_t len) {
+	if (!WireCodec::isBinaryFrame(data, len)) {
+		if (!WireCodec::isJsonFrame(data, len)) return MessageType::UNKNOWN;
+		size_t n = 0;
+		const char* name = findMsgValue(data, len, n);
+		return lookupName(name, n);
+	}
+	if (data[1] != WireCodec::VERSION) return MessageType::UNKNOWN;
+	switch ((MessageType)data[2]) {
+		case MessageType::JOIN_REQUEST:
+		case MessageType::JOIN_ACCEPT:
+		case MessageType::SET_LIGHT:
+		case MessageType::NODE_STATUS:
+		case MessageType::NODE_STATUS_DELTA:
+		case MessageType::SET_LIGHT_BATCH:
+		case MessageType::BEACON:
+		case MessageType::ACK:
+			return (MessageType)data[2];
+		default:
+			return MessageType::UNKNOWN;
+	}
 }
 
-// --- Factory ---
-EspNowMessage* MessageFactory::createMessage(const String& json) {
-	MessageType t = getMessageType(json);
-	EspNowMessage* m = nullptr;
+// --- MessageSlot ---
+MessageSlot::MessageSlot() : doc(768) {}
+
+EspNowMessage* MessageSlot::target(MessageType t) {
 	switch (t) {
-		case MessageType::JOIN_REQUEST: m = new JoinRequestMessage(); break;
-		case MessageType::JOIN_ACCEPT:  m = new JoinAcceptMessage(); break;
-		case MessageType::SET_LIGHT:    m = new SetLightMessage(); break;
-		case MessageType::NODE_STATUS:  m = new NodeStatusMessage(); break;
-		case MessageType::ERROR:        m = new ErrorMessage(); break;
-		case MessageType::ACK:          m = new AckMessage(); break;
+		case MessageType::JOIN_REQUEST: return &joinRequest;
+		case MessageType::JOIN_ACCEPT:  return &joinAccept;
+		case MessageType::SET_LIGHT:    return &setLight;
+		case MessageType::NODE_STATUS:  return &nodeStatus;
+		case MessageType::NODE_STATUS_DELTA: return &statusDelta;
+		case MessageType::SET_LIGHT_BATCH: return &lightBatch;
+		case MessageType::BEACON:       return &beacon;
+		case MessageType::WAVE:         return &wave;
+		case MessageType::ERROR:        return &error;
+		case MessageType::ACK:          return &ack;
 		default: return nullptr;
 	}
-	if (m && !m->fromJson(json)) { delete m; return nullptr; }
-	return m;
 }
 
-MessageType MessageFactory::getMessageType(const String& json) {
-	// Use filter to only extract "msg" field - more memory efficient
-	DynamicJsonDocument filter(48);
-	filter["msg"] = true;
-	
-	DynamicJsonDocument doc(256);
-	DeserializationError err = deserializeJson(doc, json, DeserializationOption::Filter(filter));
-	if (err) {
-		Serial.printf("MessageFactory: Failed to parse message type: %s\n", err.c_str());
-		return MessageType::ERROR;
+EspNowMessage* MessageSlot::decode(const uint8_t* data, size_t len) {
+	if (!data || len == 0) return nullptr;
+	// Classify first (no parse) so control frames without a struct cost nothing
+	EspNowMessage* m = target(MessageFactory::getMessageType(data, len));
+	if (!m) return nullptr;
+	if (WireCodec::isBinaryFrame(data, len)) {
+		return m->fromBinary(data, len) ? m : nullptr;
 	}
-	
-	String m = doc["msg"].as<String>();
-	if (m == "join_request") return MessageType::JOIN_REQUEST;
-	if (m == "join_accept") return MessageType::JOIN_ACCEPT;
-	if (m == "set_light") return MessageType::SET_LIGHT;
-	if (m == "node_status") return MessageType::NODE_STATUS;
-	if (m == "ack") return MessageType::ACK;
-	return MessageType::ERROR;
+	// deserializeJson() clears and refills the slot's document in place
+	DeserializationError err = deserializeJson(doc, (const char*)data, len);
+	MessageFactory::noteParse();
+	if (err) return nullptr;
+	return m->readJson(doc.as<JsonVariantConst>()) ? m : nullptr;
 }
 
+uint32_t MessageFactory::getParseCount() {
+	return s_parseCount;
+}
+
+void MessageFactory::resetParseCount() {
+	s_parseCount = 0;
+}
+
+void MessageFactory::noteParse() {
+	s_parseCount++;
+}
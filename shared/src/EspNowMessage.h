@@ -3,120 +3,509 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <type_traits>
+#include "WireCodec.h"
+#include "FixedString.h"
+#include "MessageSchema.h"
 
-// Message types signaled via the 'msg' string field in JSON
-enum class MessageType {
-	JOIN_REQUEST,
-	JOIN_ACCEPT,
-	SET_LIGHT,
-	NODE_STATUS,
-	ERROR,
-	ACK
+// Message types signaled via the 'msg' string field in JSON.
+// The numeric values are the TYPE byte of binary frames (see WireCodec.h).
+enum class MessageType : uint8_t {
+	// Not a frame this firmware can classify: garbage, or a newer type
+	UNKNOWN = 0,
+	JOIN_REQUEST = 1,
+	JOIN_ACCEPT = 2,
+	SET_LIGHT = 3,
+	NODE_STATUS = 4,
+	ERROR = 5,
+	ACK = 6,
+	// JSON-only control frames sent by the coordinator; no message struct
+	PING = 7,
+	PAIRING_PING = 8,
+	// JSON-only: test pattern started at a coordinator-clock instant
+	WAVE = 9,
+	// Binary-only: node_status fields changed since an acked keyframe
+	NODE_STATUS_DELTA = 10,
+	// Binary-only broadcast: set_light for many nodes in one frame
+	SET_LIGHT_BATCH = 11,
+	// Transport frame carrying part of a larger message (Fragmentation.h)
+	FRAGMENT = 12,
+	// Binary-only broadcast: coordinator heartbeat with reply requests
+	BEACON = 13
 };
 
-// Base message with common helpers
+// Base message with common helpers.
+// Messages are plain data: fixed-capacity inline strings and no vtable, so every
+// message type is trivially copyable and can be queued by value. The methods
+// below dispatch on `type` to the codecs generated from the concrete schema().
 struct EspNowMessage {
 	MessageType type;
-	String msg;         // e.g. "join_request", "set_light"
-	String cmd_id;      // for idempotency/acks (where applicable)
+	TagString msg;      // e.g. "join_request", "set_light"
+	CmdIdString cmd_id; // for idempotency/acks (where applicable)
 	uint32_t ts;        // timestamp (ms)
 
-	virtual ~EspNowMessage() = default;
-	virtual String toJson() const = 0;
-	virtual bool fromJson(const String& json) = 0;
+	// dict: KeyDictionary version the receiving peer negotiated (NONE = long keys)
+	String toJson(uint8_t dict = KeyDictionary::NONE) const;
+	// Populate from an already-parsed JSON document (no re-parse)
+	bool readJson(JsonVariantConst doc);
+	// Parse a JSON string and populate via readJson()
+	bool fromJson(const String& json);
+	// Packed binary form; returns bytes written, 0 if the type has no binary encoding
+	size_t toBinary(uint8_t* out, size_t cap) const;
+	bool fromBinary(const uint8_t* data, size_t len);
+	// Serialize with the requested format, falling back to JSON when needed
+	size_t encode(WireCodec::Format format, uint8_t* out, size_t cap, uint8_t dict = KeyDictionary::NONE) const;
+
+protected:
+	EspNowMessage() = default;
 };
 
+// Each message below declares its fields once in schema() (see MessageSchema.h);
+// JSON and binary codecs, defaults and worst-case sizes are generated from it.
+// Binary field order is the schema order, so append new fields at the end.
+
 // Join request message with capability reporting (PRD v0.5)
 struct JoinRequestMessage : public EspNowMessage {
-	String mac;            // station MAC
-	String fw;             // firmware version
+	static constexpr MessageType TYPE = MessageType::JOIN_REQUEST;
+	static constexpr const char* NAME = "join_request";
+	static constexpr bool HAS_BINARY = false;
+
+	MacString mac;         // station MAC
+	FwString fw;           // firmware version
 	struct Capabilities {
 		bool rgbw;         // SK6812B RGBW support
 		uint8_t led_count; // pixels per node (default 4)
 		bool temp_i2c;     // TMP177 temp sensor via I2C
 		bool deep_sleep;   // deep sleep capable
 		bool button;       // button input available
+		bool bin_wire;     // understands packed binary frames (WireCodec v1)
+		uint16_t max_frame; // largest ESP-NOW frame it can receive (1470 with v2)
 	} caps;
-	String token;          // rotating token for secure pairing
+	KeyString token;       // rotating token for secure pairing
 
 	JoinRequestMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<JoinRequestMessage>;
+		using C = Capabilities;
+		return std::make_tuple(
+			S::field("mac", &JoinRequestMessage::mac),
+			S::field("fw", &JoinRequestMessage::fw),
+			S::nested("caps", "rgbw", &JoinRequestMessage::caps, &C::rgbw),
+			S::nested("caps", "led_count", &JoinRequestMessage::caps, &C::led_count),
+			S::nested("caps", "temp_i2c", &JoinRequestMessage::caps, &C::temp_i2c),
+			S::nested("caps", "deep_sleep", &JoinRequestMessage::caps, &C::deep_sleep),
+			S::nested("caps", "button", &JoinRequestMessage::caps, &C::button),
+			S::nested("caps", "bin", &JoinRequestMessage::caps, &C::bin_wire, false, MessageSchema::OMIT_DEFAULT),
+			S::nested("caps", "mtu", &JoinRequestMessage::caps, &C::max_frame, (uint16_t)WireCodec::MAX_FRAME_LEN, MessageSchema::OMIT_DEFAULT),
+			S::field("token", &JoinRequestMessage::token));
+	}
 };
 
 // Join accept (coordinator -> node)
 struct JoinAcceptMessage : public EspNowMessage {
-	String node_id;
-	String light_id;
-	String lmk;           // link master key (ESP-NOW LMK)
+	static constexpr MessageType TYPE = MessageType::JOIN_ACCEPT;
+	static constexpr const char* NAME = "join_accept";
+	static constexpr bool HAS_BINARY = true;
+
+	IdString node_id;
+	IdString light_id;
+	KeyString lmk;        // link master key (ESP-NOW LMK)
 	uint8_t wifi_channel; // WiFi channel coordinator is using
 	struct Cfg {
 		int pwm_freq;
 		int rx_window_ms;
 		int rx_period_ms;
 	} cfg;
+	bool bin_wire;        // coordinator accepts binary frames from this node
+	uint16_t max_frame;   // negotiated frame limit; larger messages are fragmented
+	uint8_t key_dict;     // KeyDictionary version for the node's JSON frames
 
 	JoinAcceptMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<JoinAcceptMessage>;
+		return std::make_tuple(
+			S::field("node_id", &JoinAcceptMessage::node_id),
+			S::field("light_id", &JoinAcceptMessage::light_id),
+			S::field("lmk", &JoinAcceptMessage::lmk),
+			S::field("wifi_channel", &JoinAcceptMessage::wifi_channel, (uint8_t)1),
+			S::nested("cfg", "pwm_freq", &JoinAcceptMessage::cfg, &Cfg::pwm_freq),
+			S::nested("cfg", "rx_window_ms", &JoinAcceptMessage::cfg, &Cfg::rx_window_ms, 20),
+			S::nested("cfg", "rx_period_ms", &JoinAcceptMessage::cfg, &Cfg::rx_period_ms, 100),
+			S::field("bin", &JoinAcceptMessage::bin_wire, false, MessageSchema::OMIT_DEFAULT),
+			S::field("mtu", &JoinAcceptMessage::max_frame, (uint16_t)WireCodec::MAX_FRAME_LEN, MessageSchema::OMIT_DEFAULT),
+			S::field("kd", &JoinAcceptMessage::key_dict, (uint8_t)KeyDictionary::NONE, MessageSchema::OMIT_DEFAULT));
+	}
 };
 
 // set_light (PRD v0.5)
 struct SetLightMessage : public EspNowMessage {
-	String light_id;
+	static constexpr MessageType TYPE = MessageType::SET_LIGHT;
+	static constexpr const char* NAME = "set_light";
+	static constexpr bool HAS_BINARY = true;
+
+	IdString light_id;
 	// RGBW values (0..255). If omitted, 'value' may be used as brightness fallback.
-	uint8_t r = 0, g = 0, b = 0, w = 0;
-	uint8_t value = 0; // optional fallback (PWM-like)
-	uint16_t fade_ms = 0;
-	bool override_status = false;
-	uint16_t ttl_ms = 1500;
-	String reason;
-	int8_t pixel = -1; // -1 = all pixels, 0-3 = specific pixel index
+	uint8_t r, g, b, w;
+	uint8_t value;        // optional fallback (PWM-like)
+	uint16_t fade_ms;
+	bool override_status;
+	uint16_t ttl_ms;
+	int8_t pixel;         // -1 = all pixels, 0-3 = specific pixel index
+	TagString reason;
+	uint32_t at_ms;       // apply at this coordinator millis() (TimeSync.h), 0 = on receipt
 
 	SetLightMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<SetLightMessage>;
+		return std::make_tuple(
+			S::field("cmd_id", &SetLightMessage::cmd_id),
+			S::field("light_id", &SetLightMessage::light_id),
+			S::field("r", &SetLightMessage::r),
+			S::field("g", &SetLightMessage::g),
+			S::field("b", &SetLightMessage::b),
+			S::field("w", &SetLightMessage::w),
+			S::field("value", &SetLightMessage::value),
+			S::field("fade_ms", &SetLightMessage::fade_ms),
+			S::field("override_status", &SetLightMessage::override_status),
+			S::field("ttl_ms", &SetLightMessage::ttl_ms, (uint16_t)1500),
+			S::field("pixel", &SetLightMessage::pixel, (int8_t)-1),
+			S::field("reason", &SetLightMessage::reason, TagString(), MessageSchema::OMIT_DEFAULT),
+			S::field("at", &SetLightMessage::at_ms, (uint32_t)0, MessageSchema::OMIT_DEFAULT));
+	}
 };
 
 // node_status (PRD v0.5)
 struct NodeStatusMessage : public EspNowMessage {
-	String node_id;
-	String light_id;
+	static constexpr MessageType TYPE = MessageType::NODE_STATUS;
+	static constexpr const char* NAME = "node_status";
+	static constexpr bool HAS_BINARY = true;
+
+	IdString node_id;
+	IdString light_id;
 	// average output per channel (0..255)
-	uint8_t avg_r = 0, avg_g = 0, avg_b = 0, avg_w = 0;
-	String status_mode;   // "operational", "pairing", "ota", "error"
-	uint16_t vbat_mv = 0;
-	float temperature = 0.0f; // temperature in Celsius from TMP177
-	bool button_pressed = false; // current button state
-	String fw;
+	uint8_t avg_r, avg_g, avg_b, avg_w;
+	TagString status_mode; // "operational", "pairing", "ota", "error"
+	uint16_t vbat_mv;
+	float temperature;     // temperature in Celsius from TMP177
+	bool button_pressed;   // current button state
+	FwString fw;
+	uint8_t key_id;        // non-zero on delta telemetry keyframes (see TelemetryDelta.h)
+	uint8_t clock_err_ms;  // bound on the node's coordinator-time error (TimeSync.h), 0 = not synced
 
 	NodeStatusMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<NodeStatusMessage>;
+		return std::make_tuple(
+			S::field("node_id", &NodeStatusMessage::node_id),
+			S::field("light_id", &NodeStatusMessage::light_id),
+			S::field("avg_r", &NodeStatusMessage::avg_r),
+			S::field("avg_g", &NodeStatusMessage::avg_g),
+			S::field("avg_b", &NodeStatusMessage::avg_b),
+			S::field("avg_w", &NodeStatusMessage::avg_w),
+			S::field("status_mode", &NodeStatusMessage::status_mode),
+			S::field("vbat_mv", &NodeStatusMessage::vbat_mv),
+			S::field("temperature", &NodeStatusMessage::temperature),
+			S::field("button_pressed", &NodeStatusMessage::button_pressed),
+			S::field("fw", &NodeStatusMessage::fw),
+			S::field("ts", &NodeStatusMessage::ts),
+			S::field("kid", &NodeStatusMessage::key_id, (uint8_t)0, MessageSchema::OMIT_DEFAULT),
+			S::field("clk", &NodeStatusMessage::clock_err_ms, (uint8_t)0, MessageSchema::OMIT_DEFAULT));
+	}
+};
+
+// status_delta (node -> coordinator, binary only).
+// The node_status fields that changed since the keyframe the coordinator acked
+// as base_key. Bit i of `mask` is field i of NodeStatusMessage::schema(); only
+// masked fields are on the wire, the rest of `fields` is left untouched.
+struct NodeStatusDeltaMessage : public EspNowMessage {
+	static constexpr MessageType TYPE = MessageType::NODE_STATUS_DELTA;
+	static constexpr const char* NAME = "status_delta";
+	static constexpr bool HAS_BINARY = true;
+
+	uint8_t base_key;
+	uint16_t mask;
+	NodeStatusMessage fields;
+
+	NodeStatusDeltaMessage();
+
+	// Header fields only; the masked body has its own codec in EspNowMessage.cpp
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<NodeStatusDeltaMessage>;
+		return std::make_tuple(
+			S::field("base", &NodeStatusDeltaMessage::base_key),
+			S::field("mask", &NodeStatusDeltaMessage::mask));
+	}
+
+	// Every field changed
+	static constexpr size_t maxFrameSize() {
+		return MessageSchema::maxBinarySize<NodeStatusDeltaMessage>() +
+		       MessageSchema::maxBinarySize<NodeStatusMessage>() - WireCodec::HEADER_LEN;
+	}
+};
+
+// light_batch (coordinator -> all nodes, binary broadcast only).
+// One set_light per entry, addressed by the last three bytes of the node's
+// station MAC (the same bytes light ids and cmd ids are derived from). Every
+// node decodes the frame and applies only its own entry; fade and pixel are
+// per entry, ttl/override apply to the whole batch. Entries are not acked:
+// an ack per node would cost the unicast frames the batch exists to save.
+struct SetLightBatchMessage : public EspNowMessage {
+	static constexpr MessageType TYPE = MessageType::SET_LIGHT_BATCH;
+	static constexpr const char* NAME = "light_batch";
+	static constexpr bool HAS_BINARY = true;
+
+	struct Entry {
+		uint8_t node[3]; // MAC bytes 3..5
+		uint8_t r, g, b, w;
+		uint16_t fade_ms;
+		int8_t pixel;    // -1 = all pixels
+	};
+	static constexpr size_t ENTRY_WIRE_LEN = 3 + 4 + 2 + 1;
+	static constexpr size_t MAX_ENTRIES = 23;
+
+	uint32_t batch_id;    // idempotency; entries expand to cmd_id "b<batch_id>"
+	uint16_t ttl_ms;
+	bool override_status;
+	uint8_t count;
+	Entry entries[MAX_ENTRIES];
+	uint32_t at_ms;       // as SetLightMessage::at_ms; sent after the entries, only when set
+
+	SetLightBatchMessage();
+
+	// Batch-wide fields; count, entries and at_ms have their own codec in EspNowMessage.cpp
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<SetLightBatchMessage>;
+		return std::make_tuple(
+			S::field("batch", &SetLightBatchMessage::batch_id),
+			S::field("ttl_ms", &SetLightBatchMessage::ttl_ms, (uint16_t)1500),
+			S::field("override_status", &SetLightBatchMessage::override_status));
+	}
+
+	static constexpr size_t maxFrameSize() {
+		return MessageSchema::maxBinarySize<SetLightBatchMessage>() + 1 + MAX_ENTRIES * ENTRY_WIRE_LEN + 4;
+	}
+
+	// Append an entry; false when the batch is full
+	bool add(const uint8_t mac[6], uint8_t r, uint8_t g, uint8_t b, uint8_t w, uint16_t fadeMs, int8_t pixel = -1);
+	bool isFull() const { return count >= MAX_ENTRIES; }
+	const Entry* find(const uint8_t mac[6]) const;
+	// Expand this node's entry into a regular set_light; false if not addressed
+	bool extract(const uint8_t mac[6], SetLightMessage& out) const;
+};
+
+// beacon (coordinator -> all nodes, binary broadcast only).
+// One frame per heartbeat period instead of a ping per node, so heartbeat
+// airtime does not grow with the fleet. Nodes take it as proof the coordinator
+// is alive and where it is (its MAC and channel come with the frame), and
+// note its timebase. A node replies - an ack "hb<seq>" - only when its bit in
+// `reply` is set. The bit is replySlot(), a hash of the MAC's last three
+// bytes, so nothing is assigned at join; nodes sharing a bit both reply,
+// which costs a frame and nothing else.
+// `heard` marks, by the same slots, the nodes whose telemetry arrived since
+// the previous beacon: the acknowledgement for every routine report in one
+// frame (see TelemetryAcks). A node sharing a slot with one that was heard
+// takes it as its own; that only delays noticing a one-way link.
+// `switch_channel` announces a fleet channel switch: the coordinator and every
+// node retune to it at `switch_at_ms` (coordinator timebase; nodes convert
+// through time_ms). The coordinator repeats it in each beacon until then, so
+// one lost beacon does not strand a node on the old channel.
+struct BeaconMessage : public EspNowMessage {
+	static constexpr MessageType TYPE = MessageType::BEACON;
+	static constexpr const char* NAME = "beacon";
+	static constexpr bool HAS_BINARY = true;
+
+	static constexpr size_t REPLY_SLOTS = 256;
+	static constexpr size_t REPLY_BYTES = REPLY_SLOTS / 8;
+
+	uint16_t seq;
+	uint32_t time_ms;   // coordinator millis() when the beacon was built
+	uint16_t period_ms; // the next beacon is due this much later
+	uint8_t reply[REPLY_BYTES]; // trailing zero bytes are not sent
+	uint8_t heard[REPLY_BYTES]; // after reply, and only when a bit is set
+	uint8_t switch_channel;     // after heard, and only when non-zero
+	uint32_t switch_at_ms;      // coordinator millis() the switch happens at
+
+	// A switch further out than this is taken as garbage rather than waited for
+	static constexpr uint32_t MAX_SWITCH_LEAD_MS = 60000;
+
+	BeaconMessage();
+
+	// Scalar fields; the bitmaps and the switch have their own codec in
+	// EspNowMessage.cpp
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<BeaconMessage>;
+		return std::make_tuple(
+			S::field("seq", &BeaconMessage::seq),
+			S::field("time_ms", &BeaconMessage::time_ms),
+			S::field("period_ms", &BeaconMessage::period_ms));
+	}
+
+	static constexpr size_t maxFrameSize() {
+		return MessageSchema::maxBinarySize<BeaconMessage>() + 2 * (1 + REPLY_BYTES) + 1 + 4;
+	}
+
+	static uint8_t replySlot(const uint8_t mac[6]);
+	void requestReply(const uint8_t mac[6]);
+	bool wantsReply(const uint8_t mac[6]) const;
+	void clearReplies();
+	void markHeard(const uint8_t mac[6]);
+	bool heardFrom(const uint8_t mac[6]) const;
+	void clearHeard();
+	// cmd_id a node acks the beacon with
+	void replyId(CmdIdString& out) const;
+};
+
+// Wave test pattern (coordinator -> node). Every node gets the same start_at
+// and holds it until that instant in its synced copy of the coordinator clock.
+struct WaveMessage : public EspNowMessage {
+	static constexpr MessageType TYPE = MessageType::WAVE;
+	static constexpr const char* NAME = "wave";
+	static constexpr bool HAS_BINARY = false;
+
+	uint16_t period_ms;   // one brightness cycle
+	uint16_t duration_ms; // how long the pattern runs
+	uint32_t start_at;    // coordinator millis() (TimeSync.h), 0 = on receipt
+
+	WaveMessage();
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<WaveMessage>;
+		return std::make_tuple(
+			S::field("period_ms", &WaveMessage::period_ms, (uint16_t)1200),
+			S::field("duration_ms", &WaveMessage::duration_ms, (uint16_t)4000),
+			S::field("start_at", &WaveMessage::start_at));
+	}
 };
 
 // Error message (minimal)
 struct ErrorMessage : public EspNowMessage {
-	String node_id;
-	String code;
-	String info;
+	static constexpr MessageType TYPE = MessageType::ERROR;
+	static constexpr const char* NAME = "error";
+	static constexpr bool HAS_BINARY = false;
+
+	IdString node_id;
+	TagString code;
+	FixedString<63> info;
 
 	ErrorMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<ErrorMessage>;
+		return std::make_tuple(
+			S::field("node_id", &ErrorMessage::node_id),
+			S::field("code", &ErrorMessage::code),
+			S::field("info", &ErrorMessage::info));
+	}
 };
 
 // Ack for a command id
 struct AckMessage : public EspNowMessage {
+	static constexpr MessageType TYPE = MessageType::ACK;
+	static constexpr const char* NAME = "ack";
+	static constexpr bool HAS_BINARY = true;
+
+	uint8_t key_id; // telemetry keyframe being acked, 0 otherwise
+	// Clock sync on telemetry acks (see TimeSync.h), 0 otherwise
+	uint32_t echo_ts;  // the acked telemetry's ts (node millis())
+	uint32_t coord_ms; // coordinator millis() when the ack was built
+	uint16_t hold_ms;  // time between receiving that telemetry and coord_ms
+
 	AckMessage();
-	String toJson() const override;
-	bool fromJson(const String& json) override;
+
+	// Fill the clock-sync fields for telemetry sent at nodeTs, received at rxMs
+	void stampClock(uint32_t nodeTs, uint32_t rxMs, uint32_t nowMs);
+	bool hasClock() const { return coord_ms != 0; }
+
+	static constexpr auto schema() {
+		using S = MessageSchema::Fields<AckMessage>;
+		return std::make_tuple(
+			S::field("cmd_id", &AckMessage::cmd_id),
+			S::field("kid", &AckMessage::key_id, (uint8_t)0, MessageSchema::OMIT_DEFAULT),
+			S::field("ets", &AckMessage::echo_ts, (uint32_t)0, MessageSchema::OMIT_DEFAULT),
+			S::field("cms", &AckMessage::coord_ms, (uint32_t)0, MessageSchema::OMIT_DEFAULT),
+			S::field("hold", &AckMessage::hold_ms, (uint16_t)0, MessageSchema::OMIT_DEFAULT));
+	}
+};
+
+// Every message must fit one ESP-NOW frame in the encoding peers use for it,
+// sequence number included (WireCodec::stampSeq)
+static_assert(MessageSchema::maxJsonSize<JoinRequestMessage>() + WireCodec::JSON_SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "join_request can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxFrameSize<JoinAcceptMessage>() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "join_accept can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxFrameSize<SetLightMessage>() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "set_light can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxFrameSize<NodeStatusMessage>() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "node_status can exceed one ESP-NOW frame");
+static_assert(NodeStatusDeltaMessage::maxFrameSize() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "status_delta can exceed one ESP-NOW frame");
+static_assert(MessageSchema::fieldCount<NodeStatusMessage>() <= 16, "status_delta mask is 16 bits");
+static_assert(SetLightBatchMessage::maxFrameSize() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "light_batch can exceed one ESP-NOW frame");
+static_assert(BeaconMessage::maxFrameSize() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "beacon can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxJsonSize<WaveMessage>() + WireCodec::JSON_SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "wave can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxFrameSize<ErrorMessage>() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "error can exceed one ESP-NOW frame");
+static_assert(MessageSchema::maxFrameSize<AckMessage>() + WireCodec::SEQ_LEN <= WireCodec::MAX_FRAME_LEN, "ack can exceed one ESP-NOW frame");
+
+static_assert(MessageSchema::tokensDistinct<JoinRequestMessage>(), "join_request key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<JoinAcceptMessage>(), "join_accept key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<SetLightMessage>(), "set_light key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<NodeStatusMessage>(), "node_status key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<WaveMessage>(), "wave key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<ErrorMessage>(), "error key token collides with a key");
+static_assert(MessageSchema::tokensDistinct<AckMessage>(), "ack key token collides with a key");
+
+static_assert(std::is_trivially_copyable<JoinRequestMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<JoinAcceptMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<SetLightMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<NodeStatusMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<NodeStatusDeltaMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<SetLightBatchMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<BeaconMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<WaveMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<ErrorMessage>::value, "messages must stay trivially copyable");
+static_assert(std::is_trivially_copyable<AckMessage>::value, "messages must stay trivially copyable");
+
+// Reusable decode target for the RX path. Holds one instance of every message
+// type plus the JSON document they are read from; decoding overwrites the
+// matching member in place, so a steady stream of frames causes no heap
+// allocation. The returned message is only valid until the next decode() on
+// the slot; copy it out (it is trivially copyable) to keep it longer.
+class MessageSlot {
+public:
+	MessageSlot();
+	EspNowMessage* decode(const uint8_t* data, size_t len);
+
+private:
+	MessageSlot(const MessageSlot&) = delete;
+	MessageSlot& operator=(const MessageSlot&) = delete;
+	EspNowMessage* target(MessageType t);
+
+	DynamicJsonDocument doc;
+	JoinRequestMessage joinRequest;
+	JoinAcceptMessage joinAccept;
+	SetLightMessage setLight;
+	NodeStatusMessage nodeStatus;
+	NodeStatusDeltaMessage statusDelta;
+	SetLightBatchMessage lightBatch;
+	BeaconMessage beacon;
+	WaveMessage wave;
+	ErrorMessage error;
+	AckMessage ack;
 };
 
 class MessageFactory {
 public:
-	static EspNowMessage* createMessage(const String& json);
 	static MessageType getMessageType(const String& json);
+	// Allocation-free: scans a JSON frame for the "msg" value (or reads the
+	// binary TYPE byte) and looks it up in a compile-time perfect hash.
+	static MessageType getMessageType(const uint8_t* data, size_t len);
+	static MessageType typeFromName(const char* name);
+	static MessageType typeFromName(const char* name, size_t len);
+
+	// Number of full frame parses (JSON deserialization or binary body decode)
+	// performed since the last reset; used to verify the parse-once RX path.
+	static uint32_t getParseCount();
+	static void resetParseCount();
+	static void noteParse();
 };
 
 #endif // ESP_NOW_MESSAGE_H
@@ -0,0 +1,60 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+#include <string.h>
+
+// Bounded, inline string for protocol fields. Storage lives inside the owning
+// struct (no heap), so messages built from these stay trivially copyable and
+// can be memcpy'd into queues. Assignments longer than N are truncated.
+template <size_t N>
+class FixedString {
+	static_assert(N > 0 && N < 256, "FixedString capacity must fit in a uint8_t length");
+
+public:
+	constexpr FixedString() : buf_{}, len_(0) {}
+	FixedString(const char* s) { assign(s); }
+	FixedString(const String& s) { assign(s.c_str(), s.length()); }
+
+	FixedString& operator=(const char* s) { assign(s); return *this; }
+	FixedString& operator=(const String& s) { assign(s.c_str(), s.length()); return *this; }
+
+	void assign(const char* s) { assign(s, s ? strlen(s) : 0); }
+	void assign(const char* s, size_t n) {
+		if (!s) n = 0;
+		if (n > N) n = N;
+		if (n) memmove(buf_, s, n);
+		buf_[n] = '\0';
+		len_ = (uint8_t)n;
+	}
+	void clear() { len_ = 0; buf_[0] = '\0'; }
+
+	const char* c_str() const { return buf_; }
+	size_t length() const { return len_; }
+	bool isEmpty() const { return len_ == 0; }
+	static constexpr size_t capacity() { return N; }
+
+	bool operator==(const char* s) const { return s && strcmp(buf_, s) == 0; }
+	bool operator==(const String& s) const { return s.length() == len_ && memcmp(buf_, s.c_str(), len_) == 0; }
+	template <size_t M>
+	bool operator==(const FixedString<M>& o) const { return o.length() == len_ && memcmp(buf_, o.c_str(), len_) == 0; }
+	bool operator!=(const char* s) const { return !(*this == s); }
+	bool operator!=(const String& s) const { return !(*this == s); }
+
+	// Interop with Arduino APIs; allocates, so keep it off hot paths
+	operator String() const { return String(buf_); }
+
+private:
+	char buf_[N + 1];
+	uint8_t len_;
+};
+
+// Field sizes used by the ESP-NOW message layer
+using MacString = FixedString<17>;    // "AA:BB:CC:DD:EE:FF"
+using IdString = FixedString<23>;     // node / light ids
+using CmdIdString = FixedString<39>;  // "<millis>-<mac tail>" or a UUID from MQTT
+using TagString = FixedString<15>;    // message names, status modes, reasons, codes
+using FwString = FixedString<23>;     // firmware tags such as "c3-1.0.0"
+using KeyString = FixedString<32>;    // hex LMK / pairing token
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,125 @@
+#include "Fragmentation.h"
+#include "EspNowMessage.h"
+
+static_assert(Fragmentation::TYPE == (uint8_t)MessageType::FRAGMENT, "fragment TYPE byte must stay reserved");
+
+namespace Fragmentation {
+
+size_t fragmentCount(size_t len, size_t mtu) {
+	if (len == 0 || len > WireCodec::MAX_MESSAGE_LEN || mtu <= HEADER_LEN) return 0;
+	size_t chunk = mtu - HEADER_LEN;
+	size_t count = (len + chunk - 1) / chunk;
+	return count <= MAX_FRAGMENTS ? count : 0;
+}
+
+size_t buildFragment(const uint8_t* data, size_t len, uint8_t msgId, uint8_t index, uint8_t count,
+                     uint8_t* out, size_t cap) {
+	if (count == 0 || index >= count) return 0;
+	size_t chunk = (len + count - 1) / count;
+	size_t offset = (size_t)index * chunk;
+	if (offset >= len) return 0;
+	size_t n = len - offset < chunk ? len - offset : chunk;
+
+	WireCodec::Writer wr(out, cap);
+	wr.header(TYPE);
+	wr.u8(msgId);
+	wr.u8(index);
+	wr.u8(count);
+	wr.u16((uint16_t)len);
+	if (!wr.ok() || HEADER_LEN + n > cap) return 0;
+	memcpy(out + HEADER_LEN, data + offset, n);
+	return HEADER_LEN + n;
+}
+
+} // namespace Fragmentation
+
+Reassembler::Reassembler() : counters{} {
+	for (auto& s : slots) s.used = false;
+}
+
+size_t Reassembler::inFlight() const {
+	size_t n = 0;
+	for (const auto& s : slots) n += s.used ? 1 : 0;
+	return n;
+}
+
+Reassembler::Slot* Reassembler::find(const uint8_t mac[6], uint8_t msgId) {
+	for (auto& s : slots) {
+		if (s.used && s.msgId == msgId && memcmp(s.mac, mac, 6) == 0) return &s;
+	}
+	return nullptr;
+}
+
+void Reassembler::expire(uint32_t nowMs) {
+	for (auto& s : slots) {
+		if (s.used && nowMs - s.startedMs > Fragmentation::REASSEMBLY_TIMEOUT_MS) {
+			s.used = false;
+			counters.expired++;
+		}
+	}
+}
+
+Reassembler::Slot* Reassembler::claim(uint32_t nowMs) {
+	Slot* oldest = nullptr;
+	for (auto& s : slots) {
+		if (!s.used) return &s;
+		if (!oldest || nowMs - s.startedMs > nowMs - oldest->startedMs) oldest = &s;
+	}
+	counters.evicted++;
+	return oldest;
+}
+
+const uint8_t* Reassembler::accept(const uint8_t mac[6], const uint8_t* frame, size_t len, uint32_t nowMs, size_t& outLen) {
+	outLen = 0;
+	expire(nowMs);
+
+	WireCodec::Reader rd(frame, len);
+	uint8_t type = 0, flags = 0;
+	if (!mac || !rd.header(type, flags) || type != Fragmentation::TYPE) {
+		counters.rejected++;
+		return nullptr;
+	}
+	uint8_t msgId = rd.u8();
+	uint8_t index = rd.u8();
+	uint8_t count = rd.u8();
+	uint16_t total = rd.u16();
+	if (!rd.ok() || count == 0 || count > Fragmentation::MAX_FRAGMENTS || index >= count ||
+	    total == 0 || total > WireCodec::MAX_MESSAGE_LEN) {
+		counters.rejected++;
+		return nullptr;
+	}
+	size_t chunk = (total + count - 1) / count;
+	size_t offset = (size_t)index * chunk;
+	size_t expect = offset < total ? (total - offset < chunk ? total - offset : chunk) : 0;
+	if (expect == 0 || rd.remaining() != expect) {
+		counters.rejected++;
+		return nullptr;
+	}
+
+	Slot* s = find(mac, msgId);
+	if (s && (s->count != count || s->totalLen != total)) {
+		// Same id reused for a different message: start over
+		s->used = false;
+		counters.rejected++;
+		s = nullptr;
+	}
+	if (!s) {
+		s = claim(nowMs);
+		s->used = true;
+		memcpy(s->mac, mac, 6);
+		s->msgId = msgId;
+		s->count = count;
+		s->received = 0;
+		s->totalLen = total;
+		s->startedMs = nowMs;
+	}
+
+	memcpy(s->data + offset, frame + Fragmentation::HEADER_LEN, expect);
+	s->received |= (uint8_t)(1u << index);
+	if (s->received != (uint8_t)((1u << count) - 1)) return nullptr;
+
+	s->used = false; // buffer stays intact until the next accept()
+	counters.completed++;
+	outLen = s->totalLen;
+	return s->data;
+}
@@ -0,0 +1,113 @@
+#ifndef FRAGMENTATION_H
+#define FRAGMENTATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#if __has_include(<esp_now.h>)
+#include <esp_now.h>
+#endif
+#include "WireCodec.h"
+
+// Transport for messages larger than one ESP-NOW frame.
+//
+// Peers negotiate their largest frame at join time (JoinRequest caps "mtu",
+// JoinAccept "mtu"): 1470 bytes when both run ESP-NOW v2, 250 otherwise.
+// A message that does not fit the negotiated frame is split into FRAGMENT
+// frames:
+//
+//   [header 4][msg_id u8][index u8][count u8][total_len u16][chunk]
+//
+// Every chunk but the last holds ceil(total_len / count) bytes, so a fragment's
+// offset follows from its index. The receiver reassembles into a fixed pool of
+// buffers; partial messages expire after REASSEMBLY_TIMEOUT_MS and the oldest
+// is evicted when a new message finds the pool full.
+namespace Fragmentation {
+
+static constexpr uint8_t TYPE = 12; // binary TYPE byte, reserved as MessageType::FRAGMENT
+static constexpr size_t HEADER_LEN = WireCodec::HEADER_LEN + 5;
+static constexpr size_t MAX_FRAGMENTS = 8;
+static constexpr uint32_t REASSEMBLY_TIMEOUT_MS = 500;
+
+static_assert((WireCodec::MAX_MESSAGE_LEN + WireCodec::MAX_FRAME_LEN - HEADER_LEN - 1) / (WireCodec::MAX_FRAME_LEN - HEADER_LEN) <= MAX_FRAGMENTS,
+              "largest message must fit MAX_FRAGMENTS v1 frames");
+
+// Largest single frame this build can send or receive
+constexpr uint16_t localMaxFrameLen() {
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+	return ESP_NOW_MAX_DATA_LEN_V2;
+#else
+	return WireCodec::MAX_FRAME_LEN;
+#endif
+}
+
+inline bool isFragment(const uint8_t* data, size_t len) {
+	return WireCodec::isBinaryFrame(data, len) && data[2] == TYPE;
+}
+
+// Fragments needed for len bytes with frames of at most mtu; 0 if impossible
+size_t fragmentCount(size_t len, size_t mtu);
+
+// Write fragment `index` of `count` into out; returns its length (0 on error)
+size_t buildFragment(const uint8_t* data, size_t len, uint8_t msgId, uint8_t index, uint8_t count,
+                     uint8_t* out, size_t cap);
+
+// Split data and hand each fragment to sendFrame(frame, len) -> bool, in order.
+// Stops at the first failed send.
+template <typename SendFrame>
+bool send(const uint8_t* data, size_t len, size_t mtu, uint8_t msgId, SendFrame&& sendFrame) {
+	if (mtu > WireCodec::MAX_FRAME_LEN) mtu = WireCodec::MAX_FRAME_LEN; // only v1 peers need fragments
+	size_t count = fragmentCount(len, mtu);
+	if (count == 0) return false;
+	uint8_t frame[WireCodec::MAX_FRAME_LEN];
+	for (size_t i = 0; i < count; ++i) {
+		size_t n = buildFragment(data, len, msgId, (uint8_t)i, (uint8_t)count, frame, mtu);
+		if (n == 0 || !sendFrame(frame, n)) return false;
+	}
+	return true;
+}
+
+} // namespace Fragmentation
+
+// Receive side: bounded reassembly, one buffer per in-flight message
+class Reassembler {
+public:
+	static constexpr size_t SLOTS = 4;
+
+	struct Stats {
+		uint32_t completed; // messages delivered
+		uint32_t expired;   // timed out with fragments missing
+		uint32_t evicted;   // dropped to make room for a newer message
+		uint32_t rejected;  // malformed or inconsistent fragments
+	};
+
+	Reassembler();
+
+	// Feed one FRAGMENT frame from mac. Returns the complete message when its
+	// last fragment arrives (valid until the next accept()), nullptr otherwise.
+	const uint8_t* accept(const uint8_t mac[6], const uint8_t* frame, size_t len, uint32_t nowMs, size_t& outLen);
+
+	const Stats& stats() const { return counters; }
+	size_t inFlight() const;
+
+private:
+	struct Slot {
+		bool used;
+		uint8_t mac[6];
+		uint8_t msgId;
+		uint8_t count;
+		uint8_t received; // bit per fragment index
+		uint16_t totalLen;
+		uint32_t startedMs;
+		uint8_t data[WireCodec::MAX_MESSAGE_LEN];
+	};
+
+	Slot* find(const uint8_t mac[6], uint8_t msgId);
+	Slot* claim(uint32_t nowMs);
+	void expire(uint32_t nowMs);
+
+	Slot slots[SLOTS];
+	Stats counters;
+};
+
+#endif // FRAGMENTATION_H
@@ -0,0 +1,48 @@
+#include "KeyDictionary.h"
+
+namespace {
+	// First firmware release that understands each dictionary version
+	struct Release {
+		uint16_t major;
+		uint16_t minor;
+		uint8_t version;
+	};
+
+	constexpr Release kReleases[] = {
+		{1, 1, KeyDictionary::V1},
+	};
+
+	// Parse a decimal run at s; false if there is none
+	bool parseNumber(const char*& s, uint16_t& out) {
+		if (*s < '0' || *s > '9') return false;
+		uint32_t v = 0;
+		while (*s >= '0' && *s <= '9') {
+			v = v * 10 + (uint32_t)(*s - '0');
+			if (v > 0xFFFF) return false;
+			++s;
+		}
+		out = (uint16_t)v;
+		return true;
+	}
+}
+
+namespace KeyDictionary {
+
+uint8_t forFirmware(const char* fw) {
+	if (!fw) return NONE;
+	// Version follows the last '-' ("c3-1.1.0"); a bare "1.1.0" also works
+	const char* s = fw;
+	for (const char* p = fw; *p; ++p) {
+		if (*p == '-') s = p + 1;
+	}
+	uint16_t major = 0, minor = 0;
+	if (!parseNumber(s, major) || *s++ != '.' || !parseNumber(s, minor)) return NONE;
+
+	uint8_t version = NONE;
+	for (const Release& r : kReleases) {
+		if (major > r.major || (major == r.major && minor >= r.minor)) version = r.version;
+	}
+	return version;
+}
+
+} // namespace KeyDictionary
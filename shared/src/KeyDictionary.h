@@ -0,0 +1,107 @@
+#ifndef KEY_DICTIONARY_H
+#define KEY_DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Short JSON keys for peers that still exchange JSON frames (debug builds,
+// firmware without bin_wire).
+//
+// The coordinator picks a dictionary version from JoinRequestMessage::fw and
+// echoes it in JoinAcceptMessage ("kd"); from then on both sides write the
+// tokens below instead of the long keys. Receivers always accept either form,
+// so frames in flight around a (re)join decode regardless of which side
+// switched first. "msg" is never shortened: the classifier looks for it.
+//
+// The table is append only. A token is never reassigned or removed, and a new
+// version only adds entries, so decoding with the latest table is always
+// correct.
+namespace KeyDictionary {
+
+static constexpr uint8_t NONE = 0;
+static constexpr uint8_t V1 = 1;
+static constexpr uint8_t LATEST = V1;
+
+struct Entry {
+	const char* key;
+	const char* token;
+	uint8_t since; // first dictionary version with this entry
+};
+
+static constexpr Entry kEntries[] = {
+	// Common
+	{"node_id", "ni", V1},
+	{"light_id", "li", V1},
+	{"cmd_id", "ci", V1},
+	// set_light
+	{"value", "v", V1},
+	{"fade_ms", "fm", V1},
+	{"override_status", "os", V1},
+	{"ttl_ms", "tl", V1},
+	{"pixel", "px", V1},
+	{"reason", "rs", V1},
+	// node_status
+	{"avg_r", "ar", V1},
+	{"avg_g", "ag", V1},
+	{"avg_b", "ab", V1},
+	{"avg_w", "aw", V1},
+	{"status_mode", "sm", V1},
+	{"vbat_mv", "vb", V1},
+	{"temperature", "tp", V1},
+	{"button_pressed", "bp", V1},
+	// join_accept (the reply to a join already knows the node's version)
+	{"wifi_channel", "ch", V1},
+	{"cfg", "cf", V1},
+	{"pwm_freq", "pf", V1},
+	{"rx_window_ms", "rw", V1},
+	{"rx_period_ms", "rp", V1},
+	// error
+	{"code", "cd", V1},
+	{"info", "in", V1},
+};
+static constexpr size_t kEntryCount = sizeof(kEntries) / sizeof(kEntries[0]);
+
+constexpr bool sameKey(const char* a, const char* b) {
+	while (*a && *a == *b) { ++a; ++b; }
+	return *a == *b;
+}
+
+constexpr const Entry* find(const char* key) {
+	for (size_t i = 0; i < kEntryCount; ++i) {
+		if (sameKey(kEntries[i].key, key)) return &kEntries[i];
+	}
+	return nullptr;
+}
+
+// Token for key, or key itself when it has no entry
+constexpr const char* tokenFor(const char* key) {
+	const Entry* e = find(key);
+	return e ? e->token : key;
+}
+
+// Dictionary version that introduced key's token; NONE when it has none
+constexpr uint8_t versionFor(const char* key) {
+	const Entry* e = find(key);
+	return e ? e->since : NONE;
+}
+
+// Tokens are unique, never a long key and never "msg"
+constexpr bool isUnambiguous() {
+	for (size_t i = 0; i < kEntryCount; ++i) {
+		if (sameKey(kEntries[i].token, "msg") || kEntries[i].since == NONE || kEntries[i].since > LATEST) return false;
+		for (size_t j = 0; j < kEntryCount; ++j) {
+			if (sameKey(kEntries[i].token, kEntries[j].key)) return false;
+			if (i != j && (sameKey(kEntries[i].token, kEntries[j].token) || sameKey(kEntries[i].key, kEntries[j].key))) return false;
+		}
+	}
+	return true;
+}
+static_assert(isUnambiguous(), "key dictionary tokens must be unique and distinct from every long key");
+
+// Newest dictionary a peer running firmware `fw` ("c3-1.1.0") understands.
+// NONE for firmware before 1.1.0 or a string that does not parse.
+uint8_t forFirmware(const char* fw);
+
+} // namespace KeyDictionary
+
+#endif // KEY_DICTIONARY_H
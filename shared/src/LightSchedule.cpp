@@ -0,0 +1,47 @@
+#include "LightSchedule.h"
+#include <string.h>
+
+LightSchedule::LightSchedule() : count(0) {
+	memset(&counters, 0, sizeof(counters));
+}
+
+bool LightSchedule::add(const Action& a, uint32_t nowMs) {
+	int32_t lead = (int32_t)(a.dueMs - nowMs);
+	if (lead <= 0) {
+		if (lead < 0) counters.late++;
+		return false;
+	}
+	if ((uint32_t)lead > MAX_LEAD_MS || count == CAPACITY) {
+		counters.refused++;
+		return false;
+	}
+	// Insert after everything due no later (wrap-safe against nowMs)
+	size_t i = count;
+	while (i > 0 && (int32_t)(pending[i - 1].dueMs - a.dueMs) > 0) {
+		pending[i] = pending[i - 1];
+		--i;
+	}
+	pending[i] = a;
+	count++;
+	counters.queued++;
+	return true;
+}
+
+bool LightSchedule::popDue(uint32_t nowMs, Action& out) {
+	if (count == 0 || (int32_t)(pending[0].dueMs - nowMs) > 0) return false;
+	out = pending[0];
+	memmove(pending, pending + 1, (count - 1) * sizeof(Action));
+	count--;
+	return true;
+}
+
+void LightSchedule::supersede() {
+	counters.superseded += count;
+	count = 0;
+}
+
+uint32_t LightSchedule::msUntilNext(uint32_t nowMs) const {
+	if (count == 0) return UINT32_MAX;
+	int32_t lead = (int32_t)(pending[0].dueMs - nowMs);
+	return lead > 0 ? (uint32_t)lead : 0;
+}
@@ -0,0 +1,69 @@
+#ifndef LIGHT_SCHEDULE_H
+#define LIGHT_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Execute-at light commands.
+//
+// The coordinator addresses tiles one frame after another, so without help the
+// last tile of a transition changes tens of milliseconds after the first. A
+// set_light or light_batch carrying at_ms names the instant in the coordinator
+// timebase instead; nodes convert it to their own millis() (TimeSync) and hold
+// the command here until then, so every tile applies it on the same frame
+// whatever order the frames arrived in.
+//
+// Node side: a small queue in front of LedController, run in due order (equal
+// due times keep arrival order). Commands that are already due, implausibly far
+// out, or that find the queue full are not held; the caller applies them at
+// once, as it would without a time, and calls supersede() so nothing held from
+// before can come due later and overwrite the newer command.
+class LightSchedule {
+public:
+	static constexpr size_t CAPACITY = 8;
+	static constexpr uint32_t MAX_LEAD_MS = 5000; // further out means a bad clock
+
+	// Coordinator side: how far ahead to schedule a transition that takes
+	// `frames` frames to send, leaving room for queueing and MAC retries
+	static constexpr uint32_t BASE_LEAD_MS = 30;
+	static constexpr uint32_t PER_FRAME_LEAD_MS = 3;
+	static constexpr uint32_t leadMs(size_t frames) {
+		return BASE_LEAD_MS + (uint32_t)frames * PER_FRAME_LEAD_MS;
+	}
+
+	struct Action {
+		uint32_t dueMs; // local millis()
+		uint8_t r, g, b, w;
+		uint16_t fade_ms;
+		int8_t pixel;   // -1 = all pixels
+	};
+
+	struct Stats {
+		uint32_t queued;  // held until due
+		uint32_t late;    // due time already past on arrival
+		uint32_t refused; // too far ahead or queue full
+		uint32_t superseded; // held, then dropped for a newer command
+	};
+
+	LightSchedule();
+
+	// Hold a until its due time; false means apply it now
+	bool add(const Action& a, uint32_t nowMs);
+	// Next action due at nowMs, in due order; false if none is due
+	bool popDue(uint32_t nowMs, Action& out);
+	// Milliseconds until the next held action (0 if due, UINT32_MAX if none)
+	uint32_t msUntilNext(uint32_t nowMs) const;
+	// A newer command is being applied now: drop everything held
+	void supersede();
+	void clear() { count = 0; }
+	size_t size() const { return count; }
+
+	const Stats& stats() const { return counters; }
+
+private:
+	Action pending[CAPACITY]; // sorted by dueMs
+	size_t count;
+	Stats counters;
+};
+
+#endif // LIGHT_SCHEDULE_H
@@ -0,0 +1,402 @@
+#ifndef MESSAGE_SCHEMA_H
+#define MESSAGE_SCHEMA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <tuple>
+#include <type_traits>
+#include "WireCodec.h"
+#include "FixedString.h"
+#include "KeyDictionary.h"
+
+// Compile-time field descriptors for ESP-NOW messages.
+//
+// Each message lists its fields once, in wire order, in a constexpr schema():
+//
+//   static constexpr auto schema() {
+//       using S = MessageSchema::Fields<SetLightMessage>;
+//       return std::make_tuple(
+//           S::field("cmd_id", &SetLightMessage::cmd_id),
+//           S::field("ttl_ms", &SetLightMessage::ttl_ms, (uint16_t)1500),
+//           S::nested("caps", "rgbw", &X::caps, &X::Capabilities::rgbw));
+//   }
+//
+// From that table this header generates default initialisation, the JSON
+// writer/reader (absent key -> field default, always), the binary body
+// codec and worst-case encoded sizes for static_assert. Keys listed in
+// KeyDictionary.h are written as their short token for peers that negotiated
+// a dictionary, and read back in either form.
+namespace MessageSchema {
+
+enum FieldFlags : uint8_t {
+	NONE = 0,
+	OMIT_DEFAULT = 1 << 0, // JSON: leave the key out while the value equals its default
+	JSON_ONLY = 1 << 1,    // not carried in binary frames
+};
+
+// ---- Per-type wire behaviour ----
+// maxBinary / maxJson are worst-case encoded sizes of one value.
+template <typename T, typename Enable = void>
+struct Codec;
+
+template <typename T>
+struct Codec<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+	// `int` fields are carried as 16 bits on the wire, like the uint16_t ones
+	static constexpr size_t width = sizeof(T) > 2 && !std::is_same<T, uint32_t>::value ? 2 : sizeof(T);
+	static constexpr size_t maxBinary = width;
+	static constexpr size_t maxJson = width == 1 ? 4 : width == 2 ? 6 : 11;
+
+	static void put(WireCodec::Writer& w, T v) {
+		if (width == 1) w.u8((uint8_t)v);
+		else if (width == 2) w.u16((uint16_t)v);
+		else w.u32((uint32_t)v);
+	}
+	static T get(WireCodec::Reader& r) {
+		if (width == 1) return std::is_signed<T>::value ? (T)r.i8() : (T)r.u8();
+		if (width == 2) return std::is_signed<T>::value ? (T)r.i16() : (T)r.u16();
+		return (T)r.u32();
+	}
+	static T json(T v) { return v; }
+	static T fromJson(JsonVariantConst v) { return v.as<T>(); }
+	static bool equal(T a, T b) { return a == b; }
+};
+
+template <>
+struct Codec<bool> {
+	static constexpr size_t maxBinary = 1;
+	static constexpr size_t maxJson = 5;
+	static void put(WireCodec::Writer& w, bool v) { w.boolean(v); }
+	static bool get(WireCodec::Reader& r) { return r.boolean(); }
+	static bool json(bool v) { return v; }
+	static bool fromJson(JsonVariantConst v) { return v.as<bool>(); }
+	static bool equal(bool a, bool b) { return a == b; }
+};
+
+// Floats travel as centi-units in binary (see WireCodec::Writer::centi)
+template <>
+struct Codec<float> {
+	static constexpr size_t maxBinary = 2;
+	static constexpr size_t maxJson = 12;
+	static void put(WireCodec::Writer& w, float v) { w.centi(v); }
+	static float get(WireCodec::Reader& r) { return r.centi(); }
+	static float json(float v) { return v; }
+	static float fromJson(JsonVariantConst v) { return v.as<float>(); }
+	// Same value on the wire; delta masks rely on this matching the encoder
+	static bool equal(float a, float b) { return WireCodec::toCenti(a) == WireCodec::toCenti(b); }
+};
+
+// JSON bound assumes printable ASCII without escapes (ids, tags, hex keys)
+template <size_t N>
+struct Codec<FixedString<N>> {
+	static constexpr size_t maxBinary = 1 + N;
+	static constexpr size_t maxJson = 2 + N;
+	static void put(WireCodec::Writer& w, const FixedString<N>& v) { w.str(v.c_str(), v.length()); }
+	static FixedString<N> get(WireCodec::Reader& r) {
+		size_t n = 0;
+		const char* p = r.str(n);
+		FixedString<N> out;
+		out.assign(p, n);
+		return out;
+	}
+	static const char* json(const FixedString<N>& v) { return v.c_str(); }
+	static FixedString<N> fromJson(JsonVariantConst v) { return FixedString<N>(v | ""); }
+	static bool equal(const FixedString<N>& a, const FixedString<N>& b) { return a == b; }
+};
+
+// ---- Field descriptors ----
+
+// Bytes a JSON key adds around its value: "key": plus the separating comma
+constexpr size_t keyOverhead(const char* k) { return k[0] ? 1 + keyOverhead(k + 1) : 4; }
+
+// Key to write for a peer using dictionary version dict
+constexpr const char* keyFor(const char* key, const char* token, uint8_t since, uint8_t dict) {
+	return (since != KeyDictionary::NONE && dict >= since) ? token : key;
+}
+
+// Long key first, then its token; frames never carry both
+inline JsonVariantConst lookup(JsonVariantConst obj, const char* key, const char* token) {
+	JsonVariantConst v = obj[key];
+	if (v.isNull() && token != key) v = obj[token];
+	return v;
+}
+
+template <typename Msg, typename T>
+struct Field {
+	using Type = T;
+	const char* key;
+	T Msg::* member;
+	T def;
+	uint8_t flags;
+
+	const char* token;    // KeyDictionary short form, == key when there is none
+	uint8_t since;        // dictionary version that introduced token
+
+	T& ref(Msg& m) const { return m.*member; }
+	const T& ref(const Msg& m) const { return m.*member; }
+	JsonVariantConst locate(JsonVariantConst doc) const { return lookup(doc, key, token); }
+	template <typename Doc>
+	void store(Doc& doc, const T& v, uint8_t dict) const { doc[keyFor(key, token, since, dict)] = Codec<T>::json(v); }
+	constexpr size_t maxJson() const { return keyOverhead(key) + Codec<T>::maxJson; }
+	constexpr const char* groupKey() const { return nullptr; }
+};
+
+// A field one level down in a JSON object ("caps": {"rgbw": ...})
+template <typename Msg, typename G, typename T>
+struct NestedField {
+	using Type = T;
+	const char* group;
+	const char* key;
+	G Msg::* outer;
+	T G::* inner;
+	T def;
+	uint8_t flags;
+
+	const char* groupToken;
+	uint8_t groupSince;
+	const char* token;
+	uint8_t since;
+
+	T& ref(Msg& m) const { return (m.*outer).*inner; }
+	const T& ref(const Msg& m) const { return (m.*outer).*inner; }
+	JsonVariantConst locate(JsonVariantConst doc) const {
+		return lookup(lookup(doc, group, groupToken), key, token);
+	}
+	template <typename Doc>
+	void store(Doc& doc, const T& v, uint8_t dict) const {
+		doc[keyFor(group, groupToken, groupSince, dict)][keyFor(key, token, since, dict)] = Codec<T>::json(v);
+	}
+	// Excludes the group's own key and braces; maxJsonSize() adds those once
+	// per group, so fields of one group must be listed next to each other.
+	constexpr size_t maxJson() const { return keyOverhead(key) + Codec<T>::maxJson; }
+	constexpr const char* groupKey() const { return group; }
+};
+
+// Builders; accept members declared on a base (e.g. EspNowMessage::cmd_id)
+template <typename Msg>
+struct Fields {
+	template <typename T, typename C>
+	static constexpr Field<Msg, T> field(const char* key, T C::* m, T def = T(), uint8_t flags = NONE) {
+		static_assert(std::is_base_of<C, Msg>::value, "field must belong to the message");
+		return Field<Msg, T>{key, static_cast<T Msg::*>(m), def, flags,
+		                     KeyDictionary::tokenFor(key), KeyDictionary::versionFor(key)};
+	}
+	template <typename G, typename T>
+	static constexpr NestedField<Msg, G, T> nested(const char* group, const char* key, G Msg::* outer, T G::* inner,
+	                                               T def = T(), uint8_t flags = NONE) {
+		return NestedField<Msg, G, T>{group, key, outer, inner, def, flags,
+		                              KeyDictionary::tokenFor(group), KeyDictionary::versionFor(group),
+		                              KeyDictionary::tokenFor(key), KeyDictionary::versionFor(key)};
+	}
+};
+
+template <typename F, typename Tuple, size_t... I>
+void forEachImpl(Tuple&& t, F&& f, std::index_sequence<I...>) {
+	(void)std::initializer_list<int>{(f(std::get<I>(t)), 0)...};
+}
+
+template <typename Msg, typename F>
+void forEach(F&& f) {
+	static constexpr auto fields = Msg::schema();
+	forEachImpl(fields, f, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>{});
+}
+
+// As forEach, also passing the field's schema index
+template <typename F, typename Tuple, size_t... I>
+void forEachIndexedImpl(Tuple&& t, F&& f, std::index_sequence<I...>) {
+	(void)std::initializer_list<int>{(f(std::get<I>(t), I), 0)...};
+}
+
+template <typename Msg, typename F>
+void forEachIndexed(F&& f) {
+	static constexpr auto fields = Msg::schema();
+	forEachIndexedImpl(fields, f, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>{});
+}
+
+template <typename Msg>
+constexpr size_t fieldCount() {
+	return std::tuple_size<decltype(Msg::schema())>::value;
+}
+
+// ---- Generated operations ----
+
+template <typename Msg>
+void reset(Msg& m) {
+	forEach<Msg>([&m](const auto& f) { f.ref(m) = f.def; });
+}
+
+// dict: KeyDictionary version negotiated with the receiving peer
+template <typename Msg, typename Doc>
+void writeJson(const Msg& m, Doc& doc, uint8_t dict = KeyDictionary::NONE) {
+	doc["msg"] = m.msg.c_str();
+	forEach<Msg>([&](const auto& f) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if ((f.flags & OMIT_DEFAULT) && Codec<T>::equal(f.ref(m), f.def)) return;
+		f.store(doc, f.ref(m), dict);
+	});
+}
+
+template <typename Msg>
+bool readJson(Msg& m, JsonVariantConst doc) {
+	m.msg = doc["msg"] | "";
+	forEach<Msg>([&](const auto& f) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		JsonVariantConst v = f.locate(doc);
+		f.ref(m) = v.isNull() ? f.def : Codec<T>::fromJson(v);
+	});
+	return true;
+}
+
+template <typename Msg>
+void writeBinary(const Msg& m, WireCodec::Writer& w) {
+	forEach<Msg>([&](const auto& f) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if (f.flags & JSON_ONLY) return;
+		Codec<T>::put(w, f.ref(m));
+	});
+}
+
+// Fields past the end of the frame take their defaults, so frames from peers
+// built before a field was appended still decode.
+template <typename Msg>
+bool readBinary(Msg& m, WireCodec::Reader& r) {
+	forEach<Msg>([&](const auto& f) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if ((f.flags & JSON_ONLY) || (r.ok() && r.remaining() == 0)) {
+			f.ref(m) = f.def;
+			return;
+		}
+		f.ref(m) = Codec<T>::get(r);
+	});
+	return r.ok();
+}
+
+// Field-by-field equality, floats at binary (centi-unit) precision
+template <typename Msg>
+bool equal(const Msg& a, const Msg& b) {
+	bool same = true;
+	forEach<Msg>([&](const auto& f) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if (!Codec<T>::equal(f.ref(a), f.ref(b))) same = false;
+	});
+	return same;
+}
+
+// ---- Field masks (delta encoding) ----
+// Bit i stands for field i of the schema. JSON_ONLY fields never get a bit.
+
+template <typename Msg>
+uint32_t changedMask(const Msg& base, const Msg& m) {
+	static_assert(fieldCount<Msg>() <= 32, "field mask holds at most 32 fields");
+	uint32_t mask = 0;
+	forEachIndexed<Msg>([&](const auto& f, size_t i) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if (f.flags & JSON_ONLY) return;
+		if (!Codec<T>::equal(f.ref(base), f.ref(m))) mask |= 1UL << i;
+	});
+	return mask;
+}
+
+// Binary body holding only the masked fields, in schema order
+template <typename Msg>
+void writeMasked(const Msg& m, uint32_t mask, WireCodec::Writer& w) {
+	forEachIndexed<Msg>([&](const auto& f, size_t i) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if ((f.flags & JSON_ONLY) || !(mask & (1UL << i))) return;
+		Codec<T>::put(w, f.ref(m));
+	});
+}
+
+// Counterpart of writeMasked(); fields outside the mask are left untouched
+template <typename Msg>
+bool readMasked(Msg& m, uint32_t mask, WireCodec::Reader& r) {
+	forEachIndexed<Msg>([&](const auto& f, size_t i) {
+		using T = typename std::decay_t<decltype(f)>::Type;
+		if ((f.flags & JSON_ONLY) || !(mask & (1UL << i))) return;
+		f.ref(m) = Codec<T>::get(r);
+	});
+	return r.ok();
+}
+
+// Copy the masked fields of src over dst
+template <typename Msg>
+void applyMasked(Msg& dst, const Msg& src, uint32_t mask) {
+	forEachIndexed<Msg>([&](const auto& f, size_t i) {
+		if (mask & (1UL << i)) f.ref(dst) = f.ref(src);
+	});
+}
+
+// ---- Worst-case sizes ----
+
+template <typename Tuple, size_t... I>
+constexpr size_t maxBinaryImpl(const Tuple& t, std::index_sequence<I...>) {
+	size_t sum = 0;
+	const size_t parts[] = {0, ((std::get<I>(t).flags & JSON_ONLY) ? 0 : Codec<typename std::tuple_element<I, Tuple>::type::Type>::maxBinary)...};
+	for (size_t p : parts) sum += p;
+	return sum;
+}
+
+constexpr bool sameKey(const char* a, const char* b) {
+	return (!a || !b) ? a == b : (*a == *b && (*a == '\0' || sameKey(a + 1, b + 1)));
+}
+
+template <typename Tuple, size_t... I>
+constexpr size_t maxJsonImpl(const Tuple& t, std::index_sequence<I...>) {
+	size_t sum = 0;
+	const size_t parts[] = {0, std::get<I>(t).maxJson()...};
+	const char* const groups[] = {nullptr, std::get<I>(t).groupKey()...};
+	for (size_t i = 1; i < sizeof(parts) / sizeof(parts[0]); ++i) {
+		sum += parts[i];
+		if (groups[i] && !sameKey(groups[i], groups[i - 1])) {
+			sum += keyOverhead(groups[i]) + 2; // "group":{ ... },
+		}
+	}
+	return sum;
+}
+
+template <typename Msg>
+constexpr size_t maxBinarySize() {
+	constexpr auto fields = Msg::schema();
+	return WireCodec::HEADER_LEN +
+	       maxBinaryImpl(fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>{});
+}
+
+// {"msg":"<name>",...} with every field present at its longest
+template <typename Msg>
+constexpr size_t maxJsonSize() {
+	constexpr auto fields = Msg::schema();
+	return 2 + keyOverhead("msg") + keyOverhead(Msg::NAME) - 2 +
+	       maxJsonImpl(fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>{});
+}
+
+template <typename Tuple, size_t... I>
+constexpr bool tokensDistinctImpl(const Tuple& t, std::index_sequence<I...>) {
+	const char* const keys[] = {"msg", std::get<I>(t).key...};
+	const char* const groups[] = {"msg", std::get<I>(t).groupKey()...};
+	const char* const tokens[] = {"msg", std::get<I>(t).token...};
+	const size_t n = sizeof(keys) / sizeof(keys[0]);
+	for (size_t i = 1; i < n; ++i) {
+		if (tokens[i] == keys[i]) continue;
+		for (size_t j = 0; j < n; ++j) {
+			if (sameKey(tokens[i], keys[j]) || sameKey(tokens[i], groups[j])) return false;
+		}
+	}
+	return true;
+}
+
+// No dictionary token of Msg can be mistaken for one of its long keys
+template <typename Msg>
+constexpr bool tokensDistinct() {
+	constexpr auto fields = Msg::schema();
+	return tokensDistinctImpl(fields, std::make_index_sequence<std::tuple_size<decltype(fields)>::value>{});
+}
+
+// Worst case of the encoding a peer will actually use for this type:
+// binary when the type has a binary layout, JSON otherwise.
+template <typename Msg>
+constexpr size_t maxFrameSize() {
+	return Msg::HAS_BINARY ? maxBinarySize<Msg>() : maxJsonSize<Msg>();
+}
+
+} // namespace MessageSchema
+
+#endif // MESSAGE_SCHEMA_H
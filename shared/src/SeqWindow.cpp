@@ -0,0 +1,47 @@
+#include "SeqWindow.h"
+
+void SeqWindow::reset() {
+	seen = 0;
+	highest = 0;
+	staleRun = 0;
+	started = false;
+}
+
+SeqWindow::Verdict SeqWindow::accept(uint16_t seq) {
+	int16_t ahead = (int16_t)(uint16_t)(seq - highest);
+	if (!started || ahead > 0) {
+		// Slide forward; everything that falls off the end is forgotten
+		if (!started || ahead >= (int16_t)WINDOW) {
+			seen = 0;
+		} else {
+			seen <<= ahead;
+		}
+		seen |= 1;
+		highest = seq;
+		staleRun = 0;
+		started = true;
+		return Verdict::FRESH;
+	}
+	uint16_t behind = (uint16_t)(highest - seq);
+	if (behind < WINDOW) {
+		uint64_t bit = (uint64_t)1 << behind;
+		if (seen & bit) return Verdict::DUPLICATE;
+		seen |= bit;
+		staleRun = 0;
+		return Verdict::FRESH;
+	}
+	if (++staleRun < RESYNC_AFTER) return Verdict::STALE;
+	seen = 1;
+	highest = seq;
+	staleRun = 0;
+	return Verdict::RESYNC;
+}
+
+void SeqWindow::count(Verdict v, Stats& stats) {
+	switch (v) {
+		case Verdict::DUPLICATE: stats.duplicates++; break;
+		case Verdict::STALE:     stats.stale++; break;
+		case Verdict::RESYNC:    stats.resyncs++; break;
+		default: break;
+	}
+}
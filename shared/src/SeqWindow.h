@@ -0,0 +1,59 @@
+#ifndef SEQ_WINDOW_H
+#define SEQ_WINDOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Duplicate filter for one sender's sequence numbers.
+//
+// Every message carries a 16-bit number counted by its sender per destination
+// (each unicast peer, and broadcast); WireCodec::stampSeq() adds it before any
+// fragmenting, so a reassembled message is checked once. The receiver keeps
+// one window per sender and drops a message whose number it has already seen,
+// so a frame the radio delivered twice is handled once.
+//
+// The window is the highest number seen plus a bitmap of the WINDOW before it:
+// frames the sender's priority queue reordered (a few at most) still get
+// through. Numbers compare wrap-safe. One older than the window cannot be told
+// from a duplicate and is dropped - unless RESYNC_AFTER arrive in a row, which
+// means the sender restarted its count (a reboot): the window then starts over
+// from there. Sixteen bytes per sender, no allocation.
+//
+// A retransmission the sender decides on (CommandTracker) is a new message
+// with a new number; its cmd_id still lets the node re-ack without reapplying.
+class SeqWindow {
+public:
+	static constexpr uint16_t WINDOW = 64;
+	static constexpr uint8_t RESYNC_AFTER = 3;
+
+	enum class Verdict : uint8_t {
+		FRESH,     // not seen before: handle it
+		DUPLICATE, // seen before: drop
+		STALE,     // older than the window: drop
+		RESYNC     // sender started counting again: handle it
+	};
+
+	struct Stats {
+		uint32_t duplicates;
+		uint32_t stale;
+		uint32_t resyncs;
+	};
+
+	SeqWindow() { reset(); }
+	// Forget the sender's history; the next number starts a new window
+	void reset();
+	// Check seq and remember it as seen
+	Verdict accept(uint16_t seq);
+
+	static bool handle(Verdict v) { return v == Verdict::FRESH || v == Verdict::RESYNC; }
+	// Tally a verdict into caller-owned counters
+	static void count(Verdict v, Stats& stats);
+
+private:
+	uint64_t seen;     // bit i set: highest - i has arrived
+	uint16_t highest;
+	uint8_t staleRun;  // stale numbers in a row
+	bool started;
+};
+
+#endif // SEQ_WINDOW_H
@@ -0,0 +1,98 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer / single-consumer ring of fixed-size slots.
+//
+// Hands frames from an ESP-NOW driver callback (Wi-Fi task) to the main loop
+// without locks, allocation or a second copy: the producer fills a slot in
+// place between acquire() and publish(), the consumer reads front() and frees
+// it with pop(). head and tail are free-running counters (slot = index % N,
+// depth = head - tail), each written by one side only.
+//
+// Exactly one task may use the producer side and one the consumer side.
+// stats() and size() may be read from anywhere.
+template <typename T, size_t N>
+class SpscRing {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "ring capacity must be a power of two");
+
+public:
+	struct Stats {
+		uint32_t pushed;    // slots published
+		uint32_t dropped;   // acquire() found the ring full
+		uint32_t highWater; // deepest the ring has been
+	};
+
+	// ---- Producer ----
+
+	// Next free slot, or nullptr (counted as a drop) when the consumer is behind
+	T* acquire() {
+		uint32_t head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) >= N) {
+			dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return &slots_[head & (N - 1)];
+	}
+
+	// Make the slot from acquire() visible to the consumer
+	void publish() {
+		uint32_t head = head_.load(std::memory_order_relaxed) + 1;
+		head_.store(head, std::memory_order_release);
+		pushed_.store(pushed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		uint32_t depth = head - tail_.load(std::memory_order_relaxed);
+		if (depth > highWater_.load(std::memory_order_relaxed)) {
+			highWater_.store(depth, std::memory_order_relaxed);
+		}
+	}
+
+	bool push(const T& v) {
+		T* slot = acquire();
+		if (!slot) return false;
+		*slot = v;
+		publish();
+		return true;
+	}
+
+	// ---- Consumer ----
+
+	// Oldest published slot, or nullptr when empty
+	T* front() {
+		uint32_t tail = tail_.load(std::memory_order_relaxed);
+		if (head_.load(std::memory_order_acquire) == tail) return nullptr;
+		return &slots_[tail & (N - 1)];
+	}
+
+	// Release the slot returned by front()
+	void pop() {
+		tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// ---- Either side ----
+
+	size_t size() const {
+		uint32_t tail = tail_.load(std::memory_order_acquire); // tail first: head never trails it
+		return head_.load(std::memory_order_acquire) - tail;
+	}
+	static constexpr size_t capacity() { return N; }
+
+	Stats stats() const {
+		return Stats{pushed_.load(std::memory_order_relaxed),
+		             dropped_.load(std::memory_order_relaxed),
+		             highWater_.load(std::memory_order_relaxed)};
+	}
+
+private:
+	T slots_[N];
+	std::atomic<uint32_t> head_{0};
+	std::atomic<uint32_t> tail_{0};
+	// Written by the producer only
+	std::atomic<uint32_t> pushed_{0};
+	std::atomic<uint32_t> dropped_{0};
+	std::atomic<uint32_t> highWater_{0};
+};
+
+#endif // SPSC_RING_H
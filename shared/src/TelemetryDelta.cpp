@@ -0,0 +1,86 @@
+#include "TelemetryDelta.h"
+#include "TimeSync.h"
+
+// --- TelemetryEncoder ---
+TelemetryEncoder::TelemetryEncoder(uint32_t keyframeIntervalMs)
+	: keyframeIntervalMs(keyframeIntervalMs)
+	, lastKeyframeMs(0)
+	, baseKey(0)
+	, pendingKey(0)
+	, nextKey(1) {}
+
+const EspNowMessage& TelemetryEncoder::next(const NodeStatusMessage& status, uint32_t nowMs) {
+	if (baseKey == 0 || nowMs - lastKeyframeMs >= keyframeIntervalMs) {
+		keyframe = status;
+		keyframe.key_id = nextKey;
+		pendingKey = nextKey;
+		nextKey = nextKey == 255 ? 1 : nextKey + 1; // 0 means "not a keyframe"
+		lastKeyframeMs = nowMs;
+		return keyframe;
+	}
+
+	delta.base_key = baseKey;
+	delta.fields = status;
+	delta.fields.key_id = baseKey;
+	delta.mask = (uint16_t)MessageSchema::changedMask(baseline, delta.fields);
+	return delta;
+}
+
+void TelemetryEncoder::onAck(const AckMessage& ack) {
+	if (ack.cmd_id == TelemetryDelta::RESYNC_CMD) {
+		reset();
+		return;
+	}
+	// Acks for older keyframes are ignored; the newest one sent wins
+	if (ack.key_id != 0 && ack.key_id == pendingKey) {
+		baseline = keyframe;
+		baseKey = pendingKey;
+		pendingKey = 0;
+	}
+}
+
+void TelemetryEncoder::reset() {
+	baseKey = 0;
+	pendingKey = 0;
+}
+
+// --- TelemetryBaselines ---
+void TelemetryBaselines::storeKeyframe(const String& nodeId, const NodeStatusMessage& status) {
+	if (status.key_id == 0) return;
+	baselines[nodeId] = status;
+}
+
+bool TelemetryBaselines::apply(const String& nodeId, const NodeStatusDeltaMessage& delta, NodeStatusMessage& out) const {
+	auto it = baselines.find(nodeId);
+	if (it == baselines.end() || it->second.key_id != delta.base_key) return false;
+	out = it->second;
+	MessageSchema::applyMasked(out, delta.fields, delta.mask);
+	return true;
+}
+
+void TelemetryBaselines::forget(const String& nodeId) {
+	baselines.erase(nodeId);
+}
+
+// --- TelemetryAcks ---
+TelemetryAcks::TelemetryAcks() : counters{} {}
+
+bool TelemetryAcks::needsUnicast(const String& nodeId, const NodeStatusMessage* status, bool keyframe, uint32_t nowMs) {
+	bool clockDue = false;
+	if (status) {
+		bool synced = status->clock_err_ms != 0 && status->clock_err_ms < TimeSync::TARGET_ERROR_MS;
+		auto it = lastClockMs.find(nodeId);
+		clockDue = !synced || it == lastClockMs.end() || nowMs - it->second >= CLOCK_REFRESH_MS;
+	}
+	if (!status || keyframe || clockDue) {
+		if (status) lastClockMs[nodeId] = nowMs;
+		counters.unicast++;
+		return true;
+	}
+	counters.coalesced++;
+	return false;
+}
+
+void TelemetryAcks::forget(const String& nodeId) {
+	lastClockMs.erase(nodeId);
+}
@@ -0,0 +1,102 @@
+#ifndef TELEMETRY_DELTA_H
+#define TELEMETRY_DELTA_H
+
+#include <Arduino.h>
+#include <map>
+#include "EspNowMessage.h"
+
+// Delta-compressed node telemetry.
+//
+// A node sends a full node_status keyframe tagged with a non-zero key_id; the
+// coordinator stores it as the node's baseline and echoes the key in its
+// telemetry ack. Once a keyframe is acked, the node sends status_delta frames
+// carrying only the fields that differ from it. A fresh keyframe goes out every
+// keyframe interval, and on every report while no keyframe has been acked.
+// If the coordinator lacks the baseline a delta names (reboot, ack lost while
+// a newer keyframe was stored) it answers with RESYNC_CMD and the node falls
+// back to a keyframe.
+namespace TelemetryDelta {
+	static constexpr const char* ACK_CMD = "telemetry_ack";
+	static constexpr const char* RESYNC_CMD = "telemetry_resync";
+}
+
+// Node side: chooses keyframe or delta and tracks the acked baseline
+class TelemetryEncoder {
+public:
+	explicit TelemetryEncoder(uint32_t keyframeIntervalMs);
+
+	// Message to send for the current status: a keyframe (node_status with
+	// key_id set) or a status_delta against the acked baseline. The reference
+	// stays valid until the next call.
+	const EspNowMessage& next(const NodeStatusMessage& status, uint32_t nowMs);
+
+	// Feed every telemetry ack from the coordinator
+	void onAck(const AckMessage& ack);
+
+	// Drop the baseline (re-pairing, wire format change); next report is a keyframe
+	void reset();
+
+	uint8_t baselineKey() const { return baseKey; }
+
+private:
+	uint32_t keyframeIntervalMs;
+	uint32_t lastKeyframeMs;
+	uint8_t baseKey;    // acked keyframe, 0 = none
+	uint8_t pendingKey; // last keyframe sent, awaiting ack
+	uint8_t nextKey;
+	NodeStatusMessage baseline;
+	NodeStatusMessage keyframe;
+	NodeStatusDeltaMessage delta;
+};
+
+// Coordinator side: newest keyframe per node, used to rebuild full state
+class TelemetryBaselines {
+public:
+	// Store a keyframe (status.key_id != 0) as the node's baseline
+	void storeKeyframe(const String& nodeId, const NodeStatusMessage& status);
+
+	// Rebuild the full status a delta describes into `out`.
+	// Returns false when the delta's baseline is not held (ask for a resync).
+	bool apply(const String& nodeId, const NodeStatusDeltaMessage& delta, NodeStatusMessage& out) const;
+
+	void forget(const String& nodeId);
+	size_t size() const { return baselines.size(); }
+
+private:
+	std::map<String, NodeStatusMessage> baselines;
+};
+
+// Coordinator side: which telemetry still gets its own unicast ack.
+//
+// Every report is acknowledged by the next beacon's heard map, which is all a
+// node needs to know its coordinator still hears it. A unicast ack goes out
+// only when it carries something for that node alone: confirming a keyframe,
+// asking for one (resync), or a clock sync exchange - on every report while
+// the node's clock is not synced, and every CLOCK_REFRESH_MS after that.
+// Nodes that predate clock sync never report clock_err_ms, so they keep an
+// ack per report.
+class TelemetryAcks {
+public:
+	static constexpr uint32_t CLOCK_REFRESH_MS = 10000;
+
+	struct Stats {
+		uint32_t unicast;   // reports answered with their own ack
+		uint32_t coalesced; // reports left to the beacon
+	};
+
+	TelemetryAcks();
+
+	// For a report from nodeId: status is the full (rebuilt) telemetry, or
+	// nullptr when it could not be rebuilt. True means send a unicast ack now;
+	// it is taken to carry a clock exchange when status is known.
+	bool needsUnicast(const String& nodeId, const NodeStatusMessage* status, bool keyframe, uint32_t nowMs);
+
+	void forget(const String& nodeId);
+	const Stats& stats() const { return counters; }
+
+private:
+	std::map<String, uint32_t> lastClockMs;
+	Stats counters;
+};
+
+#endif // TELEMETRY_DELTA_H
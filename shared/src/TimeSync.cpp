@@ -0,0 +1,129 @@
+#include "TimeSync.h"
+#include <string.h>
+#include <math.h>
+
+TimeSync::TimeSync() {
+	reset();
+}
+
+void TimeSync::reset() {
+	clearHistory();
+	drift = 0.0f;
+	driftEpochs = 0;
+	memset(&counters, 0, sizeof(counters));
+}
+
+void TimeSync::clearHistory() {
+	count = 0;
+	head = 0;
+	bestRtt = UINT32_MAX;
+	coarse = 0;
+	refMs = 0;
+	base = 0.0f;
+	anchorMs = 0;
+	anchorOffset = 0.0f;
+}
+
+bool TimeSync::addExchange(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4) {
+	// Differences on each clock are wrap-safe; mixing clocks only happens
+	// inside the offset terms
+	int32_t rtt = (int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+	// Millisecond truncation on both clocks can make a fast exchange look
+	// slightly negative
+	if (rtt < -2 || rtt > (int32_t)MAX_RTT_MS) {
+		counters.rejected++;
+		return false;
+	}
+	if (rtt < 0) rtt = 0;
+
+	Sample s;
+	s.localMs = t4;
+	s.oneWay = t2 - t1;
+	s.rtt = (uint32_t)rtt;
+
+	if (count > 0) {
+		float predicted = base + drift * (float)(int32_t)(t4 - refMs);
+		if (fabsf(residual(s) - predicted) > (float)MAX_RTT_MS) {
+			clearHistory();
+			drift = 0.0f;
+			driftEpochs = 0;
+			counters.restarts++;
+		}
+	}
+	if (count == 0) coarse = s.oneWay;
+
+	samples[head] = s;
+	head = (head + 1) % WINDOW;
+	if (count < WINDOW) count++;
+	counters.exchanges++;
+	refit();
+	return true;
+}
+
+float TimeSync::residual(const Sample& s) const {
+	return (float)(int32_t)(s.oneWay - coarse) - s.rtt * 0.5f;
+}
+
+void TimeSync::refit() {
+	bestRtt = UINT32_MAX;
+	for (size_t i = 0; i < count; ++i) {
+		if (samples[i].rtt < bestRtt) bestRtt = samples[i].rtt;
+	}
+
+	// Offset at the newest exchange: mean of the good ones, each carried
+	// forward by the current drift
+	refMs = samples[(head + WINDOW - 1) % WINDOW].localMs;
+	float sum = 0.0f;
+	int used = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (samples[i].rtt > bestRtt + RTT_SLACK_MS) continue;
+		float age = (float)(int32_t)(samples[i].localMs - refMs);
+		sum += residual(samples[i]) - drift * age;
+		used++;
+	}
+	base = sum / used;
+
+	if (count == 1) {
+		anchorMs = refMs;
+		anchorOffset = base;
+		return;
+	}
+	uint32_t span = refMs - anchorMs;
+	if (span < DRIFT_EPOCH_MS) return;
+	float slope = (base - anchorOffset) / (float)span;
+	if (fabsf(slope) * 1e6f <= MAX_DRIFT_PPM) {
+		drift = driftEpochs == 0 ? slope : drift + (slope - drift) * 0.25f;
+		driftEpochs++;
+	}
+	anchorMs = refMs;
+	anchorOffset = base;
+}
+
+int32_t TimeSync::offsetMs(uint32_t localMs) const {
+	if (count == 0) return 0;
+	float age = (float)(int32_t)(localMs - refMs);
+	return (int32_t)(coarse + (uint32_t)(int32_t)lroundf(base + drift * age));
+}
+
+uint32_t TimeSync::toCoordinator(uint32_t localMs) const {
+	return localMs + (uint32_t)offsetMs(localMs);
+}
+
+uint32_t TimeSync::toLocal(uint32_t coordinatorMs) const {
+	// Drift moves the offset by microseconds over the offset itself, so one
+	// refinement from the offset at the last exchange is enough
+	uint32_t guess = coordinatorMs - (uint32_t)offsetMs(refMs);
+	return coordinatorMs - (uint32_t)offsetMs(guess);
+}
+
+uint32_t TimeSync::errorMs(uint32_t localMs) const {
+	if (count == 0) return UINT32_MAX;
+	// Half the slowest round trip averaged in, a millisecond of truncation,
+	// and whatever drift the estimate has not caught since the last exchange
+	float age = fabsf((float)(int32_t)(localMs - refMs));
+	return (bestRtt + RTT_SLACK_MS + 1) / 2 + 1 + (uint32_t)(age * DRIFT_BOUND_PPM * 1e-6f);
+}
+
+bool TimeSync::synced(uint32_t localMs) const {
+	return errorMs(localMs) < TARGET_ERROR_MS;
+}
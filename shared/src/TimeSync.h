@@ -0,0 +1,92 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Node-side estimate of the coordinator clock (the fleet timebase).
+//
+// Every telemetry ack is an NTP-style exchange on traffic that flows anyway:
+//   t1  node millis() when the telemetry was built (its "ts", echoed back)
+//   t2  coordinator millis() when the frame arrived (ack coord_ms - hold_ms)
+//   t3  coordinator millis() when the ack was built (ack coord_ms)
+//   t4  node millis() when the ack arrived
+// offset = ((t2 - t1) + (t3 - t4)) / 2 is exact when both legs take equally
+// long and off by at most rtt / 2 otherwise, rtt = (t4 - t1) - (t3 - t2).
+//
+// Queueing, retries and a busy loop only ever add delay, so the exchanges with
+// the smallest round trip are the trustworthy ones. The offset is taken from
+// the last WINDOW exchanges that came close to the best round trip; drift is
+// the change of that offset over DRIFT_EPOCH_MS, smoothed, and carries the
+// estimate across gaps (lost acks, a node that stops reporting).
+// An offset that jumps by more than MAX_RTT_MS means a clock restarted
+// (coordinator reboot): the history is dropped.
+class TimeSync {
+public:
+	static constexpr size_t WINDOW = 16;
+	static constexpr uint32_t MAX_RTT_MS = 250;      // slower exchanges say nothing useful
+	static constexpr uint32_t RTT_SLACK_MS = 4;      // "close to the best round trip"
+	static constexpr uint32_t DRIFT_EPOCH_MS = 60000;
+	static constexpr float MAX_DRIFT_PPM = 200.0f;   // crystals are +-40, anything more is noise
+	static constexpr float DRIFT_BOUND_PPM = 50.0f;  // assumed residual drift for the error bound
+	static constexpr uint32_t TARGET_ERROR_MS = 10;
+
+	TimeSync();
+
+	// One exchange (all ms, each on its own clock); false if rejected
+	bool addExchange(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+	void reset();
+
+	bool hasEstimate() const { return count > 0; }
+	// Error bound is below TARGET_ERROR_MS at localMs
+	bool synced(uint32_t localMs) const;
+
+	// Coordinator time at local time localMs, and back
+	uint32_t toCoordinator(uint32_t localMs) const;
+	uint32_t toLocal(uint32_t coordinatorMs) const;
+
+	// coordinator - local at localMs
+	int32_t offsetMs(uint32_t localMs) const;
+	// Coordinator clock rate relative to ours, parts per million
+	float driftPpm() const { return drift * 1e6f; }
+	// Worst-case error of toCoordinator() at localMs (UINT32_MAX without an estimate)
+	uint32_t errorMs(uint32_t localMs) const;
+	uint32_t bestRttMs() const { return bestRtt; }
+
+	struct Stats {
+		uint32_t exchanges; // accepted
+		uint32_t rejected;  // negative or over MAX_RTT_MS round trip
+		uint32_t restarts;  // offset jumps that dropped the history
+	};
+	const Stats& stats() const { return counters; }
+
+private:
+	struct Sample {
+		uint32_t localMs; // t4
+		uint32_t oneWay;  // t2 - t1; offset = oneWay - rtt / 2
+		uint32_t rtt;
+	};
+
+	// Offset of s relative to coarse; small, so a float keeps sub-ms precision
+	float residual(const Sample& s) const;
+	void refit();
+	void clearHistory();
+
+	Sample samples[WINDOW];
+	size_t count;
+	size_t head;
+	uint32_t bestRtt;
+	// offset(t) = coarse + base + drift * (t - refMs), drift in ms per ms.
+	// coarse is the first one-way difference after a (re)start, mod 2^32.
+	uint32_t coarse;
+	uint32_t refMs;
+	float base;
+	float drift;
+	// Offset estimate at the start of the current drift epoch
+	uint32_t anchorMs;
+	float anchorOffset;
+	uint32_t driftEpochs;
+	Stats counters;
+};
+
+#endif // TIME_SYNC_H
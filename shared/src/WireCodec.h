@@ -0,0 +1,214 @@
+#ifndef WIRE_CODEC_H
+#define WIRE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+// Packed binary framing for ESP-NOW messages.
+//
+// A binary frame starts with a fixed 4-byte header so it can never be confused
+// with a JSON frame (which always starts with '{'):
+//
+//   [0] MAGIC   0xB7
+//   [1] VERSION wire format version (currently 1)
+//   [2] TYPE    MessageType code
+//   [3] FLAGS   per-frame options: FLAG_SEQ, the rest 0
+//
+// With FLAG_SEQ set the header is followed by the sender's u16 sequence
+// number (see SeqWindow.h); JSON frames carry it as a leading "sq" member.
+// The body follows in field declaration order: integers little-endian with a
+// fixed width, strings as <u8 length><bytes> without terminator, floats as
+// signed centi-units in an int16. Both peers always accept JSON; binary is only
+// sent once the peer has advertised Capabilities::bin_wire at join time.
+namespace WireCodec {
+
+static constexpr uint8_t MAGIC = 0xB7;
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t HEADER_LEN = 4;
+static constexpr uint8_t FLAG_SEQ = 0x01;
+static constexpr size_t SEQ_LEN = 2;       // after a binary header
+static constexpr size_t JSON_SEQ_LEN = 11; // "sq":65535,
+static constexpr size_t MAX_FRAME_LEN = 250;     // ESP-NOW v1 payload limit
+static constexpr size_t MAX_FRAME_LEN_V2 = 1470; // ESP-NOW v2 payload limit
+// Largest message the transport carries: one v2 frame, or v1 fragments
+// reassembled on the far side (see Fragmentation.h)
+static constexpr size_t MAX_MESSAGE_LEN = MAX_FRAME_LEN_V2;
+
+enum class Format : uint8_t {
+	JSON = 0,
+	BINARY = 1
+};
+
+inline bool isBinaryFrame(const uint8_t* data, size_t len) {
+	return data && len >= HEADER_LEN && data[0] == MAGIC;
+}
+
+inline bool isJsonFrame(const uint8_t* data, size_t len) {
+	return data && len > 0 && data[0] == '{';
+}
+
+// Copy an encoded message into out with a sequence number added: after the
+// header of a binary frame, as {"sq":<seq>,...} in a JSON one. The sender does
+// this to the whole message, before any fragmenting. Returns the new length,
+// 0 when the message cannot take one (already numbered, empty, no room).
+inline size_t stampSeq(const uint8_t* msg, size_t len, uint16_t seq, uint8_t* out, size_t cap) {
+	if (isBinaryFrame(msg, len)) {
+		if ((msg[3] & FLAG_SEQ) || len + SEQ_LEN > cap) return 0;
+		memcpy(out, msg, HEADER_LEN);
+		out[3] |= FLAG_SEQ;
+		out[HEADER_LEN] = (uint8_t)(seq & 0xFF);
+		out[HEADER_LEN + 1] = (uint8_t)(seq >> 8);
+		memcpy(out + HEADER_LEN + SEQ_LEN, msg + HEADER_LEN, len - HEADER_LEN);
+		return len + SEQ_LEN;
+	}
+	if (!isJsonFrame(msg, len) || len < 2 || msg[1] == '}') return 0;
+	if (len > 6 && memcmp(msg, "{\"sq\":", 6) == 0) return 0;
+	char member[JSON_SEQ_LEN + 2];
+	size_t n = (size_t)snprintf(member, sizeof(member), "{\"sq\":%u,", (unsigned)seq);
+	if (len - 1 + n > cap) return 0;
+	memcpy(out, member, n);
+	memcpy(out + n, msg + 1, len - 1);
+	return len - 1 + n;
+}
+
+// Sequence number added by stampSeq(); false for messages sent without one
+inline bool readSeq(const uint8_t* msg, size_t len, uint16_t& seq) {
+	if (isBinaryFrame(msg, len)) {
+		if (!(msg[3] & FLAG_SEQ) || len < HEADER_LEN + SEQ_LEN) return false;
+		seq = (uint16_t)(msg[HEADER_LEN] | (msg[HEADER_LEN + 1] << 8));
+		return true;
+	}
+	if (len < 8 || memcmp(msg, "{\"sq\":", 6) != 0) return false;
+	uint32_t v = 0;
+	size_t p = 6;
+	while (p < len && p < 11 && msg[p] >= '0' && msg[p] <= '9') v = v * 10 + (msg[p++] - '0');
+	if (p == 6 || p >= len || msg[p] != ',' || v > 0xFFFF) return false;
+	seq = (uint16_t)v;
+	return true;
+}
+
+// Float -> centi-units as written on the wire (rounded, saturated)
+inline int16_t toCenti(float v) {
+	float scaled = v * 100.0f;
+	if (scaled > 32767.0f) scaled = 32767.0f;
+	if (scaled < -32768.0f) scaled = -32768.0f;
+	return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+// Bounded little-endian writer. Any overflow latches ok() to false so encoders
+// can write unconditionally and check once at the end.
+class Writer {
+public:
+	Writer(uint8_t* buf, size_t cap) : buf_(buf), cap_(cap), pos_(0), ok_(buf != nullptr) {}
+
+	void u8(uint8_t v) {
+		if (!reserve(1)) return;
+		buf_[pos_++] = v;
+	}
+	void u16(uint16_t v) {
+		if (!reserve(2)) return;
+		buf_[pos_++] = (uint8_t)(v & 0xFF);
+		buf_[pos_++] = (uint8_t)(v >> 8);
+	}
+	void u32(uint32_t v) {
+		if (!reserve(4)) return;
+		for (int i = 0; i < 4; ++i) buf_[pos_++] = (uint8_t)(v >> (8 * i));
+	}
+	void i8(int8_t v) { u8((uint8_t)v); }
+	void i16(int16_t v) { u16((uint16_t)v); }
+	void boolean(bool v) { u8(v ? 1 : 0); }
+	// Float as signed hundredths, clamped to the int16 range
+	void centi(float v) { i16(toCenti(v)); }
+	void str(const char* s, size_t len) {
+		if (len > 255) { ok_ = false; return; }
+		if (!reserve(1 + len)) return;
+		buf_[pos_++] = (uint8_t)len;
+		if (len) memcpy(buf_ + pos_, s, len);
+		pos_ += len;
+	}
+	void header(uint8_t type, uint8_t flags = 0) {
+		u8(MAGIC);
+		u8(VERSION);
+		u8(type);
+		u8(flags);
+	}
+
+	bool ok() const { return ok_; }
+	size_t length() const { return ok_ ? pos_ : 0; }
+
+private:
+	bool reserve(size_t n) {
+		if (!ok_ || pos_ + n > cap_) { ok_ = false; return false; }
+		return true;
+	}
+	uint8_t* buf_;
+	size_t cap_;
+	size_t pos_;
+	bool ok_;
+};
+
+// Bounded little-endian reader mirroring Writer. Reads past the end latch
+// ok() to false and yield zeros.
+class Reader {
+public:
+	Reader(const uint8_t* data, size_t len) : data_(data), len_(len), pos_(0), ok_(data != nullptr) {}
+
+	uint8_t u8() {
+		if (!need(1)) return 0;
+		return data_[pos_++];
+	}
+	uint16_t u16() {
+		if (!need(2)) return 0;
+		uint16_t v = (uint16_t)data_[pos_] | ((uint16_t)data_[pos_ + 1] << 8);
+		pos_ += 2;
+		return v;
+	}
+	uint32_t u32() {
+		if (!need(4)) return 0;
+		uint32_t v = 0;
+		for (int i = 0; i < 4; ++i) v |= (uint32_t)data_[pos_ + i] << (8 * i);
+		pos_ += 4;
+		return v;
+	}
+	int8_t i8() { return (int8_t)u8(); }
+	int16_t i16() { return (int16_t)u16(); }
+	bool boolean() { return u8() != 0; }
+	float centi() { return (float)i16() / 100.0f; }
+	// Returns a pointer into the frame (not terminated) and its length
+	const char* str(size_t& outLen) {
+		outLen = 0;
+		size_t n = u8();
+		if (!need(n)) return nullptr;
+		const char* p = (const char*)(data_ + pos_);
+		pos_ += n;
+		outLen = n;
+		return p;
+	}
+	// Validates magic/version and returns the type code and flags
+	bool header(uint8_t& type, uint8_t& flags) {
+		if (u8() != MAGIC || u8() != VERSION) { ok_ = false; return false; }
+		type = u8();
+		flags = u8();
+		if (flags & FLAG_SEQ) u16(); // sequence number: the transport's, not the body's
+		return ok_;
+	}
+
+	bool ok() const { return ok_; }
+	size_t remaining() const { return ok_ ? len_ - pos_ : 0; }
+
+private:
+	bool need(size_t n) {
+		if (!ok_ || pos_ + n > len_) { ok_ = false; return false; }
+		return true;
+	}
+	const uint8_t* data_;
+	size_t len_;
+	size_t pos_;
+	bool ok_;
+};
+
+} // namespace WireCodec
+
+#endif // WIRE_CODEC_H